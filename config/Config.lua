@@ -1,3 +1,22 @@
+-- 全局流水线配置（可省略）
+pipeline = {
+    capture_reactor_shards = 0,  -- 可选：共享epoll采集反应器分片数，0表示每路摄像头独立采集线程
+    dma_heap = "/dev/dma_heap/system",  -- 可选：流水线缓冲区使用的dma-heap，不可用时退化为memfd/匿名内存
+    reactor_placement = { cpus = "little", policy = "other" },  -- 可选：共享采集反应器线程放置，字段同下方placement
+    model = "test",  -- 可选：模型类型，yolov5/test，所有摄像头共用
+    model_path = "../weight/rk3566/yolov5s_relu.rknn",  -- 可选：模型文件路径
+    inference_workers = 2,  -- 可选：所有摄像头共享的推理线程数，不随摄像头数增加
+    model_instances = 2,  -- 可选：所有摄像头共享的模型实例数，模型只加载这么多份
+    inference_placement = { cpus = "big" },  -- 可选：共享推理线程放置；使用共享推理线程时各摄像头placement.inference不生效
+    batch_size = 1,  -- 可选：跨流批量推理一批最多帧数，1不批量；>1时不同摄像头的帧凑批后一次推理（批量编译的模型一次rknn_run），仅infer_interval=1的摄像头参与
+    batch_window_us = 2000,  -- 可选：凑批窗口（微秒），不足一批时最早的帧最多等待这么久，越大批越满、吞吐越高，延迟也越大
+    async_inference = false,  -- 可选：模型异步执行（双缓冲），下一帧预处理、上一帧后处理与当前帧NPU推理重叠；在批处理（batch_size>1）或独立运行的推理线程中生效
+    zero_copy_inference = false,  -- 可选：NPU输入输出零拷贝（rknn_set_io_mem），letterbox直接写入NPU输入内存（dma-heap可用时由其分配），后处理按原生NC1HWC2排布直接读取输出；开启时async_inference不生效
+    trace_path = "/tmp/pipeline_trace.json",  -- 可选：kill -USR1 <pid>时导出最近的分阶段Chrome trace，用chrome://tracing或ui.perfetto.dev打开
+    metrics_port = 9464,  -- 可选：Prometheus指标端点端口（curl http://127.0.0.1:9464/metrics），0表示关闭
+    metrics_bind = "127.0.0.1"  -- 可选：指标端点监听地址，"0.0.0.0"允许远程抓取
+}
+
 -- 摄像头配置列表
 camera_configs = {
     {
@@ -5,7 +24,32 @@ camera_configs = {
         rtmp_url = "rtmp://192.168.3.6/live/stream1",
         width = 640,
         height = 480,
-        fps = 20
+        fps = 20,
+        zero_copy = false,  -- 可选：零拷贝采集，原始帧直接下发由推理线程转换
+        pixel_format = "YUYV",  -- 可选：采集格式，USB摄像头1080p30通常需使用"MJPG"
+        decode_workers = 2,  -- 可选：MJPEG解码线程数
+        source = "v4l2",  -- 可选：帧源类型，v4l2摄像头/file录像回放（device填文件路径）/synthetic合成彩条
+        realtime = true,  -- 可选：file/synthetic按实时节拍出帧，false为尽快出帧（压测整条流水线）
+        loop = true,  -- 可选：file回放结束后从头循环
+        buffer_count = 4,  -- 可选：V4L2缓冲区环深度，越深越能吸收抖动但排队延迟越大
+        queue_depth = 100,  -- 可选：推理输入队列深度
+        memory = "mmap",  -- 可选：采集缓冲区，mmap驱动分配/dmabuf流水线dma-heap分配/userptr流水线普通内存
+        overload_policy = "block",  -- 可选：推理跟不上时的策略，block阻塞不丢帧/drop_oldest丢最旧帧/drop_newest丢新帧/latest只保留最新帧
+        reorder_hold_ms = 200,  -- 可选：推理线程乱序完成时编码前等待缺失帧的最长时间，超时跳过该帧，之后到达的迟到帧丢弃
+        weight = 1,  -- 可选：共享推理时同一优先级内按推理耗时分配的权重，2表示获得两倍的NPU时间
+        priority = 0,  -- 可选：共享推理优先级，高优先级有帧时总是先推理，低优先级只使用剩余算力
+        max_infer_fps = 0,  -- 可选：最大推理帧率，0不限制；超出时逐帧推理模式丢弃该帧，解耦模式只叠加不推理
+        infer_interval = 1,  -- 可选：推理间隔，1每帧推理后推流/N每N帧推理一帧，其余帧立即推流并叠加最近检测结果/0有空闲模型就推理
+        render_detections = true,  -- 可选：检测框画到推流画面上，false时推流原始画面，检测结果只随帧元数据输出
+        -- 可选：各阶段线程放置，cpus为big大核/little小核/all/CPU列表如"4-5"，拓扑读自/sys/devices/system/cpu
+        -- policy为other(可设nice，-20~19)/fifo/rr(可设priority，1~99)，实时策略与负nice需要CAP_SYS_NICE
+        -- capture.isolate=true时解码/推理/编码线程避开采集所用CPU；使用共享反应器时采集线程由reactor_placement决定
+        placement = {
+            capture   = { cpus = "little", policy = "other", isolate = false },
+            decode    = { cpus = "little" },
+            inference = { cpus = "big" },
+            encode    = { cpus = "big", nice = 0 }
+        }
     },
 --     {
 --         device = "/dev/video2",
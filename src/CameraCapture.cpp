@@ -1,16 +1,27 @@
 #include "CameraCapture.h"
+#include "CaptureReactor.h"
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <chrono>
 #include <cstring>
 #include <cerrno>
 #include <iostream>
 #include <system_error>
 
+extern "C" {
+#include <libavutil/imgutils.h>
+}
+
 
+#ifndef MODULE_TEST
 #define MODULE_TEST 0
+#endif
 
 // V4L2操作宏
 #define CLEAR(x) memset(&(x), 0, sizeof(x))
@@ -23,6 +34,34 @@
         _ret; \
     })
 
+// V4L2像素格式到FFmpeg像素格式的映射，压缩格式或不支持的格式返回AV_PIX_FMT_NONE
+static AVPixelFormat v4l2_to_av_format(uint32_t pixel_format) {
+    switch (pixel_format) {
+    case V4L2_PIX_FMT_YUYV:  return AV_PIX_FMT_YUYV422;
+    case V4L2_PIX_FMT_UYVY:  return AV_PIX_FMT_UYVY422;
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_NV12M: return AV_PIX_FMT_NV12;
+    case V4L2_PIX_FMT_NV16:
+    case V4L2_PIX_FMT_NV16M: return AV_PIX_FMT_NV16;
+    case V4L2_PIX_FMT_NV24:  return AV_PIX_FMT_NV24;
+    case V4L2_PIX_FMT_RGB24: return AV_PIX_FMT_RGB24;
+    default:                 return AV_PIX_FMT_NONE;
+    }
+}
+
+CaptureMemory CameraCapture::memory_from_string(const std::string& name) {
+    if (name == "dmabuf") return CaptureMemory::Dmabuf;
+    if (name == "userptr") return CaptureMemory::Userptr;
+    return CaptureMemory::Mmap;
+}
+
+uint32_t CameraCapture::fourcc_from_string(const std::string& name) {
+    if (name.size() != 4) {
+        return 0;
+    }
+    return v4l2_fourcc(name[0], name[1], name[2], name[3]);
+}
+
 CameraCapture::CameraCapture(const std::string& device_path, 
                            uint32_t width, 
                            uint32_t height, 
@@ -32,22 +71,101 @@ CameraCapture::CameraCapture(const std::string& device_path,
       width_(width),
       height_(height),
       fps_(fps),
-      pixel_format_(pixel_format) {}
+      pixel_format_(pixel_format),
+      ring_(std::make_shared<BufferRing>()) {
+    ring_->owner = this;
+}
 
 CameraCapture::~CameraCapture() {
     stop();
-    if (initialized_) {
-        uninit_device();
+    // 在途的零拷贝帧（重排环、批处理队列、编码器中）各持有缓冲区环的引用，
+    // 此处只断开环与本对象的联系，映射由最后释放的帧解除
+    if (ring_->in_flight > 0) {
+        std::cerr << "CameraCapture[" << device_path_ << "]: " << ring_->in_flight
+                  << " frames still in flight, buffers released with the last frame" << std::endl;
     }
+    uninit_device();
     if (fd_ != -1) {
         close(fd_);
         fd_ = -1;
     }
+    if (timer_fd_ != -1) {
+        close(timer_fd_);
+        timer_fd_ = -1;
+    }
 }
 
 bool CameraCapture::initialize() {
     if (initialized_) return true;
+
+    // 普通文件作为模拟设备：文件内容为连续的原始YUYV帧
+    struct stat st;
+    if (stat(device_path_.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+        if (!open_fake_device(st.st_size)) {
+            return false;
+        }
+    } else if (!open_device()) {
+        return false;
+    }
+
+    // 流水线分配缓冲区：DMA-BUF不可用时退化为USERPTR
+    if (memory_mode_ != CaptureMemory::Mmap) {
+        if (!allocator_) {
+            allocator_ = std::make_shared<DmaAllocator>();
+        }
+        ring_->allocator = allocator_;  // 环可能晚于本对象析构，随环保留分配器
+        if (memory_mode_ == CaptureMemory::Dmabuf && !allocator_->is_dmabuf()) {
+            std::cerr << "CameraCapture[" << device_path_ << "]: allocator backend "
+                      << DmaAllocator::backend_name(allocator_->backend())
+                      << " has no DMA-BUF, falling back to USERPTR" << std::endl;
+            memory_mode_ = CaptureMemory::Userptr;
+        }
+    }
+    memory_ = memory_mode_ == CaptureMemory::Dmabuf ? V4L2_MEMORY_DMABUF :
+              (memory_mode_ == CaptureMemory::Userptr ? V4L2_MEMORY_USERPTR : V4L2_MEMORY_MMAP);
     
+    // 初始化缓冲区
+    if (!request_buffers()) {
+        return false;
+    }
+
+    if (pixel_format_ == V4L2_PIX_FMT_MJPEG) {
+        // MJPEG由解码池并行解码，直接解码到帧池
+        av_format_ = AV_PIX_FMT_NONE;
+        decoder_ = std::make_unique<JpegDecodePool>(decode_workers_, frame_pool_);
+        decoder_->set_thread_init(decode_thread_init_);
+        decoder_->set_frame_callback([this](FramePtr frame) {
+            if (frame_callback_) {
+                frame_callback_(std::move(frame));
+            }
+        });
+        initialized_ = true;
+        return true;
+    }
+
+    av_format_ = v4l2_to_av_format(pixel_format_);
+    if (av_format_ == AV_PIX_FMT_NONE) {
+        report_error("Unsupported pixel format");
+        return false;
+    }
+
+    // 采集格式->BGR24
+    rgb_ctx_ = sws_getCachedContext(
+        rgb_ctx_,
+        width_, height_, av_format_,          // 输入：采集格式（默认YUYV）
+        width_, height_, AV_PIX_FMT_RGB24,    // 输出：OpenCV默认的BGR格式（与RGB兼容，通道顺序不同）
+        SWS_BILINEAR, nullptr, nullptr, nullptr
+    );
+    if (!rgb_ctx_) {
+        std::cerr << "Failed to create YUYV→RGB converter" << std::endl;
+        return false;
+    }
+    
+    initialized_ = true;
+    return true;
+}
+
+bool CameraCapture::open_device() {
     // 打开设备
     fd_ = open(device_path_.c_str(), O_RDWR | O_NONBLOCK, 0);
     if (fd_ == -1) {
@@ -61,42 +179,31 @@ bool CameraCapture::initialize() {
         report_error("VIDIOC_QUERYCAP failed");
         return false;
     }
-    //检查设备是否支持视频捕获功能
-    if (!(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE)) {
+    uint32_t caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps : cap.capabilities;
+    //检查设备是否支持视频捕获功能（RK3588 ISP、HDMI-in等节点只提供多平面接口）
+    if (caps & V4L2_CAP_VIDEO_CAPTURE) {
+        buf_type_ = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    } else if (caps & V4L2_CAP_VIDEO_CAPTURE_MPLANE) {
+        buf_type_ = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    } else {
         report_error("Device does not support video capture");
         return false;
     }
     //检查设备是否支持流式 I/O
-    if (!(cap.capabilities & V4L2_CAP_STREAMING)) {
+    if (!(caps & V4L2_CAP_STREAMING)) {
         report_error("Device does not support streaming I/O");
         return false;
     }
     
     // 设置格式
-    v4l2_format fmt;
-    CLEAR(fmt);
-    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;//设置缓冲区类型为视频捕获
-    fmt.fmt.pix.width = width_;
-    fmt.fmt.pix.height = height_;
-    fmt.fmt.pix.pixelformat = pixel_format_;
-    fmt.fmt.pix.field = V4L2_FIELD_ANY;//设置场模式为任意模式
-    
-    if (IOCTL_RETRY(fd_, VIDIOC_S_FMT, &fmt) == -1) {
-        report_error("Failed to set video format");
+    if (!set_format()) {
         return false;
     }
-    // 检查实际设置
-    if (fmt.fmt.pix.width != width_ || fmt.fmt.pix.height != height_ || 
-        fmt.fmt.pix.pixelformat != pixel_format_) {
-            report_error("Device does not support requested format");
-            return false;
-        }
-    stride_ = fmt.fmt.pix.bytesperline;
     
     // 设置帧率
     v4l2_streamparm parm;
     CLEAR(parm);
-    parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    parm.type = buf_type_;
     parm.parm.capture.timeperframe.numerator = 1;
     parm.parm.capture.timeperframe.denominator = fps_;
     
@@ -104,25 +211,93 @@ bool CameraCapture::initialize() {
         report_error("Failed to set frame rate");
         return false;
     }
+    return true;
+}
+
+bool CameraCapture::set_format() {
+    v4l2_format fmt;
+    CLEAR(fmt);
+    fmt.type = buf_type_;//设置缓冲区类型为视频捕获
+    if (is_mplane()) {
+        fmt.fmt.pix_mp.width = width_;
+        fmt.fmt.pix_mp.height = height_;
+        fmt.fmt.pix_mp.pixelformat = pixel_format_;
+        fmt.fmt.pix_mp.field = V4L2_FIELD_ANY;
+    } else {
+        fmt.fmt.pix.width = width_;
+        fmt.fmt.pix.height = height_;
+        fmt.fmt.pix.pixelformat = pixel_format_;
+        fmt.fmt.pix.field = V4L2_FIELD_ANY;//设置场模式为任意模式
+    }
     
-    // 初始化缓冲区
-    if (!request_buffers()) {
+    if (IOCTL_RETRY(fd_, VIDIOC_S_FMT, &fmt) == -1) {
+        report_error("Failed to set video format");
         return false;
     }
 
-    // YUYV->BGR24
-    rgb_ctx_ = sws_getCachedContext(
-        rgb_ctx_,
-        width_, height_, AV_PIX_FMT_YUYV422,  // 输入：YUYV格式
-        width_, height_, AV_PIX_FMT_RGB24,    // 输出：OpenCV默认的BGR格式（与RGB兼容，通道顺序不同）
-        SWS_BILINEAR, nullptr, nullptr, nullptr
-    );
-    if (!rgb_ctx_) {
-        std::cerr << "Failed to create YUYV→RGB converter" << std::endl;
+    // 检查实际设置
+    uint32_t width = is_mplane() ? fmt.fmt.pix_mp.width : fmt.fmt.pix.width;
+    uint32_t height = is_mplane() ? fmt.fmt.pix_mp.height : fmt.fmt.pix.height;
+    uint32_t pixel_format = is_mplane() ? fmt.fmt.pix_mp.pixelformat : fmt.fmt.pix.pixelformat;
+    if (width != width_ || height != height_ || pixel_format != pixel_format_) {
+        report_error("Device does not support requested format");
+        return false;
+    }
+
+    // 保存各平面步长（驱动可能按硬件要求对行宽做对齐）
+    if (is_mplane()) {
+        num_planes_ = fmt.fmt.pix_mp.num_planes;
+        if (num_planes_ < 1 || num_planes_ > VIDEO_MAX_PLANES) {
+            report_error("Invalid plane count");
+            return false;
+        }
+        for (uint32_t i = 0; i < num_planes_; ++i) {
+            bytesperline_[i] = fmt.fmt.pix_mp.plane_fmt[i].bytesperline;
+            sizeimage_[i] = fmt.fmt.pix_mp.plane_fmt[i].sizeimage;
+        }
+    } else {
+        num_planes_ = 1;
+        bytesperline_[0] = fmt.fmt.pix.bytesperline;
+        sizeimage_[0] = fmt.fmt.pix.sizeimage;
+    }
+    return true;
+}
+
+bool CameraCapture::open_fake_device(off_t file_size) {
+    if (pixel_format_ != V4L2_PIX_FMT_YUYV) {
+        report_error("Fake device only supports YUYV");
+        return false;
+    }
+    fd_ = open(device_path_.c_str(), O_RDONLY, 0);
+    if (fd_ == -1) {
+        report_error("Failed to open fake device: " + device_path_);
+        return false;
+    }
+    fake_device_ = true;
+    num_planes_ = 1;
+    bytesperline_[0] = width_ * 2;
+    fake_frame_size_ = static_cast<size_t>(bytesperline_[0]) * height_;
+    sizeimage_[0] = fake_frame_size_;
+    fake_frame_count_ = file_size / fake_frame_size_;
+    if (fake_frame_count_ == 0) {
+        report_error("Fake device file smaller than one frame");
+        return false;
+    }
+
+    // 用timerfd按帧率产生可读事件，模拟设备与真实设备一样可被select/epoll等待
+    timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd_ == -1) {
+        report_error("timerfd_create failed");
+        return false;
+    }
+    itimerspec period;
+    CLEAR(period);
+    period.it_interval.tv_nsec = 1000000000L / (fps_ ? fps_ : 30);
+    period.it_value = period.it_interval;
+    if (timerfd_settime(timer_fd_, 0, &period, nullptr) == -1) {
+        report_error("timerfd_settime failed");
         return false;
     }
-    
-    initialized_ = true;
     return true;
 }
 
@@ -136,12 +311,28 @@ void CameraCapture::start() {
     if (running_) return;
     
     // 开始流
-    if (!start_streaming()) {
+    if (!fake_device_ && !start_streaming()) {
         report_error("Failed to start streaming");
         return;
     }
     
+    if (decoder_ && !decoder_->start()) {
+        report_error("Failed to start MJPEG decoder");
+        if (!fake_device_) {
+            stop_streaming();
+        }
+        return;
+    }
+    
     running_ = true;
+    if (reactor_) {
+        // 由共享反应器分发，不再创建独立采集线程
+        if (!reactor_->add(this)) {
+            report_error("Failed to register with capture reactor");
+            running_ = false;
+        }
+        return;
+    }
     capture_thread_ = std::make_unique<std::thread>(&CameraCapture::capture_thread, this);
 }
 
@@ -149,37 +340,48 @@ void CameraCapture::stop() {
     if (!running_) return;
     
     running_ = false;
+    if (reactor_) {
+        reactor_->remove(this);
+    }
     if (capture_thread_ && capture_thread_->joinable()) {
         capture_thread_->join();
     }
     capture_thread_.reset();
     
-    stop_streaming();
-}
-
-void CameraCapture::set_frame_callback(const FrameCallback &callback) {
-    frame_callback_ = callback;
-}
-
-void CameraCapture::set_frame_callback(FrameCallback &&callback) {
-    frame_callback_ = std::move(callback);
+    if (decoder_) {
+        decoder_->stop();
+    }
+    
+    if (!fake_device_) {
+        stop_streaming();
+    }
 }
 
 void CameraCapture::capture_thread() {
+    run_thread_init();
     while (running_) {
-        AVFrame* rgb_frame = nullptr;
-        rgb_frame = get_frame();
-        if (rgb_frame) {
-            if (frame_callback_) {
-                frame_callback_(rgb_frame);
-            }
-        } else {
+        if (!wait_readable() || !process_ready_buffer()) {
             // 短暂休眠后重试
             std::this_thread::sleep_for(std::chrono::milliseconds(5));
         }
     }
 }
 
+bool CameraCapture::process_ready_buffer() {
+    if (decoder_) {
+        // MJPEG：采集线程只出队并提交压缩帧，解码由解码池完成
+        return submit_compressed_frame();
+    }
+    FramePtr rgb_frame = get_frame();
+    if (!rgb_frame) {
+        return false;
+    }
+    if (frame_callback_) {
+        frame_callback_(std::move(rgb_frame));
+    }
+    return true;
+}
+
 bool CameraCapture::init_device() {
     // 请求缓冲区
     if (!request_buffers()) {
@@ -188,20 +390,41 @@ bool CameraCapture::init_device() {
     return true;
 }
 
-void CameraCapture::uninit_device() {
+CameraCapture::BufferRing::~BufferRing() {
     // 解除内存映射
-    for (auto& buffer : buffers_) {
-        if (buffer.start) {
-            munmap(buffer.start, buffer.length);
-            buffer.start = nullptr;
-            buffer.length = 0;
-        }
-        if (buffer.dma_fd != -1) {
-            close(buffer.dma_fd);
-            buffer.dma_fd = -1;
+    for (auto& buffer : buffers) {
+        for (uint32_t p = 0; p < buffer.num_planes; ++p) {
+            Plane& plane = buffer.planes[p];
+            if (plane.owned.data) {
+                // 分配器分配的内存（dma_fd即其fd）由分配器释放
+                allocator->release(plane.owned);
+                plane.start = nullptr;
+                plane.length = 0;
+                plane.dma_fd = -1;
+                continue;
+            }
+            if (plane.start) {
+                munmap(plane.start, plane.length);
+                plane.start = nullptr;
+                plane.length = 0;
+            }
+            if (plane.dma_fd != -1) {
+                close(plane.dma_fd);
+                plane.dma_fd = -1;
+            }
         }
+        buffer.num_planes = 0;
     }
-    buffers_.clear();
+}
+
+void CameraCapture::uninit_device() {
+    {
+        // 之后释放的在途帧不再归还驱动队列；没有在途帧时环在此析构并解除映射
+        std::lock_guard<std::mutex> lock(ring_->mutex);
+        ring_->owner = nullptr;
+    }
+    ring_.reset();
+    fake_free_.clear();
     
     if (rgb_ctx_) {
         sws_freeContext(rgb_ctx_);
@@ -213,13 +436,25 @@ bool CameraCapture::request_buffers() {
     // 请求缓冲区
     v4l2_requestbuffers req;
     CLEAR(req);
-    req.count = 4;  // 请求4个缓冲区
-    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    req.memory = V4L2_MEMORY_MMAP;
-    //请求缓冲区
-    if (IOCTL_RETRY(fd_, VIDIOC_REQBUFS, &req) == -1) {
-        report_error("VIDIOC_REQBUFS failed");
-        return false;
+    req.count = buffer_count_;
+    req.type = buf_type_;
+    req.memory = memory_;
+    //请求缓冲区（模拟设备直接使用请求数量）
+    if (!fake_device_ && IOCTL_RETRY(fd_, VIDIOC_REQBUFS, &req) == -1) {
+        if (memory_ == V4L2_MEMORY_MMAP) {
+            report_error("VIDIOC_REQBUFS failed");
+            return false;
+        }
+        // 设备不支持DMABUF/USERPTR导入时退回驱动分配的mmap缓冲区
+        report_error("VIDIOC_REQBUFS with pipeline buffers failed, falling back to MMAP");
+        memory_mode_ = CaptureMemory::Mmap;
+        memory_ = V4L2_MEMORY_MMAP;
+        req.memory = memory_;
+        req.count = buffer_count_;
+        if (IOCTL_RETRY(fd_, VIDIOC_REQBUFS, &req) == -1) {
+            report_error("VIDIOC_REQBUFS failed");
+            return false;
+        }
     }
     
     if (req.count < 2) {
@@ -227,59 +462,167 @@ bool CameraCapture::request_buffers() {
         return false;
     }
     
-    buffers_.resize(req.count);
+    std::lock_guard<std::mutex> lock(ring_->mutex);
+    ring_->buffers.resize(req.count);
     
     // 映射缓冲区
-    for (size_t i = 0; i < buffers_.size(); ++i) {
-        v4l2_buffer buf;
-        CLEAR(buf);
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        buf.index = i;
-        
-        if (IOCTL_RETRY(fd_, VIDIOC_QUERYBUF, &buf) == -1) {
-            report_error("VIDIOC_QUERYBUF failed");
+    for (size_t i = 0; i < ring_->buffers.size(); ++i) {
+        if (!map_buffer(i)) {
             return false;
         }
+    }
+    
+    // 将缓冲区加入队列
+    for (size_t i = 0; i < ring_->buffers.size(); ++i) {
+        if (!queue_buffer(i)) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool CameraCapture::map_buffer(uint32_t index) {
+    Buffer& buffer = ring_->buffers[index];
+    for (Plane& plane : buffer.planes) {
+        plane.start = nullptr;
+        plane.length = 0;
+        plane.dma_fd = -1;
+        plane.owned = DmaBuffer();
+    }
+    buffer.num_planes = 0;
+    buffer.index = index;
+
+    if (memory_ != V4L2_MEMORY_MMAP) {
+        return allocate_planes(buffer);
+    }
+
+    if (fake_device_) {
+        void* start = mmap(nullptr, fake_frame_size_,
+                           PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (start == MAP_FAILED) {
+            report_error("mmap failed");
+            return false;
+        }
+        buffer.planes[0].start = start;
+        buffer.planes[0].length = fake_frame_size_;
+        buffer.num_planes = 1;
+        return true;
+    }
+
+    v4l2_buffer buf;
+    v4l2_plane planes[VIDEO_MAX_PLANES];
+    CLEAR(buf);
+    CLEAR(planes);
+    buf.type = buf_type_;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = index;
+    if (is_mplane()) {
+        buf.m.planes = planes;
+        buf.length = num_planes_;
+    }
+    
+    if (IOCTL_RETRY(fd_, VIDIOC_QUERYBUF, &buf) == -1) {
+        report_error("VIDIOC_QUERYBUF failed");
+        return false;
+    }
+    
+    //将缓冲区映射到内存中（多平面格式逐平面映射）
+    for (uint32_t p = 0; p < num_planes_; ++p) {
+        size_t length = is_mplane() ? planes[p].length : buf.length;
+        off_t offset = is_mplane() ? planes[p].m.mem_offset : buf.m.offset;
+        void* start = mmap(nullptr, length, 
+                           PROT_READ | PROT_WRITE, 
+                           MAP_SHARED, 
+                           fd_, offset);
         
-        buffers_[i].length = buf.length;
-        //将缓冲区映射到内存中
-        buffers_[i].start = mmap(nullptr, buf.length, 
-                                PROT_READ | PROT_WRITE, 
-                                MAP_SHARED, 
-                                fd_, buf.m.offset);
-        
-        if (buffers_[i].start == MAP_FAILED) {
+        if (start == MAP_FAILED) {
             report_error("mmap failed");
             return false;
         }
+        buffer.planes[p].start = start;
+        buffer.planes[p].length = length;
+        buffer.num_planes = p + 1;
         
         // 导出DMA-BUF
-        buffers_[i].dma_fd = export_dma_buf(i);
-        if (buffers_[i].dma_fd == -1) {
+        buffer.planes[p].dma_fd = export_dma_buf(index, p);
+        if (buffer.planes[p].dma_fd == -1) {
             report_error("Failed to export DMA-BUF");
         }
     }
-    
-    // 将缓冲区加入队列
-    for (size_t i = 0; i < buffers_.size(); ++i) {
-        v4l2_buffer buf;
-        CLEAR(buf);
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-        buf.index = i;
-        
-        if (IOCTL_RETRY(fd_, VIDIOC_QBUF, &buf) == -1) {
-            report_error("VIDIOC_QBUF failed");
+    return true;
+}
+
+bool CameraCapture::allocate_planes(Buffer& buffer) {
+    for (uint32_t p = 0; p < num_planes_; ++p) {
+        Plane& plane = buffer.planes[p];
+        if (!allocator_->allocate(sizeimage_[p], plane.owned)) {
+            report_error("Failed to allocate pipeline buffer");
             return false;
         }
+        plane.start = plane.owned.data;
+        plane.length = sizeimage_[p];  // 驱动按格式大小校验，不使用页对齐后的大小
+        plane.dma_fd = plane.owned.fd;
+        buffer.num_planes = p + 1;
     }
-    
     return true;
 }
 
+void CameraCapture::begin_cpu_access(const Buffer& buffer) const {
+    if (memory_ != V4L2_MEMORY_DMABUF) {
+        return;
+    }
+    for (uint32_t p = 0; p < buffer.num_planes; ++p) {
+        DmaAllocator::begin_cpu_access(buffer.planes[p].dma_fd);
+    }
+}
+
+bool CameraCapture::grow_buffers() {
+    if (buffer_count() >= kMaxBuffers) {
+        return false;
+    }
+
+    uint32_t index = 0;
+    if (fake_device_) {
+        index = buffer_count();
+    } else {
+        // 流运行期间追加缓冲区，格式沿用当前设置
+        v4l2_create_buffers create;
+        CLEAR(create);
+        create.count = 1;
+        create.memory = memory_;
+        create.format.type = buf_type_;
+        if (IOCTL_RETRY(fd_, VIDIOC_G_FMT, &create.format) == -1) {
+            report_error("VIDIOC_G_FMT failed");
+            return false;
+        }
+        if (IOCTL_RETRY(fd_, VIDIOC_CREATE_BUFS, &create) == -1 || create.count < 1) {
+            report_error("VIDIOC_CREATE_BUFS failed");
+            return false;
+        }
+        index = create.index;
+    }
+
+    std::lock_guard<std::mutex> lock(ring_->mutex);
+    if (index != ring_->buffers.size()) {
+        report_error("Unexpected buffer index from VIDIOC_CREATE_BUFS");
+        return false;
+    }
+    ring_->buffers.resize(index + 1);
+    if (!map_buffer(index)) {
+        return false;
+    }
+    return queue_buffer(index);
+}
+
+size_t CameraCapture::buffer_count() const {
+    std::lock_guard<std::mutex> lock(ring_->mutex);
+    return ring_->buffers.size();
+}
+
 bool CameraCapture::start_streaming() {
-    v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    v4l2_buf_type type = buf_type_;
     if (IOCTL_RETRY(fd_, VIDIOC_STREAMON, &type) == -1) {
         report_error("VIDIOC_STREAMON failed");
         return false;
@@ -288,7 +631,7 @@ bool CameraCapture::start_streaming() {
 }
 
 bool CameraCapture::stop_streaming() {
-    v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    v4l2_buf_type type = buf_type_;
     if (IOCTL_RETRY(fd_, VIDIOC_STREAMOFF, &type) == -1) {
         report_error("VIDIOC_STREAMOFF failed");
         return false;
@@ -296,78 +639,318 @@ bool CameraCapture::stop_streaming() {
     return true;
 }
 
-AVFrame* CameraCapture::get_frame() {
+bool CameraCapture::wait_readable() {
+    int fd = poll_fd();
     fd_set fds;
     FD_ZERO(&fds);
-    FD_SET(fd_, &fds);
+    FD_SET(fd, &fds);
     
     struct timeval tv;
     tv.tv_sec = 2;  // 2秒超时
     tv.tv_usec = 0;
     
-    int r = select(fd_ + 1, &fds, nullptr, nullptr, &tv);
+    int r = select(fd + 1, &fds, nullptr, nullptr, &tv);
     if (r == -1) {
         if (errno == EINTR) PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP;  // 中断，重试
         report_error("select failed");
-        return nullptr;
+        return false;
     }
     
     if (r == 0) {
         report_error("Capture timeout");
-        return nullptr;
+        return false;
     }
-    
-    v4l2_buffer buf;
+    return true;
+}
+
+bool CameraCapture::dequeue_ready(v4l2_buffer& buf) {
+    if (fake_device_) {
+        // 模拟设备：消费定时器到期事件，到期一次出一帧
+        uint64_t expirations = 0;
+        if (read(timer_fd_, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+            return false;
+        }
+    }
+
     CLEAR(buf);
-    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buf.memory = V4L2_MEMORY_MMAP;
+    buf.type = buf_type_;
+    buf.memory = memory_;
+    if (is_mplane()) {
+        // 平面信息数组只在采集线程中使用
+        CLEAR(dequeue_planes_);
+        buf.m.planes = dequeue_planes_;
+        buf.length = num_planes_;
+    }
     
-    if (IOCTL_RETRY(fd_, VIDIOC_DQBUF, &buf) == -1) {
-        if (errno == EAGAIN) return nullptr;  // 非阻塞模式，无数据
+    if (!dequeue_buffer(buf)) {
+        if (errno == EAGAIN) return false;  // 非阻塞模式，无数据
         report_error("VIDIOC_DQBUF failed");
-        return nullptr;
+        return false;
     }
     
-    if (buf.index >= buffers_.size()) {
+    // 缓冲区只在采集线程中扩充，此处读取无需加锁
+    if (buf.index >= ring_->buffers.size()) {
         report_error("Invalid buffer index");
+        return false;
+    }
+    begin_cpu_access(ring_->buffers[buf.index]);
+
+    // 驱动帧序号不连续说明驱动因没有空闲缓冲区而丢帧
+    if (frames_captured_ > 0 && buf.sequence > last_sequence_ + 1) {
+        driver_dropped_ += buf.sequence - last_sequence_ - 1;
+    }
+    last_sequence_ = buf.sequence;
+    frames_captured_++;
+    return true;
+}
+
+int64_t CameraCapture::capture_time_ns(const v4l2_buffer& buf) const {
+    // 驱动使用单调时钟打时间戳时直接使用，否则以出队时刻近似
+    if ((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+        return buf.timestamp.tv_sec * 1000000000LL + buf.timestamp.tv_usec * 1000LL;
+    }
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+FrameMeta CameraCapture::make_meta(const v4l2_buffer& buf) const {
+    FrameMeta meta;
+    meta.capture_ns = capture_time_ns(buf);
+    meta.sequence = buf.sequence;
+    meta.camera_id = camera_id_;
+    meta.set_stage(FrameStage::SourceOut, LatencyHistogram::now_ns());
+    return meta;
+}
+
+void CameraCapture::stamp_frame(AVFrame* frame, const v4l2_buffer& buf, int dma_fd) const {
+    FrameMeta meta = make_meta(buf);
+    meta.dma_fd = dma_fd;
+    set_frame_meta(frame, meta);
+    frame->pts = meta.capture_ns / 1000;  // 流水线中按采集时间（微秒）排序
+}
+
+FramePtr CameraCapture::get_frame() {
+    v4l2_buffer buf;
+    if (!dequeue_ready(buf)) {
         return nullptr;
     }
+
+    if (zero_copy_) {
+        return wrap_buffer(buf);
+    }
     
-    // 填充帧数据
-    AVFrame* rgb_frame = nullptr;
-    rgb_frame = av_frame_alloc();
-                rgb_frame->format = AV_PIX_FMT_RGB24;
-                rgb_frame->width = width_;
-                rgb_frame->height = height_;
-    if (av_frame_get_buffer(rgb_frame, 32) < 0)
+    // 填充帧数据（优先从帧池获取缓冲区）
+    FramePtr rgb_frame;
+    if (frame_pool_) {
+        rgb_frame = frame_pool_->acquire();
+    } else {
+        rgb_frame = make_frame_ptr(av_frame_alloc());
+        rgb_frame->format = AV_PIX_FMT_RGB24;
+        rgb_frame->width = width_;
+        rgb_frame->height = height_;
+        if (av_frame_get_buffer(rgb_frame.get(), 32) < 0) {
+            rgb_frame.reset();
+        }
+    }
+    if (!rgb_frame)
     {
         std::cerr << "av_frame_get_buffer failed!!";
-        av_frame_free(&rgb_frame);
+        return_buffer_to_queue(buf.index);
         return nullptr;
     }
     
-    uint8_t* src_data[1] = {static_cast<uint8_t*>(buffers_[buf.index].start)};
-    int src_linesize[1] = {static_cast<int>(stride_)};
+    uint8_t* src_data[4];
+    int src_linesize[4];
+    fill_planes(ring_->buffers[buf.index], src_data, src_linesize);
     sws_scale(rgb_ctx_, 
                 src_data, src_linesize, 
                 0, height_,
                 rgb_frame->data, rgb_frame->linesize);
-    rgb_frame->pts = pts_++;
+    stamp_frame(rgb_frame.get(), buf);
     return_buffer_to_queue(buf.index);
     
     return rgb_frame;
 }
 
-bool CameraCapture::return_buffer_to_queue(int index) {
-    if (index < 0 || static_cast<size_t>(index) >= buffers_.size()) {
+AVBufferRef* CameraCapture::wrap_buffer_ref(uint32_t index) {
+    Buffer& buffer = ring_->buffers[index];
+    // 引用计数归零时由release_buffer把缓冲区归还驱动（多平面时引用覆盖整个缓冲区的所有平面）
+    // 在途期间缓冲区持有环的引用，本对象先析构时环随最后一个在途帧释放
+    buffer.ring = ring_;
+    AVBufferRef* ref = av_buffer_create(static_cast<uint8_t*>(buffer.planes[0].start), buffer.planes[0].length,
+                                        &CameraCapture::release_buffer, &buffer, 0);
+    if (!ref) {
+        buffer.ring.reset();
+        return_buffer_to_queue(index);
+        return nullptr;
+    }
+    ring_->in_flight++;
+
+    // 在途帧占用过多缓冲区时扩充，保证驱动队列中始终有空闲缓冲区
+    if (buffer_count() - ring_->in_flight < kMinQueuedBuffers) {
+        grow_buffers();
+    }
+    return ref;
+}
+
+FramePtr CameraCapture::wrap_buffer(const v4l2_buffer& buf) {
+    uint32_t index = buf.index;
+    AVBufferRef* ref = wrap_buffer_ref(index);
+    if (!ref) {
+        return nullptr;
+    }
+    AVFrame* frame = av_frame_alloc();
+    if (!frame) {
+        av_buffer_unref(&ref);
+        return nullptr;
+    }
+
+    frame->buf[0] = ref;
+    fill_planes(ring_->buffers[index], frame->data, frame->linesize);
+    frame->format = av_format_;
+    frame->width = width_;
+    frame->height = height_;
+    // 帧直接引用采集缓冲区，下游（如NPU）可通过元数据中的DMA-BUF fd导入同一块内存
+    stamp_frame(frame, buf, ring_->buffers[index].planes[0].dma_fd);
+    return make_frame_ptr(frame);
+}
+
+bool CameraCapture::submit_compressed_frame() {
+    v4l2_buffer buf;
+    if (!dequeue_ready(buf)) {
         return false;
     }
-    
+
+    // 压缩帧同样零拷贝提交，解码完成释放packet时缓冲区归还驱动
+    AVBufferRef* ref = wrap_buffer_ref(buf.index);
+    if (!ref) {
+        return false;
+    }
+    AVPacket* packet = av_packet_alloc();
+    if (!packet) {
+        av_buffer_unref(&ref);
+        return false;
+    }
+    packet->buf = ref;
+    packet->data = ref->data;
+    packet->size = is_mplane() ? buf.m.planes[0].bytesused : buf.bytesused;
+    // 元数据随压缩帧传递，解码后转挂到输出帧
+    FrameMeta meta = make_meta(buf);
+    packet->opaque_ref = make_frame_meta_ref(meta);
+    packet->pts = meta.capture_ns / 1000;
+    decoder_->submit(packet);  // 解码队列满时丢帧
+    return true;
+}
+
+void CameraCapture::fill_planes(const Buffer& buffer, uint8_t* data[4], int linesize[4]) const {
+    int linesizes[4] = {0, 0, 0, 0};
+    for (uint32_t i = 0; i < num_planes_ && i < 4; ++i) {
+        linesizes[i] = static_cast<int>(bytesperline_[i]);
+    }
+    // 单内存平面的NV12/NV16/NV24：UV平面紧随Y平面，bytesperline只描述Y平面
+    if (num_planes_ == 1) {
+        if (av_format_ == AV_PIX_FMT_NV12 || av_format_ == AV_PIX_FMT_NV16) {
+            linesizes[1] = linesizes[0];
+        } else if (av_format_ == AV_PIX_FMT_NV24) {
+            linesizes[1] = linesizes[0] * 2;
+        }
+    }
+    av_image_fill_pointers(data, av_format_, height_,
+                           static_cast<uint8_t*>(buffer.planes[0].start), linesizes);
+    // 多内存平面（NV12M/NV16M）：各平面位于独立的mmap区域，直接引用，不做重排
+    for (uint32_t i = 1; i < buffer.num_planes && i < 4; ++i) {
+        data[i] = static_cast<uint8_t*>(buffer.planes[i].start);
+    }
+    for (int i = 0; i < 4; ++i) {
+        linesize[i] = linesizes[i];
+    }
+}
+
+void CameraCapture::release_buffer(void* opaque, uint8_t* data) {
+    Buffer* buffer = static_cast<Buffer*>(opaque);
+    // 先取出环的引用：采集对象已析构时这可能是最后一个引用，离开作用域时解除全部映射
+    std::shared_ptr<BufferRing> ring = std::move(buffer->ring);
+    std::lock_guard<std::mutex> lock(ring->mutex);
+    if (ring->owner) {
+        ring->owner->queue_buffer(buffer->index);
+    }
+    ring->in_flight--;
+}
+
+bool CameraCapture::dequeue_buffer(v4l2_buffer& buf) {
+    if (!fake_device_) {
+        return IOCTL_RETRY(fd_, VIDIOC_DQBUF, &buf) != -1;
+    }
+
+    std::lock_guard<std::mutex> lock(ring_->mutex);
+    if (fake_free_.empty()) {
+        // 与真实驱动一致：没有空闲缓冲区时该帧丢失，序号照常递增
+        fake_sequence_++;
+        errno = EAGAIN;
+        return false;
+    }
+    uint32_t index = fake_free_.front();
+    fake_free_.pop_front();
+
+    off_t offset = static_cast<off_t>((fake_sequence_ % fake_frame_count_) * fake_frame_size_);
+    if (pread(fd_, ring_->buffers[index].planes[0].start, fake_frame_size_, offset) != static_cast<ssize_t>(fake_frame_size_)) {
+        fake_free_.push_back(index);
+        return false;
+    }
+
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    buf.index = index;
+    buf.bytesused = fake_frame_size_;
+    buf.sequence = fake_sequence_++;
+    buf.timestamp.tv_sec = ts.tv_sec;
+    buf.timestamp.tv_usec = ts.tv_nsec / 1000;
+    buf.flags = V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
+    return true;
+}
+
+bool CameraCapture::queue_buffer(uint32_t index) {
+    if (fake_device_) {
+        fake_free_.push_back(index);
+        return true;
+    }
+
     v4l2_buffer buf;
+    v4l2_plane planes[VIDEO_MAX_PLANES];
     CLEAR(buf);
-    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buf.memory = V4L2_MEMORY_MMAP;
+    CLEAR(planes);
+    buf.type = buf_type_;
+    buf.memory = memory_;
     buf.index = index;
+    if (is_mplane()) {
+        buf.m.planes = planes;
+        buf.length = num_planes_;
+    }
+
+    // 流水线分配的缓冲区每次入队都需告知驱动内存位置
+    const Buffer& buffer = ring_->buffers[index];
+    for (uint32_t p = 0; memory_ != V4L2_MEMORY_MMAP && p < buffer.num_planes; ++p) {
+        const Plane& plane = buffer.planes[p];
+        if (memory_ == V4L2_MEMORY_DMABUF) {
+            DmaAllocator::end_cpu_access(plane.dma_fd);
+        }
+        if (is_mplane()) {
+            planes[p].length = plane.length;
+            if (memory_ == V4L2_MEMORY_DMABUF) {
+                planes[p].m.fd = plane.dma_fd;
+            } else {
+                planes[p].m.userptr = reinterpret_cast<unsigned long>(plane.start);
+            }
+        } else {
+            buf.length = plane.length;
+            if (memory_ == V4L2_MEMORY_DMABUF) {
+                buf.m.fd = plane.dma_fd;
+            } else {
+                buf.m.userptr = reinterpret_cast<unsigned long>(plane.start);
+            }
+        }
+    }
     
     if (IOCTL_RETRY(fd_, VIDIOC_QBUF, &buf) == -1) {
         report_error("VIDIOC_QBUF failed");
@@ -377,11 +960,21 @@ bool CameraCapture::return_buffer_to_queue(int index) {
     return true;
 }
 
-int CameraCapture::export_dma_buf(int index) {
+bool CameraCapture::return_buffer_to_queue(int index) {
+    std::lock_guard<std::mutex> lock(ring_->mutex);
+    if (index < 0 || static_cast<size_t>(index) >= ring_->buffers.size()) {
+        return false;
+    }
+    
+    return queue_buffer(index);
+}
+
+int CameraCapture::export_dma_buf(int index, uint32_t plane) {
     v4l2_exportbuffer expbuf;
     CLEAR(expbuf);
-    expbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    expbuf.type = buf_type_;
     expbuf.index = index;
+    expbuf.plane = plane;
     expbuf.flags = O_CLOEXEC | O_RDWR;
     
     if (IOCTL_RETRY(fd_, VIDIOC_EXPBUF, &expbuf) == -1) {
@@ -401,26 +994,26 @@ void CameraCapture::report_error(const std::string& message) {
 
 
 #if  0
-//g++ -o test_video_capture CameraCapture.cpp -lpthread -lavformat -lavutil -lswscale
+//g++ -o test_video_capture CameraCapture.cpp FramePool.cpp JpegDecodePool.cpp -lpthread -lavformat -lavcodec -lavutil -lswscale
 #include <iostream>
 int main() {
     // 创建摄像头实例
     CameraCapture cam1("/dev/video0", 640, 480, 30);
     cam1.set_camera_id(0);
-    cam1.set_frame_callback([](const AVFrame* frame) {
+    cam1.set_frame_callback([](FramePtr frame) {
             // 将原始帧放入预处理队列
             std::cout << "frame from video0 read" << std::endl;
             if(frame)
-                std::cout << frame << std::endl;
+                std::cout << frame.get() << std::endl;
         });
     
     CameraCapture cam2("/dev/video2", 640, 480, 30);
     cam2.set_camera_id(1);
-    cam2.set_frame_callback([](const AVFrame* frame) {
+    cam2.set_frame_callback([](FramePtr frame) {
             // 将原始帧放入预处理队列
             std::cout << "frame from video2 read" << std::endl;
             if(frame)
-                std::cout << frame << std::endl;
+                std::cout << frame.get() << std::endl;
         });
     
     // 初始化并启动
@@ -438,4 +1031,84 @@ int main() {
     
     return 0;
 }
-#endif
\ No newline at end of file
+#endif
+
+#if MODULE_TEST
+//g++ -c CaptureReactor.cpp DmaAllocator.cpp FramePool.cpp JpegDecodePool.cpp && g++ -DMODULE_TEST=1 -o test_zero_copy CameraCapture.cpp CaptureReactor.o DmaAllocator.o FramePool.o JpegDecodePool.o -lpthread -lavformat -lavcodec -lavutil -lswscale
+// 零拷贝模式测试：用普通文件模拟摄像头，持有多个在途帧验证缓冲区自动扩充与归还
+#include <cstdio>
+#include <deque>
+int main() {
+    const uint32_t width = 640, height = 480, frames = 8;
+    const char* path = "/tmp/fake_yuyv.raw";
+    FILE* fp = fopen(path, "wb");
+    std::vector<uint8_t> raw(width * height * 2);
+    for (uint32_t i = 0; i < frames; ++i) {
+        memset(raw.data(), static_cast<int>(i), raw.size());  // 每帧以帧号填充便于校验
+        fwrite(raw.data(), 1, raw.size(), fp);
+    }
+    fclose(fp);
+
+    // 驱动分配的mmap缓冲区与流水线分配器分配的缓冲区（模拟设备上DMA-BUF退化为USERPTR）各测一次
+    int mismatched = 0;
+    for (CaptureMemory mode : {CaptureMemory::Mmap, CaptureMemory::Userptr}) {
+        std::mutex mtx;
+        std::deque<FramePtr> held;
+        int received = 0;
+        CameraCapture cam(path, width, height, 100);
+        cam.set_zero_copy(true);
+        cam.set_memory_mode(mode);
+        cam.set_frame_callback([&](FramePtr frame) {
+            std::lock_guard<std::mutex> lock(mtx);
+            // 帧内容应与驱动帧序号对应（模拟设备按序号循环读取文件）
+            const FrameMeta* meta = get_frame_meta(frame.get());
+            if (!meta || frame->data[0][0] != meta->sequence % frames) mismatched++;
+            received++;
+            held.push_back(frame);
+            // 模拟下游最多持有6帧
+            if (held.size() > 6) {
+                held.pop_front();
+            }
+        });
+        if (!cam.initialize()) return 1;
+        cam.start();
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        cam.stop();
+        std::cout << (mode == CaptureMemory::Mmap ? "mmap" : "userptr")
+                  << " received: " << received << " mismatched: " << mismatched
+                  << " buffers: " << cam.buffer_count()
+                  << " in flight: " << cam.buffers_in_flight()
+                  << " driver dropped: " << cam.capture_stats().driver_dropped << std::endl;
+        held.clear();
+        std::cout << "in flight after release: " << cam.buffers_in_flight() << std::endl;
+    }
+
+    // 采集对象先于在途帧析构（移除流时帧仍在重排环、批处理队列或编码器中）：帧保持可读，由最后释放的帧解除映射
+    int outlived = 0;
+    {
+        std::mutex mtx;
+        std::deque<FramePtr> held;
+        std::unique_ptr<CameraCapture> cam(new CameraCapture(path, width, height, 100));
+        cam->set_zero_copy(true);
+        cam->set_frame_callback([&](FramePtr frame) {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (held.size() < 4) {
+                held.push_back(frame);
+            }
+        });
+        if (!cam->initialize()) return 1;
+        cam->start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        cam->stop();
+        cam.reset();
+        for (const FramePtr& frame : held) {
+            const FrameMeta* meta = get_frame_meta(frame.get());
+            if (meta && frame->data[0][raw.size() - 1] == meta->sequence % frames) outlived++;
+        }
+        std::cout << "frames readable after capture destroyed: " << outlived << "/" << held.size() << std::endl;
+        if (outlived == 0 || outlived != static_cast<int>(held.size())) mismatched++;
+    }
+    remove(path);
+    return mismatched == 0 ? 0 : 1;
+}
+#endif
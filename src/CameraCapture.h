@@ -11,10 +11,14 @@
  * 以及通过回调函数机制获取摄像头帧数据。
  * 
  * 主要功能特点：
- * - 支持多种像素格式（默认YUYV）
+ * - 支持多种像素格式（默认YUYV），MJPEG由JpegDecodePool并行解码
+ * - 支持多平面接口（VIDEO_CAPTURE_MPLANE）：NV12/NV16/NV24逐平面映射与导出DMA-BUF，帧直接引用各平面不做重排
  * - 基于DMA缓冲区实现高效数据传输
- * - 多线程异步采集模式
- * - 帧数据通过回调函数实时推送
+ * - 多线程异步采集模式；也可由共享的CaptureReactor（epoll）统一分发，不再每路一个采集线程
+ * - 帧数据通过回调函数实时推送，帧携带驱动的单调采集时间戳与帧序号（FrameMeta）
+ * - 零拷贝模式：V4L2 mmap缓冲区以引用计数AVFrame直接下发，最后一个引用释放时自动归还驱动队列
+ * - 缓冲区可由流水线的DmaAllocator分配（V4L2_MEMORY_DMABUF/USERPTR），驱动直接写入流水线自有内存
+ * - 设备路径为普通文件时作为模拟设备（原始YUYV帧序列），便于无摄像头环境测试
  * - 包含完整的设备初始化、缓冲区管理和资源释放逻辑
  * 
  * 使用流程：
@@ -26,23 +30,37 @@
  * 6. 对象析构时自动释放相关资源
  */
 #include <atomic>
+#include <deque>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <linux/videodev2.h>
+#include <sys/types.h>
 #include <thread>
+#include "DmaAllocator.h"
+#include "FrameMeta.h"
+#include "FramePool.h"
+#include "FrameSource.h"
+#include "JpegDecodePool.h"
+
+class CaptureReactor;
 
 extern "C" {
 #include <libavformat/avformat.h>
 #include <libswscale/swscale.h>
 }
 
-class CameraCapture {
+// 采集缓冲区的内存类型
+enum class CaptureMemory {
+    Mmap,     // 驱动分配，mmap映射（默认）
+    Dmabuf,   // 流水线分配的DMA-BUF（V4L2_MEMORY_DMABUF）
+    Userptr,  // 流水线分配的普通内存（V4L2_MEMORY_USERPTR）
+};
+
+class CameraCapture : public FrameSource {
 public:
-    // 回调函数类型定义
-    using FrameCallback = std::function<void(AVFrame*)>;
-    
     /**
      * @brief 构造函数，初始化采集参数
      * @param device_path 摄像头设备路径（如/dev/video0）
@@ -61,54 +79,167 @@ public:
      * @brief 析构函数，释放所有资源
      * 自动调用stop()停止采集，释放缓冲区，关闭设备文件描述符
      */
-    ~CameraCapture();
+    ~CameraCapture() override;
     
     /**
      * @brief 初始化摄像头设备
      * 流程：打开设备 -> 检查设备能力 -> 设置像素格式、分辨率、帧率 -> 申请缓冲区 -> 映射缓冲区
      * @return 成功返回true，失败返回false
      */
-    bool initialize();
+    bool initialize() override;
     
     /**
      * @brief 开始采集
      * 启动采集线程，线程中循环获取帧数据并通过回调函数推送
      * 注意：需先调用initialize()并返回成功后才能调用此函数
      */
-    void start();
+    void start() override;
     
     /**
      * @brief 停止采集
      * 停止采集线程，暂停帧数据获取
      */
-    void stop();
+    void stop() override;
     
     /**
-     * @brief 设置帧数据回调函数（左值引用版本和右值引用版本，支持移动语义）
-     * @param callback 回调函数对象，当有新帧到达时会被调用
+     * @brief 设置MJPEG解码线程数（需在initialize()之前调用，仅MJPEG格式有效）
+     * @param count 解码线程数
      */
-    void set_frame_callback(const FrameCallback &callback); 
-    void set_frame_callback(FrameCallback &&callback);
-    
+    void set_decode_workers(int count) { if (!initialized_) decode_workers_ = count; }
+
+    /**
+     * @brief 设置MJPEG解码线程启动时的初始化函数（需在initialize()之前调用），用于线程命名、CPU亲和性与调度策略设置
+     */
+    void set_decode_thread_init(std::function<void()> init) { decode_thread_init_ = std::move(init); }
+
+    /**
+     * @brief 设置V4L2缓冲区环深度（需在initialize()之前调用）
+     * 环越深越能吸收下游抖动，但驱动中排队的旧帧越多、延迟越大；实际数量以驱动分配为准
+     * @param count 请求的缓冲区数量，限制在[2, 16]
+     */
+    void set_buffer_count(int count) {
+        if (!initialized_) buffer_count_ = std::min(std::max(count, 2), static_cast<int>(kMaxBuffers));
+    }
+
+    /**
+     * @brief 设置采集缓冲区内存类型（需在initialize()之前调用）
+     * Dmabuf/Userptr时缓冲区由allocator分配，驱动直接写入；allocator不提供DMA-BUF时Dmabuf退化为Userptr，
+     * 设备不支持所选类型时退回Mmap
+     * @param mode 内存类型
+     * @param allocator 流水线共享的分配器，为nullptr时按默认dma-heap路径创建
+     */
+    void set_memory_mode(CaptureMemory mode, std::shared_ptr<DmaAllocator> allocator = nullptr) {
+        if (initialized_) return;
+        memory_mode_ = mode;
+        allocator_ = std::move(allocator);
+    }
+
+    /**
+     * @brief 获取实际使用的内存类型（initialize()之后有效）
+     */
+    CaptureMemory memory_mode() const { return memory_mode_; }
+
+    /**
+     * @brief 内存类型名（"mmap"/"dmabuf"/"userptr"）转换为CaptureMemory，未知名称按mmap处理
+     */
+    static CaptureMemory memory_from_string(const std::string& name);
+
+    /**
+     * @brief 获取MJPEG解码池（非MJPEG格式时为nullptr）
+     */
+    const JpegDecodePool* decoder() const { return decoder_.get(); }
+
+    /**
+     * @brief 将四字符格式名（如"YUYV"、"MJPG"）转换为V4L2像素格式
+     * @param name 四字符格式名
+     * @return V4L2像素格式，格式名非法时返回0
+     */
+    static uint32_t fourcc_from_string(const std::string& name);
+
+    /**
+     * @brief 设置帧缓冲池（需在initialize()之前调用）
+     * 拷贝模式下RGB帧、MJPEG解码帧从池中获取，不设置时每帧单独分配
+     * @param pool 与下游共享的帧缓冲池（RGB24，采集分辨率）
+     */
+    void set_frame_pool(std::shared_ptr<FramePool> pool) override { frame_pool_ = std::move(pool); }
+
+    /**
+     * @brief 设置共享采集反应器（需在start()之前调用）
+     * 设置后start()不再创建采集线程，而是将poll_fd()注册到反应器，由反应器线程在就绪时分发
+     * @param reactor 已start()的反应器，为nullptr时使用独立采集线程
+     */
+    void set_reactor(std::shared_ptr<CaptureReactor> reactor) { if (!running_) reactor_ = std::move(reactor); }
+
+    /**
+     * @brief 获取可等待就绪的文件描述符（真实设备为设备fd，模拟设备为按帧率触发的timerfd）
+     */
+    int poll_fd() const { return fake_device_ ? timer_fd_ : fd_; }
+
+    /**
+     * @brief 非阻塞地取出一个已就绪的缓冲区并分发（回调或提交MJPEG解码）
+     * 由采集线程或CaptureReactor在poll_fd()可读时调用
+     * @return 成功分发返回true，无数据或失败返回false
+     */
+    bool process_ready_buffer();
+
     /**
      * @brief 获取当前采集状态
      * @return 正在采集返回true，否则返回false
      */
-    bool is_running() const { return running_; }
-    
+    bool is_running() const override { return running_; }
+
+    /**
+     * @brief 获取帧源名称（设备路径）
+     */
+    std::string name() const override { return device_path_; }
+
+    /**
+     * @brief 设置零拷贝采集模式（需在initialize()之前调用）
+     * 开启后回调收到的是直接引用V4L2 mmap缓冲区的原始格式帧（如YUYV），不做颜色转换与拷贝；
+     * 帧的最后一个引用被释放（av_frame_free）时缓冲区自动归还驱动队列。
+     * 在途帧过多时会通过VIDIOC_CREATE_BUFS自动扩充缓冲区，保证采集环不会饿死。
+     * @param enable true开启，false使用默认的RGB24拷贝模式
+     */
+    void set_zero_copy(bool enable) { if (!initialized_) zero_copy_ = enable; }
+
+    /**
+     * @brief 获取当前是否为零拷贝模式
+     */
+    bool is_zero_copy() const { return zero_copy_; }
+
+    /**
+     * @brief 获取当前在途（已下发未归还）的缓冲区数量
+     */
+    int buffers_in_flight() const { return ring_->in_flight; }
+
+    /**
+     * @brief 获取当前缓冲区总数（含自动扩充的部分）
+     */
+    size_t buffer_count() const;
+
     /**
-     * @brief 设置摄像头ID（多摄像头场景下使用）
-     * @param id 摄像头标识ID
+     * @brief 获取采集统计（采集帧数、驱动丢帧数）
      */
-    void set_camera_id(int id) { camera_id_ = id; }
+    CaptureStats capture_stats() const override {
+        CaptureStats stats;
+        stats.captured = frames_captured_;
+        stats.driver_dropped = driver_dropped_;
+        return stats;
+    }
 
     /**
-     * @brief 获取当前摄像头ID
-     * @return 摄像头标识ID
+     * @brief 获取采集格式对应的FFmpeg像素格式（initialize()之后有效，MJPEG时为AV_PIX_FMT_NONE）
      */
-    int get_camera_id() const { return camera_id_; }
+    AVPixelFormat av_format() const override { return av_format_; }
+
+    /**
+     * @brief 获取当前是否使用多平面接口（VIDEO_CAPTURE_MPLANE）
+     */
+    bool is_mplane() const { return buf_type_ == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE; }
 
 private:
+    struct Buffer;
+
     /**
      * @brief 采集线程主函数
      * 循环执行：获取帧数据 -> 调用回调函数推送帧 -> 等待下一帧（直到stop()被调用）
@@ -122,6 +253,27 @@ private:
      */
     bool init_device();
     
+    /**
+     * @brief 打开V4L2设备并配置采集格式
+     * 包括：打开设备文件、检查设备能力、设置视频格式（分辨率/像素格式）、设置帧率
+     * @return 成功返回true，失败返回false
+     */
+    bool open_device();
+
+    /**
+     * @brief 设置分辨率与像素格式，并记录驱动返回的平面数与各平面步长
+     * 根据buf_type_选择单平面（pix）或多平面（pix_mp）格式结构
+     * @return 成功返回true，失败返回false
+     */
+    bool set_format();
+
+    /**
+     * @brief 打开模拟设备（普通文件，内容为连续的原始YUYV帧）
+     * @param file_size 文件大小（字节）
+     * @return 成功返回true，失败返回false
+     */
+    bool open_fake_device(off_t file_size);
+
     /**
      * @brief 卸载设备资源
      * 包括：解除内存映射、释放缓冲区、关闭设备文件描述符
@@ -149,13 +301,40 @@ private:
      */
     bool stop_streaming();
     
+    /**
+     * @brief 等待poll_fd()可读（select，2秒超时）
+     * @return 可读返回true，超时或出错返回false
+     */
+    bool wait_readable();
+
+    /**
+     * @brief 非阻塞地取出一个已填充的缓冲区
+     * @param buf 输出参数，出队的缓冲区信息
+     * @return 成功返回true，无数据/出错返回false
+     */
+    bool dequeue_ready(v4l2_buffer& buf);
+
+    /**
+     * @brief 取出一帧MJPEG压缩数据并提交到解码池（零拷贝）
+     * @return 成功提交返回true，无数据或失败返回false
+     */
+    bool submit_compressed_frame();
+
+    /**
+     * @brief 根据采集格式计算各平面的数据指针与行宽
+     * 单内存平面时按bytesperline推算色度平面位置，多内存平面时直接引用各平面映射
+     * @param buffer 采集缓冲区
+     * @param data 输出各平面指针
+     * @param linesize 输出各平面行宽
+     */
+    void fill_planes(const Buffer& buffer, uint8_t* data[4], int linesize[4]) const;
+
     /**
      * @brief 从设备获取一帧数据
-     * 阻塞等待直到有新帧到达，或超时/出错
-     * @param frame 输出参数，用于存储获取到的帧数据
-     * @return 成功返回true，失败返回false
+     * 非阻塞，需在poll_fd()可读后调用
+     * @return 成功返回帧，失败返回nullptr
      */
-    AVFrame* get_frame();
+    FramePtr get_frame();
     
     /**
      * @brief 将缓冲区归还到设备队列
@@ -164,46 +343,169 @@ private:
      * @return 成功返回true，失败返回false
      */
     bool return_buffer_to_queue(int index);
+
+    /**
+     * @brief 零拷贝模式下AVBufferRef的释放回调
+     * 最后一个引用释放时被调用，将对应缓冲区归还设备队列
+     * @param opaque 指向Buffer的指针
+     * @param data 缓冲区数据指针（未使用）
+     */
+    static void release_buffer(void* opaque, uint8_t* data);
+
+    /**
+     * @brief 将已出队的缓冲区包装为引用计数AVBufferRef，最后一个引用释放时归还队列
+     * @param index 缓冲区索引
+     * @return 成功返回AVBufferRef，失败返回nullptr（缓冲区已归还队列）
+     */
+    AVBufferRef* wrap_buffer_ref(uint32_t index);
+
+    /**
+     * @brief 将已出队的缓冲区包装为引用计数AVFrame（零拷贝）
+     * @param buf 出队的缓冲区信息
+     * @return 成功返回帧，失败返回nullptr（缓冲区已归还队列）
+     */
+    FramePtr wrap_buffer(const v4l2_buffer& buf);
+
+    /**
+     * @brief 获取缓冲区的采集时间（CLOCK_MONOTONIC纳秒）
+     * 驱动时间戳为单调时钟时直接使用，否则取当前时间
+     */
+    int64_t capture_time_ns(const v4l2_buffer& buf) const;
+
+    /**
+     * @brief 根据出队的缓冲区生成帧元数据
+     */
+    FrameMeta make_meta(const v4l2_buffer& buf) const;
+
+    /**
+     * @brief 为帧挂载元数据，并以采集时间（微秒）作为pts
+     */
+    void stamp_frame(AVFrame* frame, const v4l2_buffer& buf, int dma_fd = -1) const;
+
+    /**
+     * @brief 按当前内存类型分配缓冲区的各平面（Dmabuf/Userptr）
+     * @param buffer 待填充的缓冲区
+     * @return 成功返回true，失败返回false
+     */
+    bool allocate_planes(Buffer& buffer);
+
+    /**
+     * @brief 驱动写入完成后、CPU读取前同步DMA-BUF缓存（仅Dmabuf模式）
+     */
+    void begin_cpu_access(const Buffer& buffer) const;
+
+    /**
+     * @brief 映射并导出指定索引的缓冲区
+     * @param index 缓冲区索引
+     * @return 成功返回true，失败返回false
+     */
+    bool map_buffer(uint32_t index);
+
+    /**
+     * @brief 在途缓冲区过多时扩充缓冲区（VIDIOC_CREATE_BUFS）
+     * 仅在采集线程中调用
+     * @return 成功扩充返回true，已达上限或失败返回false
+     */
+    bool grow_buffers();
+
+    /**
+     * @brief 从设备（或模拟设备）取出一个已填充的缓冲区
+     * @param buf 输出参数，出队的缓冲区信息
+     * @return 成功返回true，无数据或失败返回false
+     */
+    bool dequeue_buffer(v4l2_buffer& buf);
+
+    /**
+     * @brief 将缓冲区放入设备（或模拟设备）队列，调用者需持有ring_->mutex
+     * @param index 缓冲区索引
+     * @return 成功返回true，失败返回false
+     */
+    bool queue_buffer(uint32_t index);
     
     /**
      * @brief 导出DMA-BUF文件描述符
      * 将V4L2缓冲区导出为DMA-BUF，用于跨进程或硬件加速模块共享数据
      * @param index 缓冲区索引
+     * @param plane 平面索引（单平面格式为0）
      * @return 成功返回DMA-BUF的文件描述符，失败返回-1
      */
-    int export_dma_buf(int index);
+    int export_dma_buf(int index, uint32_t plane = 0);
 
 private:
     // 配置参数
     std::string device_path_;
     uint32_t width_;
     uint32_t height_;
-    uint32_t stride_; // 保存步长
     uint32_t fps_;
     uint32_t pixel_format_;
-    uint32_t pts_ = 0;
-    int camera_id_ = 0;  // 默认摄像头ID为0
+    AVPixelFormat av_format_ = AV_PIX_FMT_YUYV422;  // 采集格式对应的FFmpeg格式
+    bool zero_copy_ = false;  // 零拷贝模式
+    v4l2_buf_type buf_type_ = V4L2_BUF_TYPE_VIDEO_CAPTURE;  // 单平面或多平面采集
+    uint32_t num_planes_ = 1;                               // 每个缓冲区的内存平面数
+    uint32_t bytesperline_[VIDEO_MAX_PLANES] = {};          // 各平面步长
+    uint32_t sizeimage_[VIDEO_MAX_PLANES] = {};             // 各平面大小
+    CaptureMemory memory_mode_ = CaptureMemory::Mmap;       // 缓冲区内存类型
+    v4l2_memory memory_ = V4L2_MEMORY_MMAP;                 // 对应的V4L2内存类型
+    std::shared_ptr<DmaAllocator> allocator_;               // Dmabuf/Userptr模式下的缓冲区分配器
+    v4l2_plane dequeue_planes_[VIDEO_MAX_PLANES];           // 多平面出队时的平面信息
     
     // 设备状态
     int fd_ = -1;  // 设备文件描述符
     std::atomic<bool> running_{false};
     std::atomic<bool> initialized_{false};
 
+    // 模拟设备（普通文件，按帧顺序循环读取原始YUYV数据）
+    bool fake_device_ = false;
+    int timer_fd_ = -1;  // 按帧率触发的timerfd
+    size_t fake_frame_size_ = 0;
+    uint64_t fake_frame_count_ = 0;  // 文件内帧数
+    uint64_t fake_sequence_ = 0;
+    std::deque<uint32_t> fake_free_;  // 模拟驱动的空闲缓冲区队列
+
     SwsContext* rgb_ctx_ = nullptr;
+    std::shared_ptr<FramePool> frame_pool_;  // 拷贝模式下RGB帧来源
+
+    // MJPEG解码池
+    std::unique_ptr<JpegDecodePool> decoder_;
+    int decode_workers_ = 2;
+    std::function<void()> decode_thread_init_;
     
     // 线程控制
     std::unique_ptr<std::thread> capture_thread_;
+    std::shared_ptr<CaptureReactor> reactor_;  // 非空时由反应器分发
     
     // 缓冲区管理
-    struct Buffer {
+    struct Plane {
         void* start;
         size_t length;
         int dma_fd;  // DMA-BUF文件描述符
+        DmaBuffer owned;  // Dmabuf/Userptr模式下由分配器分配的内存
     };
-    std::vector<Buffer> buffers_;
-    
-    // 回调函数
-    FrameCallback frame_callback_;
+    struct BufferRing;
+    struct Buffer {
+        Plane planes[VIDEO_MAX_PLANES];
+        uint32_t num_planes;
+        uint32_t index;
+        std::shared_ptr<BufferRing> ring;  // 零拷贝帧在途期间持有，release_buffer中释放
+    };
+    // 缓冲区环与采集对象分离：采集对象析构时仍有在途帧，则由最后释放的帧解除映射
+    struct BufferRing {
+        std::deque<Buffer> buffers;      // deque扩充时已有元素地址不变，release_buffer可直接持有Buffer指针
+        std::mutex mutex;                // 保护buffers扩充、跨线程归还与owner
+        CameraCapture* owner = nullptr;  // 采集对象析构时置空，之后释放的缓冲区不再归还驱动
+        std::shared_ptr<DmaAllocator> allocator;  // Dmabuf/Userptr模式下释放缓冲区所用的分配器
+        std::atomic<int> in_flight{0};   // 零拷贝模式下在途缓冲区数量
+        ~BufferRing();
+    };
+    std::shared_ptr<BufferRing> ring_;
+
+    // 帧序号统计（仅在采集线程/反应器中更新）
+    uint32_t last_sequence_ = 0;
+    std::atomic<uint64_t> frames_captured_{0};
+    std::atomic<uint64_t> driver_dropped_{0};
+    int buffer_count_ = 4;                            // 初始请求的缓冲区数量
+    static constexpr uint32_t kMinQueuedBuffers = 2;  // 驱动队列中至少保留的缓冲区
+    static constexpr uint32_t kMaxBuffers = 16;       // 自动扩充上限
     
     /**
      * @brief 错误处理函数
@@ -0,0 +1,213 @@
+#include "CaptureReactor.h"
+#include "CameraCapture.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+#include <iostream>
+
+#ifndef MODULE_TEST
+#define MODULE_TEST 0
+#endif
+
+namespace {
+constexpr int kMaxEvents = 16;
+}
+
+CaptureReactor::CaptureReactor(int shard_count) {
+    if (shard_count < 1) shard_count = 1;
+    for (int i = 0; i < shard_count; ++i) {
+        shards_.emplace_back(new Shard());
+        shards_.back()->index = i;
+    }
+}
+
+CaptureReactor::~CaptureReactor() {
+    stop();
+    for (auto& shard : shards_) {
+        if (shard->epoll_fd != -1) close(shard->epoll_fd);
+        if (shard->wake_fd != -1) close(shard->wake_fd);
+    }
+}
+
+bool CaptureReactor::start() {
+    if (running_) return true;
+
+    for (auto& shard : shards_) {
+        if (shard->epoll_fd == -1) {
+            shard->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+            shard->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (shard->epoll_fd == -1 || shard->wake_fd == -1) {
+                std::cerr << "CaptureReactor: epoll/eventfd create failed: " << strerror(errno) << std::endl;
+                return false;
+            }
+            epoll_event ev;
+            memset(&ev, 0, sizeof(ev));
+            ev.events = EPOLLIN;
+            ev.data.ptr = nullptr;  // 空指针表示唤醒事件
+            if (epoll_ctl(shard->epoll_fd, EPOLL_CTL_ADD, shard->wake_fd, &ev) == -1) {
+                std::cerr << "CaptureReactor: register eventfd failed: " << strerror(errno) << std::endl;
+                return false;
+            }
+        } else {
+            // 上次stop()写入的唤醒计数可能未被读走（线程先于epoll_wait看到running_为false），
+            // 水平触发下残留计数会使epoll_wait立即返回，重新启动前清零
+            uint64_t count;
+            while (read(shard->wake_fd, &count, sizeof(count)) == sizeof(count)) {
+            }
+        }
+    }
+
+    running_ = true;
+    for (auto& shard : shards_) {
+        shard->thread = std::thread(&CaptureReactor::shard_loop, this, shard.get());
+    }
+    return true;
+}
+
+void CaptureReactor::stop() {
+    if (!running_) return;
+
+    running_ = false;
+    for (auto& shard : shards_) {
+        uint64_t one = 1;
+        if (write(shard->wake_fd, &one, sizeof(one)) != sizeof(one)) {
+            std::cerr << "CaptureReactor: wake shard failed" << std::endl;
+        }
+    }
+    for (auto& shard : shards_) {
+        if (shard->thread.joinable()) {
+            shard->thread.join();
+        }
+    }
+}
+
+bool CaptureReactor::add(CameraCapture* cam) {
+    Shard* shard = shards_[next_shard_++ % shards_.size()].get();
+    if (shard->epoll_fd == -1) {
+        std::cerr << "CaptureReactor: add before start()" << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = cam;
+    if (epoll_ctl(shard->epoll_fd, EPOLL_CTL_ADD, cam->poll_fd(), &ev) == -1) {
+        std::cerr << "CaptureReactor: register camera " << cam->get_camera_id()
+                  << " failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    shard->cameras.insert(cam);
+    return true;
+}
+
+void CaptureReactor::remove(CameraCapture* cam) {
+    Shard* shard = find_shard(cam);
+    if (!shard) return;
+
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    epoll_ctl(shard->epoll_fd, EPOLL_CTL_DEL, cam->poll_fd(), nullptr);
+    shard->cameras.erase(cam);
+}
+
+CaptureReactor::Shard* CaptureReactor::find_shard(CameraCapture* cam) {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        if (shard->cameras.count(cam)) {
+            return shard.get();
+        }
+    }
+    return nullptr;
+}
+
+void CaptureReactor::shard_loop(Shard* shard) {
+    if (thread_init_) {
+        thread_init_(shard->index);
+    }
+    epoll_event events[kMaxEvents];
+    while (running_) {
+        int n = epoll_wait(shard->epoll_fd, events, kMaxEvents, 1000);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            std::cerr << "CaptureReactor: epoll_wait failed: " << strerror(errno) << std::endl;
+            break;
+        }
+        uint64_t wakeup_ns = LatencyHistogram::now_ns();
+
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        for (int i = 0; i < n; ++i) {
+            CameraCapture* cam = static_cast<CameraCapture*>(events[i].data.ptr);
+            if (!cam) {
+                // 唤醒事件：读走计数，否则eventfd保持可读，水平触发下epoll_wait不再阻塞
+                uint64_t count;
+                if (read(shard->wake_fd, &count, sizeof(count)) != sizeof(count) && errno != EAGAIN) {
+                    std::cerr << "CaptureReactor: drain eventfd failed: " << strerror(errno) << std::endl;
+                }
+                continue;
+            }
+            // 已在本批事件返回后被注销的摄像头
+            if (!shard->cameras.count(cam)) {
+                continue;
+            }
+            wakeup_latency_.record(LatencyHistogram::now_ns() - wakeup_ns);
+            cam->process_ready_buffer();
+        }
+    }
+}
+
+
+#if MODULE_TEST
+//g++ -c CameraCapture.cpp FramePool.cpp JpegDecodePool.cpp && g++ -DMODULE_TEST=1 -o test_capture_reactor CaptureReactor.cpp CameraCapture.o FramePool.o JpegDecodePool.o -lpthread -lavcodec -lavutil -lswscale
+// 以普通文件模拟多路摄像头：./test_capture_reactor [摄像头数] [分片数]
+#include <fcntl.h>
+#include <vector>
+int main(int argc, char** argv) {
+    int camera_count = argc > 1 ? std::atoi(argv[1]) : 8;
+    int shard_count = argc > 2 ? std::atoi(argv[2]) : 2;
+    const uint32_t width = 320, height = 240;
+
+    const char* path = "/tmp/test_capture_reactor.yuv";
+    std::vector<uint8_t> frame(width * height * 2, 0x80);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    for (int i = 0; i < 4; ++i) {
+        if (write(fd, frame.data(), frame.size()) != static_cast<ssize_t>(frame.size())) return 1;
+    }
+    close(fd);
+
+    auto reactor = std::make_shared<CaptureReactor>(shard_count);
+    if (!reactor->start()) return 1;
+
+    std::vector<std::unique_ptr<CameraCapture>> cams;
+    std::vector<std::unique_ptr<std::atomic<int>>> received;
+    for (int i = 0; i < camera_count; ++i) {
+        cams.emplace_back(new CameraCapture(path, width, height, 30));
+        received.emplace_back(new std::atomic<int>(0));
+        std::atomic<int>* counter = received.back().get();
+        cams[i]->set_camera_id(i);
+        cams[i]->set_reactor(reactor);
+        cams[i]->set_zero_copy(true);
+        cams[i]->set_frame_callback([counter](FramePtr frame) { (*counter)++; });
+        if (!cams[i]->initialize()) return 1;
+        cams[i]->start();
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+    for (auto& cam : cams) cam->stop();
+    reactor->stop();
+
+    int total = 0;
+    for (int i = 0; i < camera_count; ++i) {
+        std::cout << "camera " << i << " frames: " << *received[i] << std::endl;
+        total += *received[i];
+    }
+    LatencySnapshot lat = reactor->wakeup_latency();
+    std::cout << "cameras: " << camera_count << " shards: " << shard_count
+              << " total frames: " << total << std::endl;
+    std::cout << "wakeup->dispatch us: mean " << lat.mean_us << " p50 " << lat.p50_us
+              << " p90 " << lat.p90_us << " p99 " << lat.p99_us << " max " << lat.max_us << std::endl;
+    return total > camera_count * 40 ? 0 : 1;
+}
+#endif
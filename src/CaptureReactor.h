@@ -0,0 +1,118 @@
+#pragma once
+/**
+ * @file CaptureReactor.h
+ * @class CaptureReactor
+ * @brief 多路摄像头共享的epoll采集反应器
+ * @author achene
+ * @date 2025-08-05
+ *
+ * 将所有摄像头的文件描述符注册到一个（或少量分片的）epoll集合中，由少数反应器线程
+ * 等待就绪事件并在就绪时出队缓冲区、调用各摄像头的帧回调，取代每路摄像头一个
+ * 采集线程加select轮询的方式，8~16路摄像头时线程数与唤醒延迟都显著降低。
+ *
+ * 主要功能特点：
+ * - 分片：摄像头按注册顺序轮流分配到各分片，每个分片一个epoll实例和一个线程
+ * - 水平触发：每次就绪只处理一个缓冲区，多路摄像头之间轮流服务
+ * - 统计唤醒到分发的延迟直方图（epoll_wait返回到开始处理该摄像头的时间）
+ *
+ * 使用流程：
+ * 1. 构造CaptureReactor并指定分片数，调用start()启动反应器线程
+ * 2. 通过CameraCapture::set_reactor()关联反应器，摄像头start()/stop()时自动注册/注销
+ * 3. 通过wakeup_latency()获取延迟统计
+ * 4. 所有摄像头停止后调用stop()
+ */
+#include "LatencyHistogram.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+class CameraCapture;
+
+class CaptureReactor {
+public:
+    /**
+     * @brief 构造函数
+     * @param shard_count epoll分片数（即反应器线程数），至少为1
+     */
+    explicit CaptureReactor(int shard_count = 1);
+
+    /**
+     * @brief 析构函数，停止反应器线程并关闭epoll描述符
+     */
+    ~CaptureReactor();
+
+    CaptureReactor(const CaptureReactor&) = delete;
+    CaptureReactor& operator=(const CaptureReactor&) = delete;
+
+    /**
+     * @brief 设置反应器线程启动时的初始化函数（需在start()之前调用），用于线程命名、CPU亲和性与调度策略设置
+     * @param init 在每个分片线程中调用一次，参数为分片序号
+     */
+    void set_thread_init(std::function<void(int)> init) { thread_init_ = std::move(init); }
+
+    /**
+     * @brief 创建epoll实例并启动反应器线程
+     * @return 成功返回true，失败返回false
+     */
+    bool start();
+
+    /**
+     * @brief 停止反应器线程
+     */
+    void stop();
+
+    /**
+     * @brief 注册摄像头（由CameraCapture::start()调用）
+     * @param cam 已初始化的摄像头
+     * @return 成功返回true，失败返回false
+     */
+    bool add(CameraCapture* cam);
+
+    /**
+     * @brief 注销摄像头（由CameraCapture::stop()调用）
+     * 返回后反应器线程不会再访问该摄像头
+     * @param cam 已注册的摄像头
+     */
+    void remove(CameraCapture* cam);
+
+    /**
+     * @brief 获取唤醒到分发的延迟统计
+     */
+    LatencySnapshot wakeup_latency() const { return wakeup_latency_.snapshot(); }
+
+    /**
+     * @brief 获取分片数
+     */
+    int shard_count() const { return static_cast<int>(shards_.size()); }
+
+private:
+    struct Shard {
+        int index = 0;     // 分片序号
+        int epoll_fd = -1;
+        int wake_fd = -1;  // eventfd，stop()时唤醒epoll_wait
+        std::thread thread;
+        std::mutex mutex;  // 保护cameras，分发期间持有，保证remove()返回后不再访问摄像头
+        std::set<CameraCapture*> cameras;
+    };
+
+    /**
+     * @brief 分片线程主函数：等待就绪事件并分发
+     */
+    void shard_loop(Shard* shard);
+
+    /**
+     * @brief 查找摄像头所在分片
+     * @return 找到返回分片指针，否则返回nullptr
+     */
+    Shard* find_shard(CameraCapture* cam);
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::function<void(int)> thread_init_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint32_t> next_shard_{0};
+    LatencyHistogram wakeup_latency_;
+};
@@ -0,0 +1,94 @@
+#pragma once
+/**
+ * @file DmaAllocator.h
+ * @class DmaAllocator
+ * @brief 流水线自有的帧缓冲区分配器（dma-heap / memfd / 匿名内存）
+ * @author achene
+ * @date 2025-08-05
+ *
+ * 为V4L2_MEMORY_DMABUF/USERPTR采集提供由流水线分配的缓冲区：驱动直接把图像写入其中，
+ * 同一块内存再以零拷贝帧的形式依次交给推理与编码，各阶段之间不做拷贝。
+ *
+ * 后端按可用性依次选择：
+ * - dma-heap（目标板，如/dev/dma_heap/system）：得到DMA-BUF fd，可用于DMABUF采集及NPU/RGA导入
+ * - memfd：有fd的共享内存，可跨进程传递，仅能用于USERPTR采集
+ * - 匿名内存：无fd，仅能用于USERPTR采集
+ *
+ * dma-heap缓冲区为CPU缓存映射，CPU读写前后需调用begin_cpu_access()/end_cpu_access()同步缓存。
+ * 分配与释放均为线程安全（无共享可变状态）。
+ */
+#include <cstddef>
+#include <string>
+
+// 分配器后端
+enum class DmaBackend {
+    DmaHeap,    // dma-heap，fd为DMA-BUF
+    Memfd,      // memfd_create共享内存
+    Anonymous,  // 匿名内存
+};
+
+// 一块已分配并映射的缓冲区
+struct DmaBuffer {
+    int fd = -1;            // DMA-BUF或memfd文件描述符，匿名内存为-1
+    void* data = nullptr;   // CPU映射地址
+    size_t size = 0;        // 缓冲区大小（按页对齐）
+};
+
+class DmaAllocator {
+public:
+    /**
+     * @brief 构造函数，按dma-heap -> memfd -> 匿名内存的顺序选择可用后端
+     * @param heap_path dma-heap设备路径，为空时跳过dma-heap
+     */
+    explicit DmaAllocator(const std::string& heap_path = "/dev/dma_heap/system");
+
+    ~DmaAllocator();
+
+    DmaAllocator(const DmaAllocator&) = delete;
+    DmaAllocator& operator=(const DmaAllocator&) = delete;
+
+    /**
+     * @brief 分配并映射一块缓冲区
+     * @param size 所需字节数
+     * @param out 输出缓冲区信息
+     * @return 成功返回true，失败返回false
+     */
+    bool allocate(size_t size, DmaBuffer& out);
+
+    /**
+     * @brief 解除映射并释放缓冲区（可重复调用）
+     */
+    void release(DmaBuffer& buffer);
+
+    /**
+     * @brief 获取当前使用的后端
+     */
+    DmaBackend backend() const { return backend_; }
+
+    /**
+     * @brief 分配的缓冲区是否为DMA-BUF（可用于V4L2_MEMORY_DMABUF）
+     */
+    bool is_dmabuf() const { return backend_ == DmaBackend::DmaHeap; }
+
+    /**
+     * @brief 后端名称（"dma-heap"/"memfd"/"anonymous"）
+     */
+    static const char* backend_name(DmaBackend backend);
+
+    /**
+     * @brief CPU访问DMA-BUF前同步缓存（DMA_BUF_IOCTL_SYNC），非DMA-BUF时为空操作
+     * @param fd DMA-BUF文件描述符
+     * @param write 是否会写入
+     */
+    static void begin_cpu_access(int fd, bool write = false);
+
+    /**
+     * @brief CPU访问DMA-BUF结束后同步缓存，与begin_cpu_access()成对调用
+     */
+    static void end_cpu_access(int fd, bool write = false);
+
+private:
+    std::string heap_path_;
+    int heap_fd_ = -1;
+    DmaBackend backend_ = DmaBackend::Anonymous;
+};
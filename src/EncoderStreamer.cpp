@@ -1,4 +1,7 @@
 #include "EncoderStreamer.h"
+#include <algorithm>
+#include <deque>
+#include <fstream>
 #include <iostream>
 #include <stdexcept>
 
@@ -17,8 +20,26 @@ EncoderStreamer::EncoderStreamer(const std::string& rtmp_url,
                 height_(height),
                 fps_(fps),
                 bitrate_(bitrate),
-                cam_(device_path, width, height, fps) {
-                    cam_.set_camera_id(camera_id);
+                source_(new CameraCapture(device_path, width, height, fps, pixel_format)) {
+                    camera_ = static_cast<CameraCapture*>(source_.get());
+                    source_->set_camera_id(camera_id);
+                }
+
+EncoderStreamer::EncoderStreamer(const std::string& rtmp_url,
+                std::unique_ptr<FrameSource> source,
+                int width,
+                int height,
+                int fps,
+                int camera_id,
+                int bitrate)
+                : rtmp_url_(rtmp_url),
+                width_(width),
+                height_(height),
+                fps_(fps),
+                bitrate_(bitrate),
+                source_(std::move(source)) {
+                    camera_ = dynamic_cast<CameraCapture*>(source_.get());
+                    source_->set_camera_id(camera_id);
                 }
     
 EncoderStreamer::~EncoderStreamer() {
@@ -27,32 +48,18 @@ EncoderStreamer::~EncoderStreamer() {
 }
     
 void EncoderStreamer::init_model_pool(ModelType model_type, const std::string& model_path, int pool_size) {
-    for (int i = 0; i < pool_size; ++i) {
-        ModelPtr model = ModelFactory::get_instance().create_model(model_type);
-        if (model->loadmodel(model_path.c_str())) {
-            model_pool_.push(model);
-        } else {
-            std::cerr << "Failed to load model " << i << " (type: " 
-                          << static_cast<int>(model_type) << ")" << std::endl;
-        }
+    if (!model_pool_) {
+        model_pool_ = std::make_shared<ModelPool>();
     }
+    model_pool_->load(model_type, model_path, pool_size, model_options_);
     std::cout << "init_model_pool init success!!!!" << std::endl;
 }
     
 bool EncoderStreamer::initialize(ModelType model_type, const std::string& model_path, 
                                 int thread_count, int model_pool_size) {
-    // 初始化摄像头
-    if (!cam_.initialize()) {
-        std::cerr << "Failed to initialize camera" << std::endl;
+    if (!init_source()) {
         return false;
     }
-    std::cout << "init_cam success!!!" << std::endl;
-    // 设置帧回调
-    cam_.set_frame_callback([this](AVFrame* frame) {
-            // 将原始帧放入预处理队列
-            // std::cout << "AVFrame read success!!!" << std::endl;
-            input_queue_.push(frame);
-        });
 
     // 初始化线程池和模型池
     pool_.setMode(tdpool::PoolMode::kFIXED);
@@ -64,12 +71,62 @@ bool EncoderStreamer::initialize(ModelType model_type, const std::string& model_
     return init_ffmpeg();
 }
 
+bool EncoderStreamer::initialize(ModelPoolPtr model_pool, int worker_count) {
+    if (!model_pool || worker_count < 1) {
+        std::cerr << "Invalid shared model pool or worker count" << std::endl;
+        return false;
+    }
+    if (!init_source()) {
+        return false;
+    }
+
+    // 共享模式：不启动自有推理线程，由外部工作线程调用process_next()
+    model_pool_ = std::move(model_pool);
+    shared_workers_ = true;
+    workers_ = std::vector<WorkerContext>(worker_count);
+
+    return init_ffmpeg();
+}
+
+bool EncoderStreamer::init_source() {
+    // 初始化帧缓冲池
+    frame_pool_ = std::make_shared<FramePool>(AV_PIX_FMT_RGB24, width_, height_,
+                                              frame_pool_capacity_, frame_pool_hugepages_);
+    source_->set_frame_pool(frame_pool_);
+
+    // 各阶段线程入口按放置配置命名并绑定CPU
+    const std::string id = std::to_string(source_->get_camera_id());
+    source_->set_thread_init([this, id]() {
+        ThreadPlacement::bind_current_thread("cap" + id, placement_.capture);
+    });
+    if (camera_) {
+        camera_->set_decode_thread_init([this, id]() {
+            ThreadPlacement::bind_current_thread("dec" + id, placement_.decode, isolated_cpus_);
+        });
+    }
+
+    // 初始化摄像头
+    if (!source_->initialize()) {
+        std::cerr << "Failed to initialize frame source " << source_->name() << std::endl;
+        return false;
+    }
+    std::cout << "init_source success!!!" << std::endl;
+    // 设置帧回调
+    source_->set_frame_callback([this](FramePtr frame) {
+            // 将原始帧放入预处理队列
+            // std::cout << "AVFrame read success!!!" << std::endl;
+            enqueue_frame(std::move(frame));
+        });
+    return true;
+}
+
 void EncoderStreamer::start() {
     if (running_) return;
     
     running_ = true;
-    cam_.start();
-    for (int i = 0; i < thread_count_; ++i) {
+    start_ns_ = LatencyHistogram::now_ns();
+    source_->start();
+    for (int i = 0; !shared_workers_ && i < thread_count_; ++i) {
         pool_.submitTask([this]() { this->reading_loop(); });
     }
     encoding_thread_ = std::thread(&EncoderStreamer::encoding_loop, this);
@@ -77,102 +134,521 @@ void EncoderStreamer::start() {
 
 void EncoderStreamer::stop() {
     running_ = false;
-    cam_.stop();
+    source_->stop();
     if (encoding_thread_.joinable()) {
         encoding_thread_.join();
     }
+    // 编码线程已退出，不再有消费者：唤醒因重排环满而阻塞的推理线程，之后放入的帧直接释放
+    output_ring_.terminate();
+    // 批处理器中的帧完成回调引用本对象：排队的帧立即以失败完成，再等待推理中的批次回调返回。
+    // 析构时再次调用，覆盖停止期间仍在提交的工作线程
+    if (batcher_) {
+        batcher_->cancel(this);
+        std::unique_lock<std::mutex> lock(batch_mutex_);
+        batch_done_.wait(lock, [this]() { return batch_in_flight_ == 0; });
+    }
+}
+
+void EncoderStreamer::set_overload_policy(OverloadPolicy policy, int queue_depth) {
+    overload_policy_ = policy;
+    if (policy == OverloadPolicy::Latest) {
+        queue_depth = 1;
+    }
+    input_queue_.set_max_size(queue_depth > 0 ? queue_depth : 1);
+}
+
+void EncoderStreamer::set_thread_placement(const PipelinePlacement& placement) {
+    placement_ = placement;
+    isolated_cpus_.clear();
+    if (placement_.capture.isolate && !placement_.capture.cpus.empty() &&
+        !CpuTopology::instance().resolve(placement_.capture.cpus, isolated_cpus_)) {
+        std::cerr << "Invalid capture cpus \"" << placement_.capture.cpus << "\", isolation disabled" << std::endl;
+    }
+}
+
+OverloadPolicy EncoderStreamer::overload_policy_from_string(const std::string& name) {
+    if (name == "drop_oldest") return OverloadPolicy::DropOldest;
+    if (name == "drop_newest") return OverloadPolicy::DropNewest;
+    if (name == "latest") return OverloadPolicy::Latest;
+    return OverloadPolicy::Block;
+}
+
+void EncoderStreamer::enqueue_frame(FramePtr frame) {
+    mark_frame_stage(frame.get(), FrameStage::Enqueued);
+    switch (overload_policy_) {
+    case OverloadPolicy::Block:
+        input_queue_.push(std::move(frame));
+        break;
+    case OverloadPolicy::DropNewest:
+        // 入队失败时frame在此释放，缓冲区立即回池/归还驱动
+        if (!input_queue_.try_push(std::move(frame))) {
+            overload_dropped_.add();
+        }
+        break;
+    case OverloadPolicy::DropOldest:
+    case OverloadPolicy::Latest: {
+        FramePtr evicted;
+        if (input_queue_.push_evict(std::move(frame), evicted)) {
+            overload_dropped_.add();
+        }
+        break;
+    }
+    }
+    if (frame_ready_) {
+        frame_ready_();
+    }
 }
 
 void EncoderStreamer::reading_loop() {
+    ThreadPlacement::bind_current_thread("infer" + std::to_string(source_->get_camera_id()),
+                                         placement_.inference, isolated_cpus_);
+    WorkerContext worker;  // 线程私有的RGB转换上下文与推理拷贝
     while (running_) {
-        ModelPtr model = nullptr;
-        model_pool_.pop(model);
-        if(!model) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-            std::cerr << "get model err!!!" << std::endl;
+        if (infer_interval_ != 1) {
+            FramePtr frame;
+            uint64_t seq;
+            if (input_queue_.pop(frame, seq, 50)) { // 50ms超时
+                overlay_frame(std::move(frame), seq, worker, true);
+            }
+            continue;
+        }
+        // 独立运行时每个推理线程长期持有一个模型实例
+        ModelPtr model;
+        if (!model_pool_->acquire(model, 50)) {
             continue;
         }
+        if (model->async_depth() > 0) {
+            infer_frames_async(*model, worker);
+        }
         while (running_) {
-            AVFrame* frame;
-            if (input_queue_.pop(frame, 50)) { // 50ms超时  
-                cv::Mat rgb_mat(
-                    height_, width_, CV_8UC3,  // 高度、宽度、3通道8位（BGR）
-                    frame->data[0],       // 数据指针（指向RGB数据）
-                    frame->linesize[0]    // linesize（每行字节数）
-                );
-                if (model->run(rgb_mat)) {
-                    output_queue_.push(frame);
+            FramePtr frame;
+            uint64_t seq;
+            if (input_queue_.pop(frame, seq, 50)) { // 50ms超时  
+                infer_frame(std::move(frame), seq, *model, worker);
+            }
+        }
+        model_pool_->release(std::move(model));
+    }
+}
+
+bool EncoderStreamer::process_next(int worker, bool allow_inference, int64_t* queue_wait_ns) {
+    if (!running_ || worker < 0 || worker >= static_cast<int>(workers_.size())) {
+        return false;
+    }
+    FramePtr frame;
+    uint64_t seq;
+    if (!input_queue_.pop(frame, seq, 0)) {
+        return false;
+    }
+    if (queue_wait_ns) {
+        const FrameMeta* meta = get_frame_meta(frame.get());
+        int64_t enqueued = meta ? meta->stage(FrameStage::Enqueued) : 0;
+        *queue_wait_ns = enqueued > 0 ? static_cast<int64_t>(LatencyHistogram::now_ns()) - enqueued : 0;
+    }
+    WorkerContext& context = workers_[worker];
+    if (infer_interval_ != 1) {
+        overlay_frame(std::move(frame), seq, context, allow_inference);
+        return true;
+    }
+    if (!allow_inference) {
+        // 逐帧推理模式下未推理的帧不能送编码，在此丢弃
+        output_ring_.skip(seq);
+        return true;
+    }
+    if (batcher_) {
+        submit_batch(std::move(frame), seq, context);
+        return true;
+    }
+    ModelPtr model;
+    while (!model_pool_->acquire(model, 50)) {
+        if (!running_) {
+            output_ring_.skip(seq);
+            return true;
+        }
+    }
+    infer_frame(std::move(frame), seq, *model, context);
+    model_pool_->release(std::move(model));
+    return true;
+}
+
+void EncoderStreamer::infer_frame(FramePtr frame, uint64_t seq, Model& model, WorkerContext& worker) {
+    mark_frame_stage(frame.get(), FrameStage::Dequeued);
+    // 模型支持YUYV输入时保留原始帧，模型输入由其一次融合转换生成，RGB帧只用于画框与编码
+    FramePtr raw;
+    if (frame->format == AV_PIX_FMT_YUYV422 && model.supports_yuyv_input()) {
+        raw = frame;
+    }
+    // NV12帧且编码器使用NV12时帧原样送编码，只为模型另行转换一份RGB输入
+    FramePtr input;
+    if (encodes_directly(frame.get())) {
+        input = convert_to_rgb(frame.get(), &worker.rgb_ctx);
+        if (!input) {
+            output_ring_.skip(seq);
+            return;
+        }
+    } else if (frame->format != AV_PIX_FMT_RGB24) {
+        // 零拷贝采集的原始帧在此转换为RGB，替换后原始帧引用释放，采集缓冲区归还驱动
+        frame = convert_to_rgb(frame.get(), &worker.rgb_ctx);
+        if (!frame) {
+            output_ring_.skip(seq);
+            return;
+        }
+    }
+    const AVFrame* image = input ? input.get() : frame.get();
+    cv::Mat rgb_mat(
+        height_, width_, CV_8UC3,  // 高度、宽度、3通道8位（BGR）
+        image->data[0],       // 数据指针（指向RGB数据）
+        image->linesize[0]    // linesize（每行字节数）
+    );
+    // 推理失败的帧在此丢弃，FramePtr释放时缓冲区自动回池
+    mark_frame_stage(frame.get(), FrameStage::InferStart);
+    Detections& detections = worker.detections;
+    bool ok = raw ? model.run_yuyv(raw.get(), rgb_mat, detections) : model.run(rgb_mat, detections);
+    mark_frame_stage(frame.get(), FrameStage::InferEnd);
+    raw.reset();
+    input.reset();
+    const FrameMeta* meta = get_frame_meta(frame.get());
+    if (meta) {
+        infer_busy_ns_.add(meta->stage(FrameStage::InferEnd) - meta->stage(FrameStage::InferStart));
+    }
+    if (ok) {
+        inferred_.add();
+        publish_detections(frame, seq, detections);
+        mark_frame_stage(frame.get(), FrameStage::OutputPut);
+        output_ring_.put(seq, std::move(frame));
+    } else {
+        output_ring_.skip(seq);
+    }
+}
+
+bool EncoderStreamer::prepare_item(FramePtr& frame, FramePtr& input, uint64_t seq, WorkerContext& worker,
+                                   BatchItem& item) {
+    mark_frame_stage(frame.get(), FrameStage::Dequeued);
+    item.seq = seq;
+    if (encodes_directly(frame.get())) {
+        // 帧原样送编码，转换出的RGB帧作为模型输入随请求保留到推理完成
+        input = convert_to_rgb(frame.get(), &worker.rgb_ctx);
+        if (!input) {
+            output_ring_.skip(seq);
+            return false;
+        }
+        item.raw = nullptr;
+        item.image = cv::Mat(height_, width_, CV_8UC3, input->data[0], input->linesize[0]);
+        mark_frame_stage(frame.get(), FrameStage::InferStart);
+        return true;
+    }
+    // 原始YUYV帧随请求保留到推理完成，模型支持时由其直接生成模型输入
+    if (frame->format == AV_PIX_FMT_YUYV422) {
+        input = frame;
+    }
+    if (frame->format != AV_PIX_FMT_RGB24) {
+        frame = convert_to_rgb(frame.get(), &worker.rgb_ctx);
+        if (!frame) {
+            input.reset();
+            output_ring_.skip(seq);
+            return false;
+        }
+    }
+    item.raw = input.get();
+    item.image = cv::Mat(height_, width_, CV_8UC3, frame->data[0], frame->linesize[0]);
+    mark_frame_stage(frame.get(), FrameStage::InferStart);
+    return true;
+}
+
+void EncoderStreamer::finish_inference(FramePtr frame, uint64_t seq, bool ok, const Detections& detections,
+                                       int64_t busy_ns) {
+    mark_frame_stage(frame.get(), FrameStage::InferEnd);
+    infer_busy_ns_.add(busy_ns);
+    if (ok) {
+        inferred_.add();
+        publish_detections(frame, seq, detections);
+        mark_frame_stage(frame.get(), FrameStage::OutputPut);
+        output_ring_.put(seq, std::move(frame));
+    } else {
+        output_ring_.skip(seq);
+    }
+}
+
+void EncoderStreamer::infer_frames_async(Model& model, WorkerContext& worker) {
+    struct Job {
+        FramePtr frame;
+        FramePtr input;
+        uint64_t seq;
+        BatchItem item;
+        int64_t submit_ns;
+    };
+    // 请求地址在提交后需保持不变，按提交顺序排列
+    std::deque<std::unique_ptr<Job>> jobs;
+    const size_t depth = static_cast<size_t>(model.async_depth());
+    int64_t last_done = 0;
+    while (running_ || !jobs.empty()) {
+        if (running_ && jobs.size() < depth) {
+            std::unique_ptr<Job> job(new Job());
+            // 有在途帧时不等待新帧，直接去取已完成的结果
+            if (input_queue_.pop(job->frame, job->seq, jobs.empty() ? 50 : 0)) {
+                if (prepare_item(job->frame, job->input, job->seq, worker, job->item)) {
+                    job->submit_ns = LatencyHistogram::now_ns();
+                    if (model.submit(&job->item)) {
+                        jobs.push_back(std::move(job));
+                    } else {
+                        output_ring_.skip(job->seq);
+                    }
                 }
+                continue;
+            }
+        }
+        if (jobs.empty()) {
+            continue;
+        }
+        BatchItem* done = model.collect();
+        std::unique_ptr<Job> job = std::move(jobs.front());
+        jobs.pop_front();
+        job->input.reset();
+        // 帧的推理区间互相重叠，忙碌时间只计自上一帧完成（或本帧提交）起的部分
+        const int64_t now = LatencyHistogram::now_ns();
+        const int64_t busy = now - std::max(job->submit_ns, last_done);
+        last_done = now;
+        finish_inference(std::move(job->frame), job->seq, done == &job->item && job->item.ok,
+                         job->item.detections, busy);
+    }
+}
+
+void EncoderStreamer::submit_batch(FramePtr frame, uint64_t seq, WorkerContext& worker) {
+    FramePtr input;
+    BatchItem item;
+    if (!prepare_item(frame, input, seq, worker, item)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(batch_mutex_);
+        batch_in_flight_++;
+    }
+    bool accepted = batcher_->submit(std::move(item), [this, frame, input](BatchItem& result, int64_t cost_ns) mutable {
+        input.reset();
+        finish_inference(std::move(frame), result.seq, result.ok, result.detections, cost_ns);
+        if (inference_cost_) {
+            inference_cost_(cost_ns);
+        }
+        batch_finished();
+    }, this);
+    if (!accepted) {
+        batch_finished();
+        output_ring_.skip(seq);
+    }
+}
+
+void EncoderStreamer::batch_finished() {
+    // 持锁通知：stop()返回后本对象可能立即析构，不能在解锁后再访问条件变量
+    std::lock_guard<std::mutex> lock(batch_mutex_);
+    if (--batch_in_flight_ == 0) {
+        batch_done_.notify_all();
+    }
+}
+
+void EncoderStreamer::overlay_frame(FramePtr frame, uint64_t seq, WorkerContext& worker, bool allow_inference) {
+    mark_frame_stage(frame.get(), FrameStage::Dequeued);
+
+    // 到达推理间隔且模型池有空闲模型时推理该帧，模型全忙时跳过，不阻塞推流
+    const int stride = std::max(infer_interval_, 1);
+    ModelPtr model;
+    if (frames_since_infer_.fetch_add(1) + 1 >= stride && allow_inference && model_pool_->acquire(model, 0)) {
+        frames_since_infer_ = 0;
+    }
+    FramePtr raw;
+    if (model && frame->format == AV_PIX_FMT_YUYV422 && model->supports_yuyv_input()) {
+        raw = frame;
+    }
+    // NV12帧且编码器使用NV12时帧原样送编码，只在推理时为模型转换一份RGB输入
+    const bool direct = encodes_directly(frame.get());
+    if (!direct && frame->format != AV_PIX_FMT_RGB24) {
+        frame = convert_to_rgb(frame.get(), &worker.rgb_ctx);
+        if (!frame) {
+            output_ring_.skip(seq);
+            model_pool_->release(std::move(model));
+            return;
+        }
+    }
+
+    // 推理输入在叠加之前取出：YUYV输入直接读原始帧，帧原样送编码时使用转换出的RGB帧，RGB输入拷贝一份
+    cv::Mat& scratch = worker.scratch;
+    FramePtr input;
+    cv::Mat model_input;
+    if (model) {
+        if (raw) {
+            scratch.create(height_, width_, CV_8UC3);
+            model_input = scratch;
+        } else if (direct) {
+            input = convert_to_rgb(frame.get(), &worker.rgb_ctx);
+            if (input) {
+                model_input = cv::Mat(height_, width_, CV_8UC3, input->data[0], input->linesize[0]);
+            } else {
+                model_pool_->release(std::move(model));
             }
+        } else {
+            cv::Mat(height_, width_, CV_8UC3, frame->data[0], frame->linesize[0]).copyTo(scratch);
+            model_input = scratch;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(overlay_mutex_);
+        if (overlay_pts_ >= 0) {
+            publish_detections(frame, overlay_seq_, overlay_detections_);
         }
     }
+    // 帧送出后不再访问其元数据，推理区间单独记录
+    const int64_t pts = frame->pts;
+    const FrameMeta* meta = get_frame_meta(frame.get());
+    const uint32_t sequence = meta ? meta->sequence : 0;
+    mark_frame_stage(frame.get(), FrameStage::OutputPut);
+    output_ring_.put(seq, std::move(frame));
+    if (!model) {
+        return;
+    }
+
+    const int64_t infer_start = LatencyHistogram::now_ns();
+    Detections& detections = worker.detections;
+    bool ok = raw ? model->run_yuyv(raw.get(), model_input, detections) : model->run(model_input, detections);
+    const int64_t infer_end = LatencyHistogram::now_ns();
+    raw.reset();
+    input.reset();
+    infer_busy_ns_.add(infer_end - infer_start);
+    if (ok) {
+        inferred_.add();
+        tracer_.record_span(TraceSpan::Inference, infer_start, infer_end, sequence);
+        std::lock_guard<std::mutex> lock(overlay_mutex_);
+        if (pts >= overlay_pts_) {
+            overlay_pts_ = pts;
+            overlay_seq_ = seq;
+            overlay_detections_.swap(detections);
+        }
+    }
+    model_pool_->release(std::move(model));
+}
+
+void EncoderStreamer::publish_detections(const FramePtr& frame, uint64_t seq, const Detections& detections) {
+    if (FrameMeta* meta = mutable_frame_meta(frame.get())) {
+        FrameDetections& out = meta->detections;
+        out.seq = seq;
+        out.count = static_cast<int>(std::min<size_t>(detections.size(), FrameDetections::kMax));
+        for (int i = 0; i < out.count; ++i) {
+            const Detection& det = detections[i];
+            FrameDetection& item = out.items[i];
+            item.class_id = static_cast<int16_t>(det.class_id);
+            item.x = static_cast<int16_t>(det.box.x);
+            item.y = static_cast<int16_t>(det.box.y);
+            item.width = static_cast<int16_t>(det.box.width);
+            item.height = static_cast<int16_t>(det.box.height);
+            item.score = det.score;
+        }
+    }
+    if (render_detections_ && !detections.empty()) {
+        if (frame->format == AV_PIX_FMT_NV12) {
+            // 原样送编码的NV12帧直接画在各平面上
+            cv::Mat luma(height_, width_, CV_8UC1, frame->data[0], frame->linesize[0]);
+            cv::Mat chroma(height_ / 2, width_ / 2, CV_8UC2, frame->data[1], frame->linesize[1]);
+            draw_detections_nv12(luma, chroma, detections);
+        } else {
+            cv::Mat rgb_mat(height_, width_, CV_8UC3, frame->data[0], frame->linesize[0]);
+            draw_detections(rgb_mat, detections);
+        }
+    }
+}
+
+FramePtr EncoderStreamer::convert_to_rgb(const AVFrame* src, SwsContext** sws_ctx) {
+    *sws_ctx = sws_getCachedContext(*sws_ctx,
+                        src->width, src->height, static_cast<AVPixelFormat>(src->format),
+                        width_, height_, AV_PIX_FMT_RGB24,
+                        SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!*sws_ctx) {
+        std::cerr << "Could not initialize the RGB conversion context" << std::endl;
+        return nullptr;
+    }
+
+    FramePtr rgb_frame = frame_pool_->acquire();
+    if (!rgb_frame) {
+        std::cerr << "frame pool acquire failed!!" << std::endl;
+        return nullptr;
+    }
+    sws_scale(*sws_ctx,
+                src->data, src->linesize,
+                0, src->height,
+                rgb_frame->data, rgb_frame->linesize);
+    rgb_frame->pts = src->pts;
+    if (src->opaque_ref) {
+        rgb_frame->opaque_ref = av_buffer_ref(src->opaque_ref);  // 帧元数据随帧传递
+    }
+    return rgb_frame;
 }
 
 void EncoderStreamer::encoding_loop() {
-    
+    ThreadPlacement::bind_current_thread("enc" + std::to_string(source_->get_camera_id()),
+                                         placement_.encode, isolated_cpus_);
+
     while (running_) {
         //从result队列中读取
-        AVFrame* frame = nullptr;
-        if(!output_queue_.pop(frame,50)) {
+        FramePtr frame;
+        if(!output_ring_.pop(frame,50)) {
             continue;
         }
 
-        int64_t original_pts = frame->pts;  
+        // 帧在编码前可能已释放，取出时先拷贝一份元数据，编码完成后记录各阶段耗时
+        mark_frame_stage(frame.get(), FrameStage::EncodeStart);
+        const FrameMeta* meta = get_frame_meta(frame.get());
+        const bool traced = meta != nullptr;
+        FrameMeta trace_meta;
+        if (traced) {
+            trace_meta = *meta;
+            if (detections_callback_) {
+                detections_callback_(*meta);
+            }
+        }
 
-        cv::Mat rgb_mat(
-            height_, width_, CV_8UC3,
-            frame->data[0],
-            frame->linesize[0]
-        );
+        // 由采集时钟推导编码pts，并统计采集到编码的延迟与丢帧
+        int64_t encode_pts = next_encode_pts(frame.get());
 
-        int mat_width = rgb_mat.cols;
-        int mat_height = rgb_mat.rows;
-        AVPixelFormat src_pix_fmt;
-        if (rgb_mat.type() == CV_8UC3) {
-            src_pix_fmt = AV_PIX_FMT_RGB24;
-        } else if (rgb_mat.type() == CV_8UC1) {
-            src_pix_fmt = AV_PIX_FMT_GRAY8;
-        } else {
-            std::cerr << "Unsupported Mat format (type=" << rgb_mat.type() << ")" << std::endl;
-            // 注意释放帧资源（根据实际帧的分配方式处理）
-            av_frame_free(&frame);
+        // 帧格式与编码器输入格式一致（如NV12采集且编码器使用NV12）时直接送编码器，省去整帧转换
+        if (encodes_directly(frame.get())) {
+            frame->pts = encode_pts;
+            frame->best_effort_timestamp = frame->pts;
+            if (!encode_and_send_frame(frame.get())) {
+                std::cerr << "Encoding failed for frame: " << encode_pts << std::endl;
+            }
+            frame.reset();  // 编码器内部持有所需引用，此处释放后缓冲区回池/归还驱动
+            if (traced) {
+                trace_meta.set_stage(FrameStage::EncodeEnd, LatencyHistogram::now_ns());
+                tracer_.record_frame(trace_meta);
+            }
             continue;
         }
 
         sws_ctx_ = sws_getCachedContext(sws_ctx_, 
-                            mat_width, mat_height, src_pix_fmt,
-                            width_, height_, AV_PIX_FMT_YUV420P,
+                            frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+                            width_, height_, codec_ctx_->pix_fmt,
                             SWS_BILINEAR, 0, 0, 0);
         if (!sws_ctx_) {
             std::cerr << "Could not initialize the conversion context" << std::endl;
-            av_frame_free(&frame);
             continue;
         }
 
         if (!sws_frame_) {
             sws_frame_ = av_frame_alloc();
-            sws_frame_->format = AV_PIX_FMT_YUV420P;
+            sws_frame_->format = codec_ctx_->pix_fmt;
             sws_frame_->width = width_;
             sws_frame_->height = height_;
             if (av_frame_get_buffer(sws_frame_, 32) < 0) {
                 std::cerr << "Could not allocate the video frame data" << std::endl;
-                av_frame_free(&frame);
                 continue;
             }
         }
 
-        uint8_t* mat_data[1] = {static_cast<uint8_t*>(rgb_mat.data)};
-        int mat_linesize[1] = {static_cast<int>(rgb_mat.step[0])};
-
         sws_scale(sws_ctx_, 
-                    mat_data, mat_linesize, 
-                    0, mat_height,
+                    frame->data, frame->linesize, 
+                    0, frame->height,
                     sws_frame_->data, sws_frame_->linesize);
 
-        av_frame_free(&frame);
+        frame.reset();  // 帧缓冲区回池
         
-        // 直接使用原始帧的pts（已升序排序）
-        sws_frame_->pts = original_pts;
+        sws_frame_->pts = encode_pts;
         sws_frame_->best_effort_timestamp = sws_frame_->pts;
         
 
@@ -180,6 +656,10 @@ void EncoderStreamer::encoding_loop() {
         if (!encode_and_send_frame(sws_frame_)) {
             std::cerr << "Encoding failed for frame: " << sws_frame_->pts << std::endl;
         }
+        if (traced) {
+            trace_meta.set_stage(FrameStage::EncodeEnd, LatencyHistogram::now_ns());
+            tracer_.record_frame(trace_meta);
+        }
     }
     // 刷新编码器
     encode_and_send_frame(nullptr);
@@ -216,11 +696,11 @@ bool EncoderStreamer::init_ffmpeg() {
     codec_ctx_->bit_rate = bitrate_;
     codec_ctx_->width = width_;
     codec_ctx_->height = height_;
-    codec_ctx_->time_base = (AVRational){1, fps_};
+    codec_ctx_->time_base = (AVRational){1, 1000000};  // 微秒，pts由采集时间戳推导
     codec_ctx_->framerate = (AVRational){fps_, 1};
     codec_ctx_->gop_size = fps_;
     codec_ctx_->max_b_frames = 0;
-    codec_ctx_->pix_fmt = AV_PIX_FMT_YUV420P;
+    codec_ctx_->pix_fmt = select_pix_fmt(codec);
     
     // H264预设
     AVDictionary *codec_options = NULL;
@@ -267,9 +747,9 @@ bool EncoderStreamer::init_ffmpeg() {
         std::cerr << "Error occurred when opening output URL" << std::endl;
         return false;
     }
-    //// cv::Mat->YUV420P frame
+    //// 转换输出帧（编码器输入格式）
     sws_frame_ = av_frame_alloc();
-    sws_frame_->format = AV_PIX_FMT_YUV420P;
+    sws_frame_->format = codec_ctx_->pix_fmt;
     sws_frame_->width = width_;
     sws_frame_->height = height_;
     sws_frame_->pts = 0;
@@ -283,17 +763,130 @@ bool EncoderStreamer::init_ffmpeg() {
     return true;
 }
 
+int64_t EncoderStreamer::next_encode_pts(const AVFrame* frame) {
+    int64_t pts;
+    const FrameMeta* meta = get_frame_meta(frame);
+    if (meta) {
+        if (first_capture_ns_ < 0) {
+            first_capture_ns_ = meta->capture_ns;
+        }
+        pts = (meta->capture_ns - first_capture_ns_) / 1000;
+        capture_to_encode_.record(LatencyHistogram::now_ns() - meta->capture_ns);
+
+        // 帧序号不连续：中间的帧被驱动或流水线丢弃
+        if (encoded_ > 0 && meta->sequence > last_sequence_ + 1) {
+            sequence_gaps_ += meta->sequence - last_sequence_ - 1;
+        }
+        last_sequence_ = meta->sequence;
+    } else {
+        pts = last_pts_ + 1000000 / fps_;
+    }
+    // 编码器要求pts严格递增
+    if (pts <= last_pts_) {
+        pts = last_pts_ + 1;
+    }
+    last_pts_ = pts;
+    if (encoded_ == 0) {
+        first_frame_ns_ = LatencyHistogram::now_ns();
+    }
+    encoded_++;
+    return pts;
+}
+
+bool EncoderStreamer::dump_trace(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Could not open trace file " << path << std::endl;
+        return false;
+    }
+    int id = source_->get_camera_id();
+    return tracer_.dump_chrome_trace(out, id, "camera " + std::to_string(id) + " (" + source_->name() + ")");
+}
+
+StreamStats EncoderStreamer::stream_stats() const {
+    StreamStats stats;
+    CaptureStats capture = source_->capture_stats();
+    stats.captured = capture.captured;
+    stats.driver_dropped = capture.driver_dropped;
+    stats.encoded = encoded_;
+    stats.inferred = inferred_.value();
+    uint64_t gaps = sequence_gaps_;
+    stats.pipeline_dropped = gaps > capture.driver_dropped ? gaps - capture.driver_dropped : 0;
+    stats.overload_dropped = overload_dropped_.value();
+    ReorderStats reorder = output_ring_.stats();
+    stats.reorder_late = reorder.late;
+    stats.reorder_skipped = reorder.skipped;
+    stats.reorder_overflow = reorder.overflow;
+    stats.capture_to_encode = capture_to_encode_.snapshot();
+    const int64_t first_frame = first_frame_ns_;
+    stats.time_to_first_frame_ms = first_frame > 0 ? (first_frame - start_ns_) / 1e6 : 0;
+    return stats;
+}
+
+StreamMetrics EncoderStreamer::metrics() {
+    StreamStats stats = stream_stats();
+    StreamMetrics m;
+    m.camera_id = source_->get_camera_id();
+    m.source = source_->name();
+    m.captured = stats.captured;
+    m.driver_dropped = stats.driver_dropped;
+    m.input_queue_depth = input_queue_.size();
+    m.input_queue_capacity = input_queue_.max_size();
+    m.reorder_held = output_ring_.held();
+    m.pipeline_dropped = stats.pipeline_dropped;
+    m.overload_dropped = stats.overload_dropped;
+    m.reorder_late = stats.reorder_late;
+    m.reorder_skipped = stats.reorder_skipped;
+    m.reorder_overflow = stats.reorder_overflow;
+    m.model_pool_size = model_pool_ ? model_pool_->size() : 0;
+    m.model_pool_idle = model_pool_ ? model_pool_->idle() : 0;
+    m.model_busy_seconds = infer_busy_ns_.value() / 1e9;
+    m.inferred = stats.inferred;
+    m.inference_latency = tracer_.snapshot()[TraceSpan::Inference];
+    m.encoded = stats.encoded;
+    m.bytes_sent = bytes_sent_;
+    m.packets_sent = packets_sent_;
+    m.target_bitrate_bps = bitrate_;
+    m.encode_errors = encode_errors_;
+    m.mux_errors = mux_errors_;
+    m.capture_to_encode = stats.capture_to_encode;
+    m.time_to_first_frame = stats.time_to_first_frame_ms / 1000;
+
+    const uint64_t now = LatencyHistogram::now_ns();
+    std::lock_guard<std::mutex> lock(metrics_mutex_);
+    m.capture_fps = capture_rate_.update(m.captured, now);
+    m.inference_fps = infer_rate_.update(m.inferred, now);
+    m.encode_fps = encode_rate_.update(m.encoded, now);
+    m.bitrate_bps = byte_rate_.update(m.bytes_sent, now) * 8;
+    double busy = busy_rate_.update(m.model_busy_seconds, now);
+    m.model_utilization = m.model_pool_size > 0 ? busy / m.model_pool_size : 0;
+    return m;
+}
+
+AVPixelFormat EncoderStreamer::select_pix_fmt(const AVCodec* codec) const {
+    // 采集格式为NV12且编码器支持时直接使用NV12，NV12帧可不经转换送入编码器
+    if (source_->av_format() == AV_PIX_FMT_NV12 && codec->pix_fmts) {
+        for (const AVPixelFormat* fmt = codec->pix_fmts; *fmt != AV_PIX_FMT_NONE; ++fmt) {
+            if (*fmt == AV_PIX_FMT_NV12) {
+                return AV_PIX_FMT_NV12;
+            }
+        }
+    }
+    return AV_PIX_FMT_YUV420P;
+}
+
 bool EncoderStreamer::encode_and_send_frame(const AVFrame* frame) {
     // 发送帧到编码器
     int ret = avcodec_send_frame(codec_ctx_, frame);
     if (ret < 0) {
         std::cerr << "Error sending a frame to the encoder: " << ret << std::endl;
+        encode_errors_++;
         return false;
     }
     
     AVPacket* pkt = av_packet_alloc();
     if (!pkt){
-        return -1;
+        return false;
     }
     
     while (ret >= 0) {
@@ -302,7 +895,8 @@ bool EncoderStreamer::encode_and_send_frame(const AVFrame* frame) {
             break;
         } else if (ret < 0) {
             std::cerr << "Error during encoding: " << ret << std::endl;
-            av_packet_unref(pkt);
+            encode_errors_++;
+            av_packet_free(&pkt);
             return false;
         }
         
@@ -310,15 +904,21 @@ bool EncoderStreamer::encode_and_send_frame(const AVFrame* frame) {
         av_packet_rescale_ts(pkt, codec_ctx_->time_base, video_stream_->time_base);
         pkt->stream_index = video_stream_->index;
         
-        // 写入帧
+        // 写入帧（写入后pkt被复用器接管并清空，先记下大小）
+        const int size = pkt->size;
         ret = av_interleaved_write_frame(fmt_ctx_, pkt);
         if (ret < 0) {
             std::cerr << "Error while writing video packet: " << ret << std::endl;
+            mux_errors_++;
+        } else {
+            bytes_sent_ += size;
+            packets_sent_++;
         }
         
         av_packet_unref(pkt);
     }
     
+    av_packet_free(&pkt);
     return true;
 }
 
@@ -347,12 +947,15 @@ void EncoderStreamer::cleanup() {
         av_frame_free(&sws_frame_);
     }
 
-    AVFrame* frame;
+    // 出队即释放，缓冲区回池
+    FramePtr frame;
     while (input_queue_.pop(frame, 0)) {
-        av_frame_free(&frame);
     }
 
-    while (output_queue_.pop(frame, 0)) {
-        av_frame_free(&frame);
+    output_ring_.clear();
+    frame.reset();
+
+    if (frame_pool_) {
+        frame_pool_->shutdown();
     }
 }
\ No newline at end of file
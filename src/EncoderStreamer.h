@@ -11,16 +11,32 @@
  * 
  * 该类整合了图像处理、FFmpeg编码以及RTMP推流功能，通过多线程实现帧处理与编码推流的异步操作，
  * 支持设置自定义图像处理处理器，适用于实时视频流传输场景。
+ * 帧来源为FrameSource接口，可使用V4L2摄像头、录像回放或合成图案。
  */
 
 #include "thread_safe_queue.h"
 #include "CameraCapture.h"
+#include "CaptureReactor.h"
+#include "FrameSource.h"
+#include "FrameMeta.h"
+#include "FramePool.h"
+#include "InferenceBatcher.h"
+#include "LatencyHistogram.h"
+#include "ReorderRing.h"
+#include "MetricsServer.h"
+#include "ShardedCounter.h"
+#include "StageTracer.h"
 #include "Model.h"
 #include "ModelFactory.h"
+#include "ModelPool.h"
 #include "threadpool.h"
+#include "ThreadPlacement.h"
 #include <vector>
 #include <memory>
 #include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
 #include <thread>
 #include <string>
 #include <iostream>
@@ -34,6 +50,28 @@ extern "C" {
 }
 
 
+// 推理跟不上采集时输入队列的处理策略
+enum class OverloadPolicy {
+    Block,       // 队列满时阻塞采集线程（不丢帧，延迟无上限）
+    DropOldest,  // 队列满时丢弃队列中最旧的帧
+    DropNewest,  // 队列满时丢弃新到的帧
+    Latest,      // 只保留最新一帧（队列深度为1的DropOldest）
+};
+
+// 单路流统计
+struct StreamStats {
+    uint64_t captured = 0;          // 从驱动取出的帧数
+    uint64_t driver_dropped = 0;    // 驱动丢帧数（采集端帧序号不连续）
+    uint64_t pipeline_dropped = 0;  // 采集后在流水线中丢弃的帧数（编码端序号缺口减去驱动丢帧）
+    uint64_t overload_dropped = 0;  // 其中因输入队列过载按策略丢弃的帧数
+    uint64_t encoded = 0;           // 送入编码器的帧数
+    uint64_t inferred = 0;          // 完成推理的帧数（推理与推流解耦时少于encoded）
+    uint64_t reorder_late = 0;      // 编码前重排时因迟到超过最长等待时间而丢弃的帧数
+    uint64_t reorder_skipped = 0;   // 编码前重排时等待超时被越过的帧序号数
+    uint64_t reorder_overflow = 0;  // 编码前重排时环满被越过的缺失帧序号数
+    LatencySnapshot capture_to_encode;  // 采集时间戳到送入编码器的延迟
+    double time_to_first_frame_ms = 0;  // start()到首帧送入编码器的时间，尚未出帧为0
+};
 
 class EncoderStreamer {
 public:
@@ -54,6 +92,24 @@ public:
                 uint32_t pixel_format = V4L2_PIX_FMT_YUYV,
                 int bitrate = 2000000);
 
+    /**
+     * @brief 构造函数，使用指定帧源（录像回放、合成图案等）
+     * @param rtmp_url RTMP服务器地址
+     * @param source 帧源，所有权归EncoderStreamer
+     * @param width 编码宽度
+     * @param height 编码高度
+     * @param fps 编码帧率
+     * @param camera_id 流ID
+     * @param bitrate 视频比特率，默认值为2000000
+     */
+    EncoderStreamer(const std::string& rtmp_url,
+                std::unique_ptr<FrameSource> source,
+                int width,
+                int height,
+                int fps,
+                int camera_id,
+                int bitrate = 2000000);
+
     /**
      * @brief 析构函数，释放资源
      */
@@ -66,6 +122,50 @@ public:
     bool initialize(ModelType model_type, const std::string& model_path, 
                    int thread_count, int model_pool_size);
 
+    /**
+     * @brief 初始化为共享推理模式：不创建自有推理线程与模型，由外部工作线程调用process_next()处理帧
+     * 多路流共用同一组推理线程与同一个模型池（见StreamManager）
+     * @param model_pool 共享模型池
+     * @param worker_count 外部工作线程数（process_next()的worker取值范围）
+     * @return 初始化成功返回true，否则返回false
+     */
+    bool initialize(ModelPoolPtr model_pool, int worker_count);
+
+    /**
+     * @brief 共享推理模式下由工作线程调用：从输入队列取出一帧（不等待）并完成推理后送入输出重排环
+     * 每帧推理模式下按需从共享模型池取模型，推理完成即归还
+     * @param worker 工作线程编号（0 ~ worker_count-1），同一编号同一时刻只能被一个线程使用
+     * @param allow_inference false时该帧不推理（调度器限速）：逐帧推理模式丢弃该帧，解耦模式只叠加最近结果
+     * @param queue_wait_ns 可选，输出该帧在输入队列中的等待时间
+     * @return 处理了一帧返回true，队列为空或流已停止返回false
+     */
+    bool process_next(int worker, bool allow_inference = true, int64_t* queue_wait_ns = nullptr);
+
+    /**
+     * @brief 输入队列中待处理的帧数（流已停止时为0）
+     */
+    size_t pending_frames() const { return running_ ? input_queue_.size() : 0; }
+
+    /**
+     * @brief 设置新帧入队通知（需在start()之前调用），共享推理模式下用于唤醒空闲的工作线程
+     * 在采集线程中调用，应尽快返回
+     */
+    void set_frame_ready_callback(std::function<void()> callback) { frame_ready_ = std::move(callback); }
+
+    /**
+     * @brief 设置跨流批处理（需在start()之前调用，仅共享推理模式的逐帧推理有效）
+     * 设置后process_next()只做取帧与格式转换，帧提交给批处理器与其他流的帧一起推理，
+     * 完成后由批处理线程送入输出重排环
+     * @param batcher 已start()的批处理器，多路流共用
+     */
+    void set_batcher(InferenceBatcherPtr batcher) { batcher_ = std::move(batcher); }
+
+    /**
+     * @brief 设置批量推理完成通知（需在start()之前调用），参数为该帧分摊的推理时间（纳秒）
+     * 批处理模式下推理在process_next()返回之后完成，调度器据此按实际推理时间计费
+     */
+    void set_inference_cost_callback(std::function<void(int64_t)> callback) { inference_cost_ = std::move(callback); }
+
     /**
      * @brief 启动编码推流线程
      */
@@ -81,6 +181,148 @@ public:
      */
     void init_model_pool(ModelType model_type, const std::string& model_path, int pool_size);
 
+    /**
+     * @brief 设置独立运行时自有模型池的加载选项（需在initialize()之前调用）
+     * 异步模式下逐帧推理的推理线程同时保持两帧在途：后一帧的预处理、前一帧的后处理与NPU推理重叠
+     * @param options 模型加载选项
+     */
+    void set_model_options(const ModelOptions& options) { model_options_ = options; }
+
+    /**
+     * @brief 设置零拷贝采集模式（需在initialize()之前调用，仅V4L2帧源有效）
+     * 开启后采集线程不再做YUYV->RGB转换，原始帧直接下发，由推理线程并行转换
+     * @param enable true开启，false关闭
+     */
+    void set_zero_copy_capture(bool enable) { if (camera_) camera_->set_zero_copy(enable); }
+
+    /**
+     * @brief 设置MJPEG解码线程数（需在initialize()之前调用，仅MJPEG采集格式有效）
+     * @param count 解码线程数
+     */
+    void set_decode_workers(int count) { if (camera_) camera_->set_decode_workers(count); }
+
+    /**
+     * @brief 设置V4L2缓冲区环深度（需在initialize()之前调用，仅V4L2帧源有效）
+     * @param count 缓冲区数量
+     */
+    void set_capture_buffer_count(int count) { if (camera_) camera_->set_buffer_count(count); }
+
+    /**
+     * @brief 设置采集缓冲区内存类型（需在initialize()之前调用，仅V4L2帧源有效）
+     * Dmabuf/Userptr时驱动直接写入分配器分配的内存，零拷贝模式下该内存再依次交给推理与编码
+     * @param mode 内存类型
+     * @param allocator 流水线共享的分配器
+     */
+    void set_capture_memory(CaptureMemory mode, std::shared_ptr<DmaAllocator> allocator) {
+        if (camera_) camera_->set_memory_mode(mode, std::move(allocator));
+    }
+
+    /**
+     * @brief 设置输入队列过载策略与深度（需在start()之前调用）
+     * 延迟敏感的流使用Latest/DropOldest，需要完整帧序列（如录像）的流使用Block
+     * @param policy 过载策略
+     * @param queue_depth 输入队列深度（Latest时固定为1）
+     */
+    void set_overload_policy(OverloadPolicy policy, int queue_depth = 100);
+
+    /**
+     * @brief 设置推理间隔，使推理帧率与推流帧率解耦（需在start()之前调用）
+     * 1（默认）：每帧推理后再编码，推流帧率受推理吞吐限制；
+     * N>1：每帧都立即编码并叠加最近一次检测结果，每N帧且有空闲模型时推理一帧；
+     * 0：同上，但只要有空闲模型就推理（推理帧率为模型池能承受的最大值）。
+     * 解耦模式下推理在帧的拷贝上进行，叠加的结果比当前帧滞后一次推理
+     * @param interval 推理间隔
+     */
+    void set_inference_interval(int interval) {
+        infer_interval_ = interval < 0 ? 1 : interval;
+        frames_since_infer_ = infer_interval_;  // 第一帧即推理
+    }
+
+    /**
+     * @brief 设置编码前重排的最长等待时间（需在start()之前调用）
+     * 推理线程乱序完成时，编码线程按序号等待缺失帧，超时后越过该帧，之后才到达的帧被丢弃
+     * @param max_hold_ms 最长等待时间（毫秒）
+     */
+    void set_reorder_hold(int max_hold_ms) { output_ring_.set_max_hold(max_hold_ms); }
+
+    /**
+     * @brief 设置是否把检测结果画到推流画面上（需在start()之前调用，默认true）
+     * 检测结果总是写入帧元数据（FrameMeta::detections）；只需检测元数据的流关闭后推理线程不再画框
+     * @param enable false时推流画面不画框
+     */
+    void set_render_detections(bool enable) { render_detections_ = enable; }
+
+    /**
+     * @brief 设置检测结果回调（需在start()之前调用），在编码线程中按输出顺序对每帧调用一次
+     * 参数为帧元数据，detections.count为-1表示该帧没有检测结果；回调应尽快返回，需要保留时拷贝检测结果
+     * @param callback 检测结果消费者
+     */
+    void set_detections_callback(std::function<void(const FrameMeta&)> callback) { detections_callback_ = std::move(callback); }
+
+    /**
+     * @brief 策略名（"block"/"drop_oldest"/"drop_newest"/"latest"）转换为过载策略，未知名称按block处理
+     */
+    static OverloadPolicy overload_policy_from_string(const std::string& name);
+
+    /**
+     * @brief 设置共享采集反应器（需在start()之前调用，仅V4L2帧源有效），多路流共用少量epoll线程采集
+     * @param reactor 已start()的反应器
+     */
+    void set_capture_reactor(std::shared_ptr<CaptureReactor> reactor) {
+        if (camera_) camera_->set_reactor(std::move(reactor));
+    }
+
+    /**
+     * @brief 设置各阶段线程的CPU亲和性与调度策略（需在initialize()之前调用）
+     * 采集配置isolate时，解码、推理、编码线程避开采集线程所用的CPU
+     * @param placement 各阶段放置配置
+     */
+    void set_thread_placement(const PipelinePlacement& placement);
+
+    /**
+     * @brief 设置帧缓冲池参数（需在initialize()之前调用）
+     * @param capacity 池中最多保留的帧缓冲区数量
+     * @param use_hugepages 是否尝试使用大页内存
+     */
+    void set_frame_pool_config(int capacity, bool use_hugepages) {
+        frame_pool_capacity_ = capacity;
+        frame_pool_hugepages_ = use_hugepages;
+    }
+
+    /**
+     * @brief 流ID
+     */
+    int camera_id() const { return source_->get_camera_id(); }
+
+    /**
+     * @brief 获取帧缓冲池统计信息
+     */
+    FramePoolStats frame_pool_stats() const {
+        return frame_pool_ ? frame_pool_->stats() : FramePoolStats();
+    }
+
+    /**
+     * @brief 获取流统计（采集/丢帧/编码帧数与采集到编码延迟）
+     */
+    StreamStats stream_stats() const;
+
+    /**
+     * @brief 获取各阶段延迟统计（排队等待与处理时间分开统计，见StageTracer）
+     */
+    StageLatency stage_latency() const { return tracer_.snapshot(); }
+
+    /**
+     * @brief 将最近的分阶段事件导出为Chrome trace JSON（chrome://tracing或ui.perfetto.dev打开）
+     * @param path 输出文件路径
+     * @return 成功返回true
+     */
+    bool dump_trace(const std::string& path) const;
+
+    /**
+     * @brief 获取指标快照（供MetricsServer导出），速率类指标为距上次调用的平均值
+     */
+    StreamMetrics metrics();
+
 private:
     /**
      * @brief 编码循环线程函数，处理队列中的帧并推流
@@ -91,6 +333,92 @@ private:
      * @brief 编码循环线程函数，处理队列中的帧并推流
      */
     void reading_loop();
+
+    // 推理线程私有的处理上下文（独立运行时为reading_loop()的局部变量，共享模式下每个工作线程一个）
+    struct WorkerContext {
+        SwsContext* rgb_ctx = nullptr;  // RGB转换上下文
+        cv::Mat scratch;                // 解耦模式下推理用的帧拷贝，不送编码
+        Detections detections;          // 逐帧推理的检测结果（复用容量，避免每帧分配）
+
+        WorkerContext() = default;
+        WorkerContext(const WorkerContext&) = delete;
+        WorkerContext& operator=(const WorkerContext&) = delete;
+        ~WorkerContext() {
+            if (rgb_ctx) sws_freeContext(rgb_ctx);
+        }
+    };
+
+    /**
+     * @brief 初始化帧缓冲池与帧源，设置帧回调（两种initialize()共用）
+     */
+    bool init_source();
+
+    /**
+     * @brief 每帧推理模式：推理并画框后送入输出重排环，失败时越过该序号
+     * @param frame 输入队列取出的帧
+     * @param seq 出队序号
+     * @param model 调用方持有的模型实例
+     * @param worker 调用线程的处理上下文
+     */
+    void infer_frame(FramePtr frame, uint64_t seq, Model& model, WorkerContext& worker);
+
+    /**
+     * @brief 逐帧推理模式下异步模型的推理循环：保持最多async_depth()帧在途，完成一帧送出一帧
+     * 独立运行的推理线程长期持有模型时使用，流停止时处理完在途帧后返回
+     * @param model 支持异步推理的模型实例
+     * @param worker 调用线程的处理上下文
+     */
+    void infer_frames_async(Model& model, WorkerContext& worker);
+
+    /**
+     * @brief 将转换为RGB后待推理的帧包装为推理请求，失败时越过该序号并返回false
+     * @param frame 输入队列取出的帧，返回时为送编码的帧（RGB帧，或可直接编码时原帧不变）
+     * @param input 输出：随请求保留到推理完成的模型输入帧（原始YUYV帧，或原帧直接编码时转换出的RGB帧）
+     * @param seq 出队序号
+     * @param worker 调用线程的处理上下文
+     * @param item 输出：推理请求
+     */
+    bool prepare_item(FramePtr& frame, FramePtr& input, uint64_t seq, WorkerContext& worker, BatchItem& item);
+
+    /**
+     * @brief 推理在调用线程之外完成（批处理、异步）时的收尾：统计并送入输出重排环，失败时越过该序号
+     * @param frame RGB帧
+     * @param seq 出队序号
+     * @param ok 推理是否成功
+     * @param detections 检测结果
+     * @param busy_ns 计入模型忙碌时间的推理耗时
+     */
+    void finish_inference(FramePtr frame, uint64_t seq, bool ok, const Detections& detections, int64_t busy_ns);
+
+    /**
+     * @brief 把检测结果写入帧元数据，开启渲染时画到帧上（帧此时只由调用线程持有）
+     * @param frame RGB帧
+     * @param seq 结果所属帧的出队序号
+     * @param detections 检测结果（坐标为帧的坐标）
+     */
+    void publish_detections(const FramePtr& frame, uint64_t seq, const Detections& detections);
+
+    /**
+     * @brief 批处理模式：转换为RGB后提交给批处理器，完成回调中送入输出重排环，失败时越过该序号
+     * @param frame 输入队列取出的帧
+     * @param seq 出队序号
+     * @param worker 调用线程的处理上下文
+     */
+    void submit_batch(FramePtr frame, uint64_t seq, WorkerContext& worker);
+
+    /**
+     * @brief 一个提交给批处理器的帧已完成（或未被接受），在途帧数归零时唤醒stop()
+     */
+    void batch_finished();
+
+    /**
+     * @brief 推理与推流解耦模式：叠加最近检测结果后立即送编码，到达推理间隔且有空闲模型时再对该帧推理并更新检测结果
+     * @param frame 输入队列取出的帧
+     * @param seq 出队序号
+     * @param worker 调用线程的处理上下文
+     * @param allow_inference false时该帧只叠加不推理
+     */
+    void overlay_frame(FramePtr frame, uint64_t seq, WorkerContext& worker, bool allow_inference);
     
     /**
      * @brief 初始化FFmpeg相关组件
@@ -103,6 +431,45 @@ private:
      */
     void cleanup();
     
+    /**
+     * @brief 帧源回调：按过载策略将帧放入输入队列
+     * @param frame 帧源输出的帧
+     */
+    void enqueue_frame(FramePtr frame);
+
+    /**
+     * @brief 将原始格式帧转换为RGB24帧（零拷贝采集模式下在推理线程中调用）
+     * @param src 原始格式帧
+     * @param sws_ctx 调用线程私有的转换上下文（按需创建/复用）
+     * @return 成功返回从帧池获取的RGB24帧，失败返回nullptr
+     */
+    FramePtr convert_to_rgb(const AVFrame* src, SwsContext** sws_ctx);
+
+    /**
+     * @brief 帧能否不经转换直接送入编码器（NV12帧且编码器使用NV12，尺寸一致）
+     * 这样的帧由推理线程原样送入输出重排环，模型输入另行转换，检测框直接画在NV12平面上；
+     * 其他格式没有对应的画框实现，仍转换为RGB
+     */
+    bool encodes_directly(const AVFrame* frame) const {
+        return frame->format == AV_PIX_FMT_NV12 && codec_ctx_->pix_fmt == AV_PIX_FMT_NV12
+               && frame->width == width_ && frame->height == height_;
+    }
+
+    /**
+     * @brief 选择编码器输入像素格式
+     * @param codec 编码器
+     * @return 采集为NV12且编码器支持NV12时返回AV_PIX_FMT_NV12，否则返回AV_PIX_FMT_YUV420P
+     */
+    AVPixelFormat select_pix_fmt(const AVCodec* codec) const;
+
+    /**
+     * @brief 由帧的采集时间戳推导编码pts（微秒，相对首帧），并更新延迟与丢帧统计
+     * 帧未携带元数据时按帧率递推；保证返回值严格递增
+     * @param frame 待编码帧
+     * @return 编码pts（编码器时间基1/1000000）
+     */
+    int64_t next_encode_pts(const AVFrame* frame);
+
     /**
      * @brief 编码并发送帧数据
      * @param frame 待编码的AVFrame
@@ -113,7 +480,7 @@ private:
     
 private:
     struct AscendingComparator {
-        bool operator()(AVFrame* a, AVFrame* b) {
+        bool operator()(const FramePtr& a, const FramePtr& b) {
             return a->pts > b->pts;  // priority_queue是最大堆,返回true会使a排在b后面，这里实现升序
         }
     };
@@ -124,17 +491,62 @@ private:
     int fps_;
     int bitrate_;
     int thread_count_ {0};
-    CameraCapture cam_;
+    std::unique_ptr<FrameSource> source_;
+    CameraCapture* camera_ = nullptr;  // 帧源为V4L2摄像头时指向source_，用于摄像头专属设置
     tdpool::ThreadPool pool_;
 
+    // 帧缓冲池（采集、推理、编码共享）
+    std::shared_ptr<FramePool> frame_pool_;
+    int frame_pool_capacity_ = 16;
+    bool frame_pool_hugepages_ = false;
+
     std::atomic<bool> running_{false};
     std::thread encoding_thread_;
 
-    ThreadSafeQueue<ModelPtr> model_pool_;
+    // 分阶段延迟统计
+    StageTracer tracer_;
+
+    // 推理与推流解耦
+    int infer_interval_ = 1;
+    std::atomic<int> frames_since_infer_{1};  // 距上次开始推理经过的帧数
+    std::mutex overlay_mutex_;
+    Detections overlay_detections_;           // 最近一次推理的检测结果，叠加到其后的帧上
+    int64_t overlay_pts_ = -1;                // overlay_detections_对应帧的pts，较旧帧的结果不覆盖较新结果
+    uint64_t overlay_seq_ = 0;                // overlay_detections_对应帧的出队序号
+    ShardedCounter inferred_;                 // 多个推理线程累加，按线程分片避免缓存行争用
+    ShardedCounter infer_busy_ns_;            // 各模型实例累计推理时间
+
+    // 线程放置
+    PipelinePlacement placement_;
+    std::vector<int> isolated_cpus_;  // 采集独占的CPU，其他阶段避开
+
+    ModelPoolPtr model_pool_;
+    ModelOptions model_options_;
+
+    // 共享推理模式
+    bool shared_workers_ = false;
+    std::vector<WorkerContext> workers_;  // 按工作线程编号索引
+    std::function<void()> frame_ready_;
+
+    // 跨流批处理
+    InferenceBatcherPtr batcher_;
+    std::function<void(int64_t)> inference_cost_;
+    std::mutex batch_mutex_;
+    std::condition_variable batch_done_;  // 最后一个在途帧完成时通知stop()
+    int batch_in_flight_ = 0;              // 已提交尚未完成的帧数，stop()等待其归零
+
+    // 检测结果输出
+    bool render_detections_ = true;
+    std::function<void(const FrameMeta&)> detections_callback_;
+
+    // 输入队列过载策略
+    OverloadPolicy overload_policy_ = OverloadPolicy::Block;
+    ShardedCounter overload_dropped_;
     
     // 帧输入队列
-    ThreadSafeQueue<AVFrame*,AscendingComparator> input_queue_;
-    ThreadSafeQueue<AVFrame*,AscendingComparator> output_queue_;
+    ThreadSafeQueue<FramePtr,AscendingComparator> input_queue_;
+    // 输出重排环：按出输入队列的序号严格有序地送编码，缺失帧最多等待设定时间
+    ReorderRing<FramePtr> output_ring_{64, 200};
     
     // FFmpeg 上下文
     AVFormatContext* fmt_ctx_ = nullptr;
@@ -142,5 +554,28 @@ private:
     AVStream* video_stream_ = nullptr;
     SwsContext* sws_ctx_ = nullptr;
     AVFrame* sws_frame_ = nullptr;
-    int64_t pts_ = 0;
+
+    // 启动耗时：start()时间与首帧送入编码器的时间
+    int64_t start_ns_ = 0;
+    std::atomic<int64_t> first_frame_ns_{0};
+
+    // 编码时间戳与统计（仅在编码线程中更新）
+    int64_t first_capture_ns_ = -1;
+    int64_t last_pts_ = -1;
+    uint32_t last_sequence_ = 0;
+    std::atomic<uint64_t> encoded_{0};
+    std::atomic<uint64_t> sequence_gaps_{0};
+    LatencyHistogram capture_to_encode_;
+    std::atomic<uint64_t> bytes_sent_{0};
+    std::atomic<uint64_t> packets_sent_{0};
+    std::atomic<uint64_t> encode_errors_{0};
+    std::atomic<uint64_t> mux_errors_{0};
+
+    // 指标导出的速率计算（仅在metrics()中使用）
+    std::mutex metrics_mutex_;
+    RateMeter capture_rate_;
+    RateMeter infer_rate_;
+    RateMeter encode_rate_;
+    RateMeter byte_rate_;
+    RateMeter busy_rate_;
 };
\ No newline at end of file
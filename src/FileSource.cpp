@@ -0,0 +1,212 @@
+#include "FileSource.h"
+#include "FrameMeta.h"
+#include "LatencyHistogram.h"
+#include <iostream>
+
+extern "C" {
+#include <libavutil/mathematics.h>
+}
+
+#ifndef MODULE_TEST
+#define MODULE_TEST 0
+#endif
+
+FileSource::FileSource(const std::string& path, bool realtime, bool loop)
+    : path_(path),
+      realtime_(realtime),
+      loop_(loop) {}
+
+FileSource::~FileSource() {
+    stop();
+    av_packet_free(&packet_);
+    avcodec_free_context(&codec_ctx_);
+    avformat_close_input(&fmt_ctx_);
+}
+
+bool FileSource::initialize() {
+    if (initialized_) return true;
+
+    if (avformat_open_input(&fmt_ctx_, path_.c_str(), nullptr, nullptr) < 0) {
+        std::cerr << "FileSource: could not open " << path_ << std::endl;
+        return false;
+    }
+    if (avformat_find_stream_info(fmt_ctx_, nullptr) < 0) {
+        std::cerr << "FileSource: could not find stream info in " << path_ << std::endl;
+        return false;
+    }
+
+    const AVCodec* codec = nullptr;
+    stream_index_ = av_find_best_stream(fmt_ctx_, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+    if (stream_index_ < 0 || !codec) {
+        std::cerr << "FileSource: no decodable video stream in " << path_ << std::endl;
+        return false;
+    }
+    AVStream* stream = fmt_ctx_->streams[stream_index_];
+    time_base_ = stream->time_base;
+    if (stream->avg_frame_rate.num > 0 && stream->avg_frame_rate.den > 0) {
+        frame_interval_ns_ = 1000000000LL * stream->avg_frame_rate.den / stream->avg_frame_rate.num;
+    }
+
+    codec_ctx_ = avcodec_alloc_context3(codec);
+    if (!codec_ctx_) {
+        std::cerr << "FileSource: could not allocate decoder context" << std::endl;
+        return false;
+    }
+    if (avcodec_parameters_to_context(codec_ctx_, stream->codecpar) < 0) {
+        std::cerr << "FileSource: could not copy codec parameters" << std::endl;
+        return false;
+    }
+    codec_ctx_->thread_count = 0;  // 自动选择解码线程数
+    codec_ctx_->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    if (avcodec_open2(codec_ctx_, codec, nullptr) < 0) {
+        std::cerr << "FileSource: could not open decoder " << codec->name << std::endl;
+        return false;
+    }
+
+    packet_ = av_packet_alloc();
+    if (!packet_) {
+        return false;
+    }
+    initialized_ = true;
+    return true;
+}
+
+void FileSource::start() {
+    if (!initialized_ && !initialize()) {
+        return;
+    }
+    if (running_) return;
+
+    stop();  // 回收上一次已播放结束的线程
+    running_ = true;
+    thread_.reset(new std::thread(&FileSource::read_thread, this));
+}
+
+void FileSource::stop() {
+    // 播放结束时线程自行退出（running_已为false），此处仍需回收线程
+    running_ = false;
+    if (thread_ && thread_->joinable()) {
+        thread_->join();
+    }
+    thread_.reset();
+}
+
+bool FileSource::rewind() {
+    // 新一轮的时间轴接在上一轮最后一帧之后
+    loop_offset_ns_ = last_offset_ns_ + frame_interval_ns_;
+    first_pts_ = AV_NOPTS_VALUE;
+
+    if (av_seek_frame(fmt_ctx_, stream_index_, 0, AVSEEK_FLAG_BACKWARD) < 0) {
+        std::cerr << "FileSource: seek to start failed" << std::endl;
+        return false;
+    }
+    avcodec_flush_buffers(codec_ctx_);
+    return true;
+}
+
+bool FileSource::decode_next(AVFrame* frame) {
+    bool rewound = false;
+    while (running_) {
+        int ret = avcodec_receive_frame(codec_ctx_, frame);
+        if (ret == 0) {
+            return true;
+        }
+        if (ret == AVERROR_EOF) {
+            // 回到开头后仍解不出帧说明文件不可用，避免空转
+            if (!loop_ || rewound || !rewind()) {
+                return false;
+            }
+            rewound = true;
+            continue;
+        }
+        if (ret != AVERROR(EAGAIN)) {
+            std::cerr << "FileSource: decode error " << ret << std::endl;
+            return false;
+        }
+
+        ret = av_read_frame(fmt_ctx_, packet_);
+        if (ret < 0) {
+            avcodec_send_packet(codec_ctx_, nullptr);  // 文件结束，取出解码器中剩余的帧
+            continue;
+        }
+        if (packet_->stream_index == stream_index_) {
+            avcodec_send_packet(codec_ctx_, packet_);  // 损坏的包直接跳过
+        }
+        av_packet_unref(packet_);
+    }
+    return false;
+}
+
+void FileSource::read_thread() {
+    run_thread_init();
+    FramePacer pacer(realtime_);
+    uint32_t sequence = 0;
+    while (running_) {
+        FramePtr frame = make_frame_ptr(av_frame_alloc());
+        if (!frame || !decode_next(frame.get())) {
+            break;
+        }
+
+        // 文件时间戳换算为相对首帧的回放时间
+        int64_t offset_ns;
+        int64_t pts = frame->best_effort_timestamp;
+        if (pts == AV_NOPTS_VALUE) {
+            offset_ns = last_offset_ns_ < 0 ? 0 : last_offset_ns_ + frame_interval_ns_;
+        } else {
+            if (first_pts_ == AV_NOPTS_VALUE) {
+                first_pts_ = pts;
+            }
+            offset_ns = loop_offset_ns_ + av_rescale_q(pts - first_pts_, time_base_, AVRational{1, 1000000000});
+        }
+        if (offset_ns < last_offset_ns_) {
+            offset_ns = last_offset_ns_;
+        }
+        last_offset_ns_ = offset_ns;
+        pacer.wait(offset_ns);
+
+        FrameMeta meta;
+        meta.capture_ns = LatencyHistogram::now_ns();
+        meta.sequence = sequence++;
+        meta.camera_id = camera_id_;
+        meta.set_stage(FrameStage::SourceOut, meta.capture_ns);
+        set_frame_meta(frame.get(), meta);
+        frame->pts = meta.capture_ns / 1000;
+
+        frames_++;
+        if (frame_callback_) {
+            frame_callback_(std::move(frame));
+        }
+    }
+    running_ = false;
+    std::cout << "FileSource: playback of " << path_ << " finished after " << frames_ << " frames" << std::endl;
+}
+
+
+#if MODULE_TEST
+//g++ -DMODULE_TEST=1 -o test_file_source FileSource.cpp -lpthread -lavformat -lavcodec -lavutil
+// 回放测试：./test_file_source <录像文件> [fast]，输出出帧数与帧率
+#include <cstring>
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <video_file> [fast]" << std::endl;
+        return 1;
+    }
+    bool realtime = !(argc > 2 && strcmp(argv[2], "fast") == 0);
+    FileSource source(argv[1], realtime, false);
+    std::atomic<uint64_t> received{0};
+    source.set_frame_callback([&](FramePtr frame) { received++; });
+    if (!source.initialize()) {
+        return 1;
+    }
+    auto begin = std::chrono::steady_clock::now();
+    source.start();
+    while (source.is_running()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    source.stop();
+    std::cout << "format: " << source.av_format() << " frames: " << received
+              << " fps: " << received / seconds << (realtime ? " (realtime)" : " (fast)") << std::endl;
+    return received > 0 ? 0 : 1;
+}
+#endif
@@ -0,0 +1,92 @@
+#pragma once
+/**
+ * @file FileSource.h
+ * @class FileSource
+ * @brief 录像文件回放帧源
+ * @author achene
+ * @date 2025-08-05
+ *
+ * 通过libavformat解封装、libavcodec解码任意录像文件中的视频流，按原始格式
+ * （通常为YUV420P/NV12）逐帧输出，用于复现现场录像中的负载问题。
+ *
+ * 主要功能特点：
+ * - 实时模式按文件时间戳节拍出帧；尽快模式连续出帧，由下游队列反压限速
+ * - 可循环回放，循环时时间戳顺延保证单调递增
+ * - 解码器使用多线程（帧/片级），不限制输出分辨率，下游转换时统一缩放
+ */
+#include "FrameSource.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+class FileSource : public FrameSource {
+public:
+    /**
+     * @brief 构造函数
+     * @param path 录像文件路径（或libavformat支持的URL）
+     * @param realtime true按文件时间戳实时出帧，false尽快出帧
+     * @param loop 文件结束后是否从头循环
+     */
+    FileSource(const std::string& path, bool realtime = true, bool loop = true);
+
+    ~FileSource() override;
+
+    bool initialize() override;
+    void start() override;
+    void stop() override;
+    bool is_running() const override { return running_; }
+    AVPixelFormat av_format() const override {
+        return codec_ctx_ ? codec_ctx_->pix_fmt : AV_PIX_FMT_NONE;
+    }
+    std::string name() const override { return "file:" + path_; }
+    CaptureStats capture_stats() const override {
+        CaptureStats stats;
+        stats.captured = frames_;
+        return stats;
+    }
+
+private:
+    /**
+     * @brief 读取与解码线程主函数
+     */
+    void read_thread();
+
+    /**
+     * @brief 解码下一帧（文件结束时按需回到开头）
+     * @param frame 输出帧
+     * @return 成功返回true，文件结束（不循环）或出错返回false
+     */
+    bool decode_next(AVFrame* frame);
+
+    /**
+     * @brief 回到文件开头并清空解码器
+     * @return 成功返回true，失败返回false
+     */
+    bool rewind();
+
+    std::string path_;
+    bool realtime_;
+    bool loop_;
+
+    AVFormatContext* fmt_ctx_ = nullptr;
+    AVCodecContext* codec_ctx_ = nullptr;
+    AVPacket* packet_ = nullptr;
+    int stream_index_ = -1;
+    AVRational time_base_{1, 1};
+    int64_t frame_interval_ns_ = 40000000;  // 时间戳缺失时的帧间隔（默认25fps）
+
+    // 回放时间轴（纳秒，相对首帧），循环时整体顺延
+    int64_t first_pts_ = AV_NOPTS_VALUE;
+    int64_t loop_offset_ns_ = 0;
+    int64_t last_offset_ns_ = -1;
+
+    std::atomic<bool> running_{false};
+    std::atomic<bool> initialized_{false};
+    std::atomic<uint64_t> frames_{0};
+    std::unique_ptr<std::thread> thread_;
+};
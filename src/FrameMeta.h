@@ -0,0 +1,132 @@
+#pragma once
+/**
+ * @file FrameMeta.h
+ * @brief 帧元数据（采集时间戳、驱动帧序号、各阶段时间点、检测结果）
+ * @author achene
+ * @date 2025-08-05
+ *
+ * 元数据挂在AVFrame::opaque_ref上随帧在流水线中传递：av_frame_ref()、
+ * av_frame_copy_props()都会带上同一份元数据引用，格式转换后的帧无需额外处理。
+ * MJPEG压缩帧通过AVPacket::opaque_ref携带，由解码池转挂到解码后的帧上。
+ * 元数据缓冲区来自进程级AVBufferPool，每帧不做堆分配。
+ *
+ * 各阶段在边界处调用mark_frame_stage()记录时间点，同一帧同一时刻只由一个线程处理，
+ * 线程间经队列交接，无需额外同步。
+ */
+#include "LatencyHistogram.h"
+#include <cstdint>
+
+extern "C" {
+#include <libavutil/buffer.h>
+#include <libavutil/frame.h>
+}
+
+// 流水线阶段边界
+enum class FrameStage : int {
+    Captured,     // 采集（即capture_ns）
+    SourceOut,    // 帧源出帧（V4L2出队、回放/合成出帧）
+    Enqueued,     // 放入推理输入队列
+    Dequeued,     // 推理线程从输入队列取出
+    InferStart,   // 开始推理（转换为RGB之后）
+    InferEnd,     // 推理结束
+    OutputPut,    // 放入输出重排环
+    EncodeStart,  // 编码线程取出
+    EncodeEnd,    // 编码并发送完成
+    Count,
+};
+
+// 随帧传递的单个检测结果（紧凑格式，坐标为推理所用RGB图像的像素坐标）
+struct FrameDetection {
+    int16_t class_id;
+    int16_t x;
+    int16_t y;
+    int16_t width;
+    int16_t height;
+    float score;
+};
+
+// 帧携带的检测结果，定长存放在元数据中，随帧传递不做堆分配
+struct FrameDetections {
+    static const int kMax = 64;  // 与后处理保留的最大目标数（OBJ_NUMB_MAX_SIZE）一致
+    uint64_t seq = 0;            // 结果所属帧的流内序号：逐帧推理时为该帧，推理与推流解耦时为最近一次推理的帧
+    int count = -1;              // 结果个数，-1表示该帧没有检测结果（未推理或推理失败）
+    FrameDetection items[kMax];
+};
+
+struct FrameMeta {
+    int64_t capture_ns = 0;  // 采集时间（CLOCK_MONOTONIC纳秒，来自v4l2_buffer.timestamp）
+    uint32_t sequence = 0;   // 驱动帧序号（v4l2_buffer.sequence），序号不连续即驱动丢帧
+    int camera_id = 0;
+    int dma_fd = -1;         // 零拷贝帧所在DMA-BUF的fd（帧存活期间有效），-1表示非DMA-BUF内存
+    int64_t stage_ns[static_cast<int>(FrameStage::Count)] = {};  // 各阶段时间点（单调时钟纳秒），0表示未经过
+    FrameDetections detections;  // 检测结果，推理完成后由推理线程写入
+
+    /**
+     * @brief 获取阶段时间点，Captured返回capture_ns
+     */
+    int64_t stage(FrameStage s) const {
+        return s == FrameStage::Captured ? capture_ns : stage_ns[static_cast<int>(s)];
+    }
+
+    void set_stage(FrameStage s, int64_t ns) { stage_ns[static_cast<int>(s)] = ns; }
+};
+
+/**
+ * @brief 创建一份元数据引用
+ * @param meta 元数据
+ * @return 成功返回AVBufferRef，失败返回nullptr
+ */
+inline AVBufferRef* make_frame_meta_ref(const FrameMeta& meta) {
+    static AVBufferPool* pool = av_buffer_pool_init(sizeof(FrameMeta), av_buffer_allocz);
+    AVBufferRef* ref = av_buffer_pool_get(pool);
+    if (ref) {
+        *reinterpret_cast<FrameMeta*>(ref->data) = meta;
+    }
+    return ref;
+}
+
+/**
+ * @brief 为帧设置元数据（替换已有元数据）
+ * @return 成功返回true，失败返回false
+ */
+inline bool set_frame_meta(AVFrame* frame, const FrameMeta& meta) {
+    AVBufferRef* ref = make_frame_meta_ref(meta);
+    if (!ref) {
+        return false;
+    }
+    av_buffer_unref(&frame->opaque_ref);
+    frame->opaque_ref = ref;
+    return true;
+}
+
+/**
+ * @brief 获取帧的元数据
+ * @return 元数据指针，帧未携带元数据时返回nullptr
+ */
+inline const FrameMeta* get_frame_meta(const AVFrame* frame) {
+    if (!frame || !frame->opaque_ref || static_cast<size_t>(frame->opaque_ref->size) < sizeof(FrameMeta)) {
+        return nullptr;
+    }
+    return reinterpret_cast<const FrameMeta*>(frame->opaque_ref->data);
+}
+
+/**
+ * @brief 获取帧的可写元数据（同一帧同一时刻只由一个线程处理）
+ * @return 元数据指针，帧未携带元数据时返回nullptr
+ */
+inline FrameMeta* mutable_frame_meta(const AVFrame* frame) {
+    return get_frame_meta(frame) ? reinterpret_cast<FrameMeta*>(frame->opaque_ref->data) : nullptr;
+}
+
+/**
+ * @brief 记录帧到达某阶段边界的时间点（帧未携带元数据时为空操作）
+ * @param frame 帧
+ * @param stage 阶段边界
+ * @param ns 时间点，默认取当前单调时钟
+ */
+inline void mark_frame_stage(const AVFrame* frame, FrameStage stage,
+                             int64_t ns = static_cast<int64_t>(LatencyHistogram::now_ns())) {
+    if (FrameMeta* meta = mutable_frame_meta(frame)) {
+        meta->set_stage(stage, ns);
+    }
+}
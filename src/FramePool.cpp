@@ -0,0 +1,240 @@
+#include "FramePool.h"
+#include <sys/mman.h>
+#include <cstdlib>
+#include <iostream>
+
+extern "C" {
+#include <libavutil/imgutils.h>
+}
+
+#ifndef MODULE_TEST
+#define MODULE_TEST 0
+#endif
+
+namespace {
+constexpr size_t kSlabAlign = 64;                  // 缓冲区与行对齐（满足NEON/SSE访问）
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;  // 2MB大页
+
+inline size_t align_up(size_t value, size_t align) {
+    return (value + align - 1) & ~(align - 1);
+}
+
+/**
+ * @brief 计算帧的行宽与总大小（每行按kSlabAlign对齐）
+ * @return 成功返回true，不支持的格式返回false
+ */
+bool frame_layout(AVPixelFormat format, int width, int height, int linesizes[4], size_t* total) {
+    if (av_image_fill_linesizes(linesizes, format, width) < 0) {
+        return false;
+    }
+    ptrdiff_t aligned[4];
+    for (int i = 0; i < 4; ++i) {
+        linesizes[i] = static_cast<int>(align_up(linesizes[i], kSlabAlign));
+        aligned[i] = linesizes[i];
+    }
+    size_t plane_sizes[4];
+    if (av_image_fill_plane_sizes(plane_sizes, format, height, aligned) < 0) {
+        return false;
+    }
+    *total = 0;
+    for (int i = 0; i < 4; ++i) {
+        *total += plane_sizes[i];
+    }
+    // 尾部预留对齐余量，允许SIMD读越过最后一行
+    *total += kSlabAlign;
+    return true;
+}
+
+void free_aligned_slab(void* opaque, uint8_t* data) {
+    free(data);
+}
+
+void free_huge_slab(void* opaque, uint8_t* data) {
+    munmap(data, reinterpret_cast<uintptr_t>(opaque));
+}
+} // namespace
+
+struct FramePool::State {
+    bool use_hugepages = false;
+    std::atomic<uint64_t> pool_gets{0};    // 从AVBufferPool取缓冲区次数
+    std::atomic<uint64_t> allocs{0};       // 新分配缓冲区次数
+    std::atomic<uint64_t> overflows{0};    // 超出容量或大小的临时分配次数
+    std::atomic<int> in_flight{0};
+    std::atomic<int> pooled_in_flight{0};
+    std::atomic<int> leaked{0};
+};
+
+struct FramePool::SlabHolder {
+    AVBufferRef* slab;
+    std::shared_ptr<State> state;
+    bool pooled;
+};
+
+FramePool::FramePool(AVPixelFormat format, int width, int height,
+                     int capacity, bool use_hugepages)
+    : format_(format),
+      width_(width),
+      height_(height),
+      capacity_(capacity),
+      slab_size_(0),
+      state_(std::make_shared<State>()) {
+    state_->use_hugepages = use_hugepages;
+    int linesizes[4];
+    if (!frame_layout(format_, width_, height_, linesizes, &slab_size_)) {
+        std::cerr << "FramePool: unsupported pixel format " << format_ << std::endl;
+        return;
+    }
+    pool_ = av_buffer_pool_init2(slab_size_, state_.get(), &FramePool::alloc_slab, nullptr);
+    if (!pool_) {
+        std::cerr << "FramePool: av_buffer_pool_init2 failed" << std::endl;
+    }
+}
+
+FramePool::~FramePool() {
+    // 在途缓冲区归还后AVBufferPool才会真正释放
+    av_buffer_pool_uninit(&pool_);
+}
+
+AVBufferRef* FramePool::alloc_slab(void* opaque, size_t size) {
+    State* state = static_cast<State*>(opaque);
+    state->allocs++;
+
+    if (state->use_hugepages) {
+        size_t length = align_up(size, kHugePageSize);
+        void* data = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data != MAP_FAILED) {
+            AVBufferRef* ref = av_buffer_create(static_cast<uint8_t*>(data), size, free_huge_slab,
+                                                reinterpret_cast<void*>(length), 0);
+            if (!ref) {
+                munmap(data, length);
+            }
+            return ref;
+        }
+        // 未预留大页时退回普通对齐内存
+    }
+
+    void* data = nullptr;
+    if (posix_memalign(&data, kSlabAlign, size) != 0) {
+        return nullptr;
+    }
+    AVBufferRef* ref = av_buffer_create(static_cast<uint8_t*>(data), size, free_aligned_slab, nullptr, 0);
+    if (!ref) {
+        free(data);
+    }
+    return ref;
+}
+
+void FramePool::release_slab(void* opaque, uint8_t* data) {
+    SlabHolder* holder = static_cast<SlabHolder*>(opaque);
+    holder->state->in_flight--;
+    if (holder->pooled) {
+        holder->state->pooled_in_flight--;
+    }
+    av_buffer_unref(&holder->slab);  // 池缓冲区回池，临时缓冲区直接释放
+    delete holder;
+}
+
+FramePtr FramePool::acquire() {
+    AVFrame* frame = av_frame_alloc();
+    if (!frame) {
+        return nullptr;
+    }
+    frame->format = format_;
+    frame->width = width_;
+    frame->height = height_;
+    if (!attach_buffer(frame)) {
+        av_frame_free(&frame);
+        return nullptr;
+    }
+    return make_frame_ptr(frame);
+}
+
+bool FramePool::attach_buffer(AVFrame* frame) {
+    int linesizes[4];
+    size_t size = 0;
+    AVPixelFormat format = static_cast<AVPixelFormat>(frame->format);
+    if (!frame_layout(format, frame->width, frame->height, linesizes, &size)) {
+        std::cerr << "FramePool: unsupported pixel format " << frame->format << std::endl;
+        return false;
+    }
+
+    // 容量内且大小合适时从池中取，否则临时分配
+    bool pooled = false;
+    if (pool_ && size <= slab_size_) {
+        if (state_->pooled_in_flight.fetch_add(1) < capacity_) {
+            pooled = true;
+        } else {
+            state_->pooled_in_flight--;
+        }
+    }
+
+    AVBufferRef* slab = nullptr;
+    if (pooled) {
+        state_->pool_gets++;
+        slab = av_buffer_pool_get(pool_);
+    } else {
+        state_->overflows++;
+        slab = alloc_slab(state_.get(), size);
+    }
+    if (!slab) {
+        if (pooled) state_->pooled_in_flight--;
+        return false;
+    }
+
+    SlabHolder* holder = new SlabHolder{slab, state_, pooled};
+    frame->buf[0] = av_buffer_create(slab->data, size, &FramePool::release_slab, holder, 0);
+    if (!frame->buf[0]) {
+        if (pooled) state_->pooled_in_flight--;
+        av_buffer_unref(&holder->slab);
+        delete holder;
+        return false;
+    }
+    state_->in_flight++;
+
+    av_image_fill_pointers(frame->data, format, frame->height, frame->buf[0]->data, linesizes);
+    for (int i = 0; i < 4; ++i) {
+        frame->linesize[i] = linesizes[i];
+    }
+    return true;
+}
+
+void FramePool::shutdown() {
+    int leaked = state_->in_flight;
+    state_->leaked = leaked;
+    if (leaked > 0) {
+        std::cerr << "FramePool: " << leaked << " frames not returned" << std::endl;
+    }
+}
+
+FramePoolStats FramePool::stats() const {
+    FramePoolStats stats;
+    uint64_t pool_allocs = state_->allocs - state_->overflows;
+    stats.hits = state_->pool_gets - pool_allocs;
+    stats.misses = state_->allocs;
+    stats.in_flight = state_->in_flight;
+    stats.leaked = state_->leaked;
+    return stats;
+}
+
+
+#if MODULE_TEST
+//g++ -DMODULE_TEST=1 -o test_frame_pool FramePool.cpp -lavutil
+#include <vector>
+int main() {
+    FramePool pool(AV_PIX_FMT_RGB24, 1920, 1080, 4);
+    std::vector<FramePtr> held;
+    for (int round = 0; round < 100; ++round) {
+        for (int i = 0; i < 6; ++i) {  // 超出容量2帧，走临时分配
+            held.push_back(pool.acquire());
+        }
+        held.clear();
+    }
+    FramePtr leak = pool.acquire();
+    pool.shutdown();
+    FramePoolStats stats = pool.stats();
+    std::cout << "hits: " << stats.hits << " misses: " << stats.misses
+              << " in_flight: " << stats.in_flight << " leaked: " << stats.leaked << std::endl;
+    return (stats.misses == 4 + 200 && stats.leaked == 1) ? 0 : 1;
+}
+#endif
@@ -0,0 +1,119 @@
+#pragma once
+/**
+ * @file FramePool.h
+ * @class FramePool
+ * @brief 可复用的视频帧缓冲池
+ * @author achene
+ * @date 2025-08-05
+ *
+ * 基于FFmpeg AVBufferPool实现的帧缓冲池，每路视频流一个实例，
+ * 由CameraCapture、推理线程与EncoderStreamer共享，避免每帧通过malloc申请/释放数MB内存。
+ *
+ * 主要功能特点：
+ * - 固定容量：池中最多保留capacity块缓冲区，超出部分临时分配且用完即释放
+ * - 缓冲区按64字节对齐，可选使用大页（MAP_HUGETLB）减少TLB压力
+ * - 帧以FramePtr（引用计数智能指针）传递，最后一个引用释放时缓冲区自动回池
+ * - 统计命中、未命中、在途帧数与泄漏帧数
+ *
+ * 使用流程：
+ * 1. 构造FramePool并指定像素格式、分辨率与容量
+ * 2. 调用acquire()获取帧，写入数据后在各处理阶段间传递FramePtr
+ * 3. 流停止时调用shutdown()统计仍未归还的帧
+ */
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+extern "C" {
+#include <libavutil/buffer.h>
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+// 帧的RAII句柄，最后一个引用释放时调用av_frame_free，缓冲区随之回池
+using FramePtr = std::shared_ptr<AVFrame>;
+
+/**
+ * @brief 将AVFrame包装为FramePtr，接管其所有权
+ * @param frame av_frame_alloc()分配的帧，可为nullptr
+ * @return FramePtr，frame为nullptr时返回空指针
+ */
+inline FramePtr make_frame_ptr(AVFrame* frame) {
+    if (!frame) return nullptr;
+    return FramePtr(frame, [](AVFrame* f) { av_frame_free(&f); });
+}
+
+// 帧池统计信息
+struct FramePoolStats {
+    uint64_t hits = 0;      // 复用池中缓冲区的次数
+    uint64_t misses = 0;    // 新分配缓冲区的次数（池预热或超出容量）
+    int in_flight = 0;      // 当前已取出尚未归还的帧数
+    int leaked = 0;         // shutdown()时仍未归还的帧数
+};
+
+class FramePool {
+public:
+    /**
+     * @brief 构造函数
+     * @param format 默认像素格式
+     * @param width 默认宽度
+     * @param height 默认高度
+     * @param capacity 池中最多保留的缓冲区数量
+     * @param use_hugepages 是否尝试使用大页内存（失败时自动退回普通对齐内存）
+     */
+    FramePool(AVPixelFormat format, int width, int height,
+              int capacity = 16, bool use_hugepages = false);
+
+    /**
+     * @brief 析构函数，释放AVBufferPool（在途缓冲区归还时再真正释放）
+     */
+    ~FramePool();
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    /**
+     * @brief 按默认格式与分辨率获取一帧
+     * @return 成功返回FramePtr，失败返回nullptr
+     */
+    FramePtr acquire();
+
+    /**
+     * @brief 为已设置format/width/height的帧挂载池缓冲区并填充data/linesize
+     * 所需大小超过池缓冲区大小时临时分配（计为未命中）
+     * @param frame 目标帧，buf/data需为空
+     * @return 成功返回true，失败返回false
+     */
+    bool attach_buffer(AVFrame* frame);
+
+    /**
+     * @brief 标记池停止使用，记录此时仍未归还的帧数为泄漏帧
+     */
+    void shutdown();
+
+    /**
+     * @brief 获取统计信息（线程安全）
+     */
+    FramePoolStats stats() const;
+
+    AVPixelFormat format() const { return format_; }
+    int width() const { return width_; }
+    int height() const { return height_; }
+
+private:
+    struct State;
+    struct SlabHolder;
+
+    // AVBufferPool分配回调：分配一块对齐（或大页）的缓冲区
+    static AVBufferRef* alloc_slab(void* opaque, size_t size);
+    // 帧缓冲区最后一个引用释放时回调：更新统计并将缓冲区归还AVBufferPool
+    static void release_slab(void* opaque, uint8_t* data);
+
+    AVPixelFormat format_;
+    int width_;
+    int height_;
+    int capacity_;
+    size_t slab_size_;
+    AVBufferPool* pool_ = nullptr;
+    std::shared_ptr<State> state_;  // 在途缓冲区持有引用，池析构后统计仍有效
+};
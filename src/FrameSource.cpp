@@ -0,0 +1,33 @@
+#include "FrameSource.h"
+#include "CameraCapture.h"
+#include "FileSource.h"
+#include "SyntheticSource.h"
+#include <iostream>
+
+std::unique_ptr<FrameSource> FrameSource::create(const FrameSourceConfig& config) {
+    switch (config.type) {
+    case SourceType::V4L2: {
+        uint32_t pixel_format = config.pixel_format ? config.pixel_format : V4L2_PIX_FMT_YUYV;
+        return std::unique_ptr<FrameSource>(
+            new CameraCapture(config.path, config.width, config.height, config.fps, pixel_format));
+    }
+    case SourceType::File:
+        return std::unique_ptr<FrameSource>(new FileSource(config.path, config.realtime, config.loop));
+    case SourceType::Synthetic: {
+        AVPixelFormat format = SyntheticSource::format_from_fourcc(config.pixel_format);
+        if (format == AV_PIX_FMT_NONE) {
+            std::cerr << "SyntheticSource: unsupported pixel format" << std::endl;
+            return nullptr;
+        }
+        return std::unique_ptr<FrameSource>(
+            new SyntheticSource(config.width, config.height, config.fps, format, config.realtime));
+    }
+    }
+    return nullptr;
+}
+
+SourceType FrameSource::type_from_string(const std::string& name) {
+    if (name == "file") return SourceType::File;
+    if (name == "synthetic") return SourceType::Synthetic;
+    return SourceType::V4L2;
+}
@@ -0,0 +1,173 @@
+#pragma once
+/**
+ * @file FrameSource.h
+ * @class FrameSource
+ * @brief 帧源抽象接口
+ * @author achene
+ * @date 2025-08-05
+ *
+ * EncoderStreamer通过该接口获取帧，不再依赖具体的V4L2摄像头，
+ * 无摄像头环境下也能用录像回放或合成图案跑通采集->推理->编码的完整流水线。
+ *
+ * 已有实现：
+ * - CameraCapture：V4L2摄像头
+ * - FileSource：libavformat/libavcodec录像文件回放
+ * - SyntheticSource：合成测试图案
+ *
+ * 回放与合成源支持实时节拍（按帧率/时间戳出帧）与尽快模式（下游队列满时自然反压），
+ * 输出帧与摄像头一样携带FrameMeta（采集时间取出帧时刻，序号连续递增）。
+ */
+#include "FramePool.h"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+extern "C" {
+#include <libavutil/pixfmt.h>
+}
+
+// 采集统计
+struct CaptureStats {
+    uint64_t captured = 0;        // 从驱动取出的帧数
+    uint64_t driver_dropped = 0;  // 驱动丢帧数（由帧序号不连续得出）
+};
+
+// 帧源类型
+enum class SourceType {
+    V4L2,       // V4L2摄像头
+    File,       // 录像文件回放
+    Synthetic,  // 合成测试图案
+};
+
+// 帧源创建参数
+struct FrameSourceConfig {
+    SourceType type = SourceType::V4L2;
+    std::string path;           // 设备路径或录像文件路径（合成源忽略）
+    int width = 640;
+    int height = 480;
+    int fps = 30;
+    uint32_t pixel_format = 0;  // V4L2四字符格式（摄像头采集格式/合成源输出格式）
+    bool realtime = true;       // 回放/合成源：true按实时节拍出帧，false尽快出帧
+    bool loop = true;           // 回放源：文件结束后从头循环
+};
+
+class FrameSource {
+public:
+    // 回调函数类型定义
+    using FrameCallback = std::function<void(FramePtr)>;
+
+    virtual ~FrameSource() = default;
+
+    /**
+     * @brief 按配置创建帧源
+     * @param config 帧源创建参数
+     * @return 帧源实例，类型不支持时返回nullptr
+     */
+    static std::unique_ptr<FrameSource> create(const FrameSourceConfig& config);
+
+    /**
+     * @brief 将类型名（"v4l2"/"file"/"synthetic"）转换为SourceType，未知名称按V4L2处理
+     */
+    static SourceType type_from_string(const std::string& name);
+
+    /**
+     * @brief 初始化帧源
+     * @return 成功返回true，失败返回false
+     */
+    virtual bool initialize() = 0;
+
+    /**
+     * @brief 开始出帧（未初始化时自动初始化）
+     */
+    virtual void start() = 0;
+
+    /**
+     * @brief 停止出帧
+     */
+    virtual void stop() = 0;
+
+    /**
+     * @brief 获取当前是否正在出帧
+     */
+    virtual bool is_running() const = 0;
+
+    /**
+     * @brief 获取源数据的像素格式（initialize()之后有效，未知时返回AV_PIX_FMT_NONE）
+     */
+    virtual AVPixelFormat av_format() const = 0;
+
+    /**
+     * @brief 获取帧源名称，用于日志
+     */
+    virtual std::string name() const = 0;
+
+    /**
+     * @brief 设置与下游共享的帧缓冲池（需在initialize()之前调用，帧源可忽略）
+     */
+    virtual void set_frame_pool(std::shared_ptr<FramePool> pool) {}
+
+    /**
+     * @brief 获取出帧统计
+     */
+    virtual CaptureStats capture_stats() const { return CaptureStats(); }
+
+    /**
+     * @brief 设置帧数据回调函数（左值引用版本和右值引用版本，支持移动语义）
+     * @param callback 回调函数对象，当有新帧到达时会被调用
+     */
+    void set_frame_callback(const FrameCallback& callback) { frame_callback_ = callback; }
+    void set_frame_callback(FrameCallback&& callback) { frame_callback_ = std::move(callback); }
+
+    /**
+     * @brief 设置/获取帧源ID（多路场景下使用，写入帧元数据）
+     */
+    void set_camera_id(int id) { camera_id_ = id; }
+    int get_camera_id() const { return camera_id_; }
+
+    /**
+     * @brief 设置出帧线程启动时的初始化函数（需在start()之前调用），用于线程命名、CPU亲和性与调度策略设置
+     * @param init 在出帧线程中调用一次的函数
+     */
+    void set_thread_init(std::function<void()> init) { thread_init_ = std::move(init); }
+
+protected:
+    /**
+     * @brief 在出帧线程入口调用，执行set_thread_init()设置的初始化函数
+     */
+    void run_thread_init() const { if (thread_init_) thread_init_(); }
+
+    FrameCallback frame_callback_;
+    std::function<void()> thread_init_;
+    int camera_id_ = 0;  // 默认ID为0
+};
+
+/**
+ * @brief 出帧节拍控制：实时模式下等待到相对起点的目标时刻，尽快模式下不等待
+ */
+class FramePacer {
+public:
+    explicit FramePacer(bool realtime) : realtime_(realtime) { reset(); }
+
+    /**
+     * @brief 以当前时刻作为时间起点
+     */
+    void reset() { start_ = std::chrono::steady_clock::now(); }
+
+    /**
+     * @brief 等待到起点之后offset_ns纳秒（尽快模式直接返回）
+     */
+    void wait(int64_t offset_ns) const {
+        if (realtime_) {
+            std::this_thread::sleep_until(start_ + std::chrono::nanoseconds(offset_ns));
+        }
+    }
+
+    bool realtime() const { return realtime_; }
+
+private:
+    bool realtime_;
+    std::chrono::steady_clock::time_point start_;
+};
@@ -0,0 +1,440 @@
+#include "InferenceBatcher.h"
+#include <algorithm>
+#include <iostream>
+
+#ifndef MODULE_TEST
+#define MODULE_TEST 0
+#endif
+
+InferenceBatcher::InferenceBatcher(ModelPoolPtr models, const BatchConfig& config)
+    : models_(std::move(models)), config_(config) {
+    config_.max_batch = std::max(config_.max_batch, 1);
+    config_.window_us = std::max(config_.window_us, 0);
+    config_.runners = std::max(config_.runners, 1);
+    if (config_.capacity <= 0) {
+        config_.capacity = config_.max_batch * config_.runners * 2;
+    }
+}
+
+InferenceBatcher::~InferenceBatcher() {
+    stop();
+}
+
+bool InferenceBatcher::start() {
+    if (running_) return true;
+    if (!models_ || models_->size() == 0) {
+        std::cerr << "InferenceBatcher: empty model pool" << std::endl;
+        return false;
+    }
+    running_ = true;
+    for (int i = 0; i < config_.runners; ++i) {
+        runners_.emplace_back(&InferenceBatcher::runner_loop, this, i);
+    }
+    return true;
+}
+
+void InferenceBatcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_.exchange(false) && runners_.empty()) {
+            return;
+        }
+    }
+    not_empty_.notify_all();
+    not_full_.notify_all();
+    for (std::thread& runner : runners_) {
+        if (runner.joinable()) {
+            runner.join();
+        }
+    }
+    runners_.clear();
+
+    // 未推理的帧以失败完成，调用方据此释放帧（越过其输出序号）
+    std::deque<Request> rest;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rest.swap(queue_);
+    }
+    for (Request& request : rest) {
+        request.item.ok = false;
+        request.done(request.item, 0);
+    }
+}
+
+bool InferenceBatcher::submit(BatchItem item, Done done, const void* owner) {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this]() {
+            return !running_ || queue_.size() < static_cast<size_t>(config_.capacity);
+        });
+        if (!running_) {
+            return false;
+        }
+        queue_.push_back(Request{std::move(item), std::move(done),
+                                 static_cast<int64_t>(LatencyHistogram::now_ns()), owner});
+    }
+    // 等待凑批与等待非空的批处理线程共用一个条件变量，全部唤醒
+    not_empty_.notify_all();
+    return true;
+}
+
+void InferenceBatcher::cancel(const void* owner) {
+    std::vector<Request> cancelled;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (auto it = queue_.begin(); it != queue_.end();) {
+            if (it->owner == owner) {
+                cancelled.push_back(std::move(*it));
+                it = queue_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    if (!cancelled.empty()) {
+        not_full_.notify_all();
+    }
+    for (Request& request : cancelled) {
+        request.item.ok = false;
+        request.done(request.item, 0);
+    }
+    // 已被批处理线程取出的帧无法撤回，等待其批次完成
+    std::unique_lock<std::mutex> lock(mutex_);
+    finished_.wait(lock, [this, owner]() { return running_owners_.find(owner) == running_owners_.end(); });
+}
+
+void InferenceBatcher::finish(const std::vector<Request>& batch) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const Request& request : batch) {
+            auto it = running_owners_.find(request.owner);
+            if (it != running_owners_.end() && --it->second == 0) {
+                running_owners_.erase(it);
+            }
+        }
+    }
+    finished_.notify_all();
+}
+
+size_t InferenceBatcher::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+void InferenceBatcher::collect(std::vector<Request>& batch) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait_for(lock, std::chrono::milliseconds(50), [this]() {
+        return !queue_.empty() || !running_;
+    });
+    // 不足一批时等待更多帧，期限按当前最早一帧计算（其他批处理线程可能已取走更早的帧）
+    while (running_ && !queue_.empty() && queue_.size() < static_cast<size_t>(config_.max_batch)) {
+        const int64_t deadline = queue_.front().submit_ns + static_cast<int64_t>(config_.window_us) * 1000;
+        const int64_t remain = deadline - static_cast<int64_t>(LatencyHistogram::now_ns());
+        if (remain <= 0) {
+            break;
+        }
+        not_empty_.wait_for(lock, std::chrono::nanoseconds(remain));
+    }
+    const size_t count = std::min(queue_.size(), static_cast<size_t>(config_.max_batch));
+    for (size_t i = 0; i < count; ++i) {
+        running_owners_[queue_.front().owner]++;
+        batch.push_back(std::move(queue_.front()));
+        queue_.pop_front();
+    }
+    lock.unlock();
+    if (count > 0) {
+        not_full_.notify_all();
+    }
+}
+
+void InferenceBatcher::runner_loop(int index) {
+    if (thread_init_) {
+        thread_init_(index);
+    }
+    std::vector<Request> batch;
+    std::vector<BatchItem*> items;
+    while (running_) {
+        // 先凑批再取模型：凑批等待期间不占用模型，与不经批处理的推理（如叠加帧）共享模型池时不会饿死对方
+        batch.clear();
+        collect(batch);
+        if (batch.empty()) {
+            continue;
+        }
+        ModelPtr model;
+        while (!models_->acquire(model, 50)) {
+            if (!running_) {
+                break;
+            }
+        }
+        if (!model) {
+            // 停止时仍未取到模型：整批以失败完成
+            for (Request& request : batch) {
+                request.item.ok = false;
+                request.done(request.item, 0);
+            }
+            finish(batch);
+            continue;
+        }
+
+        items.clear();
+        const int64_t start = LatencyHistogram::now_ns();
+        for (Request& request : batch) {
+            wait_.record(static_cast<uint64_t>(std::max<int64_t>(start - request.submit_ns, 0)));
+            items.push_back(&request.item);
+        }
+        model->run_batch(items);
+        const int64_t cost = LatencyHistogram::now_ns() - start;
+        models_->release(std::move(model));
+
+        run_.record(static_cast<uint64_t>(cost));
+        batches_++;
+        frames_ += batch.size();
+        if (batch.size() == static_cast<size_t>(config_.max_batch)) {
+            full_batches_++;
+        }
+        const int64_t share = cost / static_cast<int64_t>(batch.size());
+        for (Request& request : batch) {
+            request.done(request.item, share);
+        }
+        finish(batch);
+    }
+}
+
+BatchStats InferenceBatcher::stats() const {
+    BatchStats stats;
+    stats.batches = batches_.load();
+    stats.frames = frames_.load();
+    stats.full_batches = full_batches_.load();
+    stats.mean_batch = stats.batches > 0 ? static_cast<double>(stats.frames) / stats.batches : 0;
+    stats.wait = wait_.snapshot();
+    stats.run = run_.snapshot();
+    return stats;
+}
+
+
+#if MODULE_TEST
+//g++ -DMODULE_TEST=1 -o test_inference_batcher InferenceBatcher.cpp `pkg-config --cflags --libs opencv4` -lpthread
+// 吞吐-延迟测试：桩模型按"每次提交固定开销+每帧开销"耗时，多路流按固定帧率提交，
+// 扫描批大小与凑批窗口，输出每种配置的吞吐与提交到完成的延迟分位数
+#include <thread>
+
+namespace {
+
+// 桩模型：一次run_batch()耗时 = overhead + per_frame × 批大小
+class StubBatchModel : public Model {
+public:
+    StubBatchModel(int overhead_us, int per_frame_us, int max_batch)
+        : overhead_us_(overhead_us), per_frame_us_(per_frame_us), max_batch_(max_batch) {}
+
+    bool loadmodel(const char*) override { return true; }
+    bool run(const cv::Mat&, Detections&) override {
+        std::this_thread::sleep_for(std::chrono::microseconds(overhead_us_ + per_frame_us_));
+        return true;
+    }
+    int run_batch(const std::vector<BatchItem*>& items) override {
+        largest_batch = std::max<int>(largest_batch, items.size());
+        std::this_thread::sleep_for(std::chrono::microseconds(
+            overhead_us_ + per_frame_us_ * static_cast<int>(items.size())));
+        for (BatchItem* item : items) {
+            item->ok = true;
+        }
+        return static_cast<int>(items.size());
+    }
+    int max_batch() const override { return max_batch_; }
+    std::string get_name() const override { return "StubBatchModel"; }
+
+    std::atomic<int> largest_batch{0};
+
+private:
+    int overhead_us_;
+    int per_frame_us_;
+    int max_batch_;
+};
+
+struct RunResult {
+    double fps = 0;
+    LatencySnapshot latency;
+    BatchStats stats;
+    bool complete = false;  // 每个被接受的帧恰好完成一次
+    bool bounded = false;   // 批大小不超过max_batch
+};
+
+RunResult run_case(int max_batch, int window_us, int streams, int stream_fps, int duration_ms) {
+    const int instances = 2;
+    std::vector<std::shared_ptr<StubBatchModel>> stubs;
+    ModelPoolPtr pool = std::make_shared<ModelPool>();
+    for (int i = 0; i < instances; ++i) {
+        stubs.push_back(std::make_shared<StubBatchModel>(8000, 3000, max_batch));
+        pool->add(stubs.back());
+    }
+    BatchConfig config;
+    config.max_batch = max_batch;
+    config.window_us = window_us;
+    config.runners = instances;
+    InferenceBatcher batcher(pool, config);
+    batcher.start();
+
+    LatencyHistogram latency;
+    std::atomic<uint64_t> accepted{0}, done{0};
+    const int64_t begin = LatencyHistogram::now_ns();
+    const int64_t end = begin + static_cast<int64_t>(duration_ms) * 1000000;
+    std::vector<std::thread> producers;
+    for (int s = 0; s < streams; ++s) {
+        producers.emplace_back([&, s]() {
+            const int64_t interval = 1000000000LL / stream_fps;
+            int64_t next = begin + interval * s / streams;  // 各路相位错开
+            while (next < end) {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(next - static_cast<int64_t>(LatencyHistogram::now_ns())));
+                const int64_t submitted = LatencyHistogram::now_ns();
+                bool ok = batcher.submit(BatchItem(), [&, submitted](BatchItem& item, int64_t) {
+                    if (item.ok) {
+                        latency.record(LatencyHistogram::now_ns() - submitted);
+                    }
+                    done++;
+                });
+                if (ok) accepted++;
+                // submit()阻塞（推理跟不上）时不补发落后的帧
+                next = std::max<int64_t>(next + interval, LatencyHistogram::now_ns());
+            }
+        });
+    }
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+    const double elapsed_s = (LatencyHistogram::now_ns() - begin) / 1e9;
+    batcher.stop();
+
+    RunResult result;
+    result.stats = batcher.stats();
+    result.fps = result.stats.frames / elapsed_s;
+    result.latency = latency.snapshot();
+    result.complete = accepted.load() == done.load();
+    result.bounded = true;
+    for (auto& stub : stubs) {
+        result.bounded = result.bounded && stub->largest_batch.load() <= max_batch;
+    }
+    return result;
+}
+
+// 模型池共享：批处理线程与不经批处理的使用方（如叠加帧的acquire(model, 0)）共用模型池，
+// 返回使用方不等待取模型的成功比例
+double run_shared_case(int streams, int stream_fps, int duration_ms, bool& complete) {
+    const int instances = 2;
+    ModelPoolPtr pool = std::make_shared<ModelPool>();
+    for (int i = 0; i < instances; ++i) {
+        pool->add(std::make_shared<StubBatchModel>(8000, 3000, 4));
+    }
+    BatchConfig config;
+    config.max_batch = 4;
+    config.window_us = 5000;
+    config.runners = instances;
+    InferenceBatcher batcher(pool, config);
+    batcher.start();
+
+    std::atomic<bool> producing{true};
+    std::atomic<uint64_t> accepted{0}, done{0};
+    std::vector<std::thread> producers;
+    for (int s = 0; s < streams; ++s) {
+        producers.emplace_back([&]() {
+            while (producing) {
+                if (batcher.submit(BatchItem(), [&](BatchItem&, int64_t) { done++; })) accepted++;
+                std::this_thread::sleep_for(std::chrono::microseconds(1000000 / stream_fps));
+            }
+        });
+    }
+    int attempts = 0, acquired = 0;
+    const auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(duration_ms);
+    while (std::chrono::steady_clock::now() < end) {
+        ModelPtr model;
+        attempts++;
+        if (pool->acquire(model, 0)) {
+            acquired++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            pool->release(std::move(model));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    producing = false;
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+    batcher.stop();
+    complete = accepted.load() == done.load() && batcher.stats().frames > 0;
+    return attempts > 0 ? static_cast<double>(acquired) / attempts : 0;
+}
+
+// 取消：两个提交方共用批处理器，cancel()返回时被取消方的每个帧都已完成回调，另一方不受影响
+bool run_cancel_case() {
+    ModelPoolPtr pool = std::make_shared<ModelPool>();
+    pool->add(std::make_shared<StubBatchModel>(20000, 0, 2));
+    BatchConfig config;
+    config.max_batch = 2;
+    config.window_us = 0;
+    config.capacity = 16;
+    InferenceBatcher batcher(pool, config);
+    batcher.start();
+
+    int owner_a = 0, owner_b = 0;
+    std::atomic<int> done_a{0}, failed_a{0}, done_b{0};
+    int accepted_a = 0, accepted_b = 0;
+    for (int i = 0; i < 6; ++i) {
+        accepted_a += batcher.submit(BatchItem(), [&](BatchItem& item, int64_t) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));  // 回调中仍在访问提交方
+            if (!item.ok) failed_a++;
+            done_a++;
+        }, &owner_a);
+        accepted_b += batcher.submit(BatchItem(), [&](BatchItem&, int64_t) { done_b++; }, &owner_b);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));  // 第一批已开始推理
+    batcher.cancel(&owner_a);
+    const bool a_settled = done_a.load() == accepted_a && failed_a.load() > 0;
+    for (int i = 0; i < 100 && done_b.load() < accepted_b; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    const bool b_served = done_b.load() == accepted_b && batcher.stats().frames >= static_cast<uint64_t>(accepted_b);
+    batcher.stop();
+    return accepted_a == 6 && a_settled && b_served;
+}
+
+}  // namespace
+
+int main() {
+    bool ok = true;
+    const int streams = 8, stream_fps = 30, duration_ms = 1500;
+    std::cout << "stub model: 8ms per submit + 3ms per frame, 2 instances, "
+              << streams << " streams x " << stream_fps << " fps offered" << std::endl;
+    std::cout << "batch window(us)    fps  mean_batch  latency(ms) p50     p99" << std::endl;
+
+    double fps_single = 0, fps_batched = 0;
+    const int batches[] = {1, 2, 4, 8};
+    const int windows[] = {0, 5000};
+    for (int max_batch : batches) {
+        for (int window_us : windows) {
+            if (max_batch == 1 && window_us > 0) continue;
+            RunResult r = run_case(max_batch, window_us, streams, stream_fps, duration_ms);
+            printf("%5d %10d %6.1f %11.2f %16.1f %7.1f%s\n", max_batch, window_us, r.fps, r.stats.mean_batch,
+                   r.latency.p50_us / 1000, r.latency.p99_us / 1000,
+                   r.complete && r.bounded ? "" : "  FAILED");
+            ok = ok && r.complete && r.bounded;
+            if (max_batch == 1) fps_single = r.fps;
+            if (max_batch == 4 && window_us == 5000) fps_batched = r.fps;
+        }
+    }
+    // 单帧提交时两个实例最多约180fps，4帧一批时应能承受全部240fps
+    ok = ok && fps_batched > fps_single * 1.2;
+
+    // 轻负载时批处理线程凑批期间不占用模型，共享模型池的使用方应基本都能立即取到模型
+    bool shared_complete = false;
+    const double share = run_shared_case(2, 30, duration_ms, shared_complete);
+    printf("shared pool: non-batched acquire(model, 0) succeeded %.0f%%%s\n", share * 100,
+           shared_complete && share > 0.5 ? "" : "  FAILED");
+    ok = ok && shared_complete && share > 0.5;
+
+    const bool cancel_ok = run_cancel_case();
+    printf("cancel: queued frames failed, running batch waited%s\n", cancel_ok ? "" : "  FAILED");
+    ok = ok && cancel_ok;
+
+    std::cout << "ok: " << ok << std::endl;
+    return ok ? 0 : 1;
+}
+#endif
@@ -0,0 +1,166 @@
+#pragma once
+/**
+ * @file InferenceBatcher.h
+ * @class InferenceBatcher
+ * @brief 跨流批量推理：把不同摄像头的帧在一个小时间窗内凑成一批，一次提交给模型
+ * @author achene
+ * @date 2025-08-05
+ *
+ * 每帧单独rknn_inputs_set/rknn_run时，每次提交的固定开销（驱动调用、任务下发、输出同步）由单帧承担。
+ * 批量推理时工作线程只做取帧与格式转换，之后submit()到批处理队列；批处理线程（通常每个模型实例一个）
+ * 先凑批：队列中已有max_batch帧，或最早的一帧已等待window_us时结束凑批，之后才取空闲模型，
+ * 凑批等待期间不占用模型（模型池可与不经批处理的推理共享）；调用Model::run_batch()一次推理整批（批量编译的模型一次rknn_run，多核NPU上按batch分核），
+ * 再通过各帧的完成回调把检测结果分发回各自的流。
+ *
+ * 批越大吞吐越高，但凑批等待与整批推理时间都计入每帧延迟：max_batch与window_us用于在吞吐与延迟间取舍。
+ * 批处理只依赖Model接口，可用桩模型在开发机上测量吞吐-延迟曲线（见本文件的MODULE_TEST）。
+ */
+#include "LatencyHistogram.h"
+#include "Model.h"
+#include "ModelPool.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 批处理参数
+struct BatchConfig {
+    int max_batch = 4;     // 一批最多帧数
+    int window_us = 2000;  // 凑批窗口：不足一批时最早的一帧最多等待的时间（微秒）
+    int runners = 1;       // 批处理线程数（通常等于模型实例数）
+    int capacity = 0;      // 等待队列上限，满时submit()阻塞；0表示max_batch*runners*2
+};
+
+// 批处理统计
+struct BatchStats {
+    uint64_t batches = 0;       // 推理批次数
+    uint64_t frames = 0;        // 推理帧数
+    uint64_t full_batches = 0;  // 凑满max_batch的批次数
+    double mean_batch = 0;      // 平均批大小
+    LatencySnapshot wait;       // 帧从submit()到所在批次开始推理的等待时间
+    LatencySnapshot run;        // 每批推理时间
+};
+
+class InferenceBatcher {
+public:
+    /**
+     * @brief 批次完成回调（在批处理线程中调用）
+     * @param item 推理结果（ok与detections已填写）
+     * @param cost_ns 该帧分摊的推理时间（整批耗时/批大小）
+     */
+    using Done = std::function<void(BatchItem& item, int64_t cost_ns)>;
+
+    /**
+     * @brief 构造函数
+     * @param models 模型池（批处理线程从中取模型）
+     * @param config 批处理参数
+     */
+    InferenceBatcher(ModelPoolPtr models, const BatchConfig& config);
+
+    /**
+     * @brief 析构函数，停止批处理线程
+     */
+    ~InferenceBatcher();
+
+    InferenceBatcher(const InferenceBatcher&) = delete;
+    InferenceBatcher& operator=(const InferenceBatcher&) = delete;
+
+    /**
+     * @brief 设置批处理线程启动时的初始化回调（需在start()之前调用），用于设置CPU亲和性等
+     * @param init 参数为批处理线程编号
+     */
+    void set_thread_init(std::function<void(int)> init) { thread_init_ = std::move(init); }
+
+    /**
+     * @brief 启动批处理线程
+     * @return 成功返回true，模型池为空时返回false
+     */
+    bool start();
+
+    /**
+     * @brief 停止批处理线程，队列中尚未推理的帧以失败（ok=false）完成
+     */
+    void stop();
+
+    /**
+     * @brief 提交一帧，等待队列满时阻塞（反压到调用的工作线程）
+     * @param item 推理输入，image与raw引用的数据需保持有效直到done被调用
+     * @param done 完成回调，每个被接受的帧恰好调用一次
+     * @param owner 提交方标识（如流对象地址），供cancel()使用
+     * @return 已接受返回true；已停止返回false（done不会被调用）
+     */
+    bool submit(BatchItem item, Done done, const void* owner = nullptr);
+
+    /**
+     * @brief 取消owner提交的帧：队列中尚未推理的帧在调用线程中以失败（ok=false）完成，
+     * 并等待包含其帧的批次完成回调。返回后已提交的帧的done均已返回
+     * @note 不能在完成回调中调用；返回后owner仍可继续提交
+     */
+    void cancel(const void* owner);
+
+    /**
+     * @brief 等待队列中的帧数
+     */
+    size_t pending() const;
+
+    /**
+     * @brief 获取批处理统计
+     */
+    BatchStats stats() const;
+
+    /**
+     * @brief 批处理参数
+     */
+    const BatchConfig& config() const { return config_; }
+
+private:
+    struct Request {
+        BatchItem item;
+        Done done;
+        int64_t submit_ns;
+        const void* owner;
+    };
+
+    /**
+     * @brief 批处理线程：凑批后取空闲模型推理并分发结果
+     * @param index 批处理线程编号
+     */
+    void runner_loop(int index);
+
+    /**
+     * @brief 凑一批：等待队列非空，不足max_batch时等待到最早一帧的窗口期限
+     * @param batch 输出取出的帧
+     */
+    void collect(std::vector<Request>& batch);
+
+    /**
+     * @brief 批次的完成回调均已返回，从推理中的提交方计数中移除
+     */
+    void finish(const std::vector<Request>& batch);
+
+    ModelPoolPtr models_;
+    BatchConfig config_;
+    std::function<void(int)> thread_init_;
+    std::vector<std::thread> runners_;
+    std::atomic<bool> running_{false};
+
+    mutable std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::deque<Request> queue_;
+    std::condition_variable finished_;         // 批次完成时通知cancel()
+    std::map<const void*, int> running_owners_;  // 已取出尚未完成的帧数，按提交方
+
+    std::atomic<uint64_t> batches_{0};
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> full_batches_{0};
+    LatencyHistogram wait_;
+    LatencyHistogram run_;
+};
+
+using InferenceBatcherPtr = std::shared_ptr<InferenceBatcher>;
@@ -0,0 +1,300 @@
+#include "InferenceScheduler.h"
+#include <algorithm>
+#include <climits>
+#include <iostream>
+
+#ifndef MODULE_TEST
+#define MODULE_TEST 0
+#endif
+
+namespace {
+constexpr double kTokenBurst = 1.0;  // 令牌桶容量：限速的流不允许突发
+}
+
+InferenceScheduler::InferenceScheduler(int64_t quantum_ns)
+    : quantum_ns_(quantum_ns > 0 ? quantum_ns : 1) {
+}
+
+void InferenceScheduler::add(int id, const ScheduleConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::unique_ptr<Stream>& stream = streams_[id];
+    if (!stream) {
+        stream.reset(new Stream());
+    }
+    stream->config = config;
+    stream->config.weight = std::max(config.weight, 1);
+}
+
+void InferenceScheduler::remove(int id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    streams_.erase(id);
+}
+
+bool InferenceScheduler::refill(Stream& stream, int64_t now_ns) {
+    if (stream.config.max_fps <= 0) {
+        return true;
+    }
+    if (stream.refill_ns == 0) {
+        stream.refill_ns = now_ns;
+    }
+    if (now_ns > stream.refill_ns) {
+        stream.tokens = std::min(kTokenBurst,
+                                 stream.tokens + (now_ns - stream.refill_ns) * stream.config.max_fps / 1e9);
+        stream.refill_ns = now_ns;
+    }
+    return stream.tokens >= 1.0;
+}
+
+bool InferenceScheduler::next(const std::function<bool(int)>& backlogged, ScheduleDecision& decision,
+                              int64_t now_ns) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // 标记有待处理帧的流；超出最大推理帧率的流直接返回（该帧不推理，处理代价很小）
+    bool any = false;
+    int top_priority = INT_MIN;
+    for (auto& item : streams_) {
+        Stream& stream = *item.second;
+        stream.ready = backlogged(item.first);
+        if (!stream.ready) {
+            // 队列清空的流不累积额度
+            stream.deficit_ns = std::min<int64_t>(stream.deficit_ns, 0);
+            continue;
+        }
+        if (!refill(stream, now_ns)) {
+            decision.id = item.first;
+            decision.allow_inference = false;
+            decision.charged_ns = 0;
+            return true;
+        }
+        any = true;
+        top_priority = std::max(top_priority, stream.config.priority);
+    }
+    if (!any) {
+        return false;
+    }
+
+    // 最高优先级内的赤字轮询：从上次服务的流开始，额度为正的流继续服务
+    auto in_class = [top_priority](const Stream& stream) {
+        return stream.ready && stream.config.priority == top_priority;
+    };
+    auto cursor = cursor_.find(top_priority);
+    auto start = cursor == cursor_.end() ? streams_.begin() : streams_.lower_bound(cursor->second);
+    if (start == streams_.end()) {
+        start = streams_.begin();
+    }
+
+    Stream* chosen = nullptr;
+    int chosen_id = -1;
+    for (int pass = 0; pass < 2 && !chosen; ++pass) {
+        if (pass == 1) {
+            // 没有额度为正的流：补充k轮额度，k为使某一路额度转正的最少轮数
+            int64_t rounds = INT64_MAX;
+            for (auto& item : streams_) {
+                const Stream& stream = *item.second;
+                if (in_class(stream)) {
+                    int64_t quantum = quantum_ns_ * stream.config.weight;
+                    rounds = std::min(rounds, (quantum - stream.deficit_ns) / quantum);
+                }
+            }
+            for (auto& item : streams_) {
+                Stream& stream = *item.second;
+                if (in_class(stream)) {
+                    stream.deficit_ns += rounds * quantum_ns_ * stream.config.weight;
+                }
+            }
+            // 补充后从当前位置的下一路开始找，使额度同时转正的流轮流获得服务
+            if (cursor != cursor_.end() && start->first == cursor->second && ++start == streams_.end()) {
+                start = streams_.begin();
+            }
+        }
+        auto it = start;
+        do {
+            Stream& stream = *it->second;
+            if (in_class(stream) && stream.deficit_ns > 0) {
+                chosen = &stream;
+                chosen_id = it->first;
+                break;
+            }
+            if (++it == streams_.end()) {
+                it = streams_.begin();
+            }
+        } while (it != start);
+    }
+    if (!chosen) {
+        return false;
+    }
+
+    cursor_[top_priority] = chosen_id;
+    decision.id = chosen_id;
+    decision.allow_inference = true;
+    decision.charged_ns = chosen->estimate_ns;
+    chosen->deficit_ns -= decision.charged_ns;
+    if (chosen->config.max_fps > 0) {
+        chosen->tokens -= 1.0;
+    }
+    return true;
+}
+
+void InferenceScheduler::complete(const ScheduleDecision& decision, bool served, int64_t cost_ns, int64_t wait_ns) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = streams_.find(decision.id);
+    if (it == streams_.end()) {
+        return;
+    }
+    Stream& stream = *it->second;
+    if (!decision.allow_inference) {
+        if (served) {
+            stream.rate_limited++;
+        }
+        return;
+    }
+    stream.deficit_ns += decision.charged_ns;
+    if (!served) {
+        // 选中后队列已被取空：退还令牌
+        if (stream.config.max_fps > 0) {
+            stream.tokens += 1.0;
+        }
+        return;
+    }
+    stream.deficit_ns -= cost_ns;
+    stream.estimate_ns = cost_ns;
+    stream.served++;
+    stream.busy_ns += cost_ns;
+    if (wait_ns > 0) {
+        stream.wait.record(static_cast<uint64_t>(wait_ns));
+    }
+}
+
+void InferenceScheduler::charge(int id, int64_t cost_ns) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = streams_.find(id);
+    if (it == streams_.end()) {
+        return;
+    }
+    Stream& stream = *it->second;
+    stream.deficit_ns -= cost_ns;
+    stream.busy_ns += cost_ns;
+    // complete()按取帧与转换的耗时设置了估计，加上推理部分（近似，批量时各帧完成顺序不保证）
+    stream.estimate_ns += cost_ns;
+}
+
+ScheduleStats InferenceScheduler::stats(int id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ScheduleStats stats;
+    auto it = streams_.find(id);
+    if (it != streams_.end()) {
+        const Stream& stream = *it->second;
+        stats.served = stream.served;
+        stats.rate_limited = stream.rate_limited;
+        stats.busy_ns = stream.busy_ns;
+        stats.wait = stream.wait.snapshot();
+    }
+    return stats;
+}
+
+
+#if MODULE_TEST
+//g++ -DMODULE_TEST=1 -o test_inference_scheduler InferenceScheduler.cpp -lpthread
+// 调度测试：单线程模拟时间，各流始终有待处理帧，按各流的推理耗时推进时钟，检查推理时间按权重分配、
+// 高优先级先服务、限速流的推理帧率与队列清空后不累积额度
+#include <cmath>
+
+int main() {
+    bool ok = true;
+    const int64_t ms = 1000000;
+
+    // 权重2:1:1，C每帧耗时是A、B的两倍：推理时间应约为50%:25%:25%，帧数约为2:1:0.5
+    {
+        InferenceScheduler scheduler;
+        ScheduleConfig a, b, c;
+        a.weight = 2;
+        scheduler.add(0, a);
+        scheduler.add(1, b);
+        scheduler.add(2, c);
+        const int64_t cost[] = {20 * ms, 20 * ms, 40 * ms};
+        int64_t now = 1;
+        for (int i = 0; i < 3000; ++i) {
+            ScheduleDecision d;
+            ok = ok && scheduler.next([](int) { return true; }, d, now);
+            scheduler.complete(d, true, cost[d.id], 0);
+            now += cost[d.id];
+        }
+        double total = static_cast<double>(now);
+        for (int id = 0; id < 3; ++id) {
+            ScheduleStats s = scheduler.stats(id);
+            std::cout << "stream " << id << " served " << s.served << " busy share " << s.busy_ns / total << std::endl;
+        }
+        ok = ok && std::fabs(scheduler.stats(0).busy_ns / total - 0.5) < 0.02;
+        ok = ok && std::fabs(scheduler.stats(1).busy_ns / total - 0.25) < 0.02;
+        ok = ok && std::fabs(scheduler.stats(2).busy_ns / total - 0.25) < 0.02;
+    }
+
+    // 严格优先级：高优先级有帧时总是先服务；限速流每秒最多max_fps帧推理，其余帧不推理
+    // 低优先级流始终有帧，高优先级流每40ms到达一帧，限速流30fps到达、限5fps，每次推理耗时10ms
+    {
+        InferenceScheduler scheduler;
+        ScheduleConfig low, high, capped;
+        high.priority = 1;
+        capped.max_fps = 5;
+        scheduler.add(0, low);
+        scheduler.add(1, high);
+        scheduler.add(2, capped);
+        const int64_t duration = 10000 * ms;
+        int64_t now = 1;
+        int high_arrived = 0, high_pending = 0;
+        int capped_arrived = 0, capped_pending = 0;
+        bool priority_ok = true;
+        while (now < duration) {
+            for (; high_arrived * 40 * ms <= now; ++high_arrived) high_pending++;
+            for (; capped_arrived * 100 * ms / 3 <= now; ++capped_arrived) capped_pending++;
+            ScheduleDecision d;
+            scheduler.next([&](int id) {
+                return id == 0 || (id == 1 && high_pending > 0) || (id == 2 && capped_pending > 0);
+            }, d, now);
+            if (high_pending > 0 && d.allow_inference && d.id != 1) priority_ok = false;
+            if (d.id == 1) high_pending--;
+            if (d.id == 2) capped_pending--;
+            int64_t cost = d.allow_inference ? 10 * ms : 0;
+            scheduler.complete(d, true, cost, 0);
+            now += cost > 0 ? cost : ms / 10;
+        }
+        ScheduleStats capped_stats = scheduler.stats(2);
+        std::cout << "high served " << scheduler.stats(1).served << "/" << high_arrived
+                  << " low served " << scheduler.stats(0).served
+                  << " capped served " << capped_stats.served << " limited " << capped_stats.rate_limited
+                  << "/" << capped_arrived << std::endl;
+        ok = ok && priority_ok && scheduler.stats(1).served + 1 >= static_cast<uint64_t>(high_arrived);
+        ok = ok && capped_stats.served >= 49 && capped_stats.served <= 51;
+        ok = ok && capped_stats.served + capped_stats.rate_limited + 1 >= static_cast<uint64_t>(capped_arrived);
+    }
+
+    // 空闲的流不累积额度：流1空闲很久后恢复，不应连续独占
+    {
+        InferenceScheduler scheduler;
+        scheduler.add(0, ScheduleConfig());
+        scheduler.add(1, ScheduleConfig());
+        int64_t now = 1;
+        for (int i = 0; i < 100; ++i) {
+            ScheduleDecision d;
+            scheduler.next([](int id) { return id == 0; }, d, now);
+            scheduler.complete(d, true, 20 * ms, 0);
+            now += 20 * ms;
+        }
+        int run = 0, max_run = 0, last = -1;
+        for (int i = 0; i < 100; ++i) {
+            ScheduleDecision d;
+            scheduler.next([](int) { return true; }, d, now);
+            scheduler.complete(d, true, 20 * ms, 0);
+            now += 20 * ms;
+            run = d.id == last ? run + 1 : 1;
+            last = d.id;
+            max_run = std::max(max_run, run);
+        }
+        std::cout << "longest run after idle: " << max_run << std::endl;
+        ok = ok && max_run <= 2;
+    }
+
+    std::cout << "ok: " << ok << std::endl;
+    return ok ? 0 : 1;
+}
+#endif
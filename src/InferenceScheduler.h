@@ -0,0 +1,125 @@
+#pragma once
+/**
+ * @file InferenceScheduler.h
+ * @class InferenceScheduler
+ * @brief 多路流共享推理资源时的公平调度：优先级分级 + 按推理耗时的赤字轮询（DRR）+ 每路最大推理帧率
+ * @author achene
+ * @date 2025-08-05
+ *
+ * 多路流共享推理线程与模型池时，若工作线程谁先取到帧就处理谁，帧率高或分辨率大的流会挤占其他流。
+ * 调度器位于各路输入队列与共享推理线程之间，每次由工作线程调用next()决定下一帧处理哪一路：
+ * - 优先级：priority高的一级有待处理帧时总是先于低级（严格优先级，低级只使用高级剩余的算力）
+ * - 同一优先级内赤字轮询：每路每轮获得weight×quantum的推理时间额度，处理一帧扣除实际推理耗时，
+ *   额度为正才能被服务，从而按权重分配NPU时间而不是按帧数（大分辨率、慢模型的流按耗时计费）
+ * - 最大推理帧率：令牌桶限制每路的推理帧率，无令牌时该帧不推理（逐帧推理模式丢弃，解耦模式只叠加）
+ * 队列清空的流额度清零，不累积空闲期间的额度。
+ *
+ * 调度决策在锁内完成（每帧一次），推理本身在锁外进行；多个工作线程并发推理时，
+ * 选中时先按最近的推理耗时预扣额度，complete()时按实际耗时修正。
+ */
+#include "LatencyHistogram.h"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+
+// 单路流的调度参数
+struct ScheduleConfig {
+    int weight = 1;       // 同一优先级内的推理时间权重（>=1）
+    int priority = 0;     // 优先级，越大越优先
+    double max_fps = 0;   // 最大推理帧率，0表示不限制
+};
+
+// 单路流的调度统计
+struct ScheduleStats {
+    uint64_t served = 0;        // 获得推理的帧数
+    uint64_t rate_limited = 0;  // 超出最大推理帧率未推理的帧数
+    int64_t busy_ns = 0;        // 累计推理耗时
+    LatencySnapshot wait;       // 被调度前在输入队列中的等待时间
+};
+
+// 调度决策
+struct ScheduleDecision {
+    int id = -1;                  // 选中的流
+    bool allow_inference = true;  // false：超出最大推理帧率，该帧不推理
+    int64_t charged_ns = 0;       // 选中时预扣的额度，complete()时退还后按实际耗时扣除
+};
+
+class InferenceScheduler {
+public:
+    /**
+     * @brief 构造函数
+     * @param quantum_ns 每轮权重为1的流获得的推理时间额度（纳秒）
+     */
+    explicit InferenceScheduler(int64_t quantum_ns = 10000000);
+
+    InferenceScheduler(const InferenceScheduler&) = delete;
+    InferenceScheduler& operator=(const InferenceScheduler&) = delete;
+
+    /**
+     * @brief 加入一路流（已存在时更新其调度参数）
+     * @param id 流ID
+     * @param config 调度参数
+     */
+    void add(int id, const ScheduleConfig& config);
+
+    /**
+     * @brief 移除一路流，之后对其的complete()被忽略
+     */
+    void remove(int id);
+
+    /**
+     * @brief 选择下一帧处理哪一路流
+     * @param backlogged 查询流是否有待处理帧（在锁内调用，应为轻量操作）
+     * @param decision 输出调度决策
+     * @param now_ns 当前时间（单调时钟纳秒，用于令牌桶）
+     * @return 有可处理的流返回true，所有流都没有待处理帧时返回false
+     */
+    bool next(const std::function<bool(int)>& backlogged, ScheduleDecision& decision,
+              int64_t now_ns = LatencyHistogram::now_ns());
+
+    /**
+     * @brief 报告一次调度的处理结果
+     * @param decision next()返回的决策
+     * @param served 是否实际取到并处理了一帧（队列被其他线程取空时为false）
+     * @param cost_ns 处理耗时（按此扣除额度）
+     * @param wait_ns 该帧在输入队列中的等待时间
+     */
+    void complete(const ScheduleDecision& decision, bool served, int64_t cost_ns, int64_t wait_ns);
+
+    /**
+     * @brief 补记一帧在complete()之后才完成的推理时间（批量推理时由批处理线程调用）
+     * 该时间同样扣除额度、计入累计推理耗时，并计入下次选中时的预扣估计
+     * @param id 流ID
+     * @param cost_ns 该帧分摊的推理时间
+     */
+    void charge(int id, int64_t cost_ns);
+
+    /**
+     * @brief 获取一路流的调度统计，不存在时返回空统计
+     */
+    ScheduleStats stats(int id) const;
+
+private:
+    struct Stream {
+        ScheduleConfig config;
+        int64_t deficit_ns = 0;    // 当前剩余额度（可为负）
+        int64_t estimate_ns = 0;   // 最近一次推理耗时，选中时预扣
+        double tokens = 1;         // 令牌桶
+        int64_t refill_ns = 0;     // 上次补充令牌的时间
+        uint64_t served = 0;
+        uint64_t rate_limited = 0;
+        int64_t busy_ns = 0;
+        LatencyHistogram wait;
+        bool ready = false;        // 本次next()中是否有待处理帧
+    };
+
+    // 按经过的时间补充令牌，返回是否有令牌可用于推理（需持有锁）
+    static bool refill(Stream& stream, int64_t now_ns);
+
+    const int64_t quantum_ns_;
+    mutable std::mutex mutex_;
+    std::map<int, std::unique_ptr<Stream>> streams_;  // 按ID有序，轮询顺序稳定
+    std::map<int, int> cursor_;                       // 各优先级的轮询位置（上次服务的流ID）
+};
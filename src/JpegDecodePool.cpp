@@ -0,0 +1,252 @@
+#include "JpegDecodePool.h"
+#include <cstring>
+#include <iostream>
+
+#ifndef MODULE_TEST
+#define MODULE_TEST 0
+#endif
+
+JpegDecodePool::JpegDecodePool(int worker_count, std::shared_ptr<FramePool> frame_pool, size_t max_pending)
+    : worker_count_(worker_count > 0 ? worker_count : 1),
+      frame_pool_(std::move(frame_pool)),
+      jobs_(max_pending) {}
+
+JpegDecodePool::~JpegDecodePool() {
+    stop();
+}
+
+bool JpegDecodePool::start() {
+    if (running_) return true;
+
+    if (!avcodec_find_decoder(AV_CODEC_ID_MJPEG)) {
+        std::cerr << "JpegDecodePool: MJPEG decoder not found" << std::endl;
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(reorder_mutex_);
+        pending_.clear();
+        next_emit_ = next_seq_;
+    }
+
+    running_ = true;
+    for (int i = 0; i < worker_count_; ++i) {
+        workers_.emplace_back(&JpegDecodePool::worker_loop, this);
+    }
+    return true;
+}
+
+void JpegDecodePool::stop() {
+    if (!running_) return;
+
+    running_ = false;
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers_.clear();
+
+    // 未解码的压缩帧在此释放：其采集缓冲区立即归还，重新启动后也不会再以旧序号完成
+    Job job;
+    while (jobs_.pop(job, 0)) {
+        av_packet_free(&job.packet);
+    }
+}
+
+bool JpegDecodePool::submit(AVPacket* packet) {
+    // 队列满时丢弃，不阻塞采集线程
+    Job job{next_seq_, packet};
+    if (!running_ || !jobs_.push(job, 0)) {
+        av_packet_free(&packet);
+        dropped_++;
+        return false;
+    }
+    next_seq_++;
+    return true;
+}
+
+int JpegDecodePool::get_buffer(AVCodecContext* ctx, AVFrame* frame, int flags) {
+    JpegDecodePool* self = static_cast<JpegDecodePool*>(ctx->opaque);
+    if (!self->frame_pool_) {
+        return avcodec_default_get_buffer2(ctx, frame, flags);
+    }
+
+    // 按解码器要求对齐宽高后从帧池取缓冲区
+    int width = frame->width;
+    int height = frame->height;
+    int linesize_align[AV_NUM_DATA_POINTERS];
+    avcodec_align_dimensions2(ctx, &frame->width, &frame->height, linesize_align);
+    bool attached = self->frame_pool_->attach_buffer(frame);
+    frame->width = width;
+    frame->height = height;
+    if (!attached) {
+        return avcodec_default_get_buffer2(ctx, frame, flags);
+    }
+    frame->extended_data = frame->data;
+    return 0;
+}
+
+void JpegDecodePool::worker_loop() {
+    if (thread_init_) {
+        thread_init_();
+    }
+    const AVCodec* codec = avcodec_find_decoder(AV_CODEC_ID_MJPEG);
+    AVCodecContext* ctx = avcodec_alloc_context3(codec);
+    if (!ctx) {
+        std::cerr << "JpegDecodePool: could not allocate decoder context" << std::endl;
+        return;
+    }
+    ctx->thread_count = 1;  // 并行度由解码线程数提供
+    ctx->opaque = this;
+    if (codec->capabilities & AV_CODEC_CAP_DR1) {
+        ctx->get_buffer2 = &JpegDecodePool::get_buffer;
+    }
+    if (avcodec_open2(ctx, codec, nullptr) < 0) {
+        std::cerr << "JpegDecodePool: could not open MJPEG decoder" << std::endl;
+        avcodec_free_context(&ctx);
+        return;
+    }
+
+    while (running_) {
+        Job job;
+        if (!jobs_.pop(job, 50)) {  // 50ms超时
+            continue;
+        }
+
+        int64_t pts = job.packet->pts;
+        AVBufferRef* meta = job.packet->opaque_ref;  // 帧元数据，解码后转挂到输出帧
+        job.packet->opaque_ref = nullptr;
+        int ret = avcodec_send_packet(ctx, job.packet);
+        av_packet_free(&job.packet);  // 压缩帧缓冲区（采集缓冲区）在此归还
+
+        FramePtr frame;
+        if (ret >= 0) {
+            frame = make_frame_ptr(av_frame_alloc());
+            ret = avcodec_receive_frame(ctx, frame.get());
+        }
+        if (ret < 0) {
+            av_buffer_unref(&meta);
+            failed_++;
+            complete(job.seq, nullptr);
+            continue;
+        }
+        frame->pts = pts;
+        if (meta) {
+            av_buffer_unref(&frame->opaque_ref);
+            frame->opaque_ref = meta;
+        }
+        decoded_++;
+        complete(job.seq, std::move(frame));
+    }
+    avcodec_free_context(&ctx);
+}
+
+void JpegDecodePool::complete(uint64_t seq, FramePtr frame) {
+    std::lock_guard<std::mutex> lock(reorder_mutex_);
+    if (seq < next_emit_) {
+        // 重新启动前提交的帧：输出序号已越过它，插入后将永远停留在pending_中并阻塞其后的输出
+        return;
+    }
+    pending_[seq] = std::move(frame);
+    // 依次输出已连续完成的帧
+    auto it = pending_.begin();
+    while (it != pending_.end() && it->first == next_emit_) {
+        if (it->second && frame_callback_) {
+            frame_callback_(std::move(it->second));
+        }
+        it = pending_.erase(it);
+        next_emit_++;
+    }
+}
+
+
+#if MODULE_TEST
+//g++ -c FramePool.cpp && g++ -DMODULE_TEST=1 -o bench_jpeg_decode JpegDecodePool.cpp FramePool.o -lpthread -lavcodec -lavutil
+// 解码吞吐测试：./bench_jpeg_decode <jpeg目录> [最大线程数]
+#include <dirent.h>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <algorithm>
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <jpeg_dir> [max_workers]" << std::endl;
+        return 1;
+    }
+    std::string dir = argv[1];
+    int max_workers = argc > 2 ? std::atoi(argv[2]) : 4;
+
+    // 读取目录下所有JPEG帧（按文件名排序）
+    std::vector<std::string> names;
+    DIR* dp = opendir(dir.c_str());
+    if (!dp) {
+        std::cerr << "open dir failed: " << dir << std::endl;
+        return 1;
+    }
+    while (dirent* entry = readdir(dp)) {
+        std::string name = entry->d_name;
+        if (name.size() > 4 && (name.substr(name.size() - 4) == ".jpg" || name.substr(name.size() - 5) == ".jpeg")) {
+            names.push_back(name);
+        }
+    }
+    closedir(dp);
+    std::sort(names.begin(), names.end());
+    std::vector<std::vector<uint8_t>> jpegs;
+    for (const auto& name : names) {
+        std::ifstream in(dir + "/" + name, std::ios::binary);
+        jpegs.emplace_back(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    if (jpegs.empty()) {
+        std::cerr << "no jpeg frames found" << std::endl;
+        return 1;
+    }
+
+    const int rounds = std::max<int>(1, 600 / jpegs.size());
+    for (int workers = 1; workers <= max_workers; ++workers) {
+        auto pool = std::make_shared<FramePool>(AV_PIX_FMT_RGB24, 1920, 1080, 16);
+        JpegDecodePool decoder(workers, pool, 16);
+        std::atomic<uint64_t> received{0};
+        std::atomic<bool> in_order{true};
+        int64_t last_pts = -1;
+        decoder.set_frame_callback([&](FramePtr frame) {
+            if (frame->pts <= last_pts) in_order = false;
+            last_pts = frame->pts;
+            received++;
+        });
+        decoder.start();
+
+        uint64_t total = static_cast<uint64_t>(rounds) * jpegs.size();
+        auto begin = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < total; ++i) {
+            const auto& jpeg = jpegs[i % jpegs.size()];
+            AVPacket* packet = av_packet_alloc();
+            av_new_packet(packet, jpeg.size());
+            memcpy(packet->data, jpeg.data(), jpeg.size());
+            packet->pts = i;
+            // 基准测试中队列满时重试，不丢帧
+            while (!decoder.submit(packet)) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                packet = av_packet_alloc();
+                av_new_packet(packet, jpeg.size());
+                memcpy(packet->data, jpeg.data(), jpeg.size());
+                packet->pts = i;
+            }
+        }
+        while (received + decoder.failed_count() < total) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        decoder.stop();
+
+        FramePoolStats stats = pool->stats();
+        std::cout << "workers: " << workers
+                  << " frames: " << received
+                  << " fps: " << received / seconds
+                  << " in_order: " << in_order
+                  << " pool hits: " << stats.hits << " misses: " << stats.misses << std::endl;
+    }
+    return 0;
+}
+#endif
@@ -0,0 +1,139 @@
+#pragma once
+/**
+ * @file JpegDecodePool.h
+ * @class JpegDecodePool
+ * @brief MJPEG并行解码池
+ * @author achene
+ * @date 2025-08-05
+ *
+ * 将采集线程取到的JPEG压缩帧分发给多个解码线程并行解码，解码结果按提交序号
+ * 依次通过回调输出，保证帧顺序不变；采集线程只负责出队与提交，不做任何解码。
+ *
+ * 主要功能特点：
+ * - 每个解码线程独立持有一个MJPEG解码器上下文
+ * - 通过get_buffer2回调直接解码到流水线共享的FramePool中，无额外拷贝
+ * - 待解码队列有界，队列满时丢弃新帧而不阻塞采集线程
+ * - 按序号重排输出，解码失败的帧被跳过
+ * - 压缩帧AVPacket::opaque_ref携带的帧元数据（FrameMeta）转挂到解码输出帧
+ *
+ * 使用流程：
+ * 1. 构造JpegDecodePool并指定解码线程数与帧池
+ * 2. 通过set_frame_callback()设置解码完成回调
+ * 3. 调用start()启动解码线程
+ * 4. 采集线程调用submit()提交压缩帧
+ * 5. 调用stop()停止解码线程
+ */
+#include "FramePool.h"
+#include "thread_safe_queue.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+class JpegDecodePool {
+public:
+    using FrameCallback = std::function<void(FramePtr)>;
+
+    /**
+     * @brief 构造函数
+     * @param worker_count 解码线程数量
+     * @param frame_pool 解码输出使用的帧池（为空时由解码器自行分配）
+     * @param max_pending 待解码队列最大长度
+     */
+    JpegDecodePool(int worker_count, std::shared_ptr<FramePool> frame_pool, size_t max_pending = 8);
+
+    /**
+     * @brief 析构函数，停止解码线程并释放未解码的压缩帧
+     */
+    ~JpegDecodePool();
+
+    JpegDecodePool(const JpegDecodePool&) = delete;
+    JpegDecodePool& operator=(const JpegDecodePool&) = delete;
+
+    /**
+     * @brief 启动解码线程
+     * @return 成功返回true，找不到MJPEG解码器返回false
+     */
+    bool start();
+
+    /**
+     * @brief 停止解码线程，队列中未解码的压缩帧随之释放（采集缓冲区归还）
+     */
+    void stop();
+
+    /**
+     * @brief 设置解码完成回调，按提交顺序在解码线程中调用
+     */
+    void set_frame_callback(FrameCallback callback) { frame_callback_ = std::move(callback); }
+
+    /**
+     * @brief 设置解码线程启动时的初始化函数（需在start()之前调用），用于线程命名、CPU亲和性与调度策略设置
+     */
+    void set_thread_init(std::function<void()> init) { thread_init_ = std::move(init); }
+
+    /**
+     * @brief 提交一帧JPEG压缩数据（非阻塞）
+     * @param packet 压缩帧，提交后所有权归解码池
+     * @return 成功入队返回true，队列已满（帧被丢弃）返回false
+     */
+    bool submit(AVPacket* packet);
+
+    uint64_t decoded_count() const { return decoded_; }
+    uint64_t dropped_count() const { return dropped_; }
+    uint64_t failed_count() const { return failed_; }
+
+private:
+    struct Job {
+        uint64_t seq;
+        AVPacket* packet;
+    };
+    struct JobComparator {
+        bool operator()(const Job& a, const Job& b) const {
+            return a.seq > b.seq;  // 序号小的先解码
+        }
+    };
+
+    /**
+     * @brief 解码线程主函数
+     */
+    void worker_loop();
+
+    /**
+     * @brief 解码完成后按序号重排并输出
+     * @param seq 帧序号
+     * @param frame 解码结果，解码失败时为空
+     */
+    void complete(uint64_t seq, FramePtr frame);
+
+    /**
+     * @brief 解码器缓冲区分配回调，从帧池获取缓冲区
+     */
+    static int get_buffer(AVCodecContext* ctx, AVFrame* frame, int flags);
+
+    int worker_count_;
+    std::shared_ptr<FramePool> frame_pool_;
+    FrameCallback frame_callback_;
+    std::function<void()> thread_init_;
+
+    std::atomic<bool> running_{false};
+    std::vector<std::thread> workers_;
+    ThreadSafeQueue<Job, JobComparator> jobs_;
+    uint64_t next_seq_ = 0;  // 仅在提交线程中修改
+
+    // 重排输出
+    std::mutex reorder_mutex_;
+    std::map<uint64_t, FramePtr> pending_;
+    uint64_t next_emit_ = 0;
+
+    std::atomic<uint64_t> decoded_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> failed_{0};
+};
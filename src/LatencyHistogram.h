@@ -0,0 +1,135 @@
+#pragma once
+/**
+ * @file LatencyHistogram.h
+ * @class LatencyHistogram
+ * @brief 无锁延迟直方图
+ * @author achene
+ * @date 2025-08-05
+ *
+ * 按对数分桶（每个2的幂区间再细分4个子桶，相对误差约20%）统计纳秒级延迟，
+ * record()只做几次relaxed原子操作，可在采集、推理等热路径中由多个线程并发调用。
+ *
+ * 使用流程：
+ * 1. 在热路径中调用record()记录一次延迟（纳秒）
+ * 2. 监控线程调用snapshot()获取计数、均值、分位数与最大值
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// 直方图快照（单位：微秒）
+struct LatencySnapshot {
+    uint64_t count = 0;
+    double mean_us = 0;
+    double p50_us = 0;
+    double p90_us = 0;
+    double p99_us = 0;
+    double max_us = 0;
+};
+
+class LatencyHistogram {
+public:
+    LatencyHistogram() { reset(); }
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    /**
+     * @brief 获取单调时钟当前时间（纳秒），与V4L2单调时间戳同一时钟
+     */
+    static uint64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief 记录一次延迟
+     * @param ns 延迟（纳秒）
+     */
+    void record(uint64_t ns) {
+        buckets_[bucket_of(ns)].fetch_add(1, std::memory_order_relaxed);
+        sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t prev = max_ns_.load(std::memory_order_relaxed);
+        while (ns > prev && !max_ns_.compare_exchange_weak(prev, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    /**
+     * @brief 清空统计
+     */
+    void reset() {
+        for (auto& bucket : buckets_) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        sum_ns_ = 0;
+        max_ns_ = 0;
+    }
+
+    /**
+     * @brief 获取统计快照（与并发record()之间不保证严格一致）
+     */
+    LatencySnapshot snapshot() const {
+        LatencySnapshot snap;
+        uint64_t counts[kBucketCount];
+        uint64_t total = 0;
+        for (int i = 0; i < kBucketCount; ++i) {
+            counts[i] = buckets_[i].load(std::memory_order_relaxed);
+            total += counts[i];
+        }
+        if (total == 0) {
+            return snap;
+        }
+        snap.count = total;
+        snap.mean_us = static_cast<double>(sum_ns_.load(std::memory_order_relaxed)) / total / 1000.0;
+        snap.max_us = max_ns_.load(std::memory_order_relaxed) / 1000.0;
+        snap.p50_us = percentile(counts, total, 0.50) / 1000.0;
+        snap.p90_us = percentile(counts, total, 0.90) / 1000.0;
+        snap.p99_us = percentile(counts, total, 0.99) / 1000.0;
+        snap.p50_us = std::min(snap.p50_us, snap.max_us);
+        snap.p90_us = std::min(snap.p90_us, snap.max_us);
+        snap.p99_us = std::min(snap.p99_us, snap.max_us);
+        return snap;
+    }
+
+private:
+    static constexpr int kSubBits = 2;
+    static constexpr int kSubBuckets = 1 << kSubBits;
+    static constexpr int kBucketCount = 160;  // 覆盖约2^39ns（约9分钟）
+
+    static int bucket_of(uint64_t ns) {
+        if (ns < kSubBuckets) {
+            return static_cast<int>(ns);
+        }
+        int msb = 63 - __builtin_clzll(ns);
+        int shift = msb - kSubBits;
+        int bucket = shift * kSubBuckets + static_cast<int>(ns >> shift);
+        return std::min(bucket, kBucketCount - 1);
+    }
+
+    // 桶的上界（纳秒），分位数取所在桶上界
+    static uint64_t bucket_upper(int bucket) {
+        if (bucket < kSubBuckets) {
+            return bucket;
+        }
+        int shift = bucket / kSubBuckets - 1;
+        uint64_t mantissa = bucket - shift * kSubBuckets;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+    static double percentile(const uint64_t* counts, uint64_t total, double p) {
+        uint64_t target = static_cast<uint64_t>(p * total);
+        uint64_t seen = 0;
+        for (int i = 0; i < kBucketCount; ++i) {
+            seen += counts[i];
+            if (seen > target) {
+                return static_cast<double>(bucket_upper(i));
+            }
+        }
+        return static_cast<double>(bucket_upper(kBucketCount - 1));
+    }
+
+    std::atomic<uint64_t> buckets_[kBucketCount];
+    std::atomic<uint64_t> sum_ns_{0};
+    std::atomic<uint64_t> max_ns_{0};
+};
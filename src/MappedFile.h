@@ -0,0 +1,67 @@
+#pragma once
+/**
+ * @file MappedFile.h
+ * @class MappedFile
+ * @brief 只读打开并整体mmap的文件（模型文件只映射一次，供所有模型实例初始化共用）
+ * @author achene
+ * @date 2025-08-05
+ *
+ * 映射为MAP_PRIVATE：页面来自页缓存，多个实例、多次初始化都不再复制文件内容，
+ * 使用方即使写入也只影响私有副本。映射在对象析构时解除。
+ */
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+
+class MappedFile {
+public:
+    /**
+     * @brief 打开并映射文件
+     * @param path 文件路径
+     * @return 成功返回映射对象，失败返回nullptr
+     */
+    static std::shared_ptr<MappedFile> open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            std::cerr << "MappedFile: open " << path << " failed (" << strerror(errno) << ")" << std::endl;
+            return nullptr;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+            std::cerr << "MappedFile: " << path << " is empty or unreadable" << std::endl;
+            close(fd);
+            return nullptr;
+        }
+        void* data = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        close(fd);  // 映射建立后不再需要fd
+        if (data == MAP_FAILED) {
+            std::cerr << "MappedFile: mmap " << path << " failed (" << strerror(errno) << ")" << std::endl;
+            return nullptr;
+        }
+        return std::shared_ptr<MappedFile>(new MappedFile(data, static_cast<size_t>(st.st_size)));
+    }
+
+    ~MappedFile() {
+        munmap(data_, size_);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    void* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    MappedFile(void* data, size_t size) : data_(data), size_(size) {}
+
+    void* data_;
+    size_t size_;
+};
+
+using MappedFilePtr = std::shared_ptr<MappedFile>;
@@ -0,0 +1,403 @@
+#include "MetricsServer.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifndef MODULE_TEST
+#define MODULE_TEST 0
+#endif
+
+namespace {
+constexpr int kRequestTimeoutMs = 1000;  // 读取请求的超时，避免慢客户端占住监听线程
+constexpr size_t kMaxRequestSize = 8192;
+
+std::string format_value(double value) {
+    char buf[32];
+    if (std::floor(value) == value && std::fabs(value) < 1e15) {
+        snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(value));
+    } else {
+        snprintf(buf, sizeof(buf), "%.6g", value);
+    }
+    return buf;
+}
+
+bool write_all(int fd, const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        written += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+std::string http_response(const char* status, const char* content_type, const std::string& body) {
+    std::string response = std::string("HTTP/1.1 ") + status + "\r\n";
+    response += std::string("Content-Type: ") + content_type + "\r\n";
+    response += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    response += "Connection: close\r\n\r\n";
+    response += body;
+    return response;
+}
+} // namespace
+
+void PrometheusWriter::family(const std::string& name, const char* type, const char* help) {
+    text_ += "# HELP " + name + " " + help + "\n";
+    text_ += "# TYPE " + name + " " + type + "\n";
+}
+
+void PrometheusWriter::sample(const std::string& name, const std::string& labels, double value) {
+    text_ += name;
+    if (!labels.empty()) {
+        text_ += "{" + labels + "}";
+    }
+    text_ += " " + format_value(value) + "\n";
+}
+
+void PrometheusWriter::summary(const std::string& name, const std::string& labels, const LatencySnapshot& latency) {
+    const std::string prefix = labels.empty() ? "" : labels + ",";
+    sample(name, prefix + "quantile=\"0.5\"", latency.p50_us / 1e6);
+    sample(name, prefix + "quantile=\"0.9\"", latency.p90_us / 1e6);
+    sample(name, prefix + "quantile=\"0.99\"", latency.p99_us / 1e6);
+    sample(name + "_sum", labels, latency.mean_us * latency.count / 1e6);
+    sample(name + "_count", labels, static_cast<double>(latency.count));
+}
+
+std::string PrometheusWriter::escape_label(const std::string& value) {
+    std::string escaped;
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::string MetricsServer::format_stream_metrics(const std::vector<StreamMetrics>& streams) {
+    std::vector<std::string> labels;
+    for (const StreamMetrics& s : streams) {
+        labels.push_back("camera=\"" + std::to_string(s.camera_id) + "\",source=\"" +
+                         PrometheusWriter::escape_label(s.source) + "\"");
+    }
+
+    PrometheusWriter out;
+    // 普通计数器/仪表：每个指标族写出全部流的样本
+    auto write = [&](const char* name, const char* type, const char* help,
+                     std::function<double(const StreamMetrics&)> value) {
+        out.family(name, type, help);
+        for (size_t i = 0; i < streams.size(); ++i) {
+            out.sample(name, labels[i], value(streams[i]));
+        }
+    };
+
+    write("pipeline_captured_frames_total", "counter", "Frames dequeued from the capture source.",
+          [](const StreamMetrics& s) { return s.captured; });
+    write("pipeline_capture_fps", "gauge", "Capture frame rate since the previous scrape.",
+          [](const StreamMetrics& s) { return s.capture_fps; });
+    write("pipeline_driver_dropped_frames_total", "counter", "Frames dropped by the capture driver (sequence gaps).",
+          [](const StreamMetrics& s) { return s.driver_dropped; });
+    write("pipeline_dropped_frames_total", "counter", "Captured frames that never reached the encoder.",
+          [](const StreamMetrics& s) { return s.pipeline_dropped; });
+    write("pipeline_overload_dropped_frames_total", "counter", "Frames dropped by the input queue overload policy.",
+          [](const StreamMetrics& s) { return s.overload_dropped; });
+    write("pipeline_reorder_late_frames_total", "counter", "Frames discarded by the reorder ring for arriving late.",
+          [](const StreamMetrics& s) { return s.reorder_late; });
+    write("pipeline_reorder_skipped_total", "counter", "Sequence numbers skipped by the reorder ring after waiting.",
+          [](const StreamMetrics& s) { return s.reorder_skipped; });
+    write("pipeline_reorder_overflow_total", "counter", "Missing sequence numbers skipped by the reorder ring because it was full.",
+          [](const StreamMetrics& s) { return s.reorder_overflow; });
+    write("pipeline_input_queue_depth", "gauge", "Frames waiting in the inference input queue.",
+          [](const StreamMetrics& s) { return s.input_queue_depth; });
+    write("pipeline_input_queue_capacity", "gauge", "Inference input queue capacity (0 = unbounded).",
+          [](const StreamMetrics& s) { return s.input_queue_capacity; });
+    write("pipeline_reorder_held_frames", "gauge", "Frames held in the reorder ring waiting for earlier frames.",
+          [](const StreamMetrics& s) { return s.reorder_held; });
+
+    write("pipeline_model_pool_size", "gauge", "Model instances in the pool.",
+          [](const StreamMetrics& s) { return s.model_pool_size; });
+    write("pipeline_model_pool_idle", "gauge", "Model instances currently idle.",
+          [](const StreamMetrics& s) { return s.model_pool_idle; });
+    write("pipeline_model_busy_seconds_total", "counter", "Time spent in inference summed over all model instances.",
+          [](const StreamMetrics& s) { return s.model_busy_seconds; });
+    write("pipeline_model_pool_utilization", "gauge", "Fraction of model pool time spent in inference since the previous scrape.",
+          [](const StreamMetrics& s) { return s.model_utilization; });
+    write("pipeline_inferred_frames_total", "counter", "Frames that completed inference.",
+          [](const StreamMetrics& s) { return s.inferred; });
+    write("pipeline_inference_fps", "gauge", "Inference frame rate since the previous scrape.",
+          [](const StreamMetrics& s) { return s.inference_fps; });
+    out.family("pipeline_inference_latency_seconds", "summary", "Model inference latency.");
+    for (size_t i = 0; i < streams.size(); ++i) {
+        out.summary("pipeline_inference_latency_seconds", labels[i], streams[i].inference_latency);
+    }
+
+    write("pipeline_scheduled_frames_total", "counter", "Frames granted inference by the shared scheduler.",
+          [](const StreamMetrics& s) { return s.scheduled; });
+    write("pipeline_rate_limited_frames_total", "counter", "Frames not inferred because the stream exceeded its max inference fps.",
+          [](const StreamMetrics& s) { return s.rate_limited; });
+    out.family("pipeline_schedule_wait_seconds", "summary", "Input queue wait before the shared scheduler served the frame.");
+    for (size_t i = 0; i < streams.size(); ++i) {
+        out.summary("pipeline_schedule_wait_seconds", labels[i], streams[i].schedule_wait);
+    }
+
+    write("pipeline_encoded_frames_total", "counter", "Frames sent to the encoder.",
+          [](const StreamMetrics& s) { return s.encoded; });
+    write("pipeline_encode_fps", "gauge", "Encoder frame rate since the previous scrape.",
+          [](const StreamMetrics& s) { return s.encode_fps; });
+    write("pipeline_sent_bytes_total", "counter", "Encoded bytes written to the muxer.",
+          [](const StreamMetrics& s) { return s.bytes_sent; });
+    write("pipeline_sent_packets_total", "counter", "Encoded packets written to the muxer.",
+          [](const StreamMetrics& s) { return s.packets_sent; });
+    write("pipeline_bitrate_bps", "gauge", "Measured output bitrate since the previous scrape.",
+          [](const StreamMetrics& s) { return s.bitrate_bps; });
+    write("pipeline_target_bitrate_bps", "gauge", "Configured encoder bitrate.",
+          [](const StreamMetrics& s) { return static_cast<double>(s.target_bitrate_bps); });
+    write("pipeline_encode_errors_total", "counter", "Encoder send/receive failures.",
+          [](const StreamMetrics& s) { return s.encode_errors; });
+    write("pipeline_mux_errors_total", "counter", "Muxer write failures (stream output errors).",
+          [](const StreamMetrics& s) { return s.mux_errors; });
+    write("pipeline_time_to_first_frame_seconds", "gauge", "Time from stream start to the first encoded frame (0 until then).",
+          [](const StreamMetrics& s) { return s.time_to_first_frame; });
+    out.family("pipeline_capture_to_encode_seconds", "summary", "Latency from capture timestamp to encoder input.");
+    for (size_t i = 0; i < streams.size(); ++i) {
+        out.summary("pipeline_capture_to_encode_seconds", labels[i], streams[i].capture_to_encode);
+    }
+    return out.text();
+}
+
+MetricsServer::MetricsServer(int port, const std::string& bind_address)
+    : port_(port), bind_address_(bind_address) {
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+bool MetricsServer::start() {
+    if (running_) return true;
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port_));
+    if (inet_pton(AF_INET, bind_address_.c_str(), &addr.sin_addr) != 1) {
+        std::cerr << "MetricsServer: invalid bind address " << bind_address_ << std::endl;
+        return false;
+    }
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (listen_fd_ == -1 || wake_fd_ == -1) {
+        std::cerr << "MetricsServer: socket/eventfd create failed: " << strerror(errno) << std::endl;
+        stop();
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1 ||
+        listen(listen_fd_, 8) == -1) {
+        std::cerr << "MetricsServer: bind " << bind_address_ << ":" << port_
+                  << " failed: " << strerror(errno) << std::endl;
+        stop();
+        return false;
+    }
+    socklen_t len = sizeof(addr);
+    if (getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len) == 0) {
+        port_ = ntohs(addr.sin_port);
+    }
+
+    running_ = true;
+    thread_ = std::thread(&MetricsServer::serve_loop, this);
+    return true;
+}
+
+void MetricsServer::stop() {
+    if (running_.exchange(false)) {
+        uint64_t one = 1;
+        if (write(wake_fd_, &one, sizeof(one)) != sizeof(one)) {
+            std::cerr << "MetricsServer: wake failed" << std::endl;
+        }
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (listen_fd_ != -1) {
+        close(listen_fd_);
+        listen_fd_ = -1;
+    }
+    if (wake_fd_ != -1) {
+        close(wake_fd_);
+        wake_fd_ = -1;
+    }
+}
+
+void MetricsServer::serve_loop() {
+    pollfd fds[2];
+    fds[0].fd = listen_fd_;
+    fds[0].events = POLLIN;
+    fds[1].fd = wake_fd_;
+    fds[1].events = POLLIN;
+    while (running_) {
+        int n = poll(fds, 2, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "MetricsServer: poll failed: " << strerror(errno) << std::endl;
+            break;
+        }
+        if (fds[1].revents & POLLIN) {
+            break;
+        }
+        if (fds[0].revents & POLLIN) {
+            int client = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client == -1) {
+                continue;
+            }
+            handle_client(client);
+            close(client);
+        }
+    }
+}
+
+void MetricsServer::handle_client(int fd) {
+    // 读取到请求头结束，只解析请求行
+    std::string request;
+    char buf[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < kMaxRequestSize) {
+        pollfd pfd{fd, POLLIN, 0};
+        if (poll(&pfd, 1, kRequestTimeoutMs) <= 0) {
+            return;
+        }
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            break;
+        }
+        request.append(buf, static_cast<size_t>(n));
+    }
+
+    size_t method_end = request.find(' ');
+    size_t path_end = method_end == std::string::npos ? std::string::npos : request.find(' ', method_end + 1);
+    if (path_end == std::string::npos) {
+        write_all(fd, http_response("400 Bad Request", "text/plain", "bad request\n"));
+        return;
+    }
+    std::string method = request.substr(0, method_end);
+    std::string path = request.substr(method_end + 1, path_end - method_end - 1);
+    size_t query = path.find('?');
+    if (query != std::string::npos) {
+        path.resize(query);
+    }
+
+    if (method != "GET") {
+        write_all(fd, http_response("405 Method Not Allowed", "text/plain", "only GET is supported\n"));
+    } else if (path == "/metrics") {
+        std::string body = handler_ ? handler_() : std::string();
+        write_all(fd, http_response("200 OK", "text/plain; version=0.0.4; charset=utf-8", body));
+    } else if (path == "/") {
+        write_all(fd, http_response("200 OK", "text/plain", "pipeline metrics: /metrics\n"));
+    } else {
+        write_all(fd, http_response("404 Not Found", "text/plain", "not found\n"));
+    }
+}
+
+
+#if MODULE_TEST
+//g++ -DMODULE_TEST=1 -o test_metrics_server MetricsServer.cpp -lpthread
+// 端点测试：端口0启动服务，用本地socket请求/metrics与未知路径，检查状态行与指标文本
+#include "ShardedCounter.h"
+#include <vector>
+
+static std::string http_get(int port, const std::string& path) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+        close(fd);
+        return std::string();
+    }
+    write_all(fd, "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    std::string response;
+    char buf[4096];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) {
+        response.append(buf, static_cast<size_t>(n));
+    }
+    close(fd);
+    return response;
+}
+
+int main() {
+    bool ok = true;
+
+    // 多线程并发累加分片计数器
+    ShardedCounter counter;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&counter]() {
+            for (int i = 0; i < 100000; ++i) counter.add();
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    std::cout << "sharded counter: " << counter.value() << std::endl;
+    ok = ok && counter.value() == 800000;
+
+    int scrapes = 0;
+    MetricsServer server(0);
+    server.set_handler([&scrapes]() {
+        StreamMetrics a;
+        a.camera_id = 0;
+        a.source = "v4l2 \"/dev/video0\"";
+        a.captured = 1234;
+        a.bytes_sent = 5000000000ULL;
+        a.model_utilization = 0.75;
+        a.inference_latency.count = 10;
+        a.inference_latency.mean_us = 20000;
+        a.inference_latency.p50_us = 18000;
+        StreamMetrics b;
+        b.camera_id = 1;
+        b.source = "synthetic";
+        scrapes++;
+        return MetricsServer::format_stream_metrics({a, b});
+    });
+    ok = ok && server.start() && server.port() > 0;
+    std::cout << "listening on port " << server.port() << std::endl;
+
+    std::string response = http_get(server.port(), "/metrics");
+    std::cout << response.substr(0, 600) << "..." << std::endl;
+    ok = ok && response.compare(0, 15, "HTTP/1.1 200 OK") == 0;
+    ok = ok && response.find("pipeline_captured_frames_total{camera=\"0\",source=\"v4l2 \\\"/dev/video0\\\"\"} 1234\n") != std::string::npos;
+    ok = ok && response.find("pipeline_sent_bytes_total{camera=\"0\"") != std::string::npos;
+    ok = ok && response.find("} 5000000000\n") != std::string::npos;
+    ok = ok && response.find("pipeline_model_pool_utilization{camera=\"0\",source=\"v4l2 \\\"/dev/video0\\\"\"} 0.75\n") != std::string::npos;
+    ok = ok && response.find("quantile=\"0.5\"} 0.018\n") != std::string::npos;
+    ok = ok && response.find("pipeline_inference_latency_seconds_sum{camera=\"0\",source=\"v4l2 \\\"/dev/video0\\\"\"} 0.2\n") != std::string::npos;
+    ok = ok && response.find("pipeline_captured_frames_total{camera=\"1\",source=\"synthetic\"} 0\n") != std::string::npos;
+    // 同一指标族的样本必须连续
+    size_t first = response.find("# TYPE pipeline_captured_frames_total");
+    ok = ok && first != std::string::npos && response.find("# TYPE pipeline_captured_frames_total", first + 1) == std::string::npos;
+
+    ok = ok && http_get(server.port(), "/nothing").compare(0, 12, "HTTP/1.1 404") == 0;
+    ok = ok && scrapes == 1;
+    server.stop();
+    ok = ok && http_get(server.port(), "/metrics").empty();
+
+    std::cout << "ok: " << ok << std::endl;
+    return ok ? 0 : 1;
+}
+#endif
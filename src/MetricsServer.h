@@ -0,0 +1,192 @@
+#pragma once
+/**
+ * @file MetricsServer.h
+ * @class MetricsServer
+ * @brief 内嵌HTTP指标端点，以Prometheus文本格式导出流水线计数器
+ * @author achene
+ * @date 2025-08-05
+ *
+ * 单个后台线程监听本地端口（默认只绑定127.0.0.1），收到GET /metrics时调用处理函数生成指标文本。
+ * 指标在抓取时由各模块的统计快照汇总生成，热路径只做ShardedCounter/LatencyHistogram的
+ * relaxed原子累加，抓取不会阻塞采集、推理、编码线程。
+ *
+ * 使用流程：
+ * 1. 构造MetricsServer并set_handler()，处理函数中收集各路流的StreamMetrics并调用format_stream_metrics()
+ * 2. start()启动监听线程，stop()或析构时停止
+ * 3. curl http://127.0.0.1:<port>/metrics，或在Prometheus中配置抓取
+ */
+#include "LatencyHistogram.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 单路流的指标快照（计数器为累计值，*_fps/bitrate/utilization为距上次抓取的平均值）
+struct StreamMetrics {
+    int camera_id = 0;
+    std::string source;             // 帧源描述
+
+    // 采集
+    uint64_t captured = 0;          // 从驱动取出的帧数
+    uint64_t driver_dropped = 0;    // 驱动丢帧数
+    double capture_fps = 0;
+
+    // 队列与丢帧
+    size_t input_queue_depth = 0;   // 输入队列当前深度
+    size_t input_queue_capacity = 0;  // 输入队列容量，0表示无上限
+    size_t reorder_held = 0;        // 输出重排环中等待前序帧的帧数
+    uint64_t pipeline_dropped = 0;  // 流水线中丢弃的帧数
+    uint64_t overload_dropped = 0;  // 其中输入队列过载丢弃的帧数
+    uint64_t reorder_late = 0;      // 重排迟到丢弃的帧数
+    uint64_t reorder_skipped = 0;   // 重排等待超时越过的序号数
+    uint64_t reorder_overflow = 0;  // 重排环满越过的缺失序号数
+
+    // 推理
+    size_t model_pool_size = 0;     // 模型实例数
+    size_t model_pool_idle = 0;     // 当前空闲的模型实例数
+    double model_busy_seconds = 0;  // 所有模型实例累计推理时间
+    double model_utilization = 0;   // 模型池利用率（推理时间占比，0~1）
+    uint64_t inferred = 0;          // 完成推理的帧数
+    double inference_fps = 0;
+    LatencySnapshot inference_latency;
+
+    // 共享推理调度（仅由StreamManager管理的流）
+    uint64_t scheduled = 0;         // 调度器分配推理的帧数
+    uint64_t rate_limited = 0;      // 超出最大推理帧率未推理的帧数
+    LatencySnapshot schedule_wait;  // 被调度前在输入队列中的等待时间
+
+    // 编码推流
+    uint64_t encoded = 0;           // 送入编码器的帧数
+    double encode_fps = 0;
+    uint64_t bytes_sent = 0;        // 写入复用器的字节数
+    uint64_t packets_sent = 0;      // 写入复用器的包数
+    double bitrate_bps = 0;         // 实测输出码率
+    int64_t target_bitrate_bps = 0; // 编码器目标码率
+    uint64_t encode_errors = 0;     // 编码失败次数
+    uint64_t mux_errors = 0;        // 写复用器（推流）失败次数
+    LatencySnapshot capture_to_encode;
+    double time_to_first_frame = 0; // 启动到首帧送入编码器的时间（秒），尚未出帧为0
+};
+
+/**
+ * @brief 由累计计数计算速率：每次update()返回距上次调用的平均每秒增量
+ */
+class RateMeter {
+public:
+    /**
+     * @brief 更新并返回速率
+     * @param total 当前累计值
+     * @param now_ns 当前单调时钟时间（纳秒）
+     * @return 每秒增量，首次调用或间隔过短时返回上一次的结果
+     */
+    double update(double total, uint64_t now_ns) {
+        if (last_ns_ != 0 && now_ns > last_ns_ + kMinIntervalNs) {
+            rate_ = (total - last_total_) * 1e9 / (now_ns - last_ns_);
+        } else if (last_ns_ != 0) {
+            return rate_;
+        }
+        last_total_ = total;
+        last_ns_ = now_ns;
+        return rate_;
+    }
+
+private:
+    static constexpr uint64_t kMinIntervalNs = 100000000;  // 100ms内的重复抓取沿用上次结果
+
+    double last_total_ = 0;
+    uint64_t last_ns_ = 0;
+    double rate_ = 0;
+};
+
+/**
+ * @brief Prometheus文本格式（0.0.4）写入器
+ */
+class PrometheusWriter {
+public:
+    /**
+     * @brief 开始一个指标族（同名样本必须连续写出）
+     * @param name 指标名
+     * @param type "counter"/"gauge"/"summary"
+     * @param help 说明
+     */
+    void family(const std::string& name, const char* type, const char* help);
+
+    /**
+     * @brief 写一个样本
+     * @param name 样本名（summary的_sum/_count需带后缀）
+     * @param labels 已格式化的标签（如camera="0"），可为空
+     * @param value 样本值
+     */
+    void sample(const std::string& name, const std::string& labels, double value);
+
+    /**
+     * @brief 写一个延迟summary（p50/p90/p99分位数、_sum与_count，单位秒）
+     */
+    void summary(const std::string& name, const std::string& labels, const LatencySnapshot& latency);
+
+    /**
+     * @brief 转义标签值
+     */
+    static std::string escape_label(const std::string& value);
+
+    const std::string& text() const { return text_; }
+
+private:
+    std::string text_;
+};
+
+class MetricsServer {
+public:
+    using Handler = std::function<std::string()>;
+
+    /**
+     * @brief 构造函数
+     * @param port 监听端口，0表示由系统分配（start()后由port()获取）
+     * @param bind_address 监听地址，默认只接受本机访问
+     */
+    explicit MetricsServer(int port, const std::string& bind_address = "127.0.0.1");
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    /**
+     * @brief 设置指标生成函数（需在start()之前调用），在监听线程中调用
+     */
+    void set_handler(Handler handler) { handler_ = std::move(handler); }
+
+    /**
+     * @brief 绑定端口并启动监听线程
+     * @return 成功返回true
+     */
+    bool start();
+
+    /**
+     * @brief 停止监听线程并关闭端口
+     */
+    void stop();
+
+    /**
+     * @brief 实际监听的端口
+     */
+    int port() const { return port_; }
+
+    /**
+     * @brief 将多路流的指标格式化为Prometheus文本（每个指标族一组，各路流以camera标签区分）
+     */
+    static std::string format_stream_metrics(const std::vector<StreamMetrics>& streams);
+
+private:
+    void serve_loop();
+    void handle_client(int fd);
+
+    int port_;
+    std::string bind_address_;
+    Handler handler_;
+    int listen_fd_ = -1;
+    int wake_fd_ = -1;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+};
@@ -2,23 +2,165 @@
 #define MODEL_H
 
 #include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <cstdio>
 #include <memory>
 #include <string>
+#include <vector>
+
+struct AVFrame;
+class DmaAllocator;
+
+// 单个检测结果（坐标为推理输入图像的像素坐标）
+struct Detection {
+    int class_id = -1;
+    float score = 0;
+    cv::Rect box;
+    const char* label = nullptr;  // 类别名（静态存储，随结果传递不拷贝），模型没有标签表时为nullptr
+};
+
+using Detections = std::vector<Detection>;
+
+// 批量推理中的一帧（可来自不同的流）
+struct BatchItem {
+    const AVFrame* raw = nullptr;  // 原始YUYV422帧（模型支持时由其直接生成模型输入），可为nullptr
+    cv::Mat image;                 // RGB24图像（与帧共享数据），模型只读取，不在其上画框
+    uint64_t seq = 0;              // 帧序号（调用方的流内序号），随检测结果交回调用方
+    Detections detections;         // 输出：检测结果（坐标为image的坐标）
+    bool ok = false;               // 输出：推理是否成功
+};
+
+// 检测结果的标签文字与位置（框的左上方，超出图像时贴边）
+inline void detection_label(const Detection& det, int cols, char (&text)[256], cv::Rect& background, cv::Point& origin) {
+    if (det.label) {
+        snprintf(text, sizeof(text), "%s %.1f%%", det.label, det.score * 100);
+    } else {
+        snprintf(text, sizeof(text), "class%d %.1f%%", det.class_id, det.score * 100);
+    }
+
+    int baseLine = 0;
+    cv::Size label_size = cv::getTextSize(text, cv::FONT_HERSHEY_SIMPLEX, 0.5, 1, &baseLine);
+
+    int x = det.box.x;
+    int y = det.box.y - label_size.height - baseLine;
+    if (y < 0) y = 0;
+    if (x + label_size.width > cols) x = cols - label_size.width;
+
+    background = cv::Rect(cv::Point(x, y), cv::Size(label_size.width, label_size.height + baseLine));
+    origin = cv::Point(x, y + label_size.height);
+}
+
+// 渲染阶段：在图像上画出检测框与"类别 置信度"标签，没有类别名时显示类别编号
+inline void draw_detections(cv::Mat& img, const Detections& detections) {
+    char text[256];
+    cv::Rect background;
+    cv::Point origin;
+    for (const Detection& det : detections) {
+        cv::rectangle(img, det.box.tl(), det.box.br(), cv::Scalar(255, 0, 0), 10);
+        detection_label(det, img.cols, text, background, origin);
+        cv::rectangle(img, background, cv::Scalar(255, 255, 255), -1);
+        cv::putText(img, text, origin, cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 0, 0));
+    }
+}
+
+// 渲染阶段（NV12帧）：直接画在亮度平面与半分辨率交错色度平面上，颜色与draw_detections()一致（BT.601）
+// 帧原样送编码时使用，省去为画框把整帧转换为RGB再转回
+inline void draw_detections_nv12(cv::Mat& luma, cv::Mat& chroma, const Detections& detections) {
+    char text[256];
+    cv::Rect background;
+    cv::Point origin;
+    for (const Detection& det : detections) {
+        // 红框：Y=82 U=90 V=240
+        cv::rectangle(luma, det.box.tl(), det.box.br(), cv::Scalar(82), 10);
+        cv::rectangle(chroma, cv::Point(det.box.x / 2, det.box.y / 2), cv::Point(det.box.br().x / 2, det.box.br().y / 2),
+                      cv::Scalar(90, 240), 5);
+        // 白底黑字：色度为中性，文字只画在亮度平面上
+        detection_label(det, luma.cols, text, background, origin);
+        cv::rectangle(luma, background, cv::Scalar(235), -1);
+        cv::rectangle(chroma, cv::Rect(background.x / 2, background.y / 2, (background.width + 1) / 2, (background.height + 1) / 2),
+                      cv::Scalar(128, 128), -1);
+        cv::putText(luma, text, origin, cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(16));
+    }
+}
+
+// 模型加载选项（ModelPool在loadmodel()之前传给configure()，模型不支持的选项被忽略）
+struct ModelOptions {
+    bool async = false;      // 异步执行：推理期间准备下一帧、后处理上一帧
+    bool zero_copy = false;  // 零拷贝输入输出：预处理直接写入NPU输入内存，后处理直接读NPU输出内存
+    std::shared_ptr<DmaAllocator> allocator;  // 零拷贝输入内存的分配器（dma-heap时以fd导入NPU），为空时由运行时分配
+};
+
+// 模型实例占用的NPU内存
+struct ModelMemory {
+    uint64_t weight_bytes = 0;    // 权重
+    uint64_t internal_bytes = 0;  // 中间结果
+    uint64_t dma_bytes = 0;       // 实例分配的DMA内存总量
+    bool shared_weight = false;   // 权重与其他实例共用（不重复占用）
+};
 
 class Model {
 public:
     // 虚析构函数，确保子类析构正常调用
     virtual ~Model() = default;
 
+    // 设置加载选项（在loadmodel()之前调用），默认忽略
+    virtual void configure(const ModelOptions& options) {}
+
     // 加载模型
     // 返回值：true=加载成功，false=加载失败
     virtual bool loadmodel(const char *model_path) = 0;
 
+    // 由已加载的实例派生一个共享权重的新实例（模型文件不重新读取、权重不重复加载），可在多个线程中并发调用
+    // 返回值：新实例，不支持时返回nullptr（调用方按常规方式创建并加载）
+    virtual std::shared_ptr<Model> share() { return nullptr; }
+
+    // 获取实例占用的NPU内存，不支持的模型返回全0
+    virtual ModelMemory memory() const { return ModelMemory(); }
+
     // 运行模型推理（纯虚函数，子类必须实现）
-    // 输入：待处理的图像帧
-    // 输出：处理后的图像帧（原图操作）
+    // 输入：待处理的图像帧（只读，模型不在其上画框，画框由调用方的渲染阶段按需进行）
+    // 输出：detections 检测结果（坐标为input的坐标）
     // 返回值：true=推理成功，false=推理失败
-    virtual bool run(cv::Mat& input) = 0;
+    virtual bool run(const cv::Mat& input, Detections& detections) = 0;
+
+    // 运行模型推理（原始YUYV422帧输入，可选实现）
+    // 输入：raw 原始采集帧，模型直接由其生成letterbox后的输入，省去RGB图像的缩放
+    //       display 显示用RGB24图像（只读），检测结果映射到其坐标系
+    // 输出：detections 检测结果（坐标为display的坐标）
+    // 返回值：true=推理成功，false=推理失败
+    virtual bool run_yuyv(const AVFrame* raw, const cv::Mat& display, Detections& detections) { return false; }
+
+    // 是否支持run_yuyv()，不支持时调用方只调用run()
+    virtual bool supports_yuyv_input() const { return false; }
+
+    // 批量推理：一次提交多帧，各帧的结果写回对应的BatchItem
+    // 默认逐帧调用run_yuyv()/run()；批量编译的模型可重载为一次提交整批
+    // 返回值：推理成功的帧数
+    virtual int run_batch(const std::vector<BatchItem*>& items) {
+        int succeeded = 0;
+        for (BatchItem* item : items) {
+            item->detections.clear();
+            item->ok = item->raw && supports_yuyv_input() ? run_yuyv(item->raw, item->image, item->detections)
+                                                          : run(item->image, item->detections);
+            if (!item->ok) {
+                item->detections.clear();
+            }
+            succeeded += item->ok ? 1 : 0;
+        }
+        return succeeded;
+    }
+
+    // 模型一次推理的帧数（批量编译模型的batch维），默认1
+    virtual int max_batch() const { return 1; }
+
+    // 异步推理（可选）：submit()完成预处理并启动推理后立即返回，collect()按提交顺序取回最早一帧的结果
+    // 交替调用时后一帧的预处理、前一帧的后处理与NPU推理重叠；item需保持有效直到被collect()返回
+    // 最多同时在途的帧数，0表示不支持异步
+    virtual int async_depth() const { return 0; }
+    // 提交一帧，在途帧数已达async_depth()时返回false（需先collect()）
+    virtual bool submit(BatchItem* item) { return false; }
+    // 等待最早提交的一帧完成并后处理，返回该帧（ok与detections已填写），没有在途帧时返回nullptr
+    virtual BatchItem* collect() { return nullptr; }
 
     // 获取模型名称/类型，方便调试和日志
     virtual std::string get_name() const = 0;
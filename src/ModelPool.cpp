@@ -0,0 +1,101 @@
+#include "ModelPool.h"
+#include "ModelFactory.h"
+#include <unistd.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 进程常驻内存（/proc/self/statm第二列，页数）
+int64_t resident_bytes() {
+    std::ifstream statm("/proc/self/statm");
+    int64_t size = 0, resident = 0;
+    if (!(statm >> size >> resident)) {
+        return 0;
+    }
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+ModelPtr create_and_load(ModelType model_type, const std::string& model_path, const ModelOptions& options) {
+    ModelPtr model = ModelFactory::get_instance().create_model(model_type);
+    if (!model) {
+        return nullptr;
+    }
+    model->configure(options);
+    return model->loadmodel(model_path.c_str()) ? model : nullptr;
+}
+
+}  // namespace
+
+size_t ModelPool::load(ModelType model_type, const std::string& model_path, int count,
+                       const ModelOptions& options) {
+    if (count < 1) {
+        return 0;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    const int64_t resident_before = resident_bytes();
+    std::vector<ModelPtr> models(count);
+    std::vector<ModelSlotInfo> slots(count);
+
+    // 第一个实例完整加载，其余实例由它派生
+    models[0] = create_and_load(model_type, model_path, options);
+    slots[0].init_ms = elapsed_ms(start);
+    if (models[0]) {
+        std::vector<std::thread> threads;
+        for (int i = 1; i < count; ++i) {
+            threads.emplace_back([&, i]() {
+                const auto slot_start = std::chrono::steady_clock::now();
+                ModelPtr model = models[0]->share();
+                if (!model) {
+                    model = create_and_load(model_type, model_path, options);
+                }
+                models[i] = std::move(model);
+                slots[i].init_ms = elapsed_ms(slot_start);
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    size_t loaded = 0;
+    for (int i = 0; i < count; ++i) {
+        if (!models[i]) {
+            std::cerr << "Failed to load model " << i << " (type: "
+                      << static_cast<int>(model_type) << ")" << std::endl;
+            continue;
+        }
+        slots[i].loaded = true;
+        slots[i].memory = models[i]->memory();
+        idle_.push(std::move(models[i]));
+        loaded++;
+    }
+    size_ += loaded;
+
+    ModelLoadStats stats;
+    stats.load_ms = elapsed_ms(start);
+    stats.resident_delta = resident_bytes() - resident_before;
+    stats.slots = slots;
+    for (int i = 0; i < count; ++i) {
+        const ModelSlotInfo& slot = slots[i];
+        if (!slot.loaded) continue;
+        std::cout << "model slot " << i << ": init " << slot.init_ms << " ms"
+                  << ", weight " << slot.memory.weight_bytes / 1024 << " KB"
+                  << (slot.memory.shared_weight ? " (shared)" : "")
+                  << ", internal " << slot.memory.internal_bytes / 1024 << " KB"
+                  << ", dma " << slot.memory.dma_bytes / 1024 << " KB" << std::endl;
+    }
+    std::cout << "model pool: " << loaded << "/" << count << " instances loaded in " << stats.load_ms
+              << " ms, resident memory +" << stats.resident_delta / 1024 << " KB" << std::endl;
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        load_stats_ = stats;
+    }
+    return loaded;
+}
@@ -0,0 +1,117 @@
+#pragma once
+/**
+ * @file ModelPool.h
+ * @class ModelPool
+ * @brief 推理模型实例池
+ * @author achene
+ * @date 2025-08-05
+ *
+ * 模型实例同一时刻只能被一个线程使用：推理前acquire()取出一个空闲实例，推理后release()归还。
+ * 单路流独立运行时每个EncoderStreamer持有自己的池；由StreamManager管理多路流时所有流共享同一个池，
+ * 模型只按池大小加载一次，而不是每路流各加载一份。
+ * 池只依赖Model接口（模型工厂在ModelPool.cpp中使用），测试时可用add()放入桩模型。
+ *
+ * 加载时只有第一个实例从模型文件完整初始化，其余实例由它通过Model::share()派生（共享权重），
+ * 并在各自的线程中并行初始化；不支持派生的模型退化为并行地各自加载。
+ */
+#include "Model.h"
+#include "thread_safe_queue.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum class ModelType;
+
+// 单个实例的加载结果
+struct ModelSlotInfo {
+    bool loaded = false;
+    double init_ms = 0;   // 该实例的初始化耗时
+    ModelMemory memory;   // 该实例占用的NPU内存
+};
+
+// 一次load()的统计
+struct ModelLoadStats {
+    double load_ms = 0;              // 全部实例加载完成的总耗时
+    int64_t resident_delta = 0;      // 加载前后进程常驻内存（RSS）的变化（字节）
+    std::vector<ModelSlotInfo> slots;
+};
+
+class ModelPool {
+public:
+    ModelPool() : idle_(0) {}
+
+    ModelPool(const ModelPool&) = delete;
+    ModelPool& operator=(const ModelPool&) = delete;
+
+    /**
+     * @brief 创建并加载模型实例放入池中
+     * @param model_type 模型类型
+     * @param model_path 模型文件路径
+     * @param count 实例数
+     * @param options 加载选项（异步执行等）
+     * @return 加载成功的实例数
+     */
+    size_t load(ModelType model_type, const std::string& model_path, int count,
+                const ModelOptions& options = ModelOptions());
+
+    /**
+     * @brief 最近一次load()的统计（各实例初始化耗时与内存）
+     */
+    ModelLoadStats load_stats() const {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        return load_stats_;
+    }
+
+    /**
+     * @brief 放入一个外部创建并已加载的实例
+     */
+    void add(ModelPtr model) {
+        if (model) {
+            idle_.push(std::move(model));
+            size_++;
+        }
+    }
+
+    /**
+     * @brief 取出一个空闲实例
+     * @param model 接收模型实例
+     * @param timeout_ms 超时时间(毫秒，-1表示无限等待，0表示不等待)
+     * @return 取到返回true，超时或池已终止返回false
+     */
+    bool acquire(ModelPtr& model, int timeout_ms = -1) {
+        return idle_.pop(model, timeout_ms);
+    }
+
+    /**
+     * @brief 归还实例
+     */
+    void release(ModelPtr model) {
+        if (model) {
+            idle_.push(std::move(model));
+        }
+    }
+
+    /**
+     * @brief 唤醒所有等待acquire()的线程，之后acquire()在池空时立即返回false
+     */
+    void terminate() { idle_.terminate(); }
+
+    /**
+     * @brief 加载成功的实例总数
+     */
+    size_t size() const { return size_; }
+
+    /**
+     * @brief 当前空闲的实例数
+     */
+    size_t idle() const { return idle_.size(); }
+
+private:
+    ThreadSafeQueue<ModelPtr> idle_;
+    std::atomic<size_t> size_{0};
+    mutable std::mutex stats_mutex_;
+    ModelLoadStats load_stats_;
+};
+
+using ModelPoolPtr = std::shared_ptr<ModelPool>;
@@ -0,0 +1,119 @@
+#include "ReorderRing.h"
+
+#ifndef MODULE_TEST
+#define MODULE_TEST 0
+#endif
+
+
+#if MODULE_TEST
+//g++ -DMODULE_TEST=1 -o test_reorder_ring ReorderRing.cpp -lpthread
+// 重排环测试：乱序放入、等待超时越过、迟到丢弃、skip()、环满时的反压与缺失序号越过
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+bool check(bool condition, const char* name) {
+    std::cout << (condition ? "  ok   " : "  FAIL ") << name << std::endl;
+    return condition;
+}
+
+}  // namespace
+
+int main() {
+    bool ok = true;
+
+    // 乱序放入按序号取出
+    {
+        ReorderRing<int> ring(8, 1000);
+        ring.put(2, 2);
+        ring.put(0, 0);
+        ring.put(1, 1);
+        int a = -1, b = -1, c = -1;
+        ok &= check(ring.pop(a, 0) && ring.pop(b, 0) && ring.pop(c, 0) && a == 0 && b == 1 && c == 2,
+                    "out-of-order put pops in sequence order");
+        ok &= check(ring.stats().emitted == 3 && ring.held() == 0, "emitted count");
+    }
+
+    // 缺失序号等待超时后越过，之后到达的帧为迟到帧
+    {
+        ReorderRing<int> ring(8, 30);
+        ring.put(1, 1);
+        int item = -1;
+        ok &= check(!ring.pop(item, 5), "missing head holds later frames");
+        const auto start = std::chrono::steady_clock::now();
+        bool popped = ring.pop(item, 500);
+        const auto waited = std::chrono::steady_clock::now() - start;
+        ok &= check(popped && item == 1 && waited < std::chrono::milliseconds(200), "hold timeout skips missing seq");
+        int late = 0;
+        ok &= check(!ring.put(0, std::move(late)), "late arrival rejected");
+        ReorderStats stats = ring.stats();
+        ok &= check(stats.skipped == 1 && stats.late == 1 && stats.overflow == 0, "timeout counted as skipped, arrival as late");
+    }
+
+    // skip()的序号直接越过；已被越过的序号再skip()不计为迟到
+    {
+        ReorderRing<int> ring(8, 30);
+        ring.skip(0);
+        ring.put(1, 1);
+        int item = -1;
+        ok &= check(ring.pop(item, 0) && item == 1, "skipped seq passed without waiting");
+        ring.put(3, 3);
+        ok &= check(ring.pop(item, 500) && item == 3, "seq 2 skipped after timeout");
+        ring.skip(2);
+        ring.skip(0);
+        ReorderStats stats = ring.stats();
+        ok &= check(stats.late == 0 && stats.skipped == 1, "skip() of passed seq not counted late");
+    }
+
+    // 环满：最旧序号缺失时越过并计入overflow，已到达的帧不丢弃，放入方阻塞到消费者取走
+    {
+        ReorderRing<std::shared_ptr<int>> ring(4, 10000);
+        std::weak_ptr<int> first;
+        for (uint64_t seq = 1; seq < 4; ++seq) {
+            std::shared_ptr<int> item = std::make_shared<int>(static_cast<int>(seq));
+            if (seq == 1) first = item;
+            ring.put(seq, std::move(item));
+        }
+        // 序号0缺失，序号4超出容量：越过0，序号1已到达保留
+        ring.put(4, std::make_shared<int>(4));
+        ReorderStats stats = ring.stats();
+        ok &= check(stats.overflow == 1 && stats.skipped == 0 && !first.expired(), "overflow skips missing seq, keeps filled");
+
+        // 序号5超出容量且最旧的序号1已到达：put()阻塞直到消费者取走
+        std::atomic<bool> put_done{false};
+        std::thread producer([&]() {
+            ring.put(5, std::make_shared<int>(5));
+            put_done = true;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ok &= check(!put_done && !first.expired(), "put blocks while oldest frame is deliverable");
+        std::shared_ptr<int> item;
+        bool in_order = true;
+        for (int expected = 1; expected <= 5; ++expected) {
+            in_order = in_order && ring.pop(item, 1000) && *item == expected;
+        }
+        producer.join();
+        ok &= check(put_done && in_order, "blocked put completes after pop, all frames delivered in order");
+        stats = ring.stats();
+        ok &= check(stats.emitted == 5 && stats.overflow == 1 && stats.late == 0, "overflow counted separately");
+    }
+
+    // 终止唤醒因环满阻塞的放入方
+    {
+        ReorderRing<int> ring(2, 1000);
+        ring.put(0, 0);
+        ring.put(1, 1);
+        std::atomic<int> result{-1};
+        std::thread producer([&]() { result = ring.put(2, 2) ? 1 : 0; });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ring.terminate();
+        producer.join();
+        ok &= check(result == 0, "terminate releases blocked put");
+    }
+
+    std::cout << "ok: " << ok << std::endl;
+    return ok ? 0 : 1;
+}
+#endif
@@ -0,0 +1,287 @@
+#pragma once
+/**
+ * @file ReorderRing.h
+ * @class ReorderRing
+ * @brief 按序号重排的有界等待环形缓冲区
+ * @author achene
+ * @date 2025-08-05
+ *
+ * 多个推理线程并行处理帧，完成顺序与采集顺序不一致。各帧在进入推理前分配连续序号，
+ * 处理完成后按序号放入环中，消费者（编码线程）严格按序号递增取出：
+ * - 序号对应的帧已到达：立即取出
+ * - 序号已知被丢弃（skip()）：直接越过
+ * - 序号未到达但环中已有后续帧：最多等待max_hold，超时后越过连续缺失的序号
+ * - 越过之后才到达的帧（迟到帧）直接丢弃，保证输出严格有序
+ * - 新序号超出环容量：最旧序号缺失时越过（计入overflow），已到达时put()/skip()阻塞到消费者取走，
+ *   已到达的帧不会因环满被丢弃
+ *
+ * 序号直接映射到环中槽位，put()/skip()/pop()均为O(1)（超时越过时按缺失序号数均摊）。
+ * 所有操作线程安全。
+ */
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// 重排统计
+struct ReorderStats {
+    uint64_t emitted = 0;  // 按序输出的帧数
+    uint64_t late = 0;      // 到达时其序号已被越过而丢弃的帧数（不含skip()的序号）
+    uint64_t skipped = 0;   // 等待超时被越过的缺失序号数
+    uint64_t overflow = 0;  // 环满时为腾出槽位被越过的缺失序号数
+};
+
+template <typename T>
+class ReorderRing {
+public:
+    /**
+     * @brief 构造函数
+     * @param capacity 环容量（向上取整为2的幂），即最早未输出序号之后最多可暂存的帧数
+     * @param max_hold_ms 缺失序号的最长等待时间（毫秒）
+     */
+    explicit ReorderRing(size_t capacity = 64, int max_hold_ms = 200) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        slots_.resize(size);
+        mask_ = size - 1;
+        set_max_hold(max_hold_ms);
+    }
+
+    ~ReorderRing() {
+        terminate();
+    }
+
+    /**
+     * @brief 设置缺失序号的最长等待时间
+     * @param max_hold_ms 最长等待时间（毫秒），0表示不等待，缺失即越过
+     */
+    void set_max_hold(int max_hold_ms) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        max_hold_ = std::chrono::milliseconds(max_hold_ms > 0 ? max_hold_ms : 0);
+    }
+
+    /**
+     * @brief 放入序号为seq的元素
+     * @param seq 序号
+     * @param item 元素，返回false时保持不变，由调用方释放
+     * @return 成功放入返回true，迟到（序号已被越过）或已终止返回false
+     * 序号超出环容量且最旧的帧已到达时阻塞，直到消费者取走它
+     */
+    bool put(uint64_t seq, T&& item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!reserve(seq, lock, true)) {
+            return false;
+        }
+        Slot& slot = slot_of(seq);
+        slot.item = std::move(item);
+        slot.state = SlotState::Filled;
+        held_++;
+        if (seq != next_ && !blocked_ && slot_of(next_).state == SlotState::Empty) {
+            blocked_ = true;
+            blocked_since_ = Clock::now();
+        }
+        ready_.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief 标记序号seq不会到达（如推理失败被丢弃），消费者无需等待
+     */
+    void skip(uint64_t seq) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!reserve(seq, lock, false)) {
+            return;
+        }
+        slot_of(seq).state = SlotState::Skipped;
+        ready_.notify_one();
+    }
+
+    /**
+     * @brief 按序号顺序取出下一个元素
+     * @param item 接收元素
+     * @param timeout_ms 超时时间(毫秒，-1表示无限等待)
+     * @return 取出返回true，超时或已终止返回false
+     */
+    bool pop(T& item, int timeout_ms = -1) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeout_ms);
+        while (true) {
+            // 越过已知不会到达的序号
+            while (slot_of(next_).state == SlotState::Skipped) {
+                slot_of(next_).state = SlotState::Empty;
+                next_++;
+                blocked_ = false;
+                space_.notify_all();
+            }
+
+            Slot& head = slot_of(next_);
+            if (head.state == SlotState::Filled) {
+                item = std::move(head.item);
+                head.item = T();
+                head.state = SlotState::Empty;
+                held_--;
+                next_++;
+                emitted_++;
+                space_.notify_all();
+                // 下一个序号缺失而后续帧已到达时从此刻开始计时
+                blocked_ = held_ > 0 && slot_of(next_).state == SlotState::Empty;
+                if (blocked_) blocked_since_ = Clock::now();
+                return true;
+            }
+            if (terminated_) {
+                return false;
+            }
+
+            // 有后续帧暂存时缺失序号最多等待max_hold
+            Clock::time_point now = Clock::now();
+            bool holding = held_ > 0;
+            Clock::time_point expire;
+            if (holding) {
+                if (!blocked_) {
+                    blocked_ = true;
+                    blocked_since_ = now;
+                }
+                expire = blocked_since_ + max_hold_;
+                if (now >= expire) {
+                    // 等待超时：越过连续缺失的序号直到下一个已到达（或已知丢弃）的序号
+                    while (slot_of(next_).state == SlotState::Empty) {
+                        next_++;
+                        skipped_++;
+                    }
+                    blocked_ = false;
+                    space_.notify_all();
+                    continue;
+                }
+            }
+            if (timeout_ms >= 0 && now >= deadline) {
+                return false;
+            }
+
+            if (timeout_ms >= 0 && (!holding || deadline < expire)) {
+                ready_.wait_until(lock, deadline);
+            } else if (holding) {
+                ready_.wait_until(lock, expire);
+            } else {
+                ready_.wait(lock);
+            }
+        }
+    }
+
+    /**
+     * @brief 终止，唤醒等待的消费者（已暂存的元素仍可按序取出）
+     */
+    void terminate() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            terminated_ = true;
+        }
+        ready_.notify_all();
+        space_.notify_all();
+    }
+
+    /**
+     * @brief 释放所有暂存的元素（在锁外析构），序号状态保持不变
+     */
+    void clear() {
+        std::vector<T> released;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (Slot& slot : slots_) {
+                if (slot.state == SlotState::Filled) {
+                    released.push_back(std::move(slot.item));
+                    slot.item = T();
+                    slot.state = SlotState::Skipped;
+                }
+            }
+            held_ = 0;
+            blocked_ = false;
+        }
+        space_.notify_all();
+    }
+
+    /**
+     * @brief 获取统计
+     */
+    ReorderStats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ReorderStats stats;
+        stats.emitted = emitted_;
+        stats.late = late_;
+        stats.skipped = skipped_;
+        stats.overflow = overflow_;
+        return stats;
+    }
+
+    /**
+     * @brief 获取当前暂存（等待前序帧）的元素数量
+     */
+    size_t held() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return held_;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    enum class SlotState : uint8_t {
+        Empty,    // 未到达
+        Filled,   // 已到达，等待输出
+        Skipped,  // 已知不会到达
+    };
+
+    struct Slot {
+        SlotState state = SlotState::Empty;
+        T item;
+    };
+
+    Slot& slot_of(uint64_t seq) { return slots_[seq & mask_]; }
+
+    // 检查序号可以放入（需持有锁）：迟到或已终止返回false
+    // 超出环容量时越过最旧的缺失序号腾出槽位；最旧序号已到达时等待消费者取走，不丢弃已到达的帧
+    bool reserve(uint64_t seq, std::unique_lock<std::mutex>& lock, bool count_late) {
+        while (!terminated_ && seq >= next_ && seq - next_ > mask_) {
+            Slot& oldest = slot_of(next_);
+            if (oldest.state == SlotState::Filled) {
+                ready_.notify_one();
+                space_.wait(lock);
+                continue;
+            }
+            if (oldest.state == SlotState::Empty) {
+                overflow_++;
+            }
+            oldest.state = SlotState::Empty;
+            next_++;
+            blocked_ = false;
+        }
+        if (terminated_) {
+            return false;
+        }
+        if (seq < next_) {
+            // skip()的序号已被越过属正常情况（如超时越过后推理才失败），不计为迟到
+            if (count_late) {
+                late_++;
+            }
+            return false;
+        }
+        return true;
+    }
+
+    mutable std::mutex mutex_;
+    std::condition_variable ready_;
+    std::condition_variable space_;  // 消费者推进next_时通知因环满阻塞的put()/skip()
+    std::vector<Slot> slots_;
+    size_t mask_ = 0;
+    Clock::duration max_hold_;
+
+    uint64_t next_ = 0;   // 下一个输出的序号
+    size_t held_ = 0;     // 已到达未输出的元素数
+    bool blocked_ = false;              // 是否正在等待缺失序号
+    Clock::time_point blocked_since_;   // 开始等待缺失序号的时刻
+    bool terminated_ = false;
+
+    uint64_t emitted_ = 0;
+    uint64_t late_ = 0;
+    uint64_t skipped_ = 0;
+    uint64_t overflow_ = 0;
+};
@@ -0,0 +1,75 @@
+#pragma once
+/**
+ * @file ShardedCounter.h
+ * @class ShardedCounter
+ * @brief 按线程分片的无锁计数器
+ * @author achene
+ * @date 2025-08-05
+ *
+ * 多个推理线程、采集线程同时累加同一个std::atomic计数器时，计数器所在缓存行在各核之间来回迁移。
+ * ShardedCounter把计数拆成若干分片，每个分片独占一个缓存行，线程首次累加时分配固定分片，
+ * add()只对本线程分片做一次relaxed原子加；value()在读取端（监控、指标导出）汇总所有分片。
+ *
+ * 分片数多于活跃线程数时各线程互不干扰；线程数更多时多个线程共享分片，结果仍然准确。
+ */
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+class ShardedCounter {
+public:
+    ShardedCounter() = default;
+
+    ShardedCounter(const ShardedCounter&) = delete;
+    ShardedCounter& operator=(const ShardedCounter&) = delete;
+
+    /**
+     * @brief 累加
+     * @param n 增量
+     */
+    void add(uint64_t n = 1) {
+        shards_[shard_index()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    ShardedCounter& operator++() {
+        add(1);
+        return *this;
+    }
+
+    ShardedCounter& operator+=(uint64_t n) {
+        add(n);
+        return *this;
+    }
+
+    /**
+     * @brief 汇总所有分片（与并发add()之间不保证严格一致）
+     */
+    uint64_t value() const {
+        uint64_t total = 0;
+        for (const Shard& shard : shards_) {
+            total += shard.value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    operator uint64_t() const { return value(); }
+
+private:
+    static constexpr size_t kShardCount = 16;
+    static constexpr size_t kCacheLine = 64;
+
+    // 以填充而非alignas保证分片间隔一个缓存行，C++14下堆上分配的对象同样有效
+    struct Shard {
+        std::atomic<uint64_t> value{0};
+        char padding[kCacheLine - sizeof(std::atomic<uint64_t>)];
+    };
+
+    // 线程首次调用时按线程创建顺序轮流分配分片，之后固定不变
+    static size_t shard_index() {
+        static std::atomic<size_t> next_thread{0};
+        static thread_local size_t index = next_thread.fetch_add(1, std::memory_order_relaxed) % kShardCount;
+        return index;
+    }
+
+    Shard shards_[kShardCount];
+};
@@ -0,0 +1,191 @@
+#include "StageTracer.h"
+#include <iomanip>
+#include <iostream>
+
+#ifndef MODULE_TEST
+#define MODULE_TEST 0
+#endif
+
+namespace {
+// 由帧元数据时间点换算的区间：起点、终点
+struct SpanBounds {
+    TraceSpan span;
+    FrameStage from;
+    FrameStage to;
+};
+
+const SpanBounds kFrameSpans[] = {
+    {TraceSpan::Capture,    FrameStage::Captured,    FrameStage::SourceOut},
+    {TraceSpan::Source,     FrameStage::SourceOut,   FrameStage::Enqueued},
+    {TraceSpan::InputWait,  FrameStage::Enqueued,    FrameStage::Dequeued},
+    {TraceSpan::Worker,     FrameStage::Dequeued,    FrameStage::OutputPut},
+    {TraceSpan::Inference,  FrameStage::InferStart,  FrameStage::InferEnd},
+    {TraceSpan::OutputWait, FrameStage::OutputPut,   FrameStage::EncodeStart},
+    {TraceSpan::Encode,     FrameStage::EncodeStart, FrameStage::EncodeEnd},
+    {TraceSpan::Total,      FrameStage::Captured,    FrameStage::EncodeEnd},
+};
+
+// JSON字符串转义
+std::string json_escape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            escaped += ' ';
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+} // namespace
+
+StageTracer::StageTracer(size_t event_capacity)
+    : events_(event_capacity) {
+}
+
+const char* StageTracer::span_name(TraceSpan span) {
+    switch (span) {
+    case TraceSpan::Capture:    return "capture";
+    case TraceSpan::Source:     return "source";
+    case TraceSpan::InputWait:  return "input_wait";
+    case TraceSpan::Worker:     return "worker";
+    case TraceSpan::Inference:  return "inference";
+    case TraceSpan::OutputWait: return "output_wait";
+    case TraceSpan::Encode:     return "encode";
+    case TraceSpan::Total:      return "total";
+    case TraceSpan::Count:      break;
+    }
+    return "unknown";
+}
+
+void StageTracer::record_frame(const FrameMeta& meta) {
+    // 先在锁外计入直方图并收集本帧的区间，再一次加锁写入事件环
+    Event events[sizeof(kFrameSpans) / sizeof(kFrameSpans[0])];
+    size_t count = 0;
+    for (const SpanBounds& bounds : kFrameSpans) {
+        int64_t start = meta.stage(bounds.from);
+        int64_t end = meta.stage(bounds.to);
+        if (start > 0 && end >= start) {
+            histograms_[static_cast<int>(bounds.span)].record(static_cast<uint64_t>(end - start));
+            events[count++] = Event{start, end, meta.sequence, bounds.span, false};
+        }
+    }
+    append_events(events, count);
+}
+
+void StageTracer::record_span(TraceSpan span, int64_t start_ns, int64_t end_ns, uint32_t sequence) {
+    if (start_ns > 0 && end_ns >= start_ns) {
+        histograms_[static_cast<int>(span)].record(static_cast<uint64_t>(end_ns - start_ns));
+        Event event{start_ns, end_ns, sequence, span, true};
+        append_events(&event, 1);
+    }
+}
+
+void StageTracer::append_events(const Event* events, size_t count) {
+    if (events_.empty() || count == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(events_mutex_);
+    for (size_t i = 0; i < count; ++i) {
+        events_[next_event_] = events[i];
+        if (++next_event_ == events_.size()) {
+            next_event_ = 0;
+            wrapped_ = true;
+        }
+    }
+}
+
+StageLatency StageTracer::snapshot() const {
+    StageLatency latency;
+    for (int i = 0; i < static_cast<int>(TraceSpan::Count); ++i) {
+        latency.spans[i] = histograms_[i].snapshot();
+    }
+    return latency;
+}
+
+bool StageTracer::dump_chrome_trace(std::ostream& out, int pid, const std::string& process_name) const {
+    // 拷贝出事件后在锁外格式化，按时间先后输出
+    std::vector<Event> events;
+    {
+        std::lock_guard<std::mutex> lock(events_mutex_);
+        if (wrapped_) {
+            events.insert(events.end(), events_.begin() + next_event_, events_.end());
+        }
+        events.insert(events.end(), events_.begin(), events_.begin() + next_event_);
+    }
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid
+        << ",\"args\":{\"name\":\"" << json_escape(process_name) << "\"}}";
+    out << std::fixed << std::setprecision(3);
+    for (const Event& event : events) {
+        // 异步事件：同一帧的区间共享id，单独记录的推理区间使用独立id，避免与帧的区间交叠
+        const char* name = span_name(event.span);
+        out << ",\n{\"name\":\"" << name << "\",\"cat\":\"frame\",\"ph\":\"b\",\"pid\":" << pid
+            << ",\"tid\":0,\"id\":\"" << (event.detached ? "i" : "f") << event.sequence
+            << "\",\"ts\":" << event.start_ns / 1000.0 << ",\"args\":{\"sequence\":" << event.sequence << "}}";
+        out << ",\n{\"name\":\"" << name << "\",\"cat\":\"frame\",\"ph\":\"e\",\"pid\":" << pid
+            << ",\"tid\":0,\"id\":\"" << (event.detached ? "i" : "f") << event.sequence
+            << "\",\"ts\":" << event.end_ns / 1000.0 << "}";
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
+
+
+#if MODULE_TEST
+//g++ -DMODULE_TEST=1 -o test_stage_tracer StageTracer.cpp -lavutil
+// 区间统计测试：构造各阶段时间点已知的帧，检查直方图计数与分位数、事件环回绕及JSON导出
+#include <sstream>
+
+int main() {
+    StageTracer tracer(64);
+    bool ok = true;
+    const int frames = 100;
+    for (int i = 0; i < frames; ++i) {
+        FrameMeta meta;
+        meta.sequence = i;
+        int64_t t = 1000000000LL + i * 33000000LL;
+        meta.capture_ns = t;
+        meta.set_stage(FrameStage::SourceOut, t += 2000000);    // capture 2ms
+        meta.set_stage(FrameStage::Enqueued, t += 1000000);     // source 1ms
+        meta.set_stage(FrameStage::Dequeued, t += 5000000);     // input_wait 5ms
+        meta.set_stage(FrameStage::InferStart, t += 1000000);
+        meta.set_stage(FrameStage::InferEnd, t += 20000000);    // inference 20ms
+        meta.set_stage(FrameStage::OutputPut, t += 1000000);    // worker 22ms
+        meta.set_stage(FrameStage::EncodeStart, t += 3000000);  // output_wait 3ms
+        if (i % 2 == 0) {
+            meta.set_stage(FrameStage::EncodeEnd, t += 4000000);  // encode 4ms，奇数帧未完成编码
+        }
+        tracer.record_frame(meta);
+    }
+    tracer.record_span(TraceSpan::Inference, 5000000, 35000000, 7);
+
+    StageLatency latency = tracer.snapshot();
+    for (int i = 0; i < static_cast<int>(TraceSpan::Count); ++i) {
+        const LatencySnapshot& s = latency.spans[i];
+        std::cout << std::setw(12) << StageTracer::span_name(static_cast<TraceSpan>(i))
+                  << " count " << s.count << " p50 " << s.p50_us << "us max " << s.max_us << "us" << std::endl;
+    }
+    ok = ok && latency[TraceSpan::Capture].count == frames;
+    ok = ok && latency[TraceSpan::Inference].count == frames + 1;
+    ok = ok && latency[TraceSpan::Encode].count == frames / 2 && latency[TraceSpan::Total].count == frames / 2;
+    ok = ok && latency[TraceSpan::InputWait].max_us == 5000 && latency[TraceSpan::Worker].max_us == 22000;
+    ok = ok && latency[TraceSpan::Total].max_us == 37000;
+
+    std::ostringstream json;
+    ok = ok && tracer.dump_chrome_trace(json, 0, "camera 0");
+    // 事件环容量64：导出的应为最近的64个区间（每个区间一对b/e事件）
+    std::string text = json.str();
+    size_t begins = 0;
+    for (size_t pos = 0; (pos = text.find("\"ph\":\"b\"", pos)) != std::string::npos; ++pos) begins++;
+    ok = ok && begins == 64 && text.find("\"id\":\"i7\"") != std::string::npos;
+    std::cout << "trace events: " << begins << " bytes: " << text.size() << std::endl;
+
+    std::cout << "ok: " << ok << std::endl;
+    return ok ? 0 : 1;
+}
+#endif
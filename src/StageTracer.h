@@ -0,0 +1,117 @@
+#pragma once
+/**
+ * @file StageTracer.h
+ * @class StageTracer
+ * @brief 单路流的分阶段延迟统计与Chrome trace导出
+ * @author achene
+ * @date 2025-08-05
+ *
+ * 帧经过流水线各阶段边界时在FrameMeta中记录时间点（见mark_frame_stage()），编码完成后
+ * 由编码线程调用record_frame()一次性换算为各区间耗时：
+ * - capture：采集时间戳 -> 帧源出帧（驱动与出队延迟）
+ * - source：帧源出帧 -> 放入输入队列（采集线程中的转换、MJPEG解码）
+ * - input_wait：输入队列中的排队时间
+ * - worker：推理线程处理时间（RGB转换、推理与画框）
+ * - inference：模型推理时间（worker的一部分；解耦模式下在帧拷贝上推理，由record_span()单独记录）
+ * - output_wait：输出重排环中的等待时间（含等待前序帧）
+ * - encode：编码与推流时间
+ * - total：采集时间戳 -> 编码完成
+ *
+ * 每个区间一个无锁LatencyHistogram；同时把区间写入定长事件环，dump_chrome_trace()按需导出
+ * 最近的事件为Chrome trace/Perfetto可读的JSON。每帧只有一次加锁写事件环，可在生产环境常开。
+ */
+#include "FrameMeta.h"
+#include "LatencyHistogram.h"
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// 延迟统计区间
+enum class TraceSpan : int {
+    Capture,
+    Source,
+    InputWait,
+    Worker,
+    Inference,
+    OutputWait,
+    Encode,
+    Total,
+    Count,
+};
+
+// 各区间延迟快照
+struct StageLatency {
+    LatencySnapshot spans[static_cast<int>(TraceSpan::Count)];
+
+    const LatencySnapshot& operator[](TraceSpan span) const { return spans[static_cast<int>(span)]; }
+};
+
+class StageTracer {
+public:
+    /**
+     * @brief 构造函数
+     * @param event_capacity 事件环容量（保留最近的区间数），0表示只统计直方图不记录事件
+     */
+    explicit StageTracer(size_t event_capacity = 16384);
+
+    StageTracer(const StageTracer&) = delete;
+    StageTracer& operator=(const StageTracer&) = delete;
+
+    /**
+     * @brief 记录一帧经过的各区间（两端时间点都存在的区间才记录）
+     * @param meta 帧元数据（含各阶段时间点）
+     */
+    void record_frame(const FrameMeta& meta);
+
+    /**
+     * @brief 单独记录一个区间（如解耦模式下在帧拷贝上进行的推理）
+     * @param span 区间
+     * @param start_ns 开始时间（单调时钟纳秒）
+     * @param end_ns 结束时间
+     * @param sequence 帧序号
+     */
+    void record_span(TraceSpan span, int64_t start_ns, int64_t end_ns, uint32_t sequence);
+
+    /**
+     * @brief 获取各区间延迟快照
+     */
+    StageLatency snapshot() const;
+
+    /**
+     * @brief 将事件环中的区间导出为Chrome trace JSON（chrome://tracing或ui.perfetto.dev打开）
+     * 每帧的区间为一组异步事件（以帧序号为id），单独记录的推理区间另成一组
+     * @param out 输出流
+     * @param pid 进程ID字段（多路流时用流ID区分）
+     * @param process_name 进程名字段
+     * @return 写入成功返回true
+     */
+    bool dump_chrome_trace(std::ostream& out, int pid, const std::string& process_name) const;
+
+    /**
+     * @brief 区间名（"capture"/"input_wait"等）
+     */
+    static const char* span_name(TraceSpan span);
+
+private:
+    struct Event {
+        int64_t start_ns;
+        int64_t end_ns;
+        uint32_t sequence;
+        TraceSpan span;
+        bool detached;  // 由record_span()单独记录
+    };
+
+    /**
+     * @brief 一次加锁把一组区间写入事件环（一帧的全部区间同批写入）
+     */
+    void append_events(const Event* events, size_t count);
+
+    LatencyHistogram histograms_[static_cast<int>(TraceSpan::Count)];
+
+    mutable std::mutex events_mutex_;
+    std::vector<Event> events_;  // 定长环
+    size_t next_event_ = 0;      // 下一个写入位置
+    bool wrapped_ = false;       // 是否已写满一圈
+};
@@ -0,0 +1,335 @@
+#include "StreamManager.h"
+#include <chrono>
+#include <iostream>
+
+StreamManager::StreamManager(const PipelineConfig& config)
+    : config_(config),
+      active_(std::make_shared<const StreamList>()) {
+    worker_count_ = config_.inference_workers > 0 ? config_.inference_workers : 1;
+}
+
+StreamManager::~StreamManager() {
+    stop();
+}
+
+ModelType StreamManager::model_type_from_string(const std::string& name) {
+    if (name == "test") return ModelType::Test;
+    return ModelType::YoloV5;
+}
+
+bool StreamManager::start() {
+    if (running_) return true;
+
+    // 共享模型池：模型只加载model_instances份
+    models_ = std::make_shared<ModelPool>();
+    int instances = config_.model_instances > 0 ? config_.model_instances : 1;
+    ModelOptions options;
+    options.async = config_.async_inference;
+    options.zero_copy = config_.zero_copy_inference;
+    if (options.zero_copy) {
+        // 零拷贝输入缓冲区与采集缓冲区出自同一分配器（dma-heap时以fd导入NPU）
+        std::lock_guard<std::mutex> lock(streams_mutex_);
+        if (!allocator_) {
+            allocator_ = std::make_shared<DmaAllocator>(config_.dma_heap);
+        }
+        options.allocator = allocator_;
+    }
+    if (models_->load(model_type_from_string(config_.model), config_.model_path, instances, options) == 0) {
+        std::cerr << "StreamManager: no model instance loaded from " << config_.model_path << std::endl;
+        return false;
+    }
+
+    // 跨流批处理：每个模型实例一个批处理线程
+    if (config_.batch_size > 1) {
+        BatchConfig batch;
+        batch.max_batch = config_.batch_size;
+        batch.window_us = config_.batch_window_us;
+        batch.runners = static_cast<int>(models_->size());
+        batcher_ = std::make_shared<InferenceBatcher>(models_, batch);
+        StagePlacement placement = config_.inference_placement;
+        batcher_->set_thread_init([placement](int index) {
+            ThreadPlacement::bind_current_thread("batch" + std::to_string(index), placement);
+        });
+        if (!batcher_->start()) {
+            batcher_.reset();
+        }
+    }
+
+    // 共享采集反应器：多路摄像头由少量epoll线程统一采集
+    if (config_.capture_reactor_shards > 0) {
+        reactor_ = std::make_shared<CaptureReactor>(config_.capture_reactor_shards);
+        StagePlacement reactor_placement = config_.reactor_placement;
+        reactor_->set_thread_init([reactor_placement](int shard) {
+            ThreadPlacement::bind_current_thread("reactor" + std::to_string(shard), reactor_placement);
+        });
+        if (!reactor_->start()) {
+            reactor_.reset();
+        }
+    }
+
+    running_ = true;
+    for (int i = 0; i < worker_count_; ++i) {
+        workers_.emplace_back(&StreamManager::worker_loop, this, i);
+    }
+    std::cout << "StreamManager: " << models_->size() << " model instances, "
+              << worker_count_ << " inference workers";
+    if (batcher_) {
+        std::cout << ", batch " << config_.batch_size << " within " << config_.batch_window_us << "us";
+    }
+    std::cout << std::endl;
+    return true;
+}
+
+void StreamManager::stop() {
+    std::vector<Entry> entries;
+    {
+        std::lock_guard<std::mutex> lock(streams_mutex_);
+        entries.swap(streams_);
+        publish_streams();
+    }
+    // 先停止各流（采集不再产生新帧），再停止推理线程
+    for (Entry& entry : entries) {
+        entry.streamer->stop();
+    }
+    // 批处理线程需在模型池终止前停止（其间仍在提交的帧以失败完成）
+    if (batcher_) {
+        batcher_->stop();
+    }
+    if (running_.exchange(false)) {
+        {
+            std::lock_guard<std::mutex> lock(work_mutex_);
+        }
+        work_cv_.notify_all();
+        models_->terminate();
+    }
+    for (std::thread& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers_.clear();
+    entries.clear();
+    batcher_.reset();
+    if (reactor_) {
+        reactor_->stop();
+        reactor_.reset();
+    }
+}
+
+int StreamManager::add_stream(const CameraConfig& config) {
+    if (!running_) {
+        std::cerr << "StreamManager: add_stream() before start()" << std::endl;
+        return -1;
+    }
+    int id;
+    {
+        std::lock_guard<std::mutex> lock(streams_mutex_);
+        id = next_id_++;
+    }
+
+    // 按配置创建帧源（摄像头/录像回放/合成图案）
+    FrameSourceConfig source_config;
+    source_config.type = FrameSource::type_from_string(config.source);
+    source_config.path = config.device;
+    source_config.width = config.width;
+    source_config.height = config.height;
+    source_config.fps = config.fps;
+    source_config.pixel_format = CameraCapture::fourcc_from_string(config.pixel_format);
+    source_config.realtime = config.realtime;
+    source_config.loop = config.loop;
+    std::unique_ptr<FrameSource> source = FrameSource::create(source_config);
+    if (!source) {
+        std::cerr << "StreamManager: failed to create frame source " << config.device << std::endl;
+        return -1;
+    }
+
+    std::shared_ptr<EncoderStreamer> streamer = std::make_shared<EncoderStreamer>(
+        config.rtmp_url, std::move(source), config.width, config.height, config.fps, id);
+    streamer->set_zero_copy_capture(config.zero_copy);
+    streamer->set_decode_workers(config.decode_workers);
+    streamer->set_capture_buffer_count(config.buffer_count);
+
+    // 流水线自有缓冲区：所有摄像头共用一个分配器
+    CaptureMemory memory = CameraCapture::memory_from_string(config.memory);
+    if (memory != CaptureMemory::Mmap) {
+        std::lock_guard<std::mutex> lock(streams_mutex_);
+        if (!allocator_) {
+            allocator_ = std::make_shared<DmaAllocator>(config_.dma_heap);
+        }
+        streamer->set_capture_memory(memory, allocator_);
+    }
+    streamer->set_thread_placement(config.placement);
+    streamer->set_inference_interval(config.infer_interval);
+    streamer->set_reorder_hold(config.reorder_hold_ms);
+    streamer->set_render_detections(config.render_detections);
+    streamer->set_overload_policy(EncoderStreamer::overload_policy_from_string(config.overload_policy),
+                                  config.queue_depth);
+    if (reactor_) {
+        streamer->set_capture_reactor(reactor_);
+    }
+    streamer->set_frame_ready_callback([this]() { notify_work(); });
+    if (batcher_) {
+        // 批量推理在process_next()返回后完成，推理时间由批处理线程补记到调度器
+        streamer->set_batcher(batcher_);
+        streamer->set_inference_cost_callback([this, id](int64_t cost_ns) { scheduler_.charge(id, cost_ns); });
+    }
+
+    ScheduleConfig schedule;
+    schedule.weight = config.weight;
+    schedule.priority = config.priority;
+    schedule.max_fps = config.max_infer_fps;
+    scheduler_.add(id, schedule);
+
+    if (!streamer->initialize(models_, worker_count_)) {
+        std::cerr << "StreamManager: failed to initialize stream " << id << " (" << config.device << ")" << std::endl;
+        scheduler_.remove(id);
+        return -1;
+    }
+    streamer->start();
+
+    {
+        std::lock_guard<std::mutex> lock(streams_mutex_);
+        streams_.push_back(Entry{id, streamer});
+        publish_streams();
+    }
+    std::cout << "StreamManager: stream " << id << " started (" << config.device
+              << " -> " << config.rtmp_url << ")" << std::endl;
+    return id;
+}
+
+bool StreamManager::remove_stream(int id) {
+    std::shared_ptr<EncoderStreamer> streamer;
+    {
+        std::lock_guard<std::mutex> lock(streams_mutex_);
+        for (auto it = streams_.begin(); it != streams_.end(); ++it) {
+            if (it->id == id) {
+                streamer = std::move(it->streamer);
+                streams_.erase(it);
+                break;
+            }
+        }
+        if (!streamer) {
+            return false;
+        }
+        publish_streams();
+    }
+    scheduler_.remove(id);
+
+    // stop()返回时批处理中该流的帧均已完成回调；析构时会再次等待，覆盖停止期间仍在提交的工作线程，
+    // 因此无论最后一个引用在哪个线程放下都是安全的。这里等待工作线程放下旧快照中的引用，尽量使流在此线程析构
+    streamer->stop();
+    for (int i = 0; i < 200 && streamer.use_count() > 1; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    streamer.reset();
+    std::cout << "StreamManager: stream " << id << " removed" << std::endl;
+    return true;
+}
+
+std::vector<std::shared_ptr<EncoderStreamer>> StreamManager::streams() const {
+    std::vector<std::shared_ptr<EncoderStreamer>> streams;
+    std::shared_ptr<const StreamList> list = std::atomic_load(&active_);
+    for (const Entry& entry : *list) {
+        streams.push_back(entry.streamer);
+    }
+    return streams;
+}
+
+std::shared_ptr<EncoderStreamer> StreamManager::stream(int id) const {
+    std::lock_guard<std::mutex> lock(streams_mutex_);
+    for (const Entry& entry : streams_) {
+        if (entry.id == id) {
+            return entry.streamer;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<StreamMetrics> StreamManager::metrics() const {
+    std::vector<StreamMetrics> metrics;
+    std::shared_ptr<const StreamList> list = std::atomic_load(&active_);
+    for (const Entry& entry : *list) {
+        StreamMetrics m = entry.streamer->metrics();
+        ScheduleStats schedule = scheduler_.stats(entry.id);
+        m.scheduled = schedule.served;
+        m.rate_limited = schedule.rate_limited;
+        m.schedule_wait = schedule.wait;
+        metrics.push_back(m);
+    }
+    return metrics;
+}
+
+int StreamManager::dump_traces(const std::string& path) const {
+    std::vector<std::shared_ptr<EncoderStreamer>> list = streams();
+    int written = 0;
+    for (const std::shared_ptr<EncoderStreamer>& streamer : list) {
+        std::string file = path;
+        if (list.size() > 1) {
+            // trace.json -> trace_<id>.json
+            size_t dot = path.rfind('.');
+            size_t slash = path.rfind('/');
+            std::string suffix = "_" + std::to_string(streamer->camera_id());
+            if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+                file = path.substr(0, dot) + suffix + path.substr(dot);
+            } else {
+                file = path + suffix;
+            }
+        }
+        if (streamer->dump_trace(file)) {
+            written++;
+        }
+    }
+    return written;
+}
+
+void StreamManager::worker_loop(int index) {
+    ThreadPlacement::bind_current_thread("infer" + std::to_string(index), config_.inference_placement);
+    while (running_) {
+        const uint64_t epoch = work_epoch_.load();
+        std::shared_ptr<const StreamList> list = std::atomic_load(&active_);
+        auto find = [&list](int id) -> EncoderStreamer* {
+            for (const Entry& entry : *list) {
+                if (entry.id == id) return entry.streamer.get();
+            }
+            return nullptr;
+        };
+
+        ScheduleDecision decision;
+        bool scheduled = scheduler_.next([&find](int id) {
+            EncoderStreamer* streamer = find(id);
+            return streamer && streamer->pending_frames() > 0;
+        }, decision);
+        if (scheduled) {
+            EncoderStreamer* streamer = find(decision.id);
+            int64_t start = LatencyHistogram::now_ns();
+            int64_t wait_ns = 0;
+            bool served = streamer && streamer->process_next(index, decision.allow_inference, &wait_ns);
+            scheduler_.complete(decision, served, LatencyHistogram::now_ns() - start, wait_ns);
+            continue;
+        }
+
+        // 所有流都没有待处理帧：等待新帧通知（超时兜底），等待前放下快照，不延迟被移除流的析构
+        list.reset();
+        sleeping_++;
+        {
+            std::unique_lock<std::mutex> lock(work_mutex_);
+            work_cv_.wait_for(lock, std::chrono::milliseconds(50), [this, epoch]() {
+                return work_epoch_.load() != epoch || !running_;
+            });
+        }
+        sleeping_--;
+    }
+}
+
+void StreamManager::notify_work() {
+    work_epoch_++;
+    if (sleeping_.load() > 0) {
+        std::lock_guard<std::mutex> lock(work_mutex_);
+        work_cv_.notify_one();
+    }
+}
+
+void StreamManager::publish_streams() {
+    std::shared_ptr<StreamList> list = std::make_shared<StreamList>(streams_);
+    std::atomic_store(&active_, std::shared_ptr<const StreamList>(std::move(list)));
+}
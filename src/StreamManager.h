@@ -0,0 +1,168 @@
+#pragma once
+/**
+ * @file StreamManager.h
+ * @class StreamManager
+ * @brief 多路流管理：按Config.lua创建所有摄像头的推流流水线，共享推理线程与模型池
+ * @author achene
+ * @date 2025-08-05
+ *
+ * 每个EncoderStreamer独立运行时各自创建推理线程与模型实例，8路摄像头即8组线程、8×pool_size份模型，
+ * 线程数远超CPU核数，NPU内存也被重复占用。StreamManager统一持有：
+ * - 一个全局模型池：模型只加载model_instances份，所有流共用
+ * - 一组全局推理线程（inference_workers个）：由InferenceScheduler按优先级、权重与限速决定
+ *   下一帧处理哪一路，再从该路输入队列取帧处理（EncoderStreamer::process_next()）
+ * - 可选的跨流批处理器（batch_size>1）：推理线程只取帧与转换，不同流的帧凑批后一次推理
+ * - 共享的采集反应器与DMA分配器（按pipeline配置）
+ * 流可在运行时通过add_stream()/remove_stream()增删，不影响其他流。
+ *
+ * 使用流程：
+ * 1. 构造StreamManager(pipeline配置)并start()
+ * 2. 对每个camera_configs条目调用add_stream()
+ * 3. 监控线程通过streams()/metrics()获取各路统计
+ * 4. stop()停止所有流与推理线程
+ */
+#include "EncoderStreamer.h"
+#include "InferenceBatcher.h"
+#include "InferenceScheduler.h"
+#include "lua_config.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class StreamManager {
+public:
+    /**
+     * @brief 构造函数
+     * @param config 全局流水线配置（模型、推理线程数、采集反应器等）
+     */
+    explicit StreamManager(const PipelineConfig& config);
+
+    /**
+     * @brief 析构函数，停止所有流
+     */
+    ~StreamManager();
+
+    StreamManager(const StreamManager&) = delete;
+    StreamManager& operator=(const StreamManager&) = delete;
+
+    /**
+     * @brief 加载共享模型池，启动共享推理线程与采集反应器
+     * @return 成功返回true，模型一个都未加载成功时返回false
+     */
+    bool start();
+
+    /**
+     * @brief 停止所有流与共享推理线程
+     */
+    void stop();
+
+    /**
+     * @brief 按摄像头配置创建、初始化并启动一路流（可在运行时调用）
+     * @param config 摄像头配置
+     * @return 流ID，失败返回-1
+     */
+    int add_stream(const CameraConfig& config);
+
+    /**
+     * @brief 停止并移除一路流（可在运行时调用），其他流不受影响
+     * @param id add_stream()返回的流ID
+     * @return 流存在返回true
+     */
+    bool remove_stream(int id);
+
+    /**
+     * @brief 获取当前所有流（按添加顺序）
+     */
+    std::vector<std::shared_ptr<EncoderStreamer>> streams() const;
+
+    /**
+     * @brief 按ID获取流，不存在返回nullptr
+     */
+    std::shared_ptr<EncoderStreamer> stream(int id) const;
+
+    /**
+     * @brief 获取所有流的指标快照（供MetricsServer导出）
+     */
+    std::vector<StreamMetrics> metrics() const;
+
+    /**
+     * @brief 导出所有流的分阶段trace，多路流时在文件名后追加"_<流ID>"
+     * @param path 输出文件路径
+     * @return 成功导出的流数
+     */
+    int dump_traces(const std::string& path) const;
+
+    /**
+     * @brief 获取一路流的调度统计（获得推理帧数、限速帧数、队列等待时间）
+     */
+    ScheduleStats schedule_stats(int id) const { return scheduler_.stats(id); }
+
+    /**
+     * @brief 共享采集反应器，未启用时返回nullptr
+     */
+    std::shared_ptr<CaptureReactor> reactor() const { return reactor_; }
+
+    /**
+     * @brief 跨流批处理器，未启用时返回nullptr
+     */
+    InferenceBatcherPtr batcher() const { return batcher_; }
+
+    /**
+     * @brief 共享模型池
+     */
+    ModelPoolPtr model_pool() const { return models_; }
+
+    /**
+     * @brief 模型名（"yolov5"/"test"）转换为模型类型，未知名称按yolov5处理
+     */
+    static ModelType model_type_from_string(const std::string& name);
+
+private:
+    struct Entry {
+        int id;
+        std::shared_ptr<EncoderStreamer> streamer;
+    };
+
+    using StreamList = std::vector<Entry>;
+
+    /**
+     * @brief 共享推理线程：由调度器选出下一路流并处理其一帧，所有流都没有待处理帧时等待新帧通知
+     * @param index 工作线程编号
+     */
+    void worker_loop(int index);
+
+    /**
+     * @brief 新帧入队通知（采集线程中调用），有等待中的工作线程时唤醒一个
+     */
+    void notify_work();
+
+    /**
+     * @brief 按当前流列表重建工作线程读取的快照（需持有streams_mutex_）
+     */
+    void publish_streams();
+
+    PipelineConfig config_;
+    ModelPoolPtr models_;
+    InferenceBatcherPtr batcher_;
+    std::shared_ptr<DmaAllocator> allocator_;
+    std::shared_ptr<CaptureReactor> reactor_;
+    std::vector<std::thread> workers_;
+    int worker_count_ = 1;
+    InferenceScheduler scheduler_;
+    std::atomic<bool> running_{false};
+
+    mutable std::mutex streams_mutex_;
+    std::vector<Entry> streams_;
+    int next_id_ = 0;
+    std::shared_ptr<const StreamList> active_;  // 工作线程读取的流列表快照，增删流时整体替换（std::atomic_load/store）
+
+    // 空闲工作线程等待新帧
+    std::mutex work_mutex_;
+    std::condition_variable work_cv_;
+    std::atomic<uint64_t> work_epoch_{0};  // 每有新帧入队加一
+    std::atomic<int> sleeping_{0};         // 正在等待的工作线程数
+};
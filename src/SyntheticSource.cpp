@@ -0,0 +1,176 @@
+#include "SyntheticSource.h"
+#include "FrameMeta.h"
+#include "LatencyHistogram.h"
+#include <linux/videodev2.h>
+#include <cstring>
+#include <iostream>
+
+#ifndef MODULE_TEST
+#define MODULE_TEST 0
+#endif
+
+namespace {
+constexpr int kBarCount = 8;
+// 彩条颜色：白、黄、青、绿、品红、红、蓝、黑（RGB与BT.601 YUV）
+const uint8_t kBarRgb[kBarCount][3] = {
+    {255, 255, 255}, {255, 255, 0}, {0, 255, 255}, {0, 255, 0},
+    {255, 0, 255},   {255, 0, 0},   {0, 0, 255},   {0, 0, 0},
+};
+const uint8_t kBarYuv[kBarCount][3] = {
+    {235, 128, 128}, {210, 16, 146}, {170, 166, 16}, {145, 54, 34},
+    {106, 202, 222}, {81, 90, 240},  {41, 240, 110}, {16, 128, 128},
+};
+constexpr int kScrollStep = 4;  // 每帧滚动像素数（偶数，保证YUYV/NV12色度对齐）
+} // namespace
+
+SyntheticSource::SyntheticSource(int width, int height, int fps,
+                                 AVPixelFormat format, bool realtime)
+    : width_(width & ~1),
+      height_(height & ~1),
+      fps_(fps > 0 ? fps : 30),
+      format_(format),
+      realtime_(realtime) {}
+
+SyntheticSource::~SyntheticSource() {
+    stop();
+}
+
+AVPixelFormat SyntheticSource::format_from_fourcc(uint32_t fourcc) {
+    switch (fourcc) {
+    case 0:
+    case V4L2_PIX_FMT_YUYV:  return AV_PIX_FMT_YUYV422;
+    case V4L2_PIX_FMT_NV12:  return AV_PIX_FMT_NV12;
+    case V4L2_PIX_FMT_RGB24: return AV_PIX_FMT_RGB24;
+    default:                 return AV_PIX_FMT_NONE;
+    }
+}
+
+bool SyntheticSource::initialize() {
+    if (initialized_) return true;
+
+    if (format_ != AV_PIX_FMT_YUYV422 && format_ != AV_PIX_FMT_NV12 && format_ != AV_PIX_FMT_RGB24) {
+        std::cerr << "SyntheticSource: unsupported pixel format " << format_ << std::endl;
+        return false;
+    }
+
+    // 生成两倍行宽的图案行，帧内每行从偏移处截取一行宽度
+    const int period = width_;
+    for (int x = 0; x < 2 * width_; x += 2) {
+        int bar = (x % period) * kBarCount / period;
+        const uint8_t* yuv = kBarYuv[bar];
+        const uint8_t* rgb = kBarRgb[bar];
+        switch (format_) {
+        case AV_PIX_FMT_YUYV422:
+            pattern_[0].insert(pattern_[0].end(), {yuv[0], yuv[1], yuv[0], yuv[2]});
+            break;
+        case AV_PIX_FMT_NV12:
+            pattern_[0].insert(pattern_[0].end(), {yuv[0], yuv[0]});
+            pattern_[1].insert(pattern_[1].end(), {yuv[1], yuv[2]});
+            break;
+        default:
+            pattern_[0].insert(pattern_[0].end(), {rgb[0], rgb[1], rgb[2], rgb[0], rgb[1], rgb[2]});
+            break;
+        }
+    }
+
+    pool_ = std::make_shared<FramePool>(format_, width_, height_, 8);
+    initialized_ = true;
+    return true;
+}
+
+void SyntheticSource::start() {
+    if (!initialized_ && !initialize()) {
+        return;
+    }
+    if (running_) return;
+
+    running_ = true;
+    thread_.reset(new std::thread(&SyntheticSource::generate_thread, this));
+}
+
+void SyntheticSource::stop() {
+    if (!running_) return;
+
+    running_ = false;
+    if (thread_ && thread_->joinable()) {
+        thread_->join();
+    }
+    thread_.reset();
+}
+
+void SyntheticSource::fill_frame(AVFrame* frame, uint64_t index) const {
+    int offset = static_cast<int>((index * kScrollStep) % width_);
+    int bytes_per_pixel = format_ == AV_PIX_FMT_YUYV422 ? 2 : (format_ == AV_PIX_FMT_NV12 ? 1 : 3);
+    const uint8_t* row = pattern_[0].data() + offset * bytes_per_pixel;
+    for (int y = 0; y < height_; ++y) {
+        memcpy(frame->data[0] + y * frame->linesize[0], row, width_ * bytes_per_pixel);
+    }
+    if (format_ == AV_PIX_FMT_NV12) {
+        const uint8_t* uv_row = pattern_[1].data() + offset;
+        for (int y = 0; y < height_ / 2; ++y) {
+            memcpy(frame->data[1] + y * frame->linesize[1], uv_row, width_);
+        }
+    }
+}
+
+void SyntheticSource::generate_thread() {
+    run_thread_init();
+    FramePacer pacer(realtime_);
+    const int64_t interval_ns = 1000000000LL / fps_;
+    uint64_t index = 0;
+    while (running_) {
+        pacer.wait(static_cast<int64_t>(index) * interval_ns);
+
+        FramePtr frame = pool_->acquire();
+        if (!frame) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            continue;
+        }
+        fill_frame(frame.get(), index);
+
+        FrameMeta meta;
+        meta.capture_ns = LatencyHistogram::now_ns();
+        meta.sequence = static_cast<uint32_t>(index);
+        meta.camera_id = camera_id_;
+        meta.set_stage(FrameStage::SourceOut, meta.capture_ns);
+        set_frame_meta(frame.get(), meta);
+        frame->pts = meta.capture_ns / 1000;
+
+        index++;
+        frames_++;
+        if (frame_callback_) {
+            frame_callback_(std::move(frame));
+        }
+    }
+}
+
+
+#if MODULE_TEST
+//g++ -c FramePool.cpp && g++ -DMODULE_TEST=1 -o test_synthetic_source SyntheticSource.cpp FramePool.o -lpthread -lavutil
+// 合成源出帧测试：实时模式帧率应接近设定值，尽快模式只受下游处理速度限制
+int main() {
+    const AVPixelFormat formats[] = {AV_PIX_FMT_YUYV422, AV_PIX_FMT_NV12, AV_PIX_FMT_RGB24};
+    for (AVPixelFormat format : formats) {
+        for (bool realtime : {true, false}) {
+            SyntheticSource source(1280, 720, 30, format, realtime);
+            std::atomic<uint64_t> received{0};
+            std::atomic<bool> in_order{true};
+            int64_t last_pts = -1;
+            source.set_frame_callback([&](FramePtr frame) {
+                if (frame->pts <= last_pts) in_order = false;
+                last_pts = frame->pts;
+                received++;
+            });
+            source.start();
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            source.stop();
+            std::cout << "format: " << format << (realtime ? " realtime" : " fast")
+                      << " fps: " << received << " in_order: " << in_order << std::endl;
+            if (!in_order || (realtime && (received < 25 || received > 35))) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+#endif
@@ -0,0 +1,81 @@
+#pragma once
+/**
+ * @file SyntheticSource.h
+ * @class SyntheticSource
+ * @brief 合成测试图案帧源
+ * @author achene
+ * @date 2025-08-05
+ *
+ * 生成水平滚动的彩条图案，用于无摄像头环境下压测完整流水线。
+ * 图案行预先生成，每帧只做逐行memcpy，尽快模式下帧源本身不会成为瓶颈。
+ *
+ * 主要功能特点：
+ * - 输出格式：YUYV、NV12、RGB24（与摄像头常见格式一致，覆盖零拷贝与NV12直通路径）
+ * - 帧缓冲区来自帧源自有的FramePool，下游释放后自动回池
+ * - 实时模式按帧率出帧；尽快模式连续出帧，由下游队列反压限速
+ */
+#include "FrameSource.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+class SyntheticSource : public FrameSource {
+public:
+    /**
+     * @brief 构造函数
+     * @param width 帧宽度（偶数）
+     * @param height 帧高度（偶数）
+     * @param fps 实时模式下的帧率
+     * @param format 输出像素格式（AV_PIX_FMT_YUYV422/AV_PIX_FMT_NV12/AV_PIX_FMT_RGB24）
+     * @param realtime true按帧率出帧，false尽快出帧
+     */
+    SyntheticSource(int width, int height, int fps,
+                    AVPixelFormat format = AV_PIX_FMT_YUYV422, bool realtime = true);
+
+    ~SyntheticSource() override;
+
+    /**
+     * @brief V4L2四字符格式转换为支持的输出格式（0按YUYV处理）
+     * @return 支持的格式，不支持时返回AV_PIX_FMT_NONE
+     */
+    static AVPixelFormat format_from_fourcc(uint32_t fourcc);
+
+    bool initialize() override;
+    void start() override;
+    void stop() override;
+    bool is_running() const override { return running_; }
+    AVPixelFormat av_format() const override { return format_; }
+    std::string name() const override { return "synthetic"; }
+    CaptureStats capture_stats() const override {
+        CaptureStats stats;
+        stats.captured = frames_;
+        return stats;
+    }
+
+private:
+    /**
+     * @brief 出帧线程主函数
+     */
+    void generate_thread();
+
+    /**
+     * @brief 生成第index帧图案（彩条按帧序号水平滚动）
+     */
+    void fill_frame(AVFrame* frame, uint64_t index) const;
+
+    int width_;
+    int height_;
+    int fps_;
+    AVPixelFormat format_;
+    bool realtime_;
+
+    std::shared_ptr<FramePool> pool_;
+    // 预生成的图案行（长度为两倍行宽，按偏移截取实现滚动）
+    std::vector<uint8_t> pattern_[2];
+
+    std::atomic<bool> running_{false};
+    std::atomic<bool> initialized_{false};
+    std::atomic<uint64_t> frames_{0};
+    std::unique_ptr<std::thread> thread_;
+};
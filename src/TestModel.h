@@ -8,9 +8,15 @@ class TestModel: public Model
         return true;
     }
 
-    bool run(cv::Mat& input) override {
+    bool run(const cv::Mat& input, Detections& detections) override {
         std::this_thread::sleep_for(std::chrono::milliseconds(60));//模拟任务执行
-        cv::cvtColor(input,input,cv::COLOR_RGB2BGR);
+        // 模拟检测结果：画面中央的一个框
+        Detection det;
+        det.class_id = 0;
+        det.score = 1.0f;
+        det.box = cv::Rect(input.cols / 4, input.rows / 4, input.cols / 2, input.rows / 2);
+        det.label = "test";
+        detections.assign(1, det);
         std::cout << "model run success" << std::endl;
         return true;
     }
@@ -0,0 +1,394 @@
+#include "ThreadPlacement.h"
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+#ifndef MODULE_TEST
+#define MODULE_TEST 0
+#endif
+
+namespace {
+// 已登记的线程
+struct ThreadEntry {
+    std::string name;
+    int tid;
+    std::string cpus;
+    std::string policy;
+};
+
+std::mutex g_registry_mutex;
+std::vector<ThreadEntry> g_registry;
+
+bool read_line(const std::string& path, std::string& line) {
+    std::ifstream file(path);
+    return static_cast<bool>(std::getline(file, line));
+}
+
+// 读取CPU的相对算力：优先cpu_capacity（调度器使用的归一化算力），其次最高频率
+bool read_cpu_rank(const std::string& root, int cpu, const char* file, long& value) {
+    std::string line;
+    if (!read_line(root + "/cpu" + std::to_string(cpu) + "/" + file, line)) {
+        return false;
+    }
+    char* end = nullptr;
+    value = strtol(line.c_str(), &end, 10);
+    return end != line.c_str();
+}
+
+int current_tid() {
+    return static_cast<int>(syscall(SYS_gettid));
+}
+
+std::string describe_policy(int policy, int priority, int nice) {
+    if (policy == SCHED_FIFO) return "fifo:" + std::to_string(priority);
+    if (policy == SCHED_RR) return "rr:" + std::to_string(priority);
+    return nice != 0 ? "other nice " + std::to_string(nice) : "other";
+}
+} // namespace
+
+CpuTopology::CpuTopology(const std::string& sysfs_root) {
+    std::string line;
+    if (!read_line(sysfs_root + "/online", line) || !parse_cpu_list(line, online_)) {
+        long count = sysconf(_SC_NPROCESSORS_ONLN);
+        for (int i = 0; i < count; ++i) {
+            online_.push_back(i);
+        }
+    }
+
+    static const char* const kRankFiles[] = {"cpu_capacity", "cpufreq/cpuinfo_max_freq"};
+    std::map<int, long> rank;
+    for (const char* file : kRankFiles) {
+        rank.clear();
+        for (int cpu : online_) {
+            long value;
+            if (!read_cpu_rank(sysfs_root, cpu, file, value)) break;
+            rank[cpu] = value;
+        }
+        if (rank.size() == online_.size()) break;
+    }
+
+    // 算力最低的一簇为小核，其余为大核；读不到或全部相同时视为同构
+    if (!online_.empty() && rank.size() == online_.size()) {
+        long lowest = rank.begin()->second;
+        for (const auto& item : rank) {
+            lowest = std::min(lowest, item.second);
+        }
+        for (int cpu : online_) {
+            (rank[cpu] == lowest ? little_ : big_).push_back(cpu);
+        }
+    }
+    if (big_.empty() || little_.empty()) {
+        big_ = online_;
+        little_ = online_;
+    }
+}
+
+const CpuTopology& CpuTopology::instance() {
+    static CpuTopology topology;
+    return topology;
+}
+
+bool CpuTopology::resolve(const std::string& spec, std::vector<int>& cpus) const {
+    cpus.clear();
+    if (spec == "big") {
+        cpus = big_;
+    } else if (spec == "little") {
+        cpus = little_;
+    } else if (spec == "all") {
+        cpus = online_;
+    } else {
+        std::vector<int> listed;
+        if (!parse_cpu_list(spec, listed)) {
+            return false;
+        }
+        for (int cpu : listed) {
+            if (std::find(online_.begin(), online_.end(), cpu) != online_.end()) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return !cpus.empty();
+}
+
+std::string CpuTopology::describe() const {
+    return "online " + format_cpu_list(online_) + ", big " + format_cpu_list(big_) +
+           ", little " + format_cpu_list(little_);
+}
+
+bool CpuTopology::parse_cpu_list(const std::string& text, std::vector<int>& cpus) {
+    cpus.clear();
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        item.erase(std::remove_if(item.begin(), item.end(), ::isspace), item.end());
+        if (item.empty()) continue;
+        int first = 0;
+        int last = 0;
+        char dash = 0;
+        char extra = 0;
+        int n = sscanf(item.c_str(), "%d%c%d%c", &first, &dash, &last, &extra);
+        if (n == 1) {
+            last = first;
+        } else if (n != 3 || dash != '-') {
+            return false;
+        }
+        if (first < 0 || last < first || last >= CPU_SETSIZE) {
+            return false;
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return !cpus.empty();
+}
+
+std::string CpuTopology::format_cpu_list(const std::vector<int>& cpus) {
+    std::string text;
+    size_t i = 0;
+    while (i < cpus.size()) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+            ++j;
+        }
+        if (!text.empty()) text += ",";
+        text += std::to_string(cpus[i]);
+        if (j > i) text += "-" + std::to_string(cpus[j]);
+        i = j + 1;
+    }
+    return text;
+}
+
+int ThreadPlacement::policy_from_string(const std::string& name) {
+    if (name.empty() || name == "other") return SCHED_OTHER;
+    if (name == "fifo") return SCHED_FIFO;
+    if (name == "rr") return SCHED_RR;
+    return -1;
+}
+
+bool ThreadPlacement::bind_current_thread(const std::string& name, const StagePlacement& placement,
+                                          const std::vector<int>& exclude) {
+    const std::string thread_name = name.substr(0, 15);  // 内核线程名最长15个字符
+    pthread_setname_np(pthread_self(), thread_name.c_str());
+    const int tid = current_tid();
+    bool ok = true;
+
+    // 亲和性：配置的CPU集合（未配置但有独占CPU时为全部在线CPU）去掉其他阶段独占的CPU
+    const CpuTopology& topology = CpuTopology::instance();
+    std::vector<int> cpus;
+    if (!placement.cpus.empty()) {
+        if (!topology.resolve(placement.cpus, cpus)) {
+            std::cerr << "ThreadPlacement: " << thread_name << " invalid cpus \"" << placement.cpus
+                      << "\" (" << topology.describe() << ")" << std::endl;
+            ok = false;
+        }
+    } else if (!exclude.empty()) {
+        cpus = topology.online();
+    }
+    if (!cpus.empty() && !exclude.empty()) {
+        std::vector<int> remaining;
+        for (int cpu : cpus) {
+            if (std::find(exclude.begin(), exclude.end(), cpu) == exclude.end()) {
+                remaining.push_back(cpu);
+            }
+        }
+        if (remaining.empty()) {
+            std::cerr << "ThreadPlacement: " << thread_name << " cpus " << CpuTopology::format_cpu_list(cpus)
+                      << " are all isolated for capture, sharing them" << std::endl;
+        } else {
+            cpus.swap(remaining);
+        }
+    }
+    if (!cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus) {
+            CPU_SET(cpu, &set);
+        }
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err != 0) {
+            std::cerr << "ThreadPlacement: " << thread_name << " set affinity "
+                      << CpuTopology::format_cpu_list(cpus) << " failed (" << strerror(err) << ")" << std::endl;
+            cpus.clear();
+            ok = false;
+        }
+    }
+
+    // 调度策略：实时策略设置优先级，普通策略设置nice值（Linux上nice值按线程生效）
+    int policy = policy_from_string(placement.policy);
+    int priority = 0;
+    if (policy < 0) {
+        std::cerr << "ThreadPlacement: " << thread_name << " unknown policy \"" << placement.policy
+                  << "\"" << std::endl;
+        policy = SCHED_OTHER;
+        ok = false;
+    }
+    if (policy != SCHED_OTHER) {
+        priority = std::max(sched_get_priority_min(policy),
+                            std::min(placement.priority, sched_get_priority_max(policy)));
+        sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = priority;
+        int err = pthread_setschedparam(pthread_self(), policy, &param);
+        if (err != 0) {
+            std::cerr << "ThreadPlacement: " << thread_name << " set " << placement.policy
+                      << " priority " << priority << " failed (" << strerror(err)
+                      << (err == EPERM ? ", needs CAP_SYS_NICE" : "") << ")" << std::endl;
+            policy = SCHED_OTHER;
+            priority = 0;
+            ok = false;
+        }
+    }
+    int nice = 0;
+    if (policy == SCHED_OTHER && placement.nice != 0) {
+        if (setpriority(PRIO_PROCESS, static_cast<id_t>(tid), placement.nice) == 0) {
+            nice = placement.nice;
+        } else {
+            std::cerr << "ThreadPlacement: " << thread_name << " set nice " << placement.nice
+                      << " failed (" << strerror(errno) << ")" << std::endl;
+            ok = false;
+        }
+    }
+
+    ThreadEntry entry{thread_name, tid, CpuTopology::format_cpu_list(cpus), describe_policy(policy, priority, nice)};
+    if (!cpus.empty() || policy != SCHED_OTHER || nice != 0) {
+        std::cout << "ThreadPlacement: " << thread_name << " (tid " << tid << ") cpus "
+                  << (entry.cpus.empty() ? "any" : entry.cpus) << " policy " << entry.policy << std::endl;
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_registry_mutex);
+        g_registry.erase(std::remove_if(g_registry.begin(), g_registry.end(),
+                                        [tid](const ThreadEntry& e) { return e.tid == tid; }),
+                         g_registry.end());
+        g_registry.push_back(std::move(entry));
+    }
+    return ok;
+}
+
+std::vector<ThreadCpuUsage> ThreadPlacement::cpu_usage() {
+    static const double kMsPerTick = 1000.0 / sysconf(_SC_CLK_TCK);
+    std::vector<ThreadCpuUsage> usage;
+    std::lock_guard<std::mutex> lock(g_registry_mutex);
+    auto it = g_registry.begin();
+    while (it != g_registry.end()) {
+        // /proc/self/task/<tid>/stat："tid (comm) state ..."，comm之后第12、13项为utime/stime，第37项为processor
+        std::string line;
+        bool alive = read_line("/proc/self/task/" + std::to_string(it->tid) + "/stat", line);
+        size_t open = line.find('(');
+        size_t close = line.rfind(')');
+        // 线程已退出或tid被新线程复用（线程名不同）时移除
+        if (!alive || open == std::string::npos || close == std::string::npos ||
+            line.compare(open + 1, close - open - 1, it->name) != 0) {
+            it = g_registry.erase(it);
+            continue;
+        }
+        std::stringstream fields(line.substr(close + 2));
+        std::string field;
+        unsigned long long utime = 0;
+        unsigned long long stime = 0;
+        int processor = -1;
+        for (int i = 0; fields >> field; ++i) {
+            if (i == 11) utime = strtoull(field.c_str(), nullptr, 10);
+            if (i == 12) stime = strtoull(field.c_str(), nullptr, 10);
+            if (i == 36) {
+                processor = atoi(field.c_str());
+                break;
+            }
+        }
+        ThreadCpuUsage item;
+        item.name = it->name;
+        item.tid = it->tid;
+        item.cpu_ms = (utime + stime) * kMsPerTick;
+        item.last_cpu = processor;
+        item.cpus = it->cpus;
+        item.policy = it->policy;
+        usage.push_back(item);
+        ++it;
+    }
+    return usage;
+}
+
+
+#if MODULE_TEST
+//g++ -DMODULE_TEST=1 -o test_thread_placement ThreadPlacement.cpp -lpthread
+// 放置测试：用伪造的sysfs验证大小核划分，再把两个忙线程分别绑定到不同CPU并检查CPU时间统计
+#include <atomic>
+#include <sys/stat.h>
+#include <thread>
+
+static void write_file(const std::string& path, const std::string& text) {
+    std::ofstream(path) << text << "\n";
+}
+
+int main() {
+    bool ok = true;
+
+    // RK3588风格拓扑：cpu0-3为A55（算力414），cpu4-7为A76（算力1024）
+    char root[] = "/tmp/cpu_topology_XXXXXX";
+    if (!mkdtemp(root)) return 1;
+    write_file(std::string(root) + "/online", "0-7");
+    for (int cpu = 0; cpu < 8; ++cpu) {
+        std::string dir = std::string(root) + "/cpu" + std::to_string(cpu);
+        mkdir(dir.c_str(), 0755);
+        write_file(dir + "/cpu_capacity", cpu < 4 ? "414" : "1024");
+    }
+    CpuTopology fake(root);
+    std::cout << "fake topology: " << fake.describe() << std::endl;
+    std::vector<int> cpus;
+    ok = ok && fake.big() == std::vector<int>({4, 5, 6, 7}) && fake.little() == std::vector<int>({0, 1, 2, 3});
+    ok = ok && fake.resolve("2-3,6,9", cpus) && cpus == std::vector<int>({2, 3, 6});
+    ok = ok && !fake.resolve("3-1", cpus) && !fake.resolve("x", cpus);
+
+    const CpuTopology& topology = CpuTopology::instance();
+    std::cout << "host topology: " << topology.describe() << std::endl;
+
+    // 两个忙线程：一个绑定第一个在线CPU，另一个避开它；实时调度无权限时应仅告警
+    std::atomic<bool> running(true);
+    const int first = topology.online().front();
+    auto busy = [&running](const std::string& name, StagePlacement placement, std::vector<int> exclude) {
+        ThreadPlacement::bind_current_thread(name, placement, exclude);
+        volatile uint64_t counter = 0;
+        while (running) {
+            for (int i = 0; i < 100000; ++i) ++counter;
+            std::this_thread::sleep_for(std::chrono::microseconds(200));  // 留出CPU，避免实时线程饿死其他线程
+        }
+    };
+    StagePlacement pinned;
+    pinned.cpus = std::to_string(first);
+    pinned.policy = "fifo";
+    pinned.priority = 10;
+    StagePlacement others;
+    others.nice = 5;
+    std::thread a(busy, "test-pinned", pinned, std::vector<int>());
+    std::thread b(busy, "test-others", others, std::vector<int>({first}));
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    std::vector<ThreadCpuUsage> usage = ThreadPlacement::cpu_usage();
+    for (const auto& item : usage) {
+        std::cout << item.name << " tid " << item.tid << " cpu " << item.cpu_ms << "ms last cpu "
+                  << item.last_cpu << " cpus " << item.cpus << " policy " << item.policy << std::endl;
+        ok = ok && item.cpu_ms > 0;
+        if (item.name == "test-pinned") ok = ok && item.last_cpu == first;
+        if (item.name == "test-others" && topology.online().size() > 1) ok = ok && item.last_cpu != first;
+    }
+    ok = ok && usage.size() == 2;
+    running = false;
+    a.join();
+    b.join();
+    ok = ok && ThreadPlacement::cpu_usage().empty();  // 线程退出后自动移除
+
+    std::cout << "ok: " << ok << std::endl;
+    return ok ? 0 : 1;
+}
+#endif
@@ -0,0 +1,131 @@
+#pragma once
+/**
+ * @file ThreadPlacement.h
+ * @class ThreadPlacement
+ * @brief 流水线线程放置：按阶段设置CPU亲和性、调度策略与nice值，并统计各线程CPU时间
+ * @author achene
+ * @date 2025-08-05
+ *
+ * RK3588等big.LITTLE平台上，未设置亲和性的采集、推理、编码线程会被随机调度到
+ * A55小核或A76大核，延迟与吞吐随之抖动。本模块从/sys/devices/system/cpu读取拓扑
+ * （优先cpu_capacity，其次cpufreq/cpuinfo_max_freq）区分大小核，按配置把各阶段线程
+ * 绑定到"big"/"little"/显式CPU列表上，并可将采集线程设为SCHED_FIFO实时调度。
+ *
+ * 使用流程：
+ * 1. 在各阶段线程入口调用ThreadPlacement::bind_current_thread()（未配置时只登记线程）
+ * 2. 监控线程调用ThreadPlacement::cpu_usage()获取各线程累计CPU时间与最近运行的CPU
+ *
+ * SCHED_FIFO/SCHED_RR与负nice值需要CAP_SYS_NICE（或root），权限不足时打印警告并保持默认调度，
+ * 亲和性设置不受影响。
+ */
+#include <sched.h>
+#include <string>
+#include <vector>
+
+// 单个阶段的线程放置
+struct StagePlacement {
+    std::string cpus;              // CPU集合："big"/"little"/"all"或CPU列表（如"0-3,6"），空表示不设置亲和性
+    std::string policy = "other";  // 调度策略："other"(SCHED_OTHER)/"fifo"(SCHED_FIFO)/"rr"(SCHED_RR)
+    int priority = 0;              // fifo/rr的实时优先级（1-99）
+    int nice = 0;                  // other的nice值（-20~19）
+    bool isolate = false;          // 仅采集阶段有效：从本路其他阶段的CPU集合中剔除采集CPU，使采集独占这些核
+};
+
+// 单路流各阶段的线程放置
+struct PipelinePlacement {
+    StagePlacement capture;    // 采集线程（V4L2采集、录像回放、合成图案）
+    StagePlacement decode;     // MJPEG解码线程
+    StagePlacement inference;  // 推理线程（reading_loop）
+    StagePlacement encode;     // 编码推流线程
+};
+
+// 线程CPU时间统计
+struct ThreadCpuUsage {
+    std::string name;     // 线程名
+    int tid = 0;          // 内核线程ID
+    double cpu_ms = 0;    // 累计CPU时间（用户态+内核态，毫秒）
+    int last_cpu = -1;    // 最近一次运行所在的CPU
+    std::string cpus;     // 绑定的CPU列表，空表示未绑定
+    std::string policy;   // 调度策略
+};
+
+/**
+ * @brief CPU拓扑：在线CPU及大小核划分
+ */
+class CpuTopology {
+public:
+    /**
+     * @brief 读取拓扑
+     * @param sysfs_root CPU sysfs目录
+     */
+    explicit CpuTopology(const std::string& sysfs_root = "/sys/devices/system/cpu");
+
+    /**
+     * @brief 获取本机拓扑（首次调用时读取）
+     */
+    static const CpuTopology& instance();
+
+    const std::vector<int>& online() const { return online_; }
+
+    /**
+     * @brief 大核（算力最高的一簇）；同构平台为全部在线CPU
+     */
+    const std::vector<int>& big() const { return big_; }
+
+    /**
+     * @brief 小核（大核以外的CPU）；同构平台为全部在线CPU
+     */
+    const std::vector<int>& little() const { return little_; }
+
+    /**
+     * @brief 解析CPU集合描述（"big"/"little"/"all"/CPU列表），结果只保留在线CPU
+     * @param spec CPU集合描述
+     * @param cpus 输出CPU编号（升序）
+     * @return 解析成功且非空返回true
+     */
+    bool resolve(const std::string& spec, std::vector<int>& cpus) const;
+
+    /**
+     * @brief 拓扑描述，用于日志（如"online 0-7, big 4-7, little 0-3"）
+     */
+    std::string describe() const;
+
+    /**
+     * @brief 解析sysfs格式的CPU列表（如"0-3,6"）
+     * @return 格式正确返回true
+     */
+    static bool parse_cpu_list(const std::string& text, std::vector<int>& cpus);
+
+    /**
+     * @brief 将CPU编号格式化为列表（如"0-3,6"）
+     */
+    static std::string format_cpu_list(const std::vector<int>& cpus);
+
+private:
+    std::vector<int> online_;
+    std::vector<int> big_;
+    std::vector<int> little_;
+};
+
+class ThreadPlacement {
+public:
+    /**
+     * @brief 命名并登记当前线程，按放置配置设置亲和性与调度策略
+     * @param name 线程名（超过15个字符时截断）
+     * @param placement 阶段放置配置，各项为默认值时保持系统默认
+     * @param exclude 需要避开的CPU（其他阶段独占的CPU），cpus为空时在全部在线CPU中避开
+     * @return 配置全部生效返回true，任一项失败返回false（已生效的设置保留）
+     */
+    static bool bind_current_thread(const std::string& name, const StagePlacement& placement,
+                                    const std::vector<int>& exclude = std::vector<int>());
+
+    /**
+     * @brief 获取所有已登记且仍存活线程的CPU时间统计（已退出的线程自动移除）
+     */
+    static std::vector<ThreadCpuUsage> cpu_usage();
+
+    /**
+     * @brief 策略名转换为调度策略（SCHED_OTHER/SCHED_FIFO/SCHED_RR），未知名称返回-1
+     */
+    static int policy_from_string(const std::string& name);
+};
@@ -0,0 +1,367 @@
+#include "YuyvLetterbox.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define LETTERBOX_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define LETTERBOX_SSE2 1
+#endif
+
+#ifndef MODULE_TEST
+#define MODULE_TEST 0
+#endif
+
+namespace {
+// BT.601有限范围系数（6位定点）：R = 75*(Y-16) + 102*(V-128)，G = 75*(Y-16) - 25*(U-128) - 52*(V-128)，
+// B = 75*(Y-16) + 129*(U-128)。16位有符号中间结果仅B可能溢出，溢出时结果必然钳位到255，
+// SIMD饱和加法与标量32位计算结果一致
+constexpr int kCoefY = 75;
+constexpr int kCoefRV = 102;
+constexpr int kCoefGU = 25;
+constexpr int kCoefGV = 52;
+constexpr int kCoefBU = 129;
+
+inline uint8_t lerp7(uint8_t a, uint8_t b, int w) {
+    return static_cast<uint8_t>((a * (128 - w) + b * w + 64) >> 7);
+}
+
+inline uint8_t clamp_u8(int v) {
+    return static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+inline void yuv_to_rgb(int y, int u, int v, uint8_t* rgb) {
+    int yc = (y - 16) * kCoefY;
+    int uc = u - 128;
+    int vc = v - 128;
+    rgb[0] = clamp_u8((yc + kCoefRV * vc + 32) >> 6);
+    rgb[1] = clamp_u8((yc - kCoefGU * uc - kCoefGV * vc + 32) >> 6);
+    rgb[2] = clamp_u8((yc + kCoefBU * uc + 32) >> 6);
+}
+
+/**
+ * @brief 两行按权重混合：out = (a*(128-w) + b*w + 64) >> 7
+ */
+void blend_rows(const uint8_t* a, const uint8_t* b, int w, uint8_t* out, int count) {
+    int i = 0;
+#if LETTERBOX_NEON
+    const uint8x8_t wa = vdup_n_u8(static_cast<uint8_t>(128 - w));
+    const uint8x8_t wb = vdup_n_u8(static_cast<uint8_t>(w));
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t va = vld1q_u8(a + i);
+        uint8x16_t vb = vld1q_u8(b + i);
+        uint16x8_t lo = vmlal_u8(vmull_u8(vget_low_u8(va), wa), vget_low_u8(vb), wb);
+        uint16x8_t hi = vmlal_u8(vmull_u8(vget_high_u8(va), wa), vget_high_u8(vb), wb);
+        vst1q_u8(out + i, vcombine_u8(vrshrn_n_u16(lo, 7), vrshrn_n_u16(hi, 7)));
+    }
+#elif LETTERBOX_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i wa = _mm_set1_epi16(static_cast<short>(128 - w));
+    const __m128i wb = _mm_set1_epi16(static_cast<short>(w));
+    const __m128i round = _mm_set1_epi16(64);
+    for (; i + 16 <= count; i += 16) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), wa),
+                                   _mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), wb));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), wa),
+                                   _mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), wb));
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 7);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 7);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < count; ++i) {
+        out[i] = lerp7(a[i], b[i], w);
+    }
+}
+
+/**
+ * @brief 平面Y/U/V行转换为交织RGB24
+ */
+void convert_line(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* rgb, int count) {
+    int i = 0;
+#if LETTERBOX_NEON
+    const int16x8_t c16 = vdupq_n_s16(16);
+    const int16x8_t c128 = vdupq_n_s16(128);
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t vy = vld1q_u8(y + i);
+        uint8x16_t vu = vld1q_u8(u + i);
+        uint8x16_t vv = vld1q_u8(v + i);
+        uint8x8_t r[2], g[2], b[2];
+        for (int half = 0; half < 2; ++half) {
+            uint8x8_t y8 = half ? vget_high_u8(vy) : vget_low_u8(vy);
+            uint8x8_t u8 = half ? vget_high_u8(vu) : vget_low_u8(vu);
+            uint8x8_t v8 = half ? vget_high_u8(vv) : vget_low_u8(vv);
+            int16x8_t ys = vmulq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(y8)), c16), kCoefY);
+            int16x8_t uc = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u8)), c128);
+            int16x8_t vc = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v8)), c128);
+            int16x8_t rs = vqaddq_s16(ys, vmulq_n_s16(vc, kCoefRV));
+            int16x8_t gs = vsubq_s16(vsubq_s16(ys, vmulq_n_s16(uc, kCoefGU)), vmulq_n_s16(vc, kCoefGV));
+            int16x8_t bs = vqaddq_s16(ys, vmulq_n_s16(uc, kCoefBU));
+            r[half] = vqrshrun_n_s16(rs, 6);
+            g[half] = vqrshrun_n_s16(gs, 6);
+            b[half] = vqrshrun_n_s16(bs, 6);
+        }
+        uint8x16x3_t out;
+        out.val[0] = vcombine_u8(r[0], r[1]);
+        out.val[1] = vcombine_u8(g[0], g[1]);
+        out.val[2] = vcombine_u8(b[0], b[1]);
+        vst3q_u8(rgb + i * 3, out);
+    }
+#elif LETTERBOX_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i c16 = _mm_set1_epi16(16);
+    const __m128i c128 = _mm_set1_epi16(128);
+    const __m128i c32 = _mm_set1_epi16(32);
+    const __m128i coef_y = _mm_set1_epi16(kCoefY);
+    const __m128i coef_rv = _mm_set1_epi16(kCoefRV);
+    const __m128i coef_gu = _mm_set1_epi16(kCoefGU);
+    const __m128i coef_gv = _mm_set1_epi16(kCoefGV);
+    const __m128i coef_bu = _mm_set1_epi16(kCoefBU);
+    alignas(16) uint8_t planar[32];
+    for (; i + 8 <= count; i += 8) {
+        __m128i vy = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + i)), zero);
+        __m128i vu = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(u + i)), zero);
+        __m128i vv = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(v + i)), zero);
+        __m128i ys = _mm_mullo_epi16(_mm_sub_epi16(vy, c16), coef_y);
+        __m128i uc = _mm_sub_epi16(vu, c128);
+        __m128i vc = _mm_sub_epi16(vv, c128);
+        __m128i rs = _mm_adds_epi16(ys, _mm_mullo_epi16(vc, coef_rv));
+        __m128i gs = _mm_sub_epi16(_mm_sub_epi16(ys, _mm_mullo_epi16(uc, coef_gu)), _mm_mullo_epi16(vc, coef_gv));
+        __m128i bs = _mm_adds_epi16(ys, _mm_mullo_epi16(uc, coef_bu));
+        rs = _mm_srai_epi16(_mm_adds_epi16(rs, c32), 6);
+        gs = _mm_srai_epi16(_mm_adds_epi16(gs, c32), 6);
+        bs = _mm_srai_epi16(_mm_adds_epi16(bs, c32), 6);
+        _mm_store_si128(reinterpret_cast<__m128i*>(planar), _mm_packus_epi16(rs, gs));
+        _mm_store_si128(reinterpret_cast<__m128i*>(planar + 16), _mm_packus_epi16(bs, bs));
+        // SSE2无三通道交织指令，逐像素写出
+        uint8_t* out = rgb + i * 3;
+        for (int k = 0; k < 8; ++k) {
+            out[k * 3 + 0] = planar[k];
+            out[k * 3 + 1] = planar[8 + k];
+            out[k * 3 + 2] = planar[16 + k];
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        yuv_to_rgb(y[i], u[i], v[i], rgb + i * 3);
+    }
+}
+
+/**
+ * @brief 计算输出坐标d对应的源坐标（像素中心对齐），返回7位定点权重
+ */
+void map_coordinate(int d, int src_len, int dst_len, int* i0, int* i1, uint8_t* w, int* nearest) {
+    float s = (d + 0.5f) * src_len / dst_len - 0.5f;
+    s = std::min(std::max(s, 0.0f), static_cast<float>(src_len - 1));
+    int base = static_cast<int>(s);
+    int weight = static_cast<int>(std::lround((s - base) * 128));
+    if (weight == 128) {
+        base++;
+        weight = 0;
+    }
+    *i0 = base;
+    *i1 = std::min(base + 1, src_len - 1);
+    *w = static_cast<uint8_t>(weight);
+    if (nearest) {
+        *nearest = std::min(static_cast<int>(s + 0.5f), src_len - 1);
+    }
+}
+} // namespace
+
+LetterboxInfo compute_letterbox(int src_w, int src_h, int dst_w, int dst_h) {
+    LetterboxInfo info;
+    info.scale = std::min(static_cast<float>(dst_w) / src_w, static_cast<float>(dst_h) / src_h);
+    info.resized_w = std::min(dst_w, std::max(1, static_cast<int>(std::lround(src_w * info.scale))));
+    info.resized_h = std::min(dst_h, std::max(1, static_cast<int>(std::lround(src_h * info.scale))));
+    info.pad_x = (dst_w - info.resized_w) / 2;
+    info.pad_y = (dst_h - info.resized_h) / 2;
+    return info;
+}
+
+bool YuyvLetterbox::configure(int src_w, int src_h, int dst_w, int dst_h, uint8_t pad_value) {
+    if (src_w < 2 || (src_w & 1) || src_h < 1 || dst_w < 1 || dst_h < 1) {
+        return false;
+    }
+    if (src_w == src_w_ && src_h == src_h_ && dst_w == dst_w_ && dst_h == dst_h_ && pad_value == pad_value_) {
+        return true;
+    }
+    src_w_ = src_w;
+    src_h_ = src_h;
+    dst_w_ = dst_w;
+    dst_h_ = dst_h;
+    pad_value_ = pad_value;
+    info_ = compute_letterbox(src_w, src_h, dst_w, dst_h);
+
+    columns_.resize(info_.resized_w);
+    for (int x = 0; x < info_.resized_w; ++x) {
+        int x0, x1, nearest;
+        map_coordinate(x, src_w, info_.resized_w, &x0, &x1, &columns_[x].wx, &nearest);
+        columns_[x].y0 = x0 * 2;
+        columns_[x].y1 = x1 * 2;
+        columns_[x].uv = (nearest >> 1) * 4 + 1;
+    }
+    rows_.resize(info_.resized_h);
+    for (int y = 0; y < info_.resized_h; ++y) {
+        map_coordinate(y, src_h, info_.resized_h, &rows_[y].y0, &rows_[y].y1, &rows_[y].wy, nullptr);
+    }
+
+    blend_line_.resize(src_w * 2);
+    y_line_.resize(info_.resized_w);
+    u_line_.resize(info_.resized_w);
+    v_line_.resize(info_.resized_w);
+    return true;
+}
+
+void YuyvLetterbox::run(const uint8_t* src, int src_stride, uint8_t* dst, int dst_stride) {
+    const int left = info_.pad_x * 3;
+    const int right = (dst_w_ - info_.pad_x - info_.resized_w) * 3;
+    const int width = info_.resized_w;
+    const ColumnMap* columns = columns_.data();
+    uint8_t* y_line = y_line_.data();
+    uint8_t* u_line = u_line_.data();
+    uint8_t* v_line = v_line_.data();
+    for (int y = 0; y < dst_h_; ++y) {
+        uint8_t* out = dst + static_cast<size_t>(y) * dst_stride;
+        int row = y - info_.pad_y;
+        if (row < 0 || row >= info_.resized_h) {
+            memset(out, pad_value_, dst_w_ * 3);
+            continue;
+        }
+
+        // 垂直混合（权重为0时直接使用源行）
+        const RowMap& rm = rows_[row];
+        const uint8_t* line = src + static_cast<size_t>(rm.y0) * src_stride;
+        if (rm.wy) {
+            blend_rows(line, src + static_cast<size_t>(rm.y1) * src_stride, rm.wy,
+                       blend_line_.data(), src_w_ * 2);
+            line = blend_line_.data();
+        }
+
+        // 水平重采样到平面Y/U/V行（uint8_t指针可能互相别名，循环内只使用局部指针）
+        for (int x = 0; x < width; ++x) {
+            const ColumnMap& cm = columns[x];
+            y_line[x] = lerp7(line[cm.y0], line[cm.y1], cm.wx);
+            u_line[x] = line[cm.uv];
+            v_line[x] = line[cm.uv + 2];
+        }
+
+        memset(out, pad_value_, left);
+        convert_line(y_line, u_line, v_line, out + left, width);
+        memset(out + left + width * 3, pad_value_, right);
+    }
+}
+
+void YuyvLetterbox::run_reference(const uint8_t* src, int src_stride, uint8_t* dst, int dst_stride) const {
+    for (int y = 0; y < dst_h_; ++y) {
+        uint8_t* out = dst + static_cast<size_t>(y) * dst_stride;
+        int row = y - info_.pad_y;
+        for (int x = 0; x < dst_w_; ++x) {
+            int col = x - info_.pad_x;
+            if (row < 0 || row >= info_.resized_h || col < 0 || col >= info_.resized_w) {
+                out[x * 3 + 0] = out[x * 3 + 1] = out[x * 3 + 2] = pad_value_;
+                continue;
+            }
+            const RowMap& rm = rows_[row];
+            const ColumnMap& cm = columns_[col];
+            const uint8_t* top = src + static_cast<size_t>(rm.y0) * src_stride;
+            const uint8_t* bottom = src + static_cast<size_t>(rm.y1) * src_stride;
+            auto sample = [&](int offset) { return lerp7(top[offset], bottom[offset], rm.wy); };
+            yuv_to_rgb(lerp7(sample(cm.y0), sample(cm.y1), cm.wx),
+                       sample(cm.uv), sample(cm.uv + 2), out + x * 3);
+        }
+    }
+}
+
+const char* YuyvLetterbox::simd_name() {
+#if LETTERBOX_NEON
+    return "neon";
+#elif LETTERBOX_SSE2
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+
+#if MODULE_TEST
+//g++ -O2 -DMODULE_TEST=1 -o bench_letterbox YuyvLetterbox.cpp -lswscale -lavutil `pkg-config --cflags --libs opencv4`
+// 校验SIMD实现与标量参考逐字节一致，并与原两步流程（sws_scale全帧转RGB + cv::resize）对比耗时
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <opencv2/opencv.hpp>
+extern "C" {
+#include <libswscale/swscale.h>
+}
+
+template <typename F>
+static double time_us(int iterations, F&& f) {
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        f();
+    }
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count() / iterations;
+}
+
+int main(int argc, char** argv) {
+    const int src_w = argc > 2 ? atoi(argv[1]) : 1280;
+    const int src_h = argc > 2 ? atoi(argv[2]) : 720;
+    const int model_w = 640, model_h = 640;
+    const int iterations = 200;
+
+    std::vector<uint8_t> yuyv(src_w * src_h * 2);
+    std::mt19937 rng(1);
+    for (auto& b : yuyv) b = static_cast<uint8_t>(rng());
+
+    YuyvLetterbox letterbox;
+    if (!letterbox.configure(src_w, src_h, model_w, model_h)) {
+        std::cerr << "invalid size" << std::endl;
+        return 1;
+    }
+    const LetterboxInfo& info = letterbox.info();
+    std::cout << src_w << "x" << src_h << " -> " << model_w << "x" << model_h
+              << " scale: " << info.scale << " pad: " << info.pad_x << "," << info.pad_y
+              << " simd: " << YuyvLetterbox::simd_name() << std::endl;
+
+    std::vector<uint8_t> fused(model_w * model_h * 3), reference(model_w * model_h * 3);
+    letterbox.run(yuyv.data(), src_w * 2, fused.data(), model_w * 3);
+    letterbox.run_reference(yuyv.data(), src_w * 2, reference.data(), model_w * 3);
+    size_t mismatched = 0;
+    for (size_t i = 0; i < fused.size(); ++i) {
+        if (fused[i] != reference[i]) mismatched++;
+    }
+    std::cout << "mismatched bytes: " << mismatched << std::endl;
+
+    // 原流程：sws_scale整帧YUYV->RGB24，再cv::resize到模型输入
+    SwsContext* sws = sws_getContext(src_w, src_h, AV_PIX_FMT_YUYV422, src_w, src_h, AV_PIX_FMT_RGB24,
+                                     SWS_BILINEAR, nullptr, nullptr, nullptr);
+    cv::Mat rgb(src_h, src_w, CV_8UC3);
+    double two_step = time_us(iterations, [&]() {
+        const uint8_t* src_data[1] = {yuyv.data()};
+        int src_linesize[1] = {src_w * 2};
+        uint8_t* dst_data[1] = {rgb.data};
+        int dst_linesize[1] = {static_cast<int>(rgb.step)};
+        sws_scale(sws, src_data, src_linesize, 0, src_h, dst_data, dst_linesize);
+        cv::Mat resized;
+        cv::resize(rgb, resized, cv::Size(model_w, model_h));
+    });
+    sws_freeContext(sws);
+
+    double fused_us = time_us(iterations, [&]() {
+        letterbox.run(yuyv.data(), src_w * 2, fused.data(), model_w * 3);
+    });
+    double reference_us = time_us(iterations / 10, [&]() {
+        letterbox.run_reference(yuyv.data(), src_w * 2, reference.data(), model_w * 3);
+    });
+
+    std::cout << "sws_scale + cv::resize: " << two_step << " us/frame" << std::endl;
+    std::cout << "fused (" << YuyvLetterbox::simd_name() << "): " << fused_us << " us/frame" << std::endl;
+    std::cout << "scalar reference: " << reference_us << " us/frame" << std::endl;
+    return mismatched == 0 ? 0 : 1;
+}
+#endif
@@ -0,0 +1,109 @@
+#pragma once
+/**
+ * @file YuyvLetterbox.h
+ * @class YuyvLetterbox
+ * @brief YUYV到模型输入的融合转换（色彩转换+缩放+letterbox一次完成）
+ * @author achene
+ * @date 2025-08-05
+ *
+ * 原流程先由sws_scale将YUYV整帧转换为全分辨率RGB24，再由cv::resize缩放到模型输入尺寸，
+ * 整帧数据被读写两遍且每帧分配新的Mat。本类直接从YUYV逐行生成等比缩放、居中填充后的
+ * RGB24模型输入，中间结果只保留在几行大小的行缓冲中。
+ *
+ * 每个输出行的处理：
+ * 1. 垂直双线性：两行源数据按权重混合（SIMD，整行连续字节）
+ * 2. 水平双线性：按预计算的列映射取亮度，色度取最近的像素对（标量查表）
+ * 3. BT.601有限范围YUV转RGB并交织写出（NEON/SSE2/标量，编译期选择）
+ *
+ * 所有实现使用相同的7位插值权重与6位色彩系数，SIMD结果与run_reference()逐字节一致。
+ * 实例持有行缓冲，非线程安全，每个推理线程（模型实例）各持有一个。
+ */
+#include <cstdint>
+#include <vector>
+
+// letterbox参数：模型输入坐标 = 源图坐标 * scale + pad
+struct LetterboxInfo {
+    float scale = 1.0f;  // 源图到模型输入的等比缩放系数
+    int pad_x = 0;       // 左侧填充像素数
+    int pad_y = 0;       // 上侧填充像素数
+    int resized_w = 0;   // 缩放后有效图像宽度
+    int resized_h = 0;   // 缩放后有效图像高度
+};
+
+/**
+ * @brief 计算等比缩放并居中填充的letterbox参数
+ * @param src_w 源图宽度
+ * @param src_h 源图高度
+ * @param dst_w 模型输入宽度
+ * @param dst_h 模型输入高度
+ */
+LetterboxInfo compute_letterbox(int src_w, int src_h, int dst_w, int dst_h);
+
+class YuyvLetterbox {
+public:
+    /**
+     * @brief 按源尺寸与模型输入尺寸预计算行/列映射（尺寸不变时直接返回）
+     * @param src_w 源图宽度（偶数）
+     * @param src_h 源图高度
+     * @param dst_w 模型输入宽度
+     * @param dst_h 模型输入高度
+     * @param pad_value 填充区域的灰度值（YOLOv5训练时为114）
+     * @return 参数有效返回true，否则返回false
+     */
+    bool configure(int src_w, int src_h, int dst_w, int dst_h, uint8_t pad_value = 114);
+
+    /**
+     * @brief 获取当前letterbox参数（用于检测框映射回源图）
+     */
+    const LetterboxInfo& info() const { return info_; }
+
+    /**
+     * @brief 融合转换（SIMD实现）
+     * @param src YUYV422数据
+     * @param src_stride 源图每行字节数
+     * @param dst 输出RGB24数据（dst_w x dst_h，含填充区域）
+     * @param dst_stride 输出每行字节数
+     */
+    void run(const uint8_t* src, int src_stride, uint8_t* dst, int dst_stride);
+
+    /**
+     * @brief 标量参考实现，逐像素直接按公式计算，用于校验run()与性能对比
+     * 参数同run()
+     */
+    void run_reference(const uint8_t* src, int src_stride, uint8_t* dst, int dst_stride) const;
+
+    /**
+     * @brief 当前编译使用的SIMD实现名称（"neon"/"sse2"/"scalar"）
+     */
+    static const char* simd_name();
+
+private:
+    // 输出列对应的源数据字节偏移与权重
+    struct ColumnMap {
+        int y0;       // 左侧亮度字节偏移
+        int y1;       // 右侧亮度字节偏移
+        int uv;       // 最近像素对的U字节偏移（V在其后2字节）
+        uint8_t wx;   // 右侧权重（0~128）
+    };
+    // 输出行对应的源行与权重
+    struct RowMap {
+        int y0;
+        int y1;
+        uint8_t wy;   // 下方行权重（0~128）
+    };
+
+    int src_w_ = 0;
+    int src_h_ = 0;
+    int dst_w_ = 0;
+    int dst_h_ = 0;
+    uint8_t pad_value_ = 114;
+    LetterboxInfo info_;
+    std::vector<ColumnMap> columns_;
+    std::vector<RowMap> rows_;
+
+    // 行缓冲：垂直混合后的YUYV行，以及水平重采样后的Y/U/V
+    std::vector<uint8_t> blend_line_;
+    std::vector<uint8_t> y_line_;
+    std::vector<uint8_t> u_line_;
+    std::vector<uint8_t> v_line_;
+};
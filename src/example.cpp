@@ -1,5 +1,5 @@
 
-#include "EncoderStreamer.h"
+#include "StreamManager.h"
 #include "lua_config.h"
 #include <vector>
 #include <memory>
@@ -7,66 +7,150 @@
 #include <csignal>
 
 std::atomic<bool> running(true);
+std::atomic<bool> dump_trace_requested(false);
 
 void signal_handler(int signum) {
     running = false;
 }
 
+// SIGUSR1：请求导出分阶段trace，由主循环执行
+void trace_signal_handler(int signum) {
+    dump_trace_requested = true;
+}
+
 int main() {
     // 设置信号处理
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
+    signal(SIGUSR1, trace_signal_handler);
     
 
     //v4l2-ctl -d /dev/video0 --list-formats-ext 查看摄像头支持格式
     std::vector<CameraConfig> camera_configs = read_camera_configs("../config/Config.lua");
+    PipelineConfig pipeline_config = read_pipeline_config("../config/Config.lua");
     for (size_t i = 0; i < camera_configs.size(); ++i) {
             std::cout << "摄像头 " << i << ":" << std::endl;
             std::cout << "  device: " << camera_configs[i].device << std::endl;
             std::cout << "  rtmp_url: " << camera_configs[i].rtmp_url << std::endl;
             std::cout << "  分辨率: " << camera_configs[i].width << "x" << camera_configs[i].height << std::endl;
             std::cout << "  fps: " << camera_configs[i].fps << std::endl;
+            std::cout << "  zero_copy: " << camera_configs[i].zero_copy << std::endl;
+            std::cout << "  pixel_format: " << camera_configs[i].pixel_format << std::endl;
+            std::cout << "  memory: " << camera_configs[i].memory
+                      << " buffer_count: " << camera_configs[i].buffer_count
+                      << " queue_depth: " << camera_configs[i].queue_depth
+                      << " overload_policy: " << camera_configs[i].overload_policy << std::endl;
+            std::cout << "  source: " << camera_configs[i].source
+                      << (camera_configs[i].realtime ? " (realtime)" : " (as fast as possible)") << std::endl;
         }
     
-    // 直接创建EncoderStreamer
-    EncoderStreamer stream1(
-        camera_configs[0].rtmp_url,
-        camera_configs[0].device,
-        camera_configs[0].width,
-        camera_configs[0].height,
-        camera_configs[0].fps,
-        0  // camera_id
-    );
-    
-    // EncoderStreamer stream2(
-    //     camera_configs[1].rtmp_url,
-    //     camera_configs[1].device,
-    //     camera_configs[1].width,
-    //     camera_configs[1].height,
-    //     camera_configs[1].fps,
-    //     1  // camera_id
-    // );
-
-    // 初始化并启动
-    if (stream1.initialize(ModelType::Test, "../weight/rk3566/yolov5s_relu.rknn", 2, 2)) {
-        std::cout << "stream1.initialize" << std::endl;
-        stream1.start();
+    // 所有摄像头共享一组推理线程与一个模型池
+    StreamManager manager(pipeline_config);
+    if (!manager.start()) {
+        std::cerr << "Failed to start stream manager" << std::endl;
+        return 1;
+    }
+    for (size_t i = 0; i < camera_configs.size(); ++i) {
+        if (manager.add_stream(camera_configs[i]) < 0) {
+            std::cerr << "Failed to start camera " << i << " (" << camera_configs[i].device << ")" << std::endl;
+        }
     }
-    // if (stream2.initialize(ModelType::YoloV5, "../weight/rk3566/yolov5s_relu.rknn", 2, 2)) {
-    //     stream2.start();
-    // }
 
+    std::cout << "CPU topology: " << CpuTopology::instance().describe() << std::endl;
 
+    // Prometheus指标端点：抓取时汇总各路流的计数器
+    std::unique_ptr<MetricsServer> metrics_server;
+    if (pipeline_config.metrics_port > 0) {
+        metrics_server.reset(new MetricsServer(pipeline_config.metrics_port, pipeline_config.metrics_bind));
+        metrics_server->set_handler([&manager]() {
+            return MetricsServer::format_stream_metrics(manager.metrics());
+        });
+        if (metrics_server->start()) {
+            std::cout << "metrics: http://" << pipeline_config.metrics_bind << ":"
+                      << metrics_server->port() << "/metrics" << std::endl;
+        } else {
+            metrics_server.reset();
+        }
+    }
+    int report_count = 0;
     while (running) {
         // 监控状态或处理其他任务
         std::this_thread::sleep_for(std::chrono::seconds(1));
         
         // 输出状态信息
-        std::cout << "Running... (" << 2 << " streams active)" << std::endl;
+        std::vector<std::shared_ptr<EncoderStreamer>> streams = manager.streams();
+        std::cout << "Running... (" << streams.size() << " streams active)"
+                  << " idle models: " << manager.model_pool()->idle()
+                  << "/" << manager.model_pool()->size() << std::endl;
+        for (const std::shared_ptr<EncoderStreamer>& stream : streams) {
+            FramePoolStats pool_stats = stream->frame_pool_stats();
+            StreamStats stream_stats = stream->stream_stats();
+            std::cout << "  [" << stream->camera_id() << "] frame pool hits: " << pool_stats.hits
+                      << " misses: " << pool_stats.misses
+                      << " in flight: " << pool_stats.in_flight
+                      << " first frame(ms): " << stream_stats.time_to_first_frame_ms << std::endl;
+            std::cout << "  [" << stream->camera_id() << "] captured: " << stream_stats.captured
+                      << " encoded: " << stream_stats.encoded
+                      << " inferred: " << stream_stats.inferred
+                      << " driver dropped: " << stream_stats.driver_dropped
+                      << " pipeline dropped: " << stream_stats.pipeline_dropped
+                      << " (overload: " << stream_stats.overload_dropped
+                      << " reorder late: " << stream_stats.reorder_late
+                      << " reorder skipped: " << stream_stats.reorder_skipped
+                      << " reorder overflow: " << stream_stats.reorder_overflow << ")"
+                      << " capture->encode(ms) p50: " << stream_stats.capture_to_encode.p50_us / 1000
+                      << " p99: " << stream_stats.capture_to_encode.p99_us / 1000 << std::endl;
+            ScheduleStats schedule = manager.schedule_stats(stream->camera_id());
+            std::cout << "  [" << stream->camera_id() << "] scheduled: " << schedule.served
+                      << " rate limited: " << schedule.rate_limited
+                      << " npu time(ms): " << schedule.busy_ns / 1000000
+                      << " queue wait(ms) p50: " << schedule.wait.p50_us / 1000
+                      << " p99: " << schedule.wait.p99_us / 1000 << std::endl;
+        }
+        InferenceBatcherPtr batcher = manager.batcher();
+        if (batcher) {
+            BatchStats batch = batcher->stats();
+            std::cout << "  batches: " << batch.batches << " frames: " << batch.frames
+                      << " mean batch: " << batch.mean_batch << " full: " << batch.full_batches
+                      << " batch wait(ms) p50: " << batch.wait.p50_us / 1000 << " p99: " << batch.wait.p99_us / 1000
+                      << " batch run(ms) p50: " << batch.run.p50_us / 1000 << std::endl;
+        }
+        std::shared_ptr<CaptureReactor> reactor = manager.reactor();
+        if (reactor) {
+            LatencySnapshot lat = reactor->wakeup_latency();
+            std::cout << "  capture reactor wakeup->dispatch(us) p50: " << lat.p50_us
+                      << " p99: " << lat.p99_us << " max: " << lat.max_us << std::endl;
+        }
+        if (dump_trace_requested.exchange(false)) {
+            int written = manager.dump_traces(pipeline_config.trace_path);
+            std::cout << "  trace written for " << written << " streams to " << pipeline_config.trace_path << std::endl;
+        }
+        // 每10秒输出各阶段延迟（排队等待与处理时间）以及各流水线线程的CPU时间与所在CPU
+        if (++report_count % 10 == 0) {
+            for (const std::shared_ptr<EncoderStreamer>& stream : streams) {
+                StageLatency latency = stream->stage_latency();
+                for (int i = 0; i < static_cast<int>(TraceSpan::Count); ++i) {
+                    const LatencySnapshot& span = latency.spans[i];
+                    std::cout << "  [" << stream->camera_id() << "] stage "
+                              << StageTracer::span_name(static_cast<TraceSpan>(i))
+                              << "(ms) p50: " << span.p50_us / 1000 << " p90: " << span.p90_us / 1000
+                              << " p99: " << span.p99_us / 1000 << " max: " << span.max_us / 1000 << std::endl;
+                }
+            }
+            for (const ThreadCpuUsage& usage : ThreadPlacement::cpu_usage()) {
+                std::cout << "  thread " << usage.name << " (tid " << usage.tid << ")"
+                          << " cpu time(ms): " << usage.cpu_ms
+                          << " last cpu: " << usage.last_cpu
+                          << " cpus: " << (usage.cpus.empty() ? "any" : usage.cpus)
+                          << " policy: " << usage.policy << std::endl;
+            }
+        }
     }
 
-    stream1.stop();
-    // stream2.stop();
+    if (metrics_server) {
+        metrics_server->stop();
+    }
+    manager.stop();
     
     std::cout << "All streams stopped. Exiting." << std::endl;
     return 0;
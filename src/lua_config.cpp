@@ -9,11 +9,8 @@ extern "C"
 
 
 
-// 从Lua配置文件读取摄像头配置列表
-std::vector<CameraConfig> read_camera_configs(const std::string& lua_file) {
-    std::vector<CameraConfig> configs;
-
-    // 创建Lua状态机
+// 创建Lua状态机并执行配置文件，失败时抛出异常
+static lua_State* load_config_file(const std::string& lua_file) {
     lua_State *L = luaL_newstate();
     luaopen_base(L);
     luaopen_string(L);
@@ -35,6 +32,51 @@ std::vector<CameraConfig> read_camera_configs(const std::string& lua_file) {
         lua_close(L);
         throw std::runtime_error("配置文件执行失败: " + err_msg);
     }
+    return L;
+}
+
+// 读取栈顶放置表中名为name的阶段配置（可选），字段缺省时保持默认值
+static void read_stage_placement(lua_State *L, const char* name, StagePlacement& placement) {
+    lua_getfield(L, -1, name);
+    if (lua_istable(L, -1)) {
+        lua_getfield(L, -1, "cpus");
+        if (lua_isstring(L, -1)) {
+            placement.cpus = lua_tostring(L, -1);
+        }
+        lua_pop(L, 1);
+
+        lua_getfield(L, -1, "policy");
+        if (lua_isstring(L, -1)) {
+            placement.policy = lua_tostring(L, -1);
+        }
+        lua_pop(L, 1);
+
+        lua_getfield(L, -1, "priority");
+        if (lua_isinteger(L, -1)) {
+            placement.priority = lua_tointeger(L, -1);
+        }
+        lua_pop(L, 1);
+
+        lua_getfield(L, -1, "nice");
+        if (lua_isinteger(L, -1)) {
+            placement.nice = lua_tointeger(L, -1);
+        }
+        lua_pop(L, 1);
+
+        lua_getfield(L, -1, "isolate");
+        if (lua_isboolean(L, -1)) {
+            placement.isolate = lua_toboolean(L, -1);
+        }
+        lua_pop(L, 1);
+    }
+    lua_pop(L, 1);
+}
+
+// 从Lua配置文件读取摄像头配置列表
+std::vector<CameraConfig> read_camera_configs(const std::string& lua_file) {
+    std::vector<CameraConfig> configs;
+
+    lua_State *L = load_config_file(lua_file);
 
     lua_getglobal(L, "camera_configs");
     if (!lua_istable(L, -1)) {
@@ -98,6 +140,128 @@ std::vector<CameraConfig> read_camera_configs(const std::string& lua_file) {
         }
         lua_pop(L, 1);
 
+        // 读取zero_copy字段（可选）
+        lua_getfield(L, -1, "zero_copy");
+        if (lua_isboolean(L, -1)) {
+            config.zero_copy = lua_toboolean(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取pixel_format字段（可选）
+        lua_getfield(L, -1, "pixel_format");
+        if (lua_isstring(L, -1)) {
+            config.pixel_format = lua_tostring(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取decode_workers字段（可选）
+        lua_getfield(L, -1, "decode_workers");
+        if (lua_isinteger(L, -1)) {
+            config.decode_workers = lua_tointeger(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取source字段（可选）
+        lua_getfield(L, -1, "source");
+        if (lua_isstring(L, -1)) {
+            config.source = lua_tostring(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取realtime字段（可选）
+        lua_getfield(L, -1, "realtime");
+        if (lua_isboolean(L, -1)) {
+            config.realtime = lua_toboolean(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取loop字段（可选）
+        lua_getfield(L, -1, "loop");
+        if (lua_isboolean(L, -1)) {
+            config.loop = lua_toboolean(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取buffer_count字段（可选）
+        lua_getfield(L, -1, "buffer_count");
+        if (lua_isinteger(L, -1)) {
+            config.buffer_count = lua_tointeger(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取queue_depth字段（可选）
+        lua_getfield(L, -1, "queue_depth");
+        if (lua_isinteger(L, -1)) {
+            config.queue_depth = lua_tointeger(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取overload_policy字段（可选）
+        lua_getfield(L, -1, "overload_policy");
+        if (lua_isstring(L, -1)) {
+            config.overload_policy = lua_tostring(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取memory字段（可选）
+        lua_getfield(L, -1, "memory");
+        if (lua_isstring(L, -1)) {
+            config.memory = lua_tostring(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取infer_interval字段（可选）
+        lua_getfield(L, -1, "infer_interval");
+        if (lua_isinteger(L, -1)) {
+            config.infer_interval = lua_tointeger(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取reorder_hold_ms字段（可选）
+        lua_getfield(L, -1, "reorder_hold_ms");
+        if (lua_isinteger(L, -1)) {
+            config.reorder_hold_ms = lua_tointeger(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取weight字段（可选）
+        lua_getfield(L, -1, "weight");
+        if (lua_isinteger(L, -1)) {
+            config.weight = lua_tointeger(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取priority字段（可选）
+        lua_getfield(L, -1, "priority");
+        if (lua_isinteger(L, -1)) {
+            config.priority = lua_tointeger(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取max_infer_fps字段（可选）
+        lua_getfield(L, -1, "max_infer_fps");
+        if (lua_isnumber(L, -1)) {
+            config.max_infer_fps = lua_tonumber(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取render_detections字段（可选）
+        lua_getfield(L, -1, "render_detections");
+        if (lua_isboolean(L, -1)) {
+            config.render_detections = lua_toboolean(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取placement字段（可选）
+        lua_getfield(L, -1, "placement");
+        if (lua_istable(L, -1)) {
+            read_stage_placement(L, "capture", config.placement.capture);
+            read_stage_placement(L, "decode", config.placement.decode);
+            read_stage_placement(L, "inference", config.placement.inference);
+            read_stage_placement(L, "encode", config.placement.encode);
+        }
+        lua_pop(L, 1);
+
         configs.push_back(config);
         lua_pop(L, 1);  // 弹出当前配置表
 
@@ -107,6 +271,116 @@ std::vector<CameraConfig> read_camera_configs(const std::string& lua_file) {
     return configs;
 }
 
+// 从Lua配置文件读取全局流水线配置，pipeline表不存在时使用默认值
+PipelineConfig read_pipeline_config(const std::string& lua_file) {
+    PipelineConfig config;
+
+    lua_State *L = load_config_file(lua_file);
+
+    lua_getglobal(L, "pipeline");
+    if (lua_istable(L, -1)) {
+        // 读取capture_reactor_shards字段（可选）
+        lua_getfield(L, -1, "capture_reactor_shards");
+        if (lua_isinteger(L, -1)) {
+            config.capture_reactor_shards = lua_tointeger(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取dma_heap字段（可选）
+        lua_getfield(L, -1, "dma_heap");
+        if (lua_isstring(L, -1)) {
+            config.dma_heap = lua_tostring(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取trace_path字段（可选）
+        lua_getfield(L, -1, "trace_path");
+        if (lua_isstring(L, -1)) {
+            config.trace_path = lua_tostring(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取metrics_port字段（可选）
+        lua_getfield(L, -1, "metrics_port");
+        if (lua_isinteger(L, -1)) {
+            config.metrics_port = lua_tointeger(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取metrics_bind字段（可选）
+        lua_getfield(L, -1, "metrics_bind");
+        if (lua_isstring(L, -1)) {
+            config.metrics_bind = lua_tostring(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取model字段（可选）
+        lua_getfield(L, -1, "model");
+        if (lua_isstring(L, -1)) {
+            config.model = lua_tostring(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取model_path字段（可选）
+        lua_getfield(L, -1, "model_path");
+        if (lua_isstring(L, -1)) {
+            config.model_path = lua_tostring(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取inference_workers字段（可选）
+        lua_getfield(L, -1, "inference_workers");
+        if (lua_isinteger(L, -1)) {
+            config.inference_workers = lua_tointeger(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取model_instances字段（可选）
+        lua_getfield(L, -1, "model_instances");
+        if (lua_isinteger(L, -1)) {
+            config.model_instances = lua_tointeger(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取batch_size字段（可选）
+        lua_getfield(L, -1, "batch_size");
+        if (lua_isinteger(L, -1)) {
+            config.batch_size = lua_tointeger(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取batch_window_us字段（可选）
+        lua_getfield(L, -1, "batch_window_us");
+        if (lua_isinteger(L, -1)) {
+            config.batch_window_us = lua_tointeger(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取async_inference字段（可选）
+        lua_getfield(L, -1, "async_inference");
+        if (lua_isboolean(L, -1)) {
+            config.async_inference = lua_toboolean(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取zero_copy_inference字段（可选）
+        lua_getfield(L, -1, "zero_copy_inference");
+        if (lua_isboolean(L, -1)) {
+            config.zero_copy_inference = lua_toboolean(L, -1);
+        }
+        lua_pop(L, 1);
+
+        // 读取reactor_placement字段（可选）
+        read_stage_placement(L, "reactor_placement", config.reactor_placement);
+
+        // 读取inference_placement字段（可选）
+        read_stage_placement(L, "inference_placement", config.inference_placement);
+    }
+    lua_pop(L, 1);
+    lua_close(L);
+    return config;
+}
+
 #if 0
 
 int main() {
@@ -2,6 +2,7 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include "ThreadPlacement.h"
 
 struct CameraConfig {
     std::string device;
@@ -9,6 +10,43 @@ struct CameraConfig {
     int width;
     int height;
     int fps;
+    bool zero_copy = false;  // 可选：零拷贝采集模式
+    std::string pixel_format = "YUYV";  // 可选：采集格式（YUYV/MJPG/NV12等四字符格式名）
+    int decode_workers = 2;  // 可选：MJPEG解码线程数
+    std::string source = "v4l2";  // 可选：帧源类型（v4l2/file/synthetic），file时device为录像文件路径
+    bool realtime = true;    // 可选：回放/合成源按实时节拍出帧，false尽快出帧
+    bool loop = true;        // 可选：回放源文件结束后循环
+    int buffer_count = 4;    // 可选：V4L2缓冲区环深度
+    int queue_depth = 100;   // 可选：推理输入队列深度
+    std::string overload_policy = "block";  // 可选：推理过载策略（block/drop_oldest/drop_newest/latest）
+    std::string memory = "mmap";  // 可选：采集缓冲区类型（mmap/dmabuf/userptr）
+    int infer_interval = 1;  // 可选：推理间隔，1每帧推理，N>1每N帧推理一帧其余叠加最近结果，0有空闲模型即推理
+    int reorder_hold_ms = 200;  // 可选：编码前重排等待缺失帧的最长时间（毫秒）
+    int weight = 1;  // 可选：共享推理时同一优先级内的推理时间权重
+    int priority = 0;  // 可选：共享推理优先级，越大越优先
+    double max_infer_fps = 0;  // 可选：最大推理帧率，0表示不限制
+    bool render_detections = true;  // 可选：检测框画到推流画面上，false时只输出检测元数据
+    PipelinePlacement placement;  // 可选：各阶段线程的CPU亲和性与调度策略
 };
 
-std::vector<CameraConfig> read_camera_configs(const std::string& lua_file);
\ No newline at end of file
+// 全局流水线配置（配置文件中的pipeline表，可省略）
+struct PipelineConfig {
+    int capture_reactor_shards = 0;  // 可选：共享采集反应器分片数，0表示每路摄像头独立采集线程
+    std::string dma_heap = "/dev/dma_heap/system";  // 可选：流水线缓冲区分配使用的dma-heap设备
+    StagePlacement reactor_placement;  // 可选：共享采集反应器线程的CPU亲和性与调度策略
+    std::string trace_path = "/tmp/pipeline_trace.json";  // 可选：收到SIGUSR1时导出Chrome trace的路径
+    int metrics_port = 0;  // 可选：Prometheus指标端点端口，0表示关闭
+    std::string metrics_bind = "127.0.0.1";  // 可选：指标端点监听地址
+    std::string model = "test";  // 可选：模型类型（yolov5/test），所有摄像头共用
+    std::string model_path = "../weight/rk3566/yolov5s_relu.rknn";  // 可选：模型文件路径
+    int inference_workers = 2;  // 可选：所有摄像头共享的推理线程数
+    int model_instances = 2;  // 可选：所有摄像头共享的模型实例数（模型只加载这么多份）
+    StagePlacement inference_placement;  // 可选：共享推理线程的CPU亲和性与调度策略
+    int batch_size = 1;  // 可选：跨流批量推理一批最多帧数，1表示不批量
+    int batch_window_us = 2000;  // 可选：凑批窗口（微秒），不足一批时最早一帧最多等待的时间
+    bool async_inference = false;  // 可选：模型异步执行，预处理/后处理与NPU推理重叠
+    bool zero_copy_inference = false;  // 可选：NPU输入输出零拷贝，预处理直接写入、后处理直接读取NPU内存
+};
+
+std::vector<CameraConfig> read_camera_configs(const std::string& lua_file);
+PipelineConfig read_pipeline_config(const std::string& lua_file);
\ No newline at end of file
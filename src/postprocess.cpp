@@ -19,9 +19,21 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <set>
+#include <algorithm>
 #include <vector>
 
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define POSTPROCESS_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define POSTPROCESS_SSE2 1
+#endif
+
+#ifndef MODULE_TEST
+#define MODULE_TEST 0
+#endif
+
 static const char* labels[] = {
     "person", "bicycle", "car", "motorcycle", "airplane", "bus", "train", "truck", "boat", "traffic light",
     "fire hydrant", "stop sign", "parking meter", "bench", "bird", "cat", "dog", "horse", "sheep", "cow",
@@ -34,9 +46,13 @@ static const char* labels[] = {
     "hair drier", "toothbrush"
 };
 
-const int anchor0[6] = {10, 13, 16, 30, 33, 23};
-const int anchor1[6] = {30, 61, 62, 45, 59, 119};
-const int anchor2[6] = {116, 90, 156, 198, 373, 326};
+// 标准的三层stride与YOLOv5默认anchor（每层3个，宽高交替）
+static constexpr int kStrides[HEAD_MAX_BRANCH] = {8, 16, 32};
+static constexpr int kAnchors[HEAD_MAX_BRANCH][6] = {
+    {10, 13, 16, 30, 33, 23}, {30, 61, 62, 45, 59, 119}, {116, 90, 156, 198, 373, 326}};
+// YOLOv8 DFL分箱数上限，编译期特化版本按16
+static const int kMaxRegMax = 32;
+static const int kRegMax = 16;
 
 inline static int clamp(float val, int min, int max) { return val > min ? (val < max ? val : max) : min; }
 
@@ -50,75 +66,96 @@ static float CalculateOverlap(float xmin0, float ymin0, float xmax0, float ymax0
   return u <= 0.f ? 0.f : (i / u);
 }
 
-static int nms(int validCount, std::vector<float> &outputLocations, std::vector<int> classIds, std::vector<int> &order,
-               int filterId, float threshold)
+// 按类别分桶的NMS：ctx->candidates中的候选按类别计数分桶，每个桶内按概率降序排序后贪心抑制，
+// 只与同类别的候选比较；各类别保留的框合并后部分排序取概率最高的max_keep个，下标按概率降序写入ctx->kept
+// 中间数组均取自ctx的缓冲区，容量稳定后不再分配内存
+static int nms_per_class(post_process_ctx_t *ctx, float threshold, int max_keep)
 {
-  for (int i = 0; i < validCount; ++i)
+  const std::vector<candidate_t> &candidates = ctx->candidates;
+  const int count = static_cast<int>(candidates.size());
+  // 概率相同时按候选下标排序，结果与排序算法无关
+  auto higher = [&candidates](int a, int b) {
+    return candidates[a].prob > candidates[b].prob || (candidates[a].prob == candidates[b].prob && a < b);
+  };
+
+  const int classes = ctx->head.num_classes;
+  std::vector<int> &bucket = ctx->bucket;
+  bucket.assign(classes + 1, 0);
+  for (const candidate_t &candidate : candidates)
+  {
+    bucket[candidate.class_id + 1]++;
+  }
+  for (int c = 0; c < classes; c++)
+  {
+    bucket[c + 1] += bucket[c];
+  }
+  std::vector<int> &fill = ctx->fill;
+  fill.assign(bucket.begin(), bucket.end() - 1);
+  std::vector<int> &order = ctx->order;
+  order.resize(count);
+  for (int i = 0; i < count; i++)
+  {
+    order[fill[candidates[i].class_id]++] = i;
+  }
+
+  std::vector<uint8_t> &removed = ctx->removed;
+  removed.assign(count, 0);
+  // 面积按CalculateOverlap()的算式预先计算，比较结果与逐对计算一致
+  std::vector<double> &area = ctx->area;
+  area.resize(count);
+  for (int i = 0; i < count; i++)
+  {
+    const candidate_t &candidate = candidates[i];
+    area[i] = (candidate.x + candidate.w - candidate.x + 1.0) * (candidate.y + candidate.h - candidate.y + 1.0);
+  }
+  std::vector<int> &kept = ctx->kept;
+  kept.clear();
+  for (int c = 0; c < classes; c++)
   {
-    if (order[i] == -1 || classIds[i] != filterId)
+    int *begin = order.data() + bucket[c];
+    int *end = order.data() + bucket[c + 1];
+    if (begin == end)
     {
       continue;
     }
-    int n = order[i];
-    for (int j = i + 1; j < validCount; ++j)
+    std::sort(begin, end, higher);
+    // 同类别保留max_keep个之后的框不可能进入最终结果
+    int kept_in_class = 0;
+    for (int *x = begin; x < end && kept_in_class < max_keep; ++x)
     {
-      int m = order[j];
-      if (m == -1 || classIds[i] != filterId)
+      if (removed[*x])
       {
         continue;
       }
-      float xmin0 = outputLocations[n * 4 + 0];
-      float ymin0 = outputLocations[n * 4 + 1];
-      float xmax0 = outputLocations[n * 4 + 0] + outputLocations[n * 4 + 2];
-      float ymax0 = outputLocations[n * 4 + 1] + outputLocations[n * 4 + 3];
-
-      float xmin1 = outputLocations[m * 4 + 0];
-      float ymin1 = outputLocations[m * 4 + 1];
-      float xmax1 = outputLocations[m * 4 + 0] + outputLocations[m * 4 + 2];
-      float ymax1 = outputLocations[m * 4 + 1] + outputLocations[m * 4 + 3];
-
-      float iou = CalculateOverlap(xmin0, ymin0, xmax0, ymax0, xmin1, ymin1, xmax1, ymax1);
-
-      if (iou > threshold)
+      const candidate_t &a = candidates[*x];
+      const float ax2 = a.x + a.w;
+      const float ay2 = a.y + a.h;
+      kept.push_back(*x);
+      kept_in_class++;
+      for (int *y = x + 1; y < end; ++y)
       {
-        order[j] = -1;
+        if (removed[*y])
+        {
+          continue;
+        }
+        const candidate_t &b = candidates[*y];
+        // 与CalculateOverlap()相同的算式，fmax/fmin换为可内联的std::max/std::min（有限值时结果相同）
+        float w = std::max(0.0, std::min(ax2, b.x + b.w) - std::max(a.x, b.x) + 1.0);
+        float h = std::max(0.0, std::min(ay2, b.y + b.h) - std::max(a.y, b.y) + 1.0);
+        float i = w * h;
+        float u = area[*x] + area[*y] - i;
+        if ((u <= 0.f ? 0.f : (i / u)) > threshold)
+        {
+          removed[*y] = 1;
+        }
       }
     }
   }
-  return 0;
-}
 
-static int quick_sort_indice_inverse(std::vector<float> &input, int left, int right, std::vector<int> &indices)
-{
-  float key;
-  int key_index;
-  int low = left;
-  int high = right;
-  if (left < right)
-  {
-    key_index = indices[left];
-    key = input[left];
-    while (low < high)
-    {
-      while (low < high && input[high] <= key)
-      {
-        high--;
-      }
-      input[low] = input[high];
-      indices[low] = indices[high];
-      while (low < high && input[low] >= key)
-      {
-        low++;
-      }
-      input[high] = input[low];
-      indices[high] = indices[low];
-    }
-    input[low] = key;
-    indices[low] = key_index;
-    quick_sort_indice_inverse(input, left, low - 1, indices);
-    quick_sort_indice_inverse(input, low + 1, right, indices);
-  }
-  return low;
+  const int keep = std::min(static_cast<int>(kept.size()), max_keep);
+  std::partial_sort(kept.begin(), kept.begin() + keep, kept.end(), higher);
+  kept.resize(keep);
+  return keep;
 }
 
 inline static int32_t __clip(float val, float min, float max)
@@ -136,40 +173,119 @@ static int8_t qnt_f32_to_affine(float f32, int32_t zp, float scale)
 
 static float deqnt_affine_to_f32(int8_t qnt, int32_t zp, float scale) { return ((float)qnt - (float)zp) * scale; }
 
-static int process(int8_t *input, int *anchor, int grid_h, int grid_w, int height, int width, int stride,
-                   std::vector<float> &boxes, std::vector<float> &objProbs, std::vector<int> &classId, float threshold,
-                   int32_t zp, float scale)
+// 通道c在网格位置p的元素下标（见tensor_layout_t），NCHW时即c * grid_h * grid_w + p
+static inline int element_at(const tensor_layout_t &layout, int c, int p)
+{
+  return (c / layout.c2) * layout.plane + p * layout.c2 + c % layout.c2;
+}
+
+// anchor-based/YOLOX的框：YOLOv5的xy为网格偏移×2-0.5、wh为(×2)²倍anchor，YOLOX的xy为网格偏移、wh为exp后×stride
+static inline void anchor_box(head_type_t type, float x, float y, float w, float h, int i, int j, int stride,
+                              const int *anchor, candidate_t *candidate)
+{
+  float box_x, box_y, box_w, box_h;
+  if (type == HEAD_YOLOV5)
+  {
+    box_x = x * 2.0 - 0.5;
+    box_y = y * 2.0 - 0.5;
+    box_w = w * 2.0;
+    box_h = h * 2.0;
+    box_x = (box_x + j) * (float)stride;
+    box_y = (box_y + i) * (float)stride;
+    box_w = box_w * box_w * (float)anchor[0];
+    box_h = box_h * box_h * (float)anchor[1];
+  }
+  else
+  {
+    box_x = (x + j) * (float)stride;
+    box_y = (y + i) * (float)stride;
+    box_w = expf(w) * (float)stride;
+    box_h = expf(h) * (float)stride;
+  }
+  box_x -= (box_w / 2.0);
+  box_y -= (box_h / 2.0);
+  candidate->x = box_x;
+  candidate->y = box_y;
+  candidate->w = box_w;
+  candidate->h = box_h;
+}
+
+// DFL框回归：每条边reg_max个分箱按softmax加权求期望，得到左、上、右、下四条边到网格中心的距离（网格为单位）
+// offset为各分箱通道在网格位置0的下标
+static inline void dfl_distances(const float *deq, const int8_t *input, const int *offset, int p, int c2, int reg_max,
+                                 float *distance)
+{
+  float values[kMaxRegMax];
+  for (int side = 0; side < 4; side++)
+  {
+    const int *channel = offset + side * reg_max;
+    float max = deq[input[channel[0] + p * c2]];
+    for (int k = 0; k < reg_max; k++)
+    {
+      values[k] = deq[input[channel[k] + p * c2]];
+      max = std::max(max, values[k]);
+    }
+    float sum = 0;
+    float weighted = 0;
+    for (int k = 0; k < reg_max; k++)
+    {
+      const float e = expf(values[k] - max);
+      sum += e;
+      weighted += e * k;
+    }
+    distance[side] = weighted / sum;
+  }
+}
+
+static inline void dfl_box(const float *distance, int i, int j, int stride, candidate_t *candidate)
+{
+  const float x1 = (j + 0.5f - distance[0]) * stride;
+  const float y1 = (i + 0.5f - distance[1]) * stride;
+  const float x2 = (j + 0.5f + distance[2]) * stride;
+  const float y2 = (i + 0.5f + distance[3]) * stride;
+  candidate->x = x1;
+  candidate->y = y1;
+  candidate->w = x2 - x1;
+  candidate->h = y2 - y1;
+}
+
+// 各通道在网格位置0的下标，逐元素寻址时不再做除法
+static inline void channel_offsets(const tensor_layout_t &layout, int channels, int *offset)
+{
+  for (int c = 0; c < channels; c++)
+  {
+    offset[c] = (c / layout.c2) * layout.plane + c % layout.c2;
+  }
+}
+
+// YOLOv5/YOLOX一层输出的标量参考解码，index为输出下标
+static int process_anchor_reference(post_process_ctx_t *ctx, int index, int8_t *input, const int *anchor, int grid_h,
+                                    int grid_w, int stride, float threshold, const tensor_layout_t &layout)
 {
+  const head_type_t type = ctx->head.type;
+  const int classes = ctx->head.num_classes;
+  const int props = 5 + classes;
+  const int anchors = type == HEAD_YOLOV5 ? 3 : 1;
+  const int32_t zp = ctx->zp[index];
+  const float scale = ctx->scale[index];
   int validCount = 0;
-  int grid_len = grid_h * grid_w;
   int8_t thres_i8 = qnt_f32_to_affine(threshold, zp, scale);
-  for (int a = 0; a < 3; a++)
+  for (int a = 0; a < anchors; a++)
   {
     for (int i = 0; i < grid_h; i++)
     {
       for (int j = 0; j < grid_w; j++)
       {
-        int8_t box_confidence = input[(PROP_BOX_SIZE * a + 4) * grid_len + i * grid_w + j];
+        const int p = i * grid_w + j;
+        const int base = props * a;
+        int8_t box_confidence = input[element_at(layout, base + 4, p)];
         if (box_confidence >= thres_i8)
         {
-          int offset = (PROP_BOX_SIZE * a) * grid_len + i * grid_w + j;
-          int8_t *in_ptr = input + offset;
-          float box_x = (deqnt_affine_to_f32(*in_ptr, zp, scale)) * 2.0 - 0.5;
-          float box_y = (deqnt_affine_to_f32(in_ptr[grid_len], zp, scale)) * 2.0 - 0.5;
-          float box_w = (deqnt_affine_to_f32(in_ptr[2 * grid_len], zp, scale)) * 2.0;
-          float box_h = (deqnt_affine_to_f32(in_ptr[3 * grid_len], zp, scale)) * 2.0;
-          box_x = (box_x + j) * (float)stride;
-          box_y = (box_y + i) * (float)stride;
-          box_w = box_w * box_w * (float)anchor[a * 2];
-          box_h = box_h * box_h * (float)anchor[a * 2 + 1];
-          box_x -= (box_w / 2.0);
-          box_y -= (box_h / 2.0);
-
-          int8_t maxClassProbs = in_ptr[5 * grid_len];
+          int8_t maxClassProbs = input[element_at(layout, base + 5, p)];
           int maxClassId = 0;
-          for (int k = 1; k < OBJ_CLASS_NUM; ++k)
+          for (int k = 1; k < classes; ++k)
           {
-            int8_t prob = in_ptr[(5 + k) * grid_len];
+            int8_t prob = input[element_at(layout, base + 5 + k, p)];
             if (prob > maxClassProbs)
             {
               maxClassId = k;
@@ -178,13 +294,16 @@ static int process(int8_t *input, int *anchor, int grid_h, int grid_w, int heigh
           }
           if (maxClassProbs > thres_i8)
           {
-            objProbs.push_back((deqnt_affine_to_f32(maxClassProbs, zp, scale)) * (deqnt_affine_to_f32(box_confidence, zp, scale)));
-            classId.push_back(maxClassId);
+            candidate_t candidate;
+            anchor_box(type, deqnt_affine_to_f32(input[element_at(layout, base + 0, p)], zp, scale),
+                       deqnt_affine_to_f32(input[element_at(layout, base + 1, p)], zp, scale),
+                       deqnt_affine_to_f32(input[element_at(layout, base + 2, p)], zp, scale),
+                       deqnt_affine_to_f32(input[element_at(layout, base + 3, p)], zp, scale), i, j, stride,
+                       anchor + a * 2, &candidate);
+            candidate.prob = (deqnt_affine_to_f32(maxClassProbs, zp, scale)) * (deqnt_affine_to_f32(box_confidence, zp, scale));
+            candidate.class_id = maxClassId;
+            ctx->candidates.push_back(candidate);
             validCount++;
-            boxes.push_back(box_x);
-            boxes.push_back(box_y);
-            boxes.push_back(box_w);
-            boxes.push_back(box_h);
           }
         }
       }
@@ -193,89 +312,701 @@ static int process(int8_t *input, int *anchor, int grid_h, int grid_w, int heigh
   return validCount;
 }
 
-int post_process(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h, int model_in_w, float conf_threshold,
-                 float nms_threshold, float scale_w, float scale_h, std::vector<int32_t> &qnt_zps,
-                 std::vector<float> &qnt_scales, detect_result_group_t *group)
+// YOLOv8一层输出（框回归、类别分数、可选的类别分数和）的标量参考解码，first为该层第一个输出的下标
+static int process_dfl_reference(post_process_ctx_t *ctx, int first, int8_t *const *outputs, int grid_h, int grid_w,
+                                 int stride, float threshold, const tensor_layout_t *layouts)
 {
-  memset(group, 0, sizeof(detect_result_group_t));
+  const int classes = ctx->head.num_classes;
+  const int reg_max = ctx->head.reg_max;
+  const bool has_sum = ctx->head.outputs_per_branch == 3;
+  const int8_t *box = outputs[first];
+  const int8_t *cls = outputs[first + 1];
+  const int8_t *sum = has_sum ? outputs[first + 2] : NULL;
+  const int8_t thres_cls = qnt_f32_to_affine(threshold, ctx->zp[first + 1], ctx->scale[first + 1]);
+  const int8_t thres_sum = has_sum ? qnt_f32_to_affine(threshold, ctx->zp[first + 2], ctx->scale[first + 2]) : 0;
+  std::vector<int> box_offset(4 * reg_max);
+  channel_offsets(layouts[first], 4 * reg_max, box_offset.data());
+  int validCount = 0;
+  for (int i = 0; i < grid_h; i++)
+  {
+    for (int j = 0; j < grid_w; j++)
+    {
+      const int p = i * grid_w + j;
+      // 类别分数和低于阈值时没有类别能超过阈值
+      if (has_sum && sum[element_at(layouts[first + 2], 0, p)] < thres_sum)
+      {
+        continue;
+      }
+      int8_t max_score = cls[element_at(layouts[first + 1], 0, p)];
+      int class_id = 0;
+      for (int k = 1; k < classes; ++k)
+      {
+        int8_t score = cls[element_at(layouts[first + 1], k, p)];
+        if (score > max_score)
+        {
+          class_id = k;
+          max_score = score;
+        }
+      }
+      if (max_score > thres_cls)
+      {
+        float distance[4];
+        dfl_distances(ctx->dequant[first] + 128, box, box_offset.data(), p, layouts[first].c2, reg_max, distance);
+        candidate_t candidate;
+        dfl_box(distance, i, j, stride, &candidate);
+        candidate.prob = deqnt_affine_to_f32(max_score, ctx->zp[first + 1], ctx->scale[first + 1]);
+        candidate.class_id = class_id;
+        ctx->candidates.push_back(candidate);
+        validCount++;
+      }
+    }
+  }
+  return validCount;
+}
 
-  std::vector<float> filterBoxes;
-  std::vector<float> objProbs;
-  std::vector<int> classId;
+// 置信度筛选：在count个网格位置中找出置信度>=thres的位置（相邻位置间隔step个元素），返回个数
+// step为1（NCHW的置信度平面连续）时每次比较16个位置，无候选的16格整体跳过，命中的位置按掩码压缩写出
+static int filter_candidates(const int8_t *conf, int count, int step, int8_t thres, int *hits)
+{
+  int found = 0;
+  int k = 0;
+  if (step == 1)
+  {
+#if POSTPROCESS_NEON
+    const int8x16_t t = vdupq_n_s8(thres);
+    for (; k + 16 <= count; k += 16)
+    {
+      uint8x16_t ge = vcgeq_s8(vld1q_s8(conf + k), t);
+      // 每个位置压缩为4位的掩码
+      uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(ge), 4)), 0);
+      while (mask)
+      {
+        int lane = __builtin_ctzll(mask) >> 2;
+        hits[found++] = k + lane;
+        mask &= ~(0xFULL << (lane * 4));
+      }
+    }
+#elif POSTPROCESS_SSE2
+    const __m128i t = _mm_set1_epi8(thres);
+    for (; k + 16 <= count; k += 16)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(conf + k));
+      unsigned mask = ~_mm_movemask_epi8(_mm_cmpgt_epi8(t, v)) & 0xFFFF;
+      while (mask)
+      {
+        hits[found++] = k + __builtin_ctz(mask);
+        mask &= mask - 1;
+      }
+    }
+#endif
+  }
+  for (; k < count; ++k)
+  {
+    if (conf[k * step] >= thres)
+    {
+      hits[found++] = k;
+    }
+  }
+  return found;
+}
 
-  // stride 8
-  int stride0 = 8;
-  int grid_h0 = model_in_h / stride0;
-  int grid_w0 = model_in_w / stride0;
-  int validCount0 = 0;
-  validCount0 = process(input0, (int *)anchor0, grid_h0, grid_w0, model_in_h, model_in_w, stride0, filterBoxes, objProbs,
-                        classId, conf_threshold, qnt_zps[0], qnt_scales[0]);
+// 连续count个值的最大值及其首次出现的位置
+static int argmax_run(const int8_t *values, int count, int8_t *max_value)
+{
+  int8_t best = values[0];
+  int i = 0;
+#if POSTPROCESS_NEON
+  if (count >= 16)
+  {
+    int8x16_t m = vld1q_s8(values);
+    for (i = 16; i + 16 <= count; i += 16)
+    {
+      m = vmaxq_s8(m, vld1q_s8(values + i));
+    }
+    int8x8_t m8 = vpmax_s8(vget_low_s8(m), vget_high_s8(m));
+    m8 = vpmax_s8(m8, m8);
+    m8 = vpmax_s8(m8, m8);
+    m8 = vpmax_s8(m8, m8);
+    best = vget_lane_s8(m8, 0);
+  }
+#elif POSTPROCESS_SSE2
+  if (count >= 16)
+  {
+    // SSE2没有有符号字节最大值，翻转符号位后按无符号比较
+    const __m128i flip = _mm_set1_epi8(static_cast<char>(0x80));
+    __m128i m = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(values)), flip);
+    for (i = 16; i + 16 <= count; i += 16)
+    {
+      m = _mm_max_epu8(m, _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i)), flip));
+    }
+    m = _mm_max_epu8(m, _mm_srli_si128(m, 8));
+    m = _mm_max_epu8(m, _mm_srli_si128(m, 4));
+    m = _mm_max_epu8(m, _mm_srli_si128(m, 2));
+    m = _mm_max_epu8(m, _mm_srli_si128(m, 1));
+    best = static_cast<int8_t>((_mm_cvtsi128_si32(m) & 0xFF) ^ 0x80);
+  }
+#endif
+  for (; i < count; ++i)
+  {
+    best = values[i] > best ? values[i] : best;
+  }
+  *max_value = best;
+  int index = 0;
+  while (values[index] != best)
+  {
+    index++;
+  }
+  return index;
+}
 
-  // stride 16
+// count个类别通道中概率最大者（并列时取编号最小者，与逐个比较的结果一致），offset为各通道在网格位置0的下标
+// 同一C2分组内的通道在内存中连续（NC1HWC2/NHWC），分段向量化；NCHW时各通道相隔一个平面，逐个读取
+static int argmax_classes(const int8_t *input, const int *offset, int first_channel, int count, int p,
+                          const tensor_layout_t &layout, int8_t *max_value)
+{
+  const int c2 = layout.c2;
+  if (c2 == 1)
+  {
+    const int8_t *values = input + offset[first_channel] + p;
+    const int plane = layout.plane;
+    int8_t best = values[0];
+    int best_index = 0;
+    for (int k = 1; k < count; ++k)
+    {
+      int8_t value = values[k * plane];
+      if (value > best)
+      {
+        best = value;
+        best_index = k;
+      }
+    }
+    *max_value = best;
+    return best_index;
+  }
+  int best_index = 0;
+  int8_t best = 0;
+  for (int k = 0; k < count;)
+  {
+    const int c = first_channel + k;
+    const int run = std::min(count - k, c2 - c % c2);
+    const int8_t *values = input + offset[c] + p * c2;
+    int8_t value;
+    int index;
+    if (run > 1)
+    {
+      index = argmax_run(values, run, &value);
+    }
+    else
+    {
+      index = 0;
+      value = values[0];
+    }
+    if (k == 0 || value > best)
+    {
+      best = value;
+      best_index = k + index;
+    }
+    k += run;
+  }
+  *max_value = best;
+  return best_index;
+}
 
-  int stride1 = 16;
-  int grid_h1 = model_in_h / stride1;
-  int grid_w1 = model_in_w / stride1;
-  int validCount1 = 0;
-  validCount1 = process(input1, (int *)anchor1, grid_h1, grid_w1, model_in_h, model_in_w, stride1, filterBoxes, objProbs,
-                        classId, conf_threshold, qnt_zps[1], qnt_scales[1]);
+// YOLOv5/YOLOX一层输出的解码，index为输出下标，offset为可容纳该层全部通道的偏移表
+// Type与Classes在编译期确定时，框的算式与类别循环的次数均为常量；Classes为0时类别数取ctx->head
+template <head_type_t Type, int Classes>
+static int process_anchor(post_process_ctx_t *ctx, int index, int8_t *input, const int *anchor, int grid_h, int grid_w,
+                          int stride, float threshold, const tensor_layout_t &layout, int *offset)
+{
+  const int classes = Classes ? Classes : ctx->head.num_classes;
+  const int props = 5 + classes;
+  const int anchors = Type == HEAD_YOLOV5 ? 3 : 1;
+  // 反量化查表：下标为量化值+128
+  const float *deq = ctx->dequant[index] + 128;
+  int8_t thres_i8 = qnt_f32_to_affine(threshold, ctx->zp[index], ctx->scale[index]);
+  const int c2 = layout.c2;
+  channel_offsets(layout, anchors * props, offset);
+  auto at = [offset, c2](int c, int p) { return offset[c] + p * c2; };
 
-  // stride 32
+  std::vector<candidate_t> &candidates = ctx->candidates;
+  const int kChunk = 64;
+  int hits[kChunk];
+  int validCount = 0;
+  for (int a = 0; a < anchors; a++)
+  {
+    const int base = props * a;
+    for (int i = 0; i < grid_h; i++)
+    {
+      for (int j0 = 0; j0 < grid_w; j0 += kChunk)
+      {
+        const int n = std::min(kChunk, grid_w - j0);
+        const int p0 = i * grid_w + j0;
+        const int found = filter_candidates(input + at(base + 4, p0), n, c2, thres_i8, hits);
+        for (int h = 0; h < found; h++)
+        {
+          const int j = j0 + hits[h];
+          const int p = p0 + hits[h];
+          int8_t box_confidence = input[at(base + 4, p)];
+          int8_t maxClassProbs;
+          int maxClassId = argmax_classes(input, offset, base + 5, classes, p, layout, &maxClassProbs);
+          if (maxClassProbs > thres_i8)
+          {
+            candidate_t candidate;
+            anchor_box(Type, deq[input[at(base + 0, p)]], deq[input[at(base + 1, p)]], deq[input[at(base + 2, p)]],
+                       deq[input[at(base + 3, p)]], i, j, stride, anchor + a * 2, &candidate);
+            candidate.prob = deq[maxClassProbs] * deq[box_confidence];
+            candidate.class_id = maxClassId;
+            candidates.push_back(candidate);
+            validCount++;
+          }
+        }
+      }
+    }
+  }
+  return validCount;
+}
 
-  int stride2 = 32;
-  int grid_h2 = model_in_h / stride2;
-  int grid_w2 = model_in_w / stride2;
-  int validCount2 = 0;
-  validCount2 = process(input2, (int *)anchor2, grid_h2, grid_w2, model_in_h, model_in_w, stride2, filterBoxes, objProbs,
-                        classId, conf_threshold, qnt_zps[2], qnt_scales[2]);
+// YOLOv8一层输出的解码，first为该层第一个输出的下标，offset为可容纳框回归与类别通道的偏移表
+// 有类别分数和时先按分数和向量化筛选网格，命中的网格再做类别argmax与DFL
+template <int Classes>
+static int process_dfl(post_process_ctx_t *ctx, int first, int8_t *const *outputs, int grid_h, int grid_w, int stride,
+                       float threshold, const tensor_layout_t *layouts, int *offset)
+{
+  const int classes = Classes ? Classes : ctx->head.num_classes;
+  const int reg_max = Classes ? kRegMax : ctx->head.reg_max;
+  const bool has_sum = ctx->head.outputs_per_branch == 3;
+  const int8_t *box = outputs[first];
+  const int8_t *cls = outputs[first + 1];
+  const int8_t *sum = has_sum ? outputs[first + 2] : NULL;
+  const tensor_layout_t &box_layout = layouts[first];
+  const tensor_layout_t &cls_layout = layouts[first + 1];
+  const int sum_c2 = has_sum ? layouts[first + 2].c2 : 0;
+  const float *box_deq = ctx->dequant[first] + 128;
+  const float *cls_deq = ctx->dequant[first + 1] + 128;
+  const int8_t thres_cls = qnt_f32_to_affine(threshold, ctx->zp[first + 1], ctx->scale[first + 1]);
+  const int8_t thres_sum = has_sum ? qnt_f32_to_affine(threshold, ctx->zp[first + 2], ctx->scale[first + 2]) : 0;
+  int *box_offset = offset;
+  int *cls_offset = offset + 4 * reg_max;
+  channel_offsets(box_layout, 4 * reg_max, box_offset);
+  channel_offsets(cls_layout, classes, cls_offset);
 
+  std::vector<candidate_t> &candidates = ctx->candidates;
+  const int kChunk = 64;
+  int hits[kChunk];
+  int validCount = 0;
+  for (int i = 0; i < grid_h; i++)
+  {
+    for (int j0 = 0; j0 < grid_w; j0 += kChunk)
+    {
+      const int n = std::min(kChunk, grid_w - j0);
+      const int p0 = i * grid_w + j0;
+      int found = n;
+      if (has_sum)
+      {
+        found = filter_candidates(sum + p0 * sum_c2, n, sum_c2, thres_sum, hits);
+      }
+      else
+      {
+        for (int k = 0; k < n; k++)
+        {
+          hits[k] = k;
+        }
+      }
+      for (int h = 0; h < found; h++)
+      {
+        const int j = j0 + hits[h];
+        const int p = p0 + hits[h];
+        int8_t max_score;
+        int class_id = argmax_classes(cls, cls_offset, 0, classes, p, cls_layout, &max_score);
+        if (max_score > thres_cls)
+        {
+          float distance[4];
+          dfl_distances(box_deq, box, box_offset, p, box_layout.c2, reg_max, distance);
+          candidate_t candidate;
+          dfl_box(distance, i, j, stride, &candidate);
+          candidate.prob = cls_deq[max_score];
+          candidate.class_id = class_id;
+          candidates.push_back(candidate);
+          validCount++;
+        }
+      }
+    }
+  }
+  return validCount;
+}
 
-  int validCount = validCount0 + validCount1 + validCount2;
-  // no object detect
-  if (validCount <= 0)
+// 编译期确定的检测头参数：Classes、InH、InW为0时对应的值在运行时取ctx->head（通用版本）
+template <head_type_t Type, int Classes, int InH, int InW>
+struct head_spec
+{
+  // 一层输出需要的通道偏移表长度：YOLOv5/YOLOX为全部anchor的通道，YOLOv8为框回归与类别通道
+  static constexpr int kChannels = Type == HEAD_YOLOV8 ? 4 * kRegMax + Classes : (Type == HEAD_YOLOV5 ? 3 : 1) * (5 + Classes);
+  static constexpr int kGridH[HEAD_MAX_BRANCH] = {InH / kStrides[0], InH / kStrides[1], InH / kStrides[2]};
+  static constexpr int kGridW[HEAD_MAX_BRANCH] = {InW / kStrides[0], InW / kStrides[1], InW / kStrides[2]};
+};
+
+template <head_type_t Type, int Classes, int InH, int InW>
+constexpr int head_spec<Type, Classes, InH, InW>::kGridH[HEAD_MAX_BRANCH];
+template <head_type_t Type, int Classes, int InH, int InW>
+constexpr int head_spec<Type, Classes, InH, InW>::kGridW[HEAD_MAX_BRANCH];
+
+// 解码全部输出层（head_decode_fn）：特化版本的网格、stride、类别数与偏移表大小为编译期常量，通用版本取ctx->head
+template <head_type_t Type, int Classes, int InH, int InW>
+static int decode_head(post_process_ctx_t *ctx, int8_t *const *outputs, float threshold, const tensor_layout_t *layouts)
+{
+  typedef head_spec<Type, Classes, InH, InW> spec;
+  int local_offset[Classes ? spec::kChannels : 1];
+  int *offset = Classes ? local_offset : ctx->offset.data();
+  int validCount = 0;
+  for (int b = 0; b < HEAD_MAX_BRANCH; b++)
   {
-    return 0;
+    const int grid_h = InH ? spec::kGridH[b] : ctx->head.grid_h[b];
+    const int grid_w = InW ? spec::kGridW[b] : ctx->head.grid_w[b];
+    const int stride = InH ? kStrides[b] : ctx->head.stride[b];
+    if (Type == HEAD_YOLOV8)
+    {
+      validCount += process_dfl<Classes>(ctx, b * ctx->head.outputs_per_branch, outputs, grid_h, grid_w, stride,
+                                         threshold, layouts, offset);
+    }
+    else
+    {
+      validCount += process_anchor<Type, Classes>(ctx, b, outputs[b], kAnchors[b], grid_h, grid_w, stride, threshold,
+                                                  layouts[b], offset);
+    }
+  }
+  return validCount;
+}
+
+// 标量参考解码全部输出层
+static int decode_reference(post_process_ctx_t *ctx, int8_t *const *outputs, float threshold,
+                            const tensor_layout_t *layouts)
+{
+  const head_desc_t &head = ctx->head;
+  int validCount = 0;
+  for (int b = 0; b < HEAD_MAX_BRANCH; b++)
+  {
+    if (head.type == HEAD_YOLOV8)
+    {
+      validCount += process_dfl_reference(ctx, b * head.outputs_per_branch, outputs, head.grid_h[b], head.grid_w[b],
+                                          head.stride[b], threshold, layouts);
+    }
+    else
+    {
+      validCount += process_anchor_reference(ctx, b, outputs[b], kAnchors[b], head.grid_h[b], head.grid_w[b],
+                                             head.stride[b], threshold, layouts[b]);
+    }
+  }
+  return validCount;
+}
+
+typedef struct _decoder_entry_t
+{
+  head_type_t type;
+  int num_classes;  // 0表示任意类别数
+  int in_h;         // 0表示任意输入尺寸
+  int in_w;
+  head_decode_fn decode;
+  const char *name;
+} decoder_entry_t;
+
+// 按顺序取第一个匹配的版本：先COCO 80类、640×640输入的完全特化版本，再80类任意尺寸，最后为各类型的通用版本
+static const decoder_entry_t kDecoders[] = {
+    {HEAD_YOLOV5, 80, 640, 640, decode_head<HEAD_YOLOV5, 80, 640, 640>, "yolov5/80/640x640"},
+    {HEAD_YOLOX, 80, 640, 640, decode_head<HEAD_YOLOX, 80, 640, 640>, "yolox/80/640x640"},
+    {HEAD_YOLOV8, 80, 640, 640, decode_head<HEAD_YOLOV8, 80, 640, 640>, "yolov8/80/640x640"},
+    {HEAD_YOLOV5, 80, 0, 0, decode_head<HEAD_YOLOV5, 80, 0, 0>, "yolov5/80"},
+    {HEAD_YOLOX, 80, 0, 0, decode_head<HEAD_YOLOX, 80, 0, 0>, "yolox/80"},
+    {HEAD_YOLOV8, 80, 0, 0, decode_head<HEAD_YOLOV8, 80, 0, 0>, "yolov8/80"},
+    {HEAD_YOLOV5, 0, 0, 0, decode_head<HEAD_YOLOV5, 0, 0, 0>, "yolov5"},
+    {HEAD_YOLOX, 0, 0, 0, decode_head<HEAD_YOLOX, 0, 0, 0>, "yolox"},
+    {HEAD_YOLOV8, 0, 0, 0, decode_head<HEAD_YOLOV8, 0, 0, 0>, "yolov8"},
+};
+
+static bool decoder_matches(const decoder_entry_t &entry, const head_desc_t &head)
+{
+  if (entry.type != head.type || (entry.num_classes && entry.num_classes != head.num_classes))
+  {
+    return false;
+  }
+  // YOLOv8的特化版本按16个DFL分箱
+  if (entry.type == HEAD_YOLOV8 && entry.num_classes && head.reg_max != kRegMax)
+  {
+    return false;
+  }
+  if (entry.in_h == 0)
+  {
+    return true;
+  }
+  for (int b = 0; b < HEAD_MAX_BRANCH; b++)
+  {
+    if (head.stride[b] != kStrides[b] || head.grid_h[b] != entry.in_h / kStrides[b] ||
+        head.grid_w[b] != entry.in_w / kStrides[b])
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void select_decoder(post_process_ctx_t *ctx)
+{
+  ctx->decode = NULL;
+  ctx->decoder = "none";
+  for (const decoder_entry_t &entry : kDecoders)
+  {
+    if (decoder_matches(entry, ctx->head))
+    {
+      ctx->decode = entry.decode;
+      ctx->decoder = entry.name;
+      break;
+    }
+  }
+  // 通用版本的通道偏移表
+  const head_desc_t &head = ctx->head;
+  const int channels = head.type == HEAD_YOLOV8 ? 4 * head.reg_max + head.num_classes
+                                                : (head.type == HEAD_YOLOV5 ? 3 : 1) * (5 + head.num_classes);
+  ctx->offset.resize(channels);
+}
+
+const char *head_type_name(head_type_t type)
+{
+  switch (type)
+  {
+  case HEAD_YOLOV5:
+    return "yolov5";
+  case HEAD_YOLOX:
+    return "yolox";
+  case HEAD_YOLOV8:
+    return "yolov8";
+  }
+  return "unknown";
+}
+
+bool detect_head(const tensor_shape_t *shapes, int n_output, int model_in_h, int model_in_w, head_desc_t *head)
+{
+  memset(head, 0, sizeof(head_desc_t));
+  if (n_output == HEAD_MAX_BRANCH)
+  {
+    const int c = shapes[0].c;
+    for (int b = 1; b < HEAD_MAX_BRANCH; b++)
+    {
+      if (shapes[b].c != c)
+      {
+        return false;
+      }
+    }
+    // 3×(5+类别数)按YOLOv5识别，否则按YOLOX的5+类别数
+    if (c % 3 == 0 && c / 3 > 5)
+    {
+      head->type = HEAD_YOLOV5;
+      head->num_classes = c / 3 - 5;
+    }
+    else if (c > 5)
+    {
+      head->type = HEAD_YOLOX;
+      head->num_classes = c - 5;
+    }
+    else
+    {
+      return false;
+    }
+    head->outputs_per_branch = 1;
+  }
+  else if (n_output == 2 * HEAD_MAX_BRANCH || n_output == 3 * HEAD_MAX_BRANCH)
+  {
+    const int per = n_output / HEAD_MAX_BRANCH;
+    head->type = HEAD_YOLOV8;
+    head->outputs_per_branch = per;
+    head->reg_max = shapes[0].c / 4;
+    head->num_classes = shapes[1].c;
+    if (shapes[0].c % 4 != 0 || head->reg_max < 1 || head->reg_max > kMaxRegMax || head->num_classes < 1)
+    {
+      return false;
+    }
+    for (int b = 0; b < HEAD_MAX_BRANCH; b++)
+    {
+      const tensor_shape_t *branch = shapes + b * per;
+      for (int k = 1; k < per; k++)
+      {
+        if (branch[k].h != branch[0].h || branch[k].w != branch[0].w)
+        {
+          return false;
+        }
+      }
+      if (branch[0].c != 4 * head->reg_max || branch[1].c != head->num_classes || (per == 3 && branch[2].c != 1))
+      {
+        return false;
+      }
+    }
+  }
+  else
+  {
+    return false;
+  }
+
+  // 网格取自输出张量，各层stride须一致地整除输入尺寸且从小到大
+  for (int b = 0; b < HEAD_MAX_BRANCH; b++)
+  {
+    const tensor_shape_t &shape = shapes[b * head->outputs_per_branch];
+    if (shape.h <= 0 || shape.w <= 0 || model_in_h % shape.h != 0 || model_in_w % shape.w != 0 ||
+        model_in_h / shape.h != model_in_w / shape.w)
+    {
+      return false;
+    }
+    head->grid_h[b] = shape.h;
+    head->grid_w[b] = shape.w;
+    head->stride[b] = model_in_h / shape.h;
+    if (b > 0 && head->stride[b] <= head->stride[b - 1])
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void init_tables(post_process_ctx_t *ctx, int n_output, const std::vector<int32_t> &qnt_zps,
+                        const std::vector<float> &qnt_scales)
+{
+  for (int i = 0; i < n_output; i++)
+  {
+    ctx->zp[i] = qnt_zps[i];
+    ctx->scale[i] = qnt_scales[i];
+    for (int q = -128; q < 128; q++)
+    {
+      ctx->dequant[i][q + 128] = deqnt_affine_to_f32((int8_t)q, qnt_zps[i], qnt_scales[i]);
+    }
   }
+  // 预留常见场景所需的候选缓冲区，拥挤场景超出时扩容一次后复用
+  const size_t reserve = 1024;
+  ctx->candidates.reserve(reserve);
+  ctx->order.reserve(reserve);
+  ctx->removed.reserve(reserve);
+  ctx->area.reserve(reserve);
+  ctx->kept.reserve(reserve);
+}
 
-  std::vector<int> indexArray;
-  for (int i = 0; i < validCount; ++i)
+bool init_post_process(post_process_ctx_t *ctx, const head_desc_t &head, const std::vector<int32_t> &qnt_zps,
+                       const std::vector<float> &qnt_scales)
+{
+  const int n_output = head.outputs_per_branch * HEAD_MAX_BRANCH;
+  if (n_output <= 0 || n_output > HEAD_MAX_OUTPUT || (int)qnt_zps.size() < n_output ||
+      (int)qnt_scales.size() < n_output)
   {
-    indexArray.push_back(i);
+    return false;
   }
+  ctx->head = head;
+  select_decoder(ctx);
+  init_tables(ctx, n_output, qnt_zps, qnt_scales);
+  return ctx->decode != NULL;
+}
 
-  quick_sort_indice_inverse(objProbs, 0, validCount - 1, indexArray);
-  
-  std::set<int> class_set(std::begin(classId), std::end(classId));
+void init_post_process(post_process_ctx_t *ctx, const std::vector<int32_t> &qnt_zps, const std::vector<float> &qnt_scales)
+{
+  head_desc_t head;
+  memset(&head, 0, sizeof(head));
+  head.type = HEAD_YOLOV5;
+  head.num_classes = OBJ_CLASS_NUM;
+  head.outputs_per_branch = 1;
+  init_post_process(ctx, head, qnt_zps, qnt_scales);
+}
 
-  for (auto c : class_set)
+const char *post_process_label(const post_process_ctx_t *ctx, int class_id)
+{
+  if (ctx->head.num_classes != OBJ_CLASS_NUM || class_id < 0 || class_id >= OBJ_CLASS_NUM)
   {
-    nms(validCount, filterBoxes, classId, indexArray, c, nms_threshold);
+    return NULL;
   }
+  return labels[class_id];
+}
+
+const char *post_process_simd_name()
+{
+#if POSTPROCESS_NEON
+  return "neon";
+#elif POSTPROCESS_SSE2
+  return "sse2";
+#else
+  return "scalar";
+#endif
+}
+
+static int post_process_impl(post_process_ctx_t *ctx, bool reference, int8_t *const *outputs, int model_in_h,
+                             int model_in_w, float conf_threshold, float nms_threshold, float scale_w, float scale_h,
+                             detect_result_group_t *group, int pad_x, int pad_y, const tensor_layout_t *layouts)
+{
+  memset(group, 0, sizeof(detect_result_group_t));
 
+  ctx->candidates.clear();
+
+  head_desc_t &head = ctx->head;
+  if (head.grid_h[0] == 0)
+  {
+    // 兼容初始化：网格按模型输入尺寸/stride得到后重新选择解码函数
+    for (int b = 0; b < HEAD_MAX_BRANCH; b++)
+    {
+      head.stride[b] = kStrides[b];
+      head.grid_h[b] = model_in_h / kStrides[b];
+      head.grid_w[b] = model_in_w / kStrides[b];
+    }
+    select_decoder(ctx);
+  }
+  if (!ctx->decode)
+  {
+    return -1;
+  }
+  tensor_layout_t nchw[HEAD_MAX_OUTPUT];
+  if (!layouts)
+  {
+    for (int i = 0; i < head.outputs_per_branch * HEAD_MAX_BRANCH; i++)
+    {
+      const int b = i / head.outputs_per_branch;
+      nchw[i].c2 = 1;
+      nchw[i].plane = head.grid_h[b] * head.grid_w[b];
+    }
+    layouts = nchw;
+  }
+
+  int validCount = reference ? decode_reference(ctx, outputs, conf_threshold, layouts)
+                             : ctx->decode(ctx, outputs, conf_threshold, layouts);
+  // no object detect
+  if (validCount <= 0)
+  {
+    return 0;
+  }
+
+  const int keep = nms_per_class(ctx, nms_threshold, OBJ_NUMB_MAX_SIZE);
 
   int last_count = 0;
   group->count = 0;
   /* box valid detect target */
-  for (int i = 0; i < validCount; ++i)
+  for (int i = 0; i < keep; ++i)
   {
-    if (indexArray[i] == -1 || last_count >= OBJ_NUMB_MAX_SIZE) continue;
-
-    int n = indexArray[i];
+    const candidate_t &candidate = ctx->candidates[ctx->kept[i]];
 
-    float x1 = filterBoxes[n * 4 + 0];
-    float y1 = filterBoxes[n * 4 + 1];
-    float x2 = x1 + filterBoxes[n * 4 + 2];
-    float y2 = y1 + filterBoxes[n * 4 + 3];
-    int id = classId[n];
-    float obj_conf = objProbs[i];
+    float x1 = candidate.x;
+    float y1 = candidate.y;
+    float x2 = x1 + candidate.w;
+    float y2 = y1 + candidate.h;
+    int id = candidate.class_id;
+    float obj_conf = candidate.prob;
 
-    group->results[last_count].box.left = (int)(clamp(x1, 0, model_in_w) / scale_w);
-    group->results[last_count].box.top = (int)(clamp(y1, 0, model_in_h) / scale_h);
-    group->results[last_count].box.right = (int)(clamp(x2, 0, model_in_w) / scale_w);
-    group->results[last_count].box.bottom = (int)(clamp(y2, 0, model_in_h) / scale_h);
+    // letterbox输入时先去掉填充区域再按缩放系数映射回原图
+    group->results[last_count].box.left = (int)((clamp(x1, pad_x, model_in_w - pad_x) - pad_x) / scale_w);
+    group->results[last_count].box.top = (int)((clamp(y1, pad_y, model_in_h - pad_y) - pad_y) / scale_h);
+    group->results[last_count].box.right = (int)((clamp(x2, pad_x, model_in_w - pad_x) - pad_x) / scale_w);
+    group->results[last_count].box.bottom = (int)((clamp(y2, pad_y, model_in_h - pad_y) - pad_y) / scale_h);
     group->results[last_count].prop = obj_conf;
-    const char *label = labels[id];
-    strncpy(group->results[last_count].name, label, OBJ_NAME_MAX_SIZE);
+    group->results[last_count].class_id = id;
+    // 非COCO 80类的自定义模型没有标签表，以类别编号命名
+    const char *label = post_process_label(ctx, id);
+    if (label)
+    {
+      strncpy(group->results[last_count].name, label, OBJ_NAME_MAX_SIZE);
+    }
+    else
+    {
+      snprintf(group->results[last_count].name, OBJ_NAME_MAX_SIZE, "class%d", id);
+    }
 
     // printf("result %2d: (%4d, %4d, %4d, %4d), %s\n", i, group->results[last_count].box.left,
     // group->results[last_count].box.top,
@@ -287,3 +1018,367 @@ int post_process(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h,
 
   return 0;
 }
+
+int post_process(post_process_ctx_t *ctx, int8_t *const *outputs, int model_in_h, int model_in_w,
+                 float conf_threshold, float nms_threshold, float scale_w, float scale_h, detect_result_group_t *group,
+                 int pad_x, int pad_y, const tensor_layout_t *layouts)
+{
+  return post_process_impl(ctx, false, outputs, model_in_h, model_in_w, conf_threshold, nms_threshold, scale_w,
+                           scale_h, group, pad_x, pad_y, layouts);
+}
+
+int post_process_reference(post_process_ctx_t *ctx, int8_t *const *outputs, int model_in_h, int model_in_w,
+                           float conf_threshold, float nms_threshold, float scale_w, float scale_h,
+                           detect_result_group_t *group, int pad_x, int pad_y, const tensor_layout_t *layouts)
+{
+  return post_process_impl(ctx, true, outputs, model_in_h, model_in_w, conf_threshold, nms_threshold, scale_w,
+                           scale_h, group, pad_x, pad_y, layouts);
+}
+
+int post_process(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h, int model_in_w, float conf_threshold,
+                 float nms_threshold, float scale_w, float scale_h, std::vector<int32_t> &qnt_zps,
+                 std::vector<float> &qnt_scales, detect_result_group_t *group, int pad_x, int pad_y,
+                 const tensor_layout_t *layouts)
+{
+  post_process_ctx_t ctx;
+  init_post_process(&ctx, qnt_zps, qnt_scales);
+  int8_t *outputs[HEAD_MAX_BRANCH] = {input0, input1, input2};
+  return post_process(&ctx, outputs, model_in_h, model_in_w, conf_threshold, nms_threshold, scale_w, scale_h, group,
+                      pad_x, pad_y, layouts);
+}
+
+
+#if MODULE_TEST
+//g++ -O2 -DMODULE_TEST=1 -o bench_postprocess postprocess.cpp
+// 校验各检测头（YOLOv5/YOLOX/YOLOv8，编译期特化与通用版本）的向量化解码与标量参考实现的结果逐位一致
+// （NCHW、NHWC、NC1HWC2三种排布），并对比三者的解码耗时与拥挤场景下的NMS耗时
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <set>
+
+template <typename F>
+static double time_us(int iterations, F&& f)
+{
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i)
+  {
+    f();
+  }
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count() / iterations;
+}
+
+// NMS参照：原实现的结构（全部候选排序后，对每个出现的类别扫描全部候选两两比较），类别判断按候选各自的类别
+static int nms_reference(const std::vector<candidate_t> &candidates, float threshold, std::vector<int> &result)
+{
+  const int count = static_cast<int>(candidates.size());
+  std::vector<int> order(count);
+  for (int i = 0; i < count; ++i)
+  {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&candidates](int a, int b) {
+    return candidates[a].prob > candidates[b].prob || (candidates[a].prob == candidates[b].prob && a < b);
+  });
+  std::vector<int> classes;
+  for (const candidate_t &candidate : candidates)
+  {
+    classes.push_back(candidate.class_id);
+  }
+  std::set<int> class_set(classes.begin(), classes.end());
+  for (int c : class_set)
+  {
+    for (int i = 0; i < count; ++i)
+    {
+      const int n = order[i];
+      if (n == -1 || classes[n] != c) continue;
+      for (int j = i + 1; j < count; ++j)
+      {
+        const int m = order[j];
+        if (m == -1 || classes[m] != c) continue;
+        const candidate_t &a = candidates[n], &b = candidates[m];
+        if (CalculateOverlap(a.x, a.y, a.x + a.w, a.y + a.h, b.x, b.y, b.x + b.w, b.y + b.h) > threshold)
+        {
+          order[j] = -1;
+        }
+      }
+    }
+  }
+  result.clear();
+  for (int i = 0; i < count && static_cast<int>(result.size()) < OBJ_NUMB_MAX_SIZE; ++i)
+  {
+    if (order[i] != -1) result.push_back(order[i]);
+  }
+  return static_cast<int>(result.size());
+}
+
+// 拥挤场景：objects个目标（多数为同一类别，如人群、车流），每个目标在相邻网格与anchor上产生若干抖动的候选框
+static std::vector<candidate_t> crowded_fixture(int objects, std::mt19937 &rng)
+{
+  std::vector<candidate_t> candidates;
+  std::uniform_real_distribution<float> unit(0, 1);
+  for (int o = 0; o < objects; ++o)
+  {
+    const float w = 20 + 60 * unit(rng), h = 40 + 120 * unit(rng);
+    const float x = unit(rng) * (640 - w), y = unit(rng) * (640 - h);
+    const float score = 0.3f + 0.7f * unit(rng);
+    const int class_id = unit(rng) < 0.7f ? 0 : static_cast<int>(rng() % 8);
+    const int boxes = 4 + rng() % 9;
+    for (int b = 0; b < boxes; ++b)
+    {
+      candidate_t candidate;
+      candidate.x = x + (unit(rng) - 0.5f) * 0.2f * w;
+      candidate.y = y + (unit(rng) - 0.5f) * 0.2f * h;
+      candidate.w = w * (0.85f + 0.3f * unit(rng));
+      candidate.h = h * (0.85f + 0.3f * unit(rng));
+      candidate.prob = score * (0.5f + 0.5f * unit(rng));
+      candidate.class_id = class_id;
+      candidates.push_back(candidate);
+    }
+  }
+  std::shuffle(candidates.begin(), candidates.end(), rng);
+  return candidates;
+}
+
+// 按NCHW逻辑张量生成指定排布的数据
+static std::vector<int8_t> to_layout(const std::vector<int8_t> &nchw, int channels, int grid_len, int c2)
+{
+  const int groups = (channels + c2 - 1) / c2;
+  std::vector<int8_t> out(groups * grid_len * c2, -128);
+  for (int c = 0; c < channels; ++c)
+  {
+    for (int p = 0; p < grid_len; ++p)
+    {
+      out[(c / c2) * grid_len * c2 + p * c2 + c % c2] = nchw[c * grid_len + p];
+    }
+  }
+  return out;
+}
+
+// 测试用检测头：输出张量形状与模型输入尺寸，由detect_head()识别
+struct head_case
+{
+  const char *name;
+  int in_h;
+  int in_w;
+  std::vector<tensor_shape_t> shapes;
+  const char *decoder;  // 应选中的解码函数
+};
+
+static std::vector<tensor_shape_t> branch_shapes(int in_h, int in_w, std::initializer_list<int> channels)
+{
+  std::vector<tensor_shape_t> shapes;
+  for (int b = 0; b < HEAD_MAX_BRANCH; ++b)
+  {
+    for (int c : channels)
+    {
+      shapes.push_back(tensor_shape_t{c, in_h / (8 << b), in_w / (8 << b)});
+    }
+  }
+  return shapes;
+}
+
+// 按检测头生成各输出的NCHW数据：背景值落在阈值(-64)附近及以下，覆盖等于阈值的边界；每个(anchor, 网格)以density的概率成为候选
+static std::vector<std::vector<int8_t>> make_outputs(const head_desc_t &head, const std::vector<tensor_shape_t> &shapes,
+                                                     double density, std::mt19937 &rng)
+{
+  std::uniform_real_distribution<double> unit(0, 1);
+  std::vector<std::vector<int8_t>> outputs(shapes.size());
+  for (size_t o = 0; o < shapes.size(); ++o)
+  {
+    const tensor_shape_t &shape = shapes[o];
+    outputs[o].resize(shape.c * shape.h * shape.w);
+    for (auto &v : outputs[o])
+    {
+      v = static_cast<int8_t>(-128 + rng() % 65);
+    }
+  }
+  for (int b = 0; b < HEAD_MAX_BRANCH; ++b)
+  {
+    const int grid_len = head.grid_h[b] * head.grid_w[b];
+    if (head.type == HEAD_YOLOV8)
+    {
+      const int first = b * head.outputs_per_branch;
+      for (auto &v : outputs[first])
+      {
+        v = static_cast<int8_t>(rng());  // DFL分箱
+      }
+      for (int p = 0; p < grid_len; ++p)
+      {
+        if (unit(rng) >= density) continue;
+        for (int c = 0; c < head.num_classes; ++c)
+        {
+          outputs[first + 1][c * grid_len + p] = static_cast<int8_t>(rng());
+        }
+        if (head.outputs_per_branch == 3)
+        {
+          outputs[first + 2][p] = static_cast<int8_t>(-64 + rng() % 192);
+        }
+      }
+      continue;
+    }
+    const int props = 5 + head.num_classes;
+    const int anchors = head.type == HEAD_YOLOV5 ? 3 : 1;
+    for (int a = 0; a < anchors; ++a)
+    {
+      for (int p = 0; p < grid_len; ++p)
+      {
+        if (unit(rng) >= density) continue;
+        for (int c = 0; c < props; ++c)
+        {
+          outputs[b][(a * props + c) * grid_len + p] = static_cast<int8_t>(rng());
+        }
+        outputs[b][(a * props + 4) * grid_len + p] = static_cast<int8_t>(-64 + rng() % 192);
+      }
+    }
+  }
+  return outputs;
+}
+
+int main()
+{
+  std::cout << "simd: " << post_process_simd_name() << std::endl;
+  bool ok = true;
+  std::mt19937 rng(7);
+
+  // 形状不符合任何检测头时识别失败
+  {
+    head_desc_t head;
+    std::vector<tensor_shape_t> four = branch_shapes(640, 640, {255});
+    four.push_back(four.back());
+    std::vector<tensor_shape_t> mixed = branch_shapes(640, 640, {255});
+    mixed[1].c = 85;
+    std::vector<tensor_shape_t> dfl = branch_shapes(640, 640, {66, 80});
+    std::vector<tensor_shape_t> order = branch_shapes(640, 640, {85});
+    std::swap(order[0], order[2]);
+    const bool rejected = !detect_head(four.data(), 4, 640, 640, &head) &&
+                          !detect_head(mixed.data(), 3, 640, 640, &head) &&
+                          !detect_head(dfl.data(), 6, 640, 640, &head) &&
+                          !detect_head(order.data(), 3, 640, 640, &head);
+    std::cout << "unsupported heads rejected: " << rejected << std::endl;
+    ok = ok && rejected;
+  }
+
+  const head_case cases[] = {
+      {"yolov5 c80", 640, 640, branch_shapes(640, 640, {255}), "yolov5/80/640x640"},
+      {"yolox c80", 640, 640, branch_shapes(640, 640, {85}), "yolox/80/640x640"},
+      {"yolov8 c80", 640, 640, branch_shapes(640, 640, {64, 80, 1}), "yolov8/80/640x640"},
+      {"yolov8 nosum", 640, 640, branch_shapes(640, 640, {64, 80}), "yolov8/80/640x640"},
+      {"yolov5 c80", 480, 640, branch_shapes(480, 640, {255}), "yolov5/80"},
+      {"yolov5 c3", 416, 416, branch_shapes(416, 416, {24}), "yolov5"},
+      {"yolox c20", 320, 256, branch_shapes(320, 256, {25}), "yolox"},
+      {"yolov8 c3", 480, 640, branch_shapes(480, 640, {64, 3, 1}), "yolov8"},
+  };
+  std::cout << "head          input    decoder            layout   cand  det   decode(us)  generic  reference"
+            << std::endl;
+  post_process_ctx_t ctx;
+  for (const head_case &test : cases)
+  {
+    const int n_output = static_cast<int>(test.shapes.size());
+    head_desc_t head;
+    if (!detect_head(test.shapes.data(), n_output, test.in_h, test.in_w, &head))
+    {
+      std::cout << test.name << ": head not detected" << std::endl;
+      ok = false;
+      continue;
+    }
+    std::vector<int32_t> zps(n_output, -128);
+    std::vector<float> scales(n_output, 1.0f / 256);
+    init_post_process(&ctx, head, zps, scales);
+    const bool selected = strcmp(ctx.decoder, test.decoder) == 0;
+    ok = ok && selected;
+    // 同一检测头的通用版本，用于对比特化带来的差异
+    post_process_ctx_t generic;
+    init_post_process(&generic, head, zps, scales);
+    for (const decoder_entry_t &entry : kDecoders)
+    {
+      if (entry.type == head.type && entry.num_classes == 0)
+      {
+        generic.decode = entry.decode;
+      }
+    }
+
+    const std::vector<std::vector<int8_t>> nchw = make_outputs(head, test.shapes, 0.01, rng);
+    detect_result_group_t expected;
+    memset(&expected, 0, sizeof(expected));
+    const char *layout_names[] = {"NCHW", "NHWC", "NC1HWC2"};
+    for (int l = 0; l < 3; ++l)
+    {
+      std::vector<std::vector<int8_t>> data(n_output);
+      int8_t *outputs[HEAD_MAX_OUTPUT];
+      tensor_layout_t layouts[HEAD_MAX_OUTPUT];
+      for (int o = 0; o < n_output; ++o)
+      {
+        const int grid_len = test.shapes[o].h * test.shapes[o].w;
+        const int c2 = l == 0 ? 1 : (l == 1 ? test.shapes[o].c : 16);
+        data[o] = l == 0 ? nchw[o] : to_layout(nchw[o], test.shapes[o].c, grid_len, c2);
+        outputs[o] = data[o].data();
+        layouts[o].c2 = c2;
+        layouts[o].plane = grid_len * c2;
+      }
+      detect_result_group_t fast, slow, reference;
+      post_process(&ctx, outputs, test.in_h, test.in_w, BOX_THRESH, NMS_THRESH, 1.0f, 1.0f, &fast, 0, 0, layouts);
+      post_process(&generic, outputs, test.in_h, test.in_w, BOX_THRESH, NMS_THRESH, 1.0f, 1.0f, &slow, 0, 0, layouts);
+      post_process_reference(&ctx, outputs, test.in_h, test.in_w, BOX_THRESH, NMS_THRESH, 1.0f, 1.0f, &reference, 0,
+                             0, layouts);
+      if (l == 0)
+      {
+        expected = reference;
+      }
+      // 特化版本、通用版本与参考实现逐位一致，且各排布的结果相同
+      const bool same = memcmp(&fast, &reference, sizeof(fast)) == 0 && memcmp(&slow, &reference, sizeof(fast)) == 0 &&
+                        memcmp(&fast, &expected, sizeof(fast)) == 0 && fast.count > 0;
+      ok = ok && same;
+
+      // 只计候选筛选与解码（不含排序与NMS）
+      const int iterations = 50;
+      const double decode_us = time_us(iterations, [&]() {
+        ctx.candidates.clear();
+        ctx.decode(&ctx, outputs, BOX_THRESH, layouts);
+      });
+      const size_t candidates = ctx.candidates.size();
+      const double generic_us = time_us(iterations, [&]() {
+        generic.candidates.clear();
+        generic.decode(&generic, outputs, BOX_THRESH, layouts);
+      });
+      const double reference_us = time_us(iterations, [&]() {
+        ctx.candidates.clear();
+        decode_reference(&ctx, outputs, BOX_THRESH, layouts);
+      });
+      printf("%-13s %3dx%-4d %-18s %-8s %5zu %4d %11.1f %8.1f %10.1f%s%s\n", test.name, test.in_h, test.in_w,
+             ctx.decoder, layout_names[l], candidates, fast.count, decode_us, generic_us, reference_us,
+             same ? "" : "  MISMATCH", selected ? "" : "  WRONG DECODER");
+    }
+  }
+
+  // 拥挤场景的NMS：与参照结果一致，并对比耗时
+  std::vector<int32_t> zps(3, -128);
+  std::vector<float> scales(3, 1.0f / 256);
+  init_post_process(&ctx, zps, scales);
+  std::cout << "objects  candidates  kept  nms(us)  reference(us)" << std::endl;
+  const int crowds[] = {20, 60, 120, 250};
+  for (int objects : crowds)
+  {
+    const std::vector<candidate_t> fixture = crowded_fixture(objects, rng);
+    ctx.candidates = fixture;
+    const int keep = nms_per_class(&ctx, NMS_THRESH, OBJ_NUMB_MAX_SIZE);
+    std::vector<int> expected;
+    nms_reference(fixture, NMS_THRESH, expected);
+    const bool same = ctx.kept == expected;
+    ok = ok && same;
+
+    const int iterations = 50;
+    const double nms_us = time_us(iterations, [&]() {
+      ctx.candidates.assign(fixture.begin(), fixture.end());
+      nms_per_class(&ctx, NMS_THRESH, OBJ_NUMB_MAX_SIZE);
+    });
+    std::vector<int> result;
+    const double reference_us = time_us(iterations, [&]() { nms_reference(fixture, NMS_THRESH, result); });
+    printf("%7d %11zu %5d %8.1f %14.1f%s\n", objects, fixture.size(), keep, nms_us, reference_us,
+           same ? "" : "  MISMATCH");
+  }
+
+  std::cout << "ok: " << ok << std::endl;
+  return ok ? 0 : 1;
+}
+#endif
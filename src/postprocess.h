@@ -1,6 +1,7 @@
 #ifndef _RKNN_POSTPROCESS_H_
 #define _RKNN_POSTPROCESS_H_
 
+#include <stddef.h>
 #include <stdint.h>
 #include <vector>
 
@@ -24,6 +25,7 @@ typedef struct __detect_result_t
     char name[OBJ_NAME_MAX_SIZE];
     BOX_RECT box;
     float prop;
+    int class_id;
 } detect_result_t;
 
 typedef struct _detect_result_group_t
@@ -33,10 +35,128 @@ typedef struct _detect_result_group_t
     detect_result_t results[OBJ_NUMB_MAX_SIZE];
 } detect_result_group_t;
 
+// 输出张量排布：通道c、网格位置p（行优先）的元素位于 (c / c2) * plane + p * c2 + c % c2
+// NCHW: c2=1, plane=H*W；NC1HWC2（NPU原生排布，通道按C2分组）: c2=C2, plane=H*W*C2；NHWC: c2=C
+typedef struct _tensor_layout_t
+{
+    int c2;
+    int plane;
+} tensor_layout_t;
+
+// 解码得到的候选框（模型输入坐标）
+typedef struct _candidate_t
+{
+    float x;
+    float y;
+    float w;
+    float h;
+    float prob;
+    int class_id;
+} candidate_t;
+
+#define HEAD_MAX_BRANCH 3  // 检测层数（stride 8/16/32）
+#define HEAD_MAX_OUTPUT 9  // 输出张量数上限（YOLOv8每层3个）
+
+// 检测头类型
+typedef enum _head_type_t
+{
+    HEAD_YOLOV5 = 0,  // anchor-based：每层1个输出，3个anchor×(xywh、目标置信度、各类别概率)
+    HEAD_YOLOX,       // anchor-free：每层1个输出，xywh、目标置信度、各类别概率，框为网格偏移与exp(wh)
+    HEAD_YOLOV8,      // anchor-free：每层DFL框回归(4×reg_max通道)、各类别分数、可选的类别分数和
+} head_type_t;
+
+// 输出张量的逻辑形状
+typedef struct _tensor_shape_t
+{
+    int c;
+    int h;
+    int w;
+} tensor_shape_t;
+
+// 检测头描述：加载模型时由输出张量的形状识别（见detect_head()）
+typedef struct _head_desc_t
+{
+    head_type_t type;
+    int num_classes;
+    int outputs_per_branch;  // 每层的输出张量数：YOLOv5/YOLOX为1，YOLOv8为2或3（有无类别分数和）
+    int reg_max;             // YOLOv8 DFL每条边的分箱数
+    int grid_h[HEAD_MAX_BRANCH];
+    int grid_w[HEAD_MAX_BRANCH];
+    int stride[HEAD_MAX_BRANCH];
+} head_desc_t;
+
+struct _post_process_ctx_t;
+
+// 解码一帧的全部输出层，候选框追加到ctx->candidates，返回候选数
+typedef int (*head_decode_fn)(struct _post_process_ctx_t *ctx, int8_t *const *outputs, float threshold,
+                              const tensor_layout_t *layouts);
+
+// 后处理上下文：模型加载时按检测头选定解码函数、按各输出的量化参数建好反量化表，并预留候选与NMS的缓冲区，逐帧复用
+// 每个模型实例各持有一个，非线程安全
+typedef struct _post_process_ctx_t
+{
+    head_desc_t head;
+    head_decode_fn decode;  // 按检测头类型、类别数、输入尺寸选出的解码函数（编译期特化版本或通用版本）
+    const char *decoder;    // 所选解码函数的名称
+    float dequant[HEAD_MAX_OUTPUT][256];  // dequant[i][q + 128] = (q - zp[i]) * scale[i]，与逐值计算的结果逐位一致
+    int32_t zp[HEAD_MAX_OUTPUT];
+    float scale[HEAD_MAX_OUTPUT];
+    std::vector<int> offset;              // 通用解码函数的通道偏移表
+    std::vector<candidate_t> candidates;  // 本帧的候选框
+    std::vector<int> bucket;              // 各类别桶的起始位置
+    std::vector<int> fill;                // 分桶时各类别的写入位置
+    std::vector<int> order;               // 按类别分桶、桶内按概率降序的候选下标
+    std::vector<uint8_t> removed;         // 被NMS抑制的候选
+    std::vector<double> area;             // 候选框面积
+    std::vector<int> kept;                // NMS保留的候选下标（按概率降序）
+} post_process_ctx_t;
+
+/**
+ * @brief 由输出张量的形状识别检测头
+ * 3个输出：通道数为3×(5+类别数)时为YOLOv5，否则按5+类别数为YOLOX；6或9个输出（每层2或3个）为YOLOv8
+ * 网格尺寸取自输出张量，stride为模型输入尺寸/网格尺寸
+ * @param shapes 各输出张量的逻辑形状（按输出顺序，层按stride从小到大）
+ * @return 识别成功返回true
+ */
+bool detect_head(const tensor_shape_t *shapes, int n_output, int model_in_h, int model_in_w, head_desc_t *head);
+
+const char *head_type_name(head_type_t type);
+
+// 按检测头选择解码函数（类别数、输入尺寸与编译期特化版本一致时用特化版本，否则用该类型的通用版本）
+// qnt_zps/qnt_scales为全部输出张量的量化参数
+bool init_post_process(post_process_ctx_t *ctx, const head_desc_t &head, const std::vector<int32_t> &qnt_zps,
+                       const std::vector<float> &qnt_scales);
+
+// 兼容：80类YOLOv5，网格在第一次后处理时按模型输入尺寸/stride得到
+void init_post_process(post_process_ctx_t *ctx, const std::vector<int32_t> &qnt_zps,
+                       const std::vector<float> &qnt_scales);
+
+// 置信度按整行向量比较筛选候选，类别argmax在同一C2分组内向量化（NEON/SSE2/标量，编译期选择），结果与参考实现一致；
+// 候选按类别分桶后各自排序、贪心NMS，只与同类别候选比较，最终取概率最高的OBJ_NUMB_MAX_SIZE个（按概率降序）
+// outputs为全部输出张量，layouts为各输出的排布，为NULL时按NCHW处理
+int post_process(post_process_ctx_t *ctx, int8_t *const *outputs, int model_in_h, int model_in_w,
+                 float conf_threshold, float nms_threshold, float scale_w, float scale_h, detect_result_group_t *group,
+                 int pad_x = 0, int pad_y = 0, const tensor_layout_t *layouts = NULL);
+
+// 标量参考解码：逐网格比较置信度，逐值反量化，用于校验post_process()与性能对比，参数同上（NMS相同）
+int post_process_reference(post_process_ctx_t *ctx, int8_t *const *outputs, int model_in_h, int model_in_w,
+                           float conf_threshold, float nms_threshold, float scale_w, float scale_h,
+                           detect_result_group_t *group, int pad_x = 0, int pad_y = 0,
+                           const tensor_layout_t *layouts = NULL);
+
+// 类别名（静态存储）：COCO 80类的检测头返回标签表中的名称，其他类别数返回NULL
+const char *post_process_label(const post_process_ctx_t *ctx, int class_id);
+
+// 当前编译使用的向量指令集（"neon"/"sse2"/"scalar"）
+const char *post_process_simd_name();
+
+// 兼容接口：80类YOLOv5，每次调用按qnt_zps/qnt_scales临时建反量化表
+// layouts为三个输出层的排布，为NULL时按NCHW处理
 int post_process(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h, int model_in_w,
                  float conf_threshold, float nms_threshold, float scale_w, float scale_h,
                  std::vector<int32_t> &qnt_zps, std::vector<float> &qnt_scales,
-                 detect_result_group_t *group);
+                 detect_result_group_t *group, int pad_x = 0, int pad_y = 0,
+                 const tensor_layout_t *layouts = NULL);
 
 void deinitPostProcess();
 #endif //_RKNN_POSTPROCESS_H_
@@ -13,6 +13,7 @@
 #include <chrono>
 #include <memory>
 #include <atomic>
+#include <cstdint>
 #include <optional>
 #include <iostream>
 // 线程安全队列模板类，支持多线程环境下的生产者-消费者模型
@@ -157,6 +158,97 @@ public:
         return true;
     }
     
+    /**
+     * @brief 从队列中取出元素并获取出队序号
+     * 序号在锁内按出队顺序从0连续分配，多个消费者并发取出时序号顺序与出队顺序严格一致
+     * @param item 用于接收元素的引用
+     * @param ticket 接收出队序号
+     * @param timeout_ms 超时时间(毫秒，-1表示无限等待)
+     * @return 成功取出返回true，超时或队列终止且为空返回false
+     */
+    bool pop(T& item, uint64_t& ticket, int timeout_ms = -1) {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        // 等待队列有元素或超时
+        auto ready = [this] { return !queue_.empty() || terminated_; };
+        if (timeout_ms >= 0) {
+            if (!not_empty_.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready)) {
+                return false; // 超时
+            }
+        } else {
+            not_empty_.wait(lock, ready);
+        }
+
+        // 检查是否已终止
+        if (terminated_ && queue_.empty()) return false;
+
+        // 取出元素并分配序号
+        item = std::move(const_cast<T&>(queue_.top()));
+        queue_.pop();
+        ticket = next_ticket_++;
+
+        // 通知生产者
+        if (max_size_ > 0) {
+            not_full_.notify_one();
+        }
+        return true;
+    }
+
+    /**
+     * @brief 非阻塞推入元素，队列已满时不入队
+     * @param item 要推入的元素，失败时保持不变
+     * @return 成功推入返回true，队列已满或已终止返回false
+     */
+    bool try_push(T&& item) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (terminated_ || (max_size_ > 0 && queue_.size() >= max_size_)) {
+            return false;
+        }
+        queue_.push(std::move(item));
+        not_empty_.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief 推入元素，队列已满时挤出队首元素（下一个将被取出的元素，按pts排序时即最旧的元素）
+     * @param item 要推入的元素
+     * @param evicted 接收被挤出的元素，在锁外析构
+     * @return 有元素被挤出返回true，否则返回false（队列已终止时item不入队）
+     */
+    bool push_evict(T&& item, T& evicted) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (terminated_) return false;
+        bool full = max_size_ > 0 && queue_.size() >= max_size_;
+        if (full) {
+            evicted = std::move(const_cast<T&>(queue_.top()));
+            queue_.pop();
+        }
+        queue_.push(std::move(item));
+        not_empty_.notify_one();
+        return full;
+    }
+
+    /**
+     * @brief 修改队列容量，缩小时已有元素保留，直到被取出后才按新容量限制入队
+     * @param max_size 队列最大容量（0表示无界队列）
+     */
+    void set_max_size(size_t max_size) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            max_size_ = max_size;
+        }
+        not_full_.notify_all();
+    }
+
+    /**
+     * @brief 获取队列容量
+     * @return 队列最大容量（0表示无界队列）
+     */
+    size_t max_size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return max_size_;
+    }
+
     // 尝试取出元素（非阻塞）
     // std::optional<T> try_pop() {
     //     std::unique_lock<std::mutex> lock(mutex_);
@@ -214,10 +306,11 @@ public:
     }
 
 private:
-    std::mutex mutex_;
+    mutable std::mutex mutex_;
     std::condition_variable not_empty_;
     std::condition_variable not_full_;
     std::priority_queue<T, std::vector<T>, Comparator> queue_;
-    const size_t max_size_;
+    size_t max_size_;
     bool terminated_;
+    uint64_t next_ticket_ = 0;  // 下一个出队序号
 };
@@ -1,29 +1,13 @@
 #include "yolov5model.h"
+#include <algorithm>
 #include <iostream>
 
-static unsigned char* load_model(const char* model_path, int* model_len)
-{
-    FILE *fp = fopen(model_path,"rb");
-    if(fp == nullptr)
-    {
-        std::cerr << "open model faile!" << std::endl;
-        return NULL;
-    }
-    fseek(fp,0,SEEK_END);
-    int model_size = ftell(fp);
-    unsigned char *model = (unsigned char *)malloc(model_size);
-    fseek(fp,0,SEEK_SET);
-    if(model_size != fread(model,1,model_size,fp))
-    {
-        std::cerr << "read model faile!" << std::endl;
-        return NULL;
-    }
-    *model_len = model_size;
-    if(fp)
-    {
-        fclose(fp);
-    }
-    return model;
+#ifndef MODULE_TEST
+#define MODULE_TEST 0
+#endif
+
+extern "C" {
+#include <libavutil/frame.h>
 }
 
 static void dump_tensor_attr_info(rknn_tensor_attr *attr)
@@ -46,6 +30,47 @@ static void dump_tensor_attr_info(rknn_tensor_attr *attr)
     std::cout << "scale= " << attr->scale << std::endl;
 }
 
+// 由张量属性得到后处理使用的排布（见tensor_layout_t）
+static tensor_layout_t layout_of(const rknn_tensor_attr& attr)
+{
+    tensor_layout_t layout;
+    if(attr.fmt == RKNN_TENSOR_NC1HWC2 && attr.n_dims == 5)
+    {
+        layout.c2 = attr.dims[4];
+        layout.plane = attr.dims[2] * attr.dims[3] * attr.dims[4];
+    }
+    else if(attr.fmt == RKNN_TENSOR_NHWC && attr.n_dims == 4)
+    {
+        layout.c2 = attr.dims[3];
+        layout.plane = attr.dims[1] * attr.dims[2] * attr.dims[3];
+    }
+    else
+    {
+        layout.c2 = 1;
+        layout.plane = attr.dims[2] * attr.dims[3];
+    }
+    return layout;
+}
+
+// 由张量属性（非原生排布）得到逻辑形状，用于识别检测头
+static tensor_shape_t shape_of(const rknn_tensor_attr& attr)
+{
+    tensor_shape_t shape;
+    if(attr.fmt == RKNN_TENSOR_NHWC && attr.n_dims == 4)
+    {
+        shape.h = attr.dims[1];
+        shape.w = attr.dims[2];
+        shape.c = attr.dims[3];
+    }
+    else
+    {
+        shape.c = attr.dims[1];
+        shape.h = attr.dims[2];
+        shape.w = attr.dims[3];
+    }
+    return shape;
+}
+
 Yolov5Model::Yolov5Model()
 {
     ctx = 0;
@@ -53,39 +78,143 @@ Yolov5Model::Yolov5Model()
     channel = 3;
     width   = 0;
     height  = 0;
+    batch_  = 1;
+    async_  = false;
+    zero_copy_ = false;
+    input_mem_ = nullptr;
+    input_stride_ = 0;
+    async_running_ = -1;
     nms_threshold = NMS_THRESH;
     box_conf_threshold = BOX_THRESH; 
 }
 
 Yolov5Model::~Yolov5Model()
 {
+    // 正在运行的帧需等待完成后才能销毁上下文
+    if(async_running_ >= 0)
+    {
+        rknn_run_extend run_ext;
+        memset(&run_ext, 0, sizeof(run_ext));
+        run_ext.frame_id = async_slots_[async_running_].frame_id;
+        rknn_wait(ctx, &run_ext);
+    }
+    release_zero_copy();
     if(ctx > 0)
     {
         rknn_destroy(ctx);
     }
 }
 
+void Yolov5Model::configure(const ModelOptions& options)
+{
+    zero_copy_ = options.zero_copy;
+    allocator_ = options.allocator;
+    // 零拷贝的输入输出内存绑定在上下文上只有一组，无法与异步双缓冲交替使用
+    async_ = options.async && !zero_copy_;
+    if(options.async && zero_copy_)
+    {
+        std::cout << "zero-copy io binds one buffer set per context, async mode disabled" << std::endl;
+    }
+}
+
 bool Yolov5Model::loadmodel(const char *model_path)
 {
     std::cout << "load model ..." << std::endl;
-    auto model = load_model(model_path, &model_len);
-    int ret = rknn_init(&ctx, model, model_len,0,NULL);
+    // 模型文件只映射一次，共享权重的实例由share()从同一映射派生
+    model_file_ = MappedFile::open(model_path);
+    if(!model_file_)
+    {
+        std::cerr << "open model faile!" << std::endl;
+        return false;
+    }
+    model_len = model_file_->size();
+    // 异步模式：rknn_run不等待推理完成，由rknn_wait()等待指定帧
+    uint32_t flags = async_ ? RKNN_FLAG_ASYNC_MASK : 0;
+    int ret = rknn_init(&ctx, model_file_->data(), model_len, flags, NULL);
     if(ret < 0)
     {
         std::cerr << "rknn init fail!" << std::endl;
+        ctx = 0;
         return false;
     }
-    free(model);
-    
-    ret = rknn_query(ctx, RKNN_QUERY_IN_OUT_NUM, &io_num, sizeof(io_num));
+    return query_model(true);
+}
+
+ModelPtr Yolov5Model::share()
+{
+    if(ctx == 0 || !model_file_)
+    {
+        return nullptr;
+    }
+    std::shared_ptr<Yolov5Model> model = std::make_shared<Yolov5Model>();
+    model->async_ = async_;
+    model->zero_copy_ = zero_copy_;
+    model->allocator_ = allocator_;
+    model->model_file_ = model_file_;
+    model->model_len = model_len;
+
+    // 优先由已初始化的上下文复制，权重不重复加载
+    int ret;
+    {
+        std::lock_guard<std::mutex> lock(share_mutex_);
+        ret = rknn_dup_context(&ctx, &model->ctx);
+    }
+    model->shared_weight_ = ret == RKNN_SUCC;
+    if(ret != RKNN_SUCC)
+    {
+        // 不支持dup时从同一映射初始化并共享权重内存，仍失败则独立初始化
+        const uint32_t flags = async_ ? RKNN_FLAG_ASYNC_MASK : 0;
+        rknn_init_extend extend;
+        memset(&extend, 0, sizeof(extend));
+        extend.ctx = ctx;
+        ret = rknn_init(&model->ctx, model_file_->data(), model_len, flags | RKNN_FLAG_SHARE_WEIGHT_MEM, &extend);
+        model->shared_weight_ = ret == RKNN_SUCC;
+        if(ret != RKNN_SUCC)
+        {
+            ret = rknn_init(&model->ctx, model_file_->data(), model_len, flags, NULL);
+        }
+    }
+    if(ret != RKNN_SUCC)
+    {
+        std::cerr << "rknn derive context fail!" << std::endl;
+        model->ctx = 0;
+        return nullptr;
+    }
+    if(!model->query_model(false))
+    {
+        return nullptr;
+    }
+    return model;
+}
+
+ModelMemory Yolov5Model::memory() const
+{
+    ModelMemory memory;
+    memory.shared_weight = shared_weight_;
+    rknn_mem_size mem_size;
+    memset(&mem_size, 0, sizeof(mem_size));
+    if(ctx != 0 && rknn_query(ctx, RKNN_QUERY_MEM_SIZE, &mem_size, sizeof(mem_size)) == RKNN_SUCC)
+    {
+        memory.weight_bytes = mem_size.total_weight_size;
+        memory.internal_bytes = mem_size.total_internal_size;
+        memory.dma_bytes = mem_size.total_dma_allocated_size;
+    }
+    return memory;
+}
+
+bool Yolov5Model::query_model(bool verbose)
+{
+    int ret = rknn_query(ctx, RKNN_QUERY_IN_OUT_NUM, &io_num, sizeof(io_num));
     if(ret != RKNN_SUCC)
     {
         std::cerr << "rknn query num fail!" << std::endl;
         return false;
     }
-    std::cout << "model input num: " << io_num.n_input << " ,output num: " << io_num.n_output << std::endl;
-
-    std::cout << "model input attr: " << std::endl;
+    if(verbose)
+    {
+        std::cout << "model input num: " << io_num.n_input << " ,output num: " << io_num.n_output << std::endl;
+        std::cout << "model input attr: " << std::endl;
+    }
     rknn_tensor_attr input_attrs[io_num.n_input];
     memset(input_attrs, 0, sizeof(input_attrs));
 
@@ -99,10 +228,10 @@ bool Yolov5Model::loadmodel(const char *model_path)
             return false;
         }
         input_atts.push_back(input_attrs[i]);
-        dump_tensor_attr_info(&(input_attrs[i]));
+        if(verbose) dump_tensor_attr_info(&(input_attrs[i]));
     }
 
-    std::cout << "model output attr: " << std::endl;
+    if(verbose) std::cout << "model output attr: " << std::endl;
     rknn_tensor_attr output_attrs[io_num.n_output];
     memset(output_attrs, 0, sizeof(output_attrs));
 
@@ -116,12 +245,12 @@ bool Yolov5Model::loadmodel(const char *model_path)
             return false;
         }
         output_atts.push_back(output_attrs[i]);
-        dump_tensor_attr_info(&(output_attrs[i]));
+        if(verbose) dump_tensor_attr_info(&(output_attrs[i]));
     }
 
     if(input_attrs[0].fmt == RKNN_TENSOR_NCHW)
     {
-        std::cout << "model input fmt RKNN_TENSOR_NCHW" << std::endl;
+        if(verbose) std::cout << "model input fmt RKNN_TENSOR_NCHW" << std::endl;
         channel = input_attrs[0].dims[1];
         height = input_attrs[0].dims[2];
         width = input_attrs[0].dims[3];
@@ -129,29 +258,219 @@ bool Yolov5Model::loadmodel(const char *model_path)
 
     if(input_attrs[0].fmt == RKNN_TENSOR_NHWC)
     {
-        std::cout << "model input fmt RKNN_TENSOR_NHWC" << std::endl;
+        if(verbose) std::cout << "model input fmt RKNN_TENSOR_NHWC" << std::endl;
         height = input_attrs[0].dims[1];
         width = input_attrs[0].dims[2];
         channel = input_attrs[0].dims[3];
     }
-    std::cout << "input image height: " << height << " width: " << width << " channels: " << channel << std::endl;
+    if(verbose) std::cout << "input image height: " << height << " width: " << width << " channels: " << channel << std::endl;
+
+    // 批量编译的模型：一次推理batch_帧，多核NPU上将整批分到多个核心
+    batch_ = input_attrs[0].dims[0] > 1 ? input_attrs[0].dims[0] : 1;
+    if(batch_ > 1)
+    {
+        if(verbose) std::cout << "model batch: " << batch_ << std::endl;
+        ret = rknn_set_batch_core_num(ctx, std::min(batch_, 3));
+        if(ret != RKNN_SUCC && verbose)
+        {
+            std::cout << "rknn_set_batch_core_num not supported, batch runs on one core" << std::endl;
+        }
+    }
+
+    // 按输出张量的形状识别检测头（YOLOv5/YOLOX/YOLOv8、类别数、各层网格）
+    head_desc_t head;
+    std::vector<tensor_shape_t> shapes;
+    for(int i = 0; i < io_num.n_output; i++)
+    {
+        shapes.push_back(shape_of(output_atts[i]));
+    }
+    if(!detect_head(shapes.data(), io_num.n_output, height, width, &head))
+    {
+        std::cerr << "unsupported detection head (" << io_num.n_output << " outputs)" << std::endl;
+        return false;
+    }
+
+    input_stride_ = width * channel;
+    output_layouts_.clear();
+    for(int i = 0; i < io_num.n_output; i++)
+    {
+        output_layouts_.push_back(layout_of(output_atts[i]));
+    }
+    if(zero_copy_ && channel != 3)
+    {
+        std::cout << "zero-copy io needs a 3-channel input, copying io" << std::endl;
+        zero_copy_ = false;
+    }
+    if(zero_copy_ && !setup_zero_copy(verbose))
+    {
+        std::cout << "zero-copy io unavailable, using rknn_inputs_set/rknn_outputs_get" << std::endl;
+        zero_copy_ = false;
+    }
+    // 反量化表按最终使用的输出属性（零拷贝时为原生属性）建立一次，解码函数按检测头选择
+    std::vector<int32_t> out_zps;
+    std::vector<float> out_scales;
+    for(int i = 0; i < io_num.n_output; i++)
+    {
+        out_zps.push_back(output_atts[i].zp);
+        out_scales.push_back(output_atts[i].scale);
+    }
+    if(!init_post_process(&post_ctx_, head, out_zps, out_scales))
+    {
+        std::cerr << "no decoder for " << head_type_name(head.type) << " head" << std::endl;
+        release_zero_copy();
+        return false;
+    }
+    if(verbose)
+    {
+        std::cout << "detection head: " << head_type_name(head.type) << ", " << head.num_classes
+                  << " classes, decoder " << post_ctx_.decoder << std::endl;
+    }
+
+    if(async_ && channel != 3)
+    {
+        std::cout << "async mode needs a 3-channel input, running synchronously" << std::endl;
+        async_ = false;
+    }
+    if(async_)
+    {
+        // 双缓冲：两个槽各有自己的输入与输出缓冲区
+        for(AsyncSlot& slot : async_slots_)
+        {
+            slot.input.resize(height * width * channel);
+            slot.outputs.resize(io_num.n_output);
+            for(int i = 0; i < io_num.n_output; i++)
+            {
+                slot.outputs[i].resize(output_atts[i].n_elems);
+            }
+        }
+        if(verbose) std::cout << "rknn async mode, double-buffered" << std::endl;
+    }
     return true;
 }
 
-bool Yolov5Model::run(cv::Mat &img)
+bool Yolov5Model::setup_zero_copy(bool verbose)
 {
-    cv::Mat test_img = img;
-    rknn_input inputs[io_num.n_input];
-    memset(inputs, 0, sizeof(inputs));
-    for(int i = 0; i < io_num.n_input; i++)
+    // 原生输入属性给出NPU要求的行距（w_stride）；输入仍按uint8 NHWC提供，归一化由NPU完成
+    rknn_tensor_attr input_attr;
+    memset(&input_attr, 0, sizeof(input_attr));
+    input_attr.index = 0;
+    if(rknn_query(ctx, RKNN_QUERY_NATIVE_INPUT_ATTR, &input_attr, sizeof(input_attr)) != RKNN_SUCC)
     {
-        inputs[i].index = i;
-        inputs[i].type = RKNN_TENSOR_UINT8;
-        inputs[i].size = height * width * channel;
-        inputs[i].fmt = input_atts[i].fmt;
-        inputs[i].pass_through = 0;
+        std::cerr << "rknn query native input attr fail!" << std::endl;
+        return false;
+    }
+    if(verbose)
+    {
+        std::cout << "model native input attr: " << std::endl;
+        dump_tensor_attr_info(&input_attr);
+    }
+    input_attr.type = RKNN_TENSOR_UINT8;
+    input_attr.fmt = RKNN_TENSOR_NHWC;
+    input_attr.pass_through = 0;
+    const int w_stride = input_attr.w_stride > 0 ? input_attr.w_stride : width;
+    const uint32_t input_size = std::max<uint32_t>(input_attr.size_with_stride, batch_ * height * w_stride * channel);
+
+    // 流水线的分配器为dma-heap时，输入缓冲区由其分配后以fd导入，否则由运行时分配
+    if(allocator_ && allocator_->is_dmabuf() && allocator_->allocate(input_size, input_dma_))
+    {
+        input_mem_ = rknn_create_mem_from_fd(ctx, input_dma_.fd, input_dma_.data, input_size, 0);
+        if(!input_mem_)
+        {
+            allocator_->release(input_dma_);
+        }
+    }
+    if(!input_mem_)
+    {
+        input_mem_ = rknn_create_mem(ctx, input_size);
+    }
+    if(!input_mem_ || rknn_set_io_mem(ctx, input_mem_, &input_attr) != RKNN_SUCC)
+    {
+        std::cerr << "rknn bind input mem fail!" << std::endl;
+        release_zero_copy();
+        return false;
+    }
+
+    // 输出按原生排布（通常为NC1HWC2）绑定，省去运行时转换为NCHW与拷贝，后处理按该排布读取
+    std::vector<rknn_tensor_attr> native_atts(io_num.n_output);
+    for(int i = 0; i < io_num.n_output; i++)
+    {
+        rknn_tensor_attr& attr = native_atts[i];
+        memset(&attr, 0, sizeof(attr));
+        attr.index = i;
+        if(rknn_query(ctx, RKNN_QUERY_NATIVE_OUTPUT_ATTR, &attr, sizeof(attr)) != RKNN_SUCC
+           || attr.type != RKNN_TENSOR_INT8)
+        {
+            std::cerr << "rknn native output " << i << " is not int8!" << std::endl;
+            release_zero_copy();
+            return false;
+        }
+        if(verbose)
+        {
+            std::cout << "model native output attr: " << std::endl;
+            dump_tensor_attr_info(&attr);
+        }
+        attr.size_with_stride = std::max(attr.size_with_stride, attr.size);
+        rknn_tensor_mem* mem = rknn_create_mem(ctx, attr.size_with_stride);
+        if(!mem)
+        {
+            std::cerr << "rknn create output mem fail!" << std::endl;
+            release_zero_copy();
+            return false;
+        }
+        output_mems_.push_back(mem);
+        if(rknn_set_io_mem(ctx, mem, &attr) != RKNN_SUCC)
+        {
+            std::cerr << "rknn bind output mem fail!" << std::endl;
+            release_zero_copy();
+            return false;
+        }
+    }
+
+    input_stride_ = w_stride * channel;
+    for(int i = 0; i < io_num.n_output; i++)
+    {
+        output_atts[i] = native_atts[i];
+        output_layouts_[i] = layout_of(native_atts[i]);
+    }
+    if(verbose)
+    {
+        std::cout << "rknn zero-copy io, input " << (input_dma_.fd >= 0 ? "imported from dma-heap" : "allocated by runtime")
+                  << ", output " << get_format_string(output_atts[0].fmt) << std::endl;
+    }
+    return true;
+}
+
+void Yolov5Model::release_zero_copy()
+{
+    for(rknn_tensor_mem* mem : output_mems_)
+    {
+        rknn_destroy_mem(ctx, mem);
+    }
+    output_mems_.clear();
+    if(input_mem_)
+    {
+        rknn_destroy_mem(ctx, input_mem_);
+        input_mem_ = nullptr;
+    }
+    if(allocator_)
+    {
+        allocator_->release(input_dma_);
     }
+}
 
+bool Yolov5Model::run(const cv::Mat &img, Detections& detections)
+{
+    detections.clear();
+    if (batch_ > 1 || async_ || zero_copy_)
+    {
+        // 批量模型的输入为整批、异步模式的输入为各槽的缓冲区、零拷贝的输入为绑定的内存，单帧推理也走批量路径
+        BatchItem item;
+        item.image = img;
+        run_batch(std::vector<BatchItem*>{&item});
+        detections.swap(item.detections);
+        return item.ok;
+    }
+    cv::Mat test_img = img;
     if(test_img.empty()) 
     {
         std::cerr << "capture.read error!" << std::endl;
@@ -163,12 +482,151 @@ bool Yolov5Model::run(cv::Mat &img)
     if (img_width != width || img_height != height) 
     {
         cv::resize(test_img,test_img,cv::Size(width,height));
-        inputs[0].buf = (void*)test_img.data;
     } 
-    else 
+
+    std::vector<OutputSlot> slots(1);
+    slots[0].image = img;
+    slots[0].scale_w = (float)width / img_width;
+    slots[0].scale_h = (float)height / img_height;
+    slots[0].detections = &detections;
+    return infer((void*)test_img.data, input_atts[0].fmt, slots);
+}
+
+bool Yolov5Model::run_yuyv(const AVFrame* raw, const cv::Mat& display, Detections& detections)
+{
+    detections.clear();
+    if (raw->format != AV_PIX_FMT_YUYV422 || channel != 3)
+    {
+        return run(display, detections);
+    }
+    if (batch_ > 1 || async_ || zero_copy_)
+    {
+        BatchItem item;
+        item.raw = raw;
+        item.image = display;
+        run_batch(std::vector<BatchItem*>{&item});
+        detections.swap(item.detections);
+        return item.ok;
+    }
+    input_buf_.resize(height * width * channel);
+    std::vector<OutputSlot> slots(1);
+    BatchItem item;
+    item.raw = raw;
+    item.image = display;
+    if (!fill_slot(item, input_buf_.data(), slots[0]))
+    {
+        return false;
+    }
+    slots[0].detections = &detections;
+    return infer(input_buf_.data(), RKNN_TENSOR_NHWC, slots);
+}
+
+bool Yolov5Model::fill_slot(const BatchItem& item, uint8_t* dst, OutputSlot& slot)
+{
+    const AVFrame* raw = item.raw;
+    if (raw && raw->format == AV_PIX_FMT_YUYV422 && channel == 3)
+    {
+        if (!letterbox_.configure(raw->width, raw->height, width, height))
+        {
+            std::cerr << "letterbox configure fail!" << std::endl;
+            return false;
+        }
+        letterbox_.run(raw->data[0], raw->linesize[0], dst, input_stride_);
+
+        // 检测框先映射回原始帧坐标，再按显示图像与原始帧的尺寸比换算
+        const LetterboxInfo& info = letterbox_.info();
+        slot.image = item.image;
+        slot.scale_w = info.scale * raw->width / item.image.cols;
+        slot.scale_h = info.scale * raw->height / item.image.rows;
+        slot.pad_x = info.pad_x;
+        slot.pad_y = info.pad_y;
+        return true;
+    }
+    if (item.image.empty() || item.image.type() != CV_8UC3 || channel != 3)
+    {
+        std::cerr << "unsupported batch input!" << std::endl;
+        return false;
+    }
+    cv::Mat input(height, width, CV_8UC3, dst, input_stride_);
+    cv::resize(item.image, input, cv::Size(width, height));
+    slot.image = item.image;
+    slot.scale_w = (float)width / item.image.cols;
+    slot.scale_h = (float)height / item.image.rows;
+    slot.pad_x = 0;
+    slot.pad_y = 0;
+    return true;
+}
+
+int Yolov5Model::run_batch(const std::vector<BatchItem*>& items)
+{
+    if (batch_ <= 1 && !zero_copy_)
+    {
+        return async_ ? run_async(items) : Model::run_batch(items);
+    }
+    // 每batch_帧一次推理，不足一批时空位保留上次的输入，其结果不取；零拷贝时直接写入绑定的输入内存
+    const size_t slot_size = static_cast<size_t>(height) * input_stride_;
+    uint8_t* input;
+    if (zero_copy_)
+    {
+        input = static_cast<uint8_t*>(input_mem_->virt_addr);
+    }
+    else
+    {
+        input_buf_.resize(batch_ * slot_size);
+        input = input_buf_.data();
+    }
+    int succeeded = 0;
+    for (size_t begin = 0; begin < items.size(); begin += batch_)
     {
-        inputs[0].buf = (void*)test_img.data;
+        const size_t count = std::min(items.size() - begin, static_cast<size_t>(batch_));
+        std::vector<OutputSlot> slots(count);
+        // 导入的dma-heap缓冲区为CPU缓存映射，写入前后同步缓存
+        if (input_dma_.fd >= 0)
+        {
+            DmaAllocator::begin_cpu_access(input_dma_.fd, true);
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            BatchItem& item = *items[begin + i];
+            item.ok = false;
+            item.detections.clear();
+            if (!fill_slot(item, input + i * slot_size, slots[i]))
+            {
+                slots[i].image = cv::Mat();
+            }
+            slots[i].detections = &item.detections;
+        }
+        if (input_dma_.fd >= 0)
+        {
+            DmaAllocator::end_cpu_access(input_dma_.fd, true);
+        }
+        if (!(zero_copy_ ? infer_zero_copy(slots) : infer(input, RKNN_TENSOR_NHWC, slots)))
+        {
+            continue;
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            items[begin + i]->ok = !slots[i].image.empty();
+            succeeded += items[begin + i]->ok ? 1 : 0;
+        }
     }
+    return succeeded;
+}
+
+bool Yolov5Model::infer(void* input, rknn_tensor_format fmt, std::vector<OutputSlot>& slots)
+{
+    rknn_input inputs[io_num.n_input];
+    memset(inputs, 0, sizeof(inputs));
+    for(int i = 0; i < io_num.n_input; i++)
+    {
+        inputs[i].index = i;
+        inputs[i].type = RKNN_TENSOR_UINT8;
+        inputs[i].size = batch_ * height * width * channel;
+        inputs[i].fmt = fmt;
+        inputs[i].pass_through = 0;
+    }
+    inputs[0].buf = input;
+
     auto ret = rknn_inputs_set(ctx, io_num.n_input, inputs);
     if(ret < 0 )
     {
@@ -198,51 +656,503 @@ bool Yolov5Model::run(cv::Mat &img)
         return false;
     }
 
-    float scale_w = (float)width / img_width;
-    float scale_h = (float)height / img_height;
+    // 输出按batch维连续排列，第b帧的输出从b * n_elems / batch_处开始
+    for(size_t b = 0; b < slots.size(); b++)
+    {
+        if (slots[b].image.empty())
+        {
+            continue;
+        }
+        int8_t* out[HEAD_MAX_OUTPUT];
+        for(int i = 0; i < io_num.n_output; i++)
+        {
+            out[i] = (int8_t *)outputs[i].buf + b * (output_atts[i].n_elems / batch_);
+        }
+        decode_outputs(out, slots[b]);
+    }
+    ret = rknn_outputs_release(ctx, io_num.n_output, outputs);
+    if (ret < 0)
+    {
+        std::cerr << "rknn_outputs_release fail!" << std::endl;
+        return false;
+    }
+    return true;
+}
 
-    detect_result_group_t detect_result_group;
-    std::vector<float> out_scales;
-    std::vector<int32_t> out_zps;
-    for(int i = 0; i < io_num.n_output; i++)
+bool Yolov5Model::infer_zero_copy(std::vector<OutputSlot>& slots)
+{
+    int ret = rknn_run(ctx, NULL);
+    if(ret < 0)
     {
-        out_scales.push_back(output_atts[i].scale);
-        out_zps.push_back(output_atts[i].zp);
+        std::cerr << "rknn_run fail!" << std::endl;
+        return false;
+    }
+    // 输出留在绑定的内存中原地后处理，按batch维连续排列
+    for(size_t b = 0; b < slots.size(); b++)
+    {
+        if (slots[b].image.empty())
+        {
+            continue;
+        }
+        int8_t* out[HEAD_MAX_OUTPUT];
+        for(int i = 0; i < io_num.n_output; i++)
+        {
+            out[i] = (int8_t *)output_mems_[i]->virt_addr + b * (output_atts[i].size_with_stride / batch_);
+        }
+        decode_outputs(out, slots[b]);
     }
+    return true;
+}
 
-    post_process((int8_t *)outputs[0].buf, (int8_t *)outputs[1].buf, (int8_t *)outputs[2].buf, 
-                height, width,box_conf_threshold, nms_threshold, scale_w, scale_h,
-                out_zps, out_scales, &detect_result_group);
+void Yolov5Model::decode_outputs(int8_t* const* out, OutputSlot& slot)
+{
+    detect_result_group_t detect_result_group;
+    post_process(&post_ctx_, out,
+                height, width,box_conf_threshold, nms_threshold, slot.scale_w, slot.scale_h,
+                &detect_result_group, slot.pad_x, slot.pad_y, output_layouts_.data());
 
-    char text[256];
+    Detections& detections = *slot.detections;
+    detections.clear();
     for (int i = 0; i < detect_result_group.count; i++) 
     {
         detect_result_t* det_result = &(detect_result_group.results[i]);
+        Detection det;
+        det.class_id = det_result->class_id;
+        det.score = det_result->prop;
+        det.box = cv::Rect(cv::Point(det_result->box.left, det_result->box.top),
+                           cv::Point(det_result->box.right, det_result->box.bottom));
+        det.label = post_process_label(&post_ctx_, det_result->class_id);
+        detections.push_back(det);
+    }
+}
 
-        int x1 = det_result->box.left;
-        int y1 = det_result->box.top;
-        int x2 = det_result->box.right;
-        int y2 = det_result->box.bottom;
-        cv::rectangle(img, cv::Point(x1, y1), cv::Point(x2, y2), cv::Scalar(255, 0, 0),10);
-        sprintf(text, "%s %.1f%%", det_result->name, det_result->prop * 100);
+bool Yolov5Model::submit(BatchItem* item)
+{
+    if (!async_ || async_order_.size() >= 2)
+    {
+        return false;
+    }
+    // 取不在途的槽：在途的槽至多一个在NPU上运行、一个已准备好等待启动
+    const int index = async_order_.empty() ? 0 : 1 - async_order_.front();
+    AsyncSlot& slot = async_slots_[index];
+    slot.item = item;
+    slot.output.detections = &item->detections;
+    item->ok = false;
+    item->detections.clear();
+    slot.failed = !fill_slot(*item, slot.input.data(), slot.output);
+    async_order_.push_back(index);
+    if (async_running_ < 0)
+    {
+        start_slot(index);
+    }
+    return true;
+}
 
-        int baseLine = 0;
-        cv::Size label_size = cv::getTextSize(text, cv::FONT_HERSHEY_SIMPLEX, 0.5, 1, &baseLine);
+BatchItem* Yolov5Model::collect()
+{
+    if (async_order_.empty())
+    {
+        return nullptr;
+    }
+    const int index = async_order_.front();
+    async_order_.pop_front();
+    AsyncSlot& slot = async_slots_[index];
 
-        int x = det_result->box.left;
-        int y = det_result->box.top - label_size.height - baseLine;
-        if (y < 0) y = 0;
-        if (x + label_size.width > test_img.cols) x = test_img.cols - label_size.width;
+    if (!slot.failed && async_running_ == index)
+    {
+        // 等待该帧推理完成，输出直接写入该槽的预分配缓冲区
+        rknn_run_extend run_ext;
+        memset(&run_ext, 0, sizeof(run_ext));
+        run_ext.frame_id = slot.frame_id;
+        int ret = rknn_wait(ctx, &run_ext);
+        async_running_ = -1;
 
-        cv::rectangle(img, cv::Rect(cv::Point(x, y), cv::Size(label_size.width, label_size.height + baseLine)), cv::Scalar(255, 255, 255), -1);
+        rknn_output outputs[io_num.n_output];
+        memset(outputs, 0, sizeof(outputs));
+        for(int i = 0; i < io_num.n_output; i++)
+        {
+            outputs[i].index = i;
+            outputs[i].want_float = 0;
+            outputs[i].is_prealloc = 1;
+            outputs[i].buf = slot.outputs[i].data();
+            outputs[i].size = slot.outputs[i].size();
+        }
+        rknn_output_extend out_ext;
+        memset(&out_ext, 0, sizeof(out_ext));
+        if (ret < 0 || rknn_outputs_get(ctx, io_num.n_output, outputs, &out_ext) < 0)
+        {
+            std::cerr << "rknn async wait/outputs_get fail!" << std::endl;
+            slot.failed = true;
+        }
+        else if (out_ext.frame_id != slot.frame_id)
+        {
+            std::cerr << "rknn async output frame " << out_ext.frame_id
+                      << " does not match run frame " << slot.frame_id << std::endl;
+            slot.failed = true;
+        }
+        rknn_outputs_release(ctx, io_num.n_output, outputs);
+    }
+    else if (async_running_ == index)
+    {
+        async_running_ = -1;
+    }
 
-       cv::putText(img, text, cv::Point(x, y + label_size.height), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 0, 0));
-    } 
-    ret = rknn_outputs_release(ctx, io_num.n_output, outputs);
-    if (ret < 0)
+    // 先启动下一帧，再在CPU上后处理本帧，两者重叠
+    if (!async_order_.empty() && async_running_ < 0)
     {
-        std::cerr << "rknn_outputs_release fail!" << std::endl;
-        return false;
+        start_slot(async_order_.front());
     }
-    return true;
-}
\ No newline at end of file
+
+    BatchItem* item = slot.item;
+    slot.item = nullptr;
+    if (!slot.failed)
+    {
+        int8_t* out[HEAD_MAX_OUTPUT];
+        for(int i = 0; i < io_num.n_output; i++)
+        {
+            out[i] = slot.outputs[i].data();
+        }
+        decode_outputs(out, slot.output);
+        item->ok = true;
+    }
+    return item;
+}
+
+void Yolov5Model::start_slot(int index)
+{
+    AsyncSlot& slot = async_slots_[index];
+    if (slot.failed)
+    {
+        return;
+    }
+    rknn_input inputs[io_num.n_input];
+    memset(inputs, 0, sizeof(inputs));
+    for(int i = 0; i < io_num.n_input; i++)
+    {
+        inputs[i].index = i;
+        inputs[i].type = RKNN_TENSOR_UINT8;
+        inputs[i].size = height * width * channel;
+        inputs[i].fmt = RKNN_TENSOR_NHWC;
+        inputs[i].pass_through = 0;
+    }
+    inputs[0].buf = slot.input.data();
+
+    rknn_run_extend run_ext;
+    memset(&run_ext, 0, sizeof(run_ext));
+    run_ext.non_block = 1;
+    if (rknn_inputs_set(ctx, io_num.n_input, inputs) < 0 || rknn_run(ctx, &run_ext) < 0)
+    {
+        std::cerr << "rknn async run fail!" << std::endl;
+        slot.failed = true;
+        return;
+    }
+    slot.frame_id = run_ext.frame_id;
+    async_running_ = index;
+}
+
+int Yolov5Model::run_async(const std::vector<BatchItem*>& items)
+{
+    // 第i+1帧的预处理在第i帧推理期间进行，第i帧的后处理在第i+1帧推理期间进行
+    int succeeded = 0;
+    size_t next = 0;
+    size_t done = 0;
+    while (done < items.size())
+    {
+        if (next < items.size() && submit(items[next]))
+        {
+            next++;
+            continue;
+        }
+        BatchItem* item = collect();
+        if (!item)
+        {
+            break;
+        }
+        succeeded += item->ok ? 1 : 0;
+        done++;
+    }
+    return succeeded;
+}
+
+
+#if MODULE_TEST
+//g++ -DMODULE_TEST=1 -o test_yolov5model yolov5model.cpp postprocess.cpp YuyvLetterbox.cpp DmaAllocator.cpp -I../librknn_api/include `pkg-config --cflags --libs opencv4 libavutil` -lpthread
+// 桩运行时测试：以模拟的rknn接口代替librknnrt，在开发机上对比拷贝模式与零拷贝模式
+// 桩模型输入64x64x3（原生输入行距72像素），三个int8输出层：拷贝输出为NCHW，原生输出为NC1HWC2（C2=16）。
+// 桩推理按输入有效像素的平均值决定目标所在的网格，两种模式的检测结果应一致，且零拷贝模式不调用inputs_set/outputs_get
+#include <cstdio>
+#include <map>
+
+namespace {
+
+const int kSize = 64;      // 模型输入宽高
+const int kStride = 72;    // 原生输入行距（像素）
+const int kChannels = 255;
+const int kC2 = 16;
+
+struct StubContext {
+    std::vector<uint8_t> input;          // rknn_inputs_set()设置的输入（行距kSize）
+    std::vector<int8_t> logical[3];      // 最近一次推理的输出（NCHW）
+    rknn_tensor_mem* input_mem = nullptr;
+    rknn_tensor_attr input_attr;
+    rknn_tensor_mem* output_mems[3] = {nullptr, nullptr, nullptr};
+};
+
+std::map<rknn_context, StubContext> g_contexts;
+rknn_context g_next_ctx = 1;
+int g_inputs_set = 0, g_outputs_get = 0, g_mems = 0;
+
+int grid_of(int index) { return kSize / (8 << index); }
+
+void fill_attr(rknn_tensor_attr* attr, bool native) {
+    const uint32_t index = attr->index;
+    memset(attr, 0, sizeof(*attr));
+    attr->index = index;
+    attr->type = RKNN_TENSOR_INT8;
+    attr->qnt_type = RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC;
+    attr->zp = -128;
+    attr->scale = 1.0f / 256;
+    const int g = grid_of(index);
+    snprintf(attr->name, sizeof(attr->name), "output%u", index);
+    attr->n_elems = kChannels * g * g;
+    attr->size = attr->n_elems;
+    if (native) {
+        attr->fmt = RKNN_TENSOR_NC1HWC2;
+        attr->n_dims = 5;
+        attr->dims[0] = 1; attr->dims[1] = (kChannels + kC2 - 1) / kC2; attr->dims[2] = g; attr->dims[3] = g; attr->dims[4] = kC2;
+        attr->size_with_stride = attr->dims[1] * g * g * kC2;
+    } else {
+        attr->fmt = RKNN_TENSOR_NCHW;
+        attr->n_dims = 4;
+        attr->dims[0] = 1; attr->dims[1] = kChannels; attr->dims[2] = g; attr->dims[3] = g;
+        attr->size_with_stride = attr->size;
+    }
+}
+
+// 桩推理：目标放在第0层网格(mean % 64)的第0个anchor，类别17，置信度约0.9
+void infer_stub(StubContext& c, const uint8_t* input, int row_stride) {
+    uint64_t sum = 0;
+    for (int y = 0; y < kSize; ++y) {
+        for (int x = 0; x < kSize * 3; ++x) {
+            sum += input[y * row_stride + x];
+        }
+    }
+    const int cell = static_cast<int>(sum / (kSize * kSize * 3)) % 64;
+    for (int i = 0; i < 3; ++i) {
+        const int g = grid_of(i);
+        c.logical[i].assign(kChannels * g * g, -128);
+    }
+    const int plane = grid_of(0) * grid_of(0);
+    std::vector<int8_t>& out = c.logical[0];
+    out[0 * plane + cell] = 0;    // x、y偏移0.5
+    out[1 * plane + cell] = 0;
+    out[2 * plane + cell] = 0;    // w、h为anchor的1倍
+    out[3 * plane + cell] = 0;
+    out[4 * plane + cell] = 102;  // 目标置信度
+    out[(5 + 17) * plane + cell] = 102;
+}
+
+}  // namespace
+
+int rknn_init(rknn_context* context, void*, uint32_t, uint32_t, rknn_init_extend*) {
+    *context = g_next_ctx++;
+    g_contexts[*context] = StubContext();
+    return RKNN_SUCC;
+}
+int rknn_dup_context(rknn_context*, rknn_context*) { return -1; }
+int rknn_destroy(rknn_context context) { g_contexts.erase(context); return RKNN_SUCC; }
+int rknn_set_batch_core_num(rknn_context, int) { return -1; }
+int rknn_wait(rknn_context, rknn_run_extend*) { return RKNN_SUCC; }
+
+int rknn_query(rknn_context, rknn_query_cmd cmd, void* info, uint32_t) {
+    if (cmd == RKNN_QUERY_IN_OUT_NUM) {
+        rknn_input_output_num* num = static_cast<rknn_input_output_num*>(info);
+        num->n_input = 1;
+        num->n_output = 3;
+        return RKNN_SUCC;
+    }
+    rknn_tensor_attr* attr = static_cast<rknn_tensor_attr*>(info);
+    if (cmd == RKNN_QUERY_INPUT_ATTR || cmd == RKNN_QUERY_NATIVE_INPUT_ATTR) {
+        memset(attr, 0, sizeof(*attr));
+        snprintf(attr->name, sizeof(attr->name), "images");
+        attr->fmt = RKNN_TENSOR_NHWC;
+        attr->type = RKNN_TENSOR_INT8;
+        attr->n_dims = 4;
+        attr->dims[0] = 1; attr->dims[1] = kSize; attr->dims[2] = kSize; attr->dims[3] = 3;
+        attr->n_elems = kSize * kSize * 3;
+        attr->size = attr->n_elems;
+        attr->w_stride = cmd == RKNN_QUERY_NATIVE_INPUT_ATTR ? kStride : kSize;
+        attr->size_with_stride = kSize * attr->w_stride * 3;
+        return RKNN_SUCC;
+    }
+    if (cmd == RKNN_QUERY_OUTPUT_ATTR || cmd == RKNN_QUERY_NATIVE_OUTPUT_ATTR) {
+        fill_attr(attr, cmd == RKNN_QUERY_NATIVE_OUTPUT_ATTR);
+        return RKNN_SUCC;
+    }
+    return -1;
+}
+
+int rknn_inputs_set(rknn_context context, uint32_t, rknn_input inputs[]) {
+    g_inputs_set++;
+    const uint8_t* data = static_cast<const uint8_t*>(inputs[0].buf);
+    g_contexts[context].input.assign(data, data + inputs[0].size);
+    return RKNN_SUCC;
+}
+
+int rknn_run(rknn_context context, rknn_run_extend*) {
+    StubContext& c = g_contexts[context];
+    if (!c.input_mem) {
+        infer_stub(c, c.input.data(), kSize * 3);
+        return RKNN_SUCC;
+    }
+    // 绑定了内存：按原生行距读输入，按NC1HWC2写输出
+    infer_stub(c, static_cast<const uint8_t*>(c.input_mem->virt_addr), c.input_attr.w_stride * 3);
+    for (int i = 0; i < 3; ++i) {
+        const int plane = grid_of(i) * grid_of(i);
+        int8_t* dst = static_cast<int8_t*>(c.output_mems[i]->virt_addr);
+        memset(dst, -128, c.output_mems[i]->size);
+        for (int ch = 0; ch < kChannels; ++ch) {
+            for (int p = 0; p < plane; ++p) {
+                dst[(ch / kC2) * plane * kC2 + p * kC2 + ch % kC2] = c.logical[i][ch * plane + p];
+            }
+        }
+    }
+    return RKNN_SUCC;
+}
+
+int rknn_outputs_get(rknn_context context, uint32_t n_outputs, rknn_output outputs[], rknn_output_extend*) {
+    g_outputs_get++;
+    StubContext& c = g_contexts[context];
+    for (uint32_t i = 0; i < n_outputs; ++i) {
+        std::vector<int8_t>& logical = c.logical[outputs[i].index];
+        if (!outputs[i].is_prealloc) {
+            outputs[i].buf = malloc(logical.size());
+            outputs[i].size = logical.size();
+        }
+        memcpy(outputs[i].buf, logical.data(), std::min<size_t>(outputs[i].size, logical.size()));
+    }
+    return RKNN_SUCC;
+}
+
+int rknn_outputs_release(rknn_context, uint32_t n_outputs, rknn_output outputs[]) {
+    for (uint32_t i = 0; i < n_outputs; ++i) {
+        if (!outputs[i].is_prealloc) {
+            free(outputs[i].buf);
+        }
+    }
+    return RKNN_SUCC;
+}
+
+rknn_tensor_mem* rknn_create_mem(rknn_context, uint32_t size) {
+    rknn_tensor_mem* mem = new rknn_tensor_mem();
+    mem->virt_addr = calloc(size, 1);
+    mem->fd = -1;
+    mem->size = size;
+    mem->flags = RKNN_TENSOR_MEMORY_FLAGS_ALLOC_INSIDE;
+    g_mems++;
+    return mem;
+}
+
+rknn_tensor_mem* rknn_create_mem_from_fd(rknn_context, int32_t fd, void* virt_addr, uint32_t size, int32_t offset) {
+    rknn_tensor_mem* mem = new rknn_tensor_mem();
+    mem->virt_addr = static_cast<uint8_t*>(virt_addr) + offset;
+    mem->fd = fd;
+    mem->offset = offset;
+    mem->size = size;
+    mem->flags = RKNN_TENSOR_MEMORY_FLAGS_FROM_FD;
+    g_mems++;
+    return mem;
+}
+
+int rknn_destroy_mem(rknn_context, rknn_tensor_mem* mem) {
+    if (mem->flags == RKNN_TENSOR_MEMORY_FLAGS_ALLOC_INSIDE) {
+        free(mem->virt_addr);
+    }
+    delete mem;
+    g_mems--;
+    return RKNN_SUCC;
+}
+
+int rknn_set_io_mem(rknn_context context, rknn_tensor_mem* mem, rknn_tensor_attr* attr) {
+    StubContext& c = g_contexts[context];
+    if (strcmp(attr->name, "images") == 0) {
+        if (attr->type != RKNN_TENSOR_UINT8 || attr->fmt != RKNN_TENSOR_NHWC || mem->size < attr->size_with_stride) {
+            return -1;
+        }
+        c.input_mem = mem;
+        c.input_attr = *attr;
+        return RKNN_SUCC;
+    }
+    if (attr->index >= 3 || attr->fmt != RKNN_TENSOR_NC1HWC2 || mem->size < attr->size_with_stride) {
+        return -1;
+    }
+    c.output_mems[attr->index] = mem;
+    return RKNN_SUCC;
+}
+
+int main() {
+    const char* path = "/tmp/test_yolov5model.rknn";
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return 1;
+    }
+    fputs("stub rknn model", file);
+    fclose(file);
+
+    bool ok = true;
+    {
+        Yolov5Model copy_model;
+        Yolov5Model zero_copy_model;
+        ModelOptions options;
+        options.zero_copy = true;
+        options.allocator = std::make_shared<DmaAllocator>("");
+        zero_copy_model.configure(options);
+        ok = copy_model.loadmodel(path) && zero_copy_model.loadmodel(path);
+        ModelPtr derived = zero_copy_model.share();
+        ok = ok && derived;
+
+        // 不同亮度与非均匀图像：目标网格取决于输入内容，行距或排布处理错误时两种模式的结果不同
+        std::vector<cv::Mat> images;
+        images.push_back(cv::Mat(48, 80, CV_8UC3, cv::Scalar(10, 10, 10)));
+        images.push_back(cv::Mat(48, 80, CV_8UC3, cv::Scalar(37, 40, 43)));
+        cv::Mat gradient(120, 90, CV_8UC3);
+        for (int y = 0; y < gradient.rows; ++y) {
+            gradient.row(y).setTo(cv::Scalar(y, 2 * y % 256, 63));
+        }
+        images.push_back(gradient);
+
+        for (size_t i = 0; ok && i < images.size(); ++i) {
+            cv::Mat a = images[i].clone(), b = images[i].clone(), c = images[i].clone();
+            Detections expected, actual, shared;
+            const int sets_before = g_inputs_set, gets_before = g_outputs_get;
+            ok = copy_model.run(a, expected);
+            const int copy_calls = g_inputs_set - sets_before + g_outputs_get - gets_before;
+            ok = ok && zero_copy_model.run(b, actual) && derived->run(c, shared);
+            const int zero_copy_calls = g_inputs_set - sets_before + g_outputs_get - gets_before - copy_calls;
+
+            bool same = expected.size() == 1 && actual.size() == 1 && shared.size() == 1
+                        && expected[0].class_id == 17 && expected[0].label && strcmp(expected[0].label, "horse") == 0
+                        && expected[0].box == actual[0].box && expected[0].box == shared[0].box
+                        && expected[0].class_id == actual[0].class_id && expected[0].score == actual[0].score;
+            // 推理不在输入图像上画框
+            const size_t bytes = images[i].total() * images[i].elemSize();
+            same = same && memcmp(a.data, images[i].data, bytes) == 0 && memcmp(b.data, images[i].data, bytes) == 0
+                   && memcmp(c.data, images[i].data, bytes) == 0;
+            printf("image %zu: copy %zu dets (io calls %d), zero-copy %zu dets (io calls %d)%s\n",
+                   i, expected.size(), copy_calls, actual.size(), zero_copy_calls, same ? "" : "  MISMATCH");
+            if (!expected.empty()) {
+                printf("  box (%d,%d %dx%d) class %d score %.3f\n", expected[0].box.x, expected[0].box.y,
+                       expected[0].box.width, expected[0].box.height, expected[0].class_id, expected[0].score);
+            }
+            ok = ok && same && copy_calls == 2 && zero_copy_calls == 0;
+        }
+    }
+    // 模型析构后绑定的内存全部释放
+    printf("tensor mems alive after release: %d\n", g_mems);
+    ok = ok && g_mems == 0;
+    remove(path);
+
+    std::cout << "ok: " << ok << std::endl;
+    return ok ? 0 : 1;
+}
+#endif
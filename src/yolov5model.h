@@ -2,11 +2,16 @@
 #define YOLOV5MODEL_H
 
 #include "Model.h"
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <opencv2/opencv.hpp>
 #include <vector>
 #include "postprocess.h"
 #include "rknn_api.h"
+#include "YuyvLetterbox.h"
+#include "MappedFile.h"
+#include "DmaAllocator.h"
 
 
 class Yolov5Model: public Model
@@ -16,23 +21,130 @@ public:
     ~Yolov5Model();
 
     bool loadmodel(const char *model_path) override;
-    bool run(cv::Mat &img) override;
+    ModelPtr share() override;
+    ModelMemory memory() const override;
+    bool run(const cv::Mat &img, Detections& detections) override;
+    bool run_yuyv(const AVFrame* raw, const cv::Mat& display, Detections& detections) override;
+    bool supports_yuyv_input() const override { return true; }
+    int run_batch(const std::vector<BatchItem*>& items) override;
+    int max_batch() const override { return batch_; }
+    void configure(const ModelOptions& options) override;
+    int async_depth() const override { return async_ ? 2 : 0; }
+    bool submit(BatchItem* item) override;
+    BatchItem* collect() override;
     std::string get_name() const override {
         return "YOLOV5";
     }
 
 private:
+    /**
+     * @brief 上下文初始化后查询输入输出属性，确定输入尺寸、batch与异步缓冲区
+     * @param verbose 是否打印张量属性（派生实例不重复打印）
+     */
+    bool query_model(bool verbose);
+
+    // 一次推理中一帧的输出映射：模型输入坐标到结果图像坐标的变换
+    struct OutputSlot {
+        cv::Mat image;                    // 结果坐标所在的图像（只读），为空时该位置不取结果（填充位或准备失败）
+        float scale_w = 1.0f;             // 模型输入到image坐标的缩放系数
+        float scale_h = 1.0f;
+        int pad_x = 0;                    // 模型输入中letterbox填充的像素数
+        int pad_y = 0;
+        Detections* detections = nullptr; // 检测结果输出位置
+    };
+
+    /**
+     * @brief 零拷贝模式：按原生属性创建（或由dma-heap缓冲区导入）输入输出内存并绑定到上下文
+     * @param verbose 是否打印原生张量属性
+     * @return 成功返回true；失败时已创建的内存被释放，调用方退回拷贝模式
+     */
+    bool setup_zero_copy(bool verbose);
+
+    /**
+     * @brief 释放零拷贝输入输出内存
+     */
+    void release_zero_copy();
+
+    /**
+     * @brief 设置输入、执行推理，按各位置的映射做后处理并画出检测结果
+     * @param input 模型输入数据（batch x height x width x channel）
+     * @param fmt 输入数据排布
+     * @param slots 各batch位置的输出映射（不多于batch_）
+     */
+    bool infer(void* input, rknn_tensor_format fmt, std::vector<OutputSlot>& slots);
+
+    /**
+     * @brief 零拷贝模式下执行推理：输入已由fill_slot()写入绑定的输入内存，输出在绑定的输出内存中原地后处理
+     * @param slots 各batch位置的输出映射（不多于batch_）
+     */
+    bool infer_zero_copy(std::vector<OutputSlot>& slots);
+
+    /**
+     * @brief 将一帧缩放（YUYV输入时letterbox）到模型输入的一个batch位置
+     * @param item 输入帧
+     * @param dst 该位置的模型输入（height x width x channel，NHWC，行距input_stride_）
+     * @param slot 输出该帧的坐标映射
+     */
+    bool fill_slot(const BatchItem& item, uint8_t* dst, OutputSlot& slot);
+
+    /**
+     * @brief 对一帧的输出做后处理，检测结果写入slot.detections
+     * @param out 各输出张量在该帧的起始地址
+     * @param slot 该帧的坐标映射
+     */
+    void decode_outputs(int8_t* const* out, OutputSlot& slot);
+
+    // 异步模式的一个缓冲槽：一帧从submit()到collect()期间独占
+    struct AsyncSlot {
+        std::vector<uint8_t> input;                // 模型输入（NHWC）
+        std::vector<std::vector<int8_t>> outputs;  // 预分配的各层输出
+        OutputSlot output;                         // 坐标映射与结果位置
+        BatchItem* item = nullptr;
+        uint64_t frame_id = 0;                     // rknn_run返回的帧号
+        bool failed = false;                       // 预处理或启动推理失败
+    };
+
+    /**
+     * @brief 设置槽的输入并非阻塞启动推理
+     */
+    void start_slot(int index);
+
+    /**
+     * @brief 异步模式下流水线处理多帧：submit()与collect()交替，使预处理、推理、后处理重叠
+     * @return 推理成功的帧数
+     */
+    int run_async(const std::vector<BatchItem*>& items);
+
     bool ready_;
     rknn_context ctx;
+    MappedFilePtr model_file_;         // 模型文件映射，与派生实例共用
+    bool shared_weight_ = false;       // 上下文由share()派生，权重与源上下文共用
+    std::mutex share_mutex_;           // 串行化对本上下文的rknn_dup_context
     int model_len;
     int channel;
     int width;
     int height;
     float nms_threshold;
     float box_conf_threshold; 
+    int batch_;                        // 模型batch维，批量编译的模型大于1
+    bool async_;                       // 异步执行（RKNN_FLAG_ASYNC_MASK + rknn_wait）
+    bool zero_copy_;                   // 零拷贝输入输出（rknn_create_mem + rknn_set_io_mem）
+    std::shared_ptr<DmaAllocator> allocator_;  // 零拷贝输入内存的分配器，可为空
+    DmaBuffer input_dma_;              // 由分配器分配并导入NPU的输入缓冲区
+    rknn_tensor_mem* input_mem_;       // 绑定的输入内存（整批）
+    std::vector<rknn_tensor_mem*> output_mems_;  // 绑定的输出内存（原生排布）
+    int input_stride_;                 // 模型输入的行距（字节），零拷贝时按原生属性的w_stride
+    std::vector<tensor_layout_t> output_layouts_;  // 各输出层的排布，供后处理按原生排布原地读取
+    post_process_ctx_t post_ctx_;      // 后处理上下文（检测头、解码函数、各输出的反量化表），加载时建立
+    AsyncSlot async_slots_[2];         // 双缓冲槽
+    std::deque<int> async_order_;      // 在途槽按提交顺序排列
+    int async_running_;                // 正在NPU上运行的槽，-1表示空闲
     rknn_input_output_num io_num;
     std::vector<rknn_tensor_attr> input_atts;
     std::vector<rknn_tensor_attr> output_atts;
+
+    YuyvLetterbox letterbox_;          // YUYV直接生成模型输入
+    std::vector<uint8_t> input_buf_;   // letterbox后的模型输入（复用，避免每帧分配），批量模型为整批
 };
 
 #endif
\ No newline at end of file